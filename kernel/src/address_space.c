@@ -0,0 +1,174 @@
+// address_space.c
+#include "address_space.h"
+#include "memory_manager.h"
+#include "paging.h"
+#include "klibc.h"
+#include "graphics.h"
+#include "config.h"
+#include "rbtree.h"
+#include "percpu.h"
+#include "apic.h"
+#include "idt.h"
+#include "preempt.h"
+#include "cpu.h"
+#include "shm.h"
+
+// Quá số trang này thì nạp lại CR3 thay vì invlpg từng trang
+#define TLB_FLUSH_MAX_PAGES 32
+
+// Số trang gỡ trước mỗi lần xóa TLB trong address_space_unmap
+#define UNMAP_BATCH 32
+
+// Yêu cầu xóa TLB đang gửi đi; shootdown_lock cho phép mỗi lúc một yêu cầu
+static spinlock_t shootdown_lock = SPINLOCK_INIT;
+static address_space_t *volatile shootdown_mm;
+static uint64_t shootdown_start;
+static uint64_t shootdown_len;
+static volatile uint32_t shootdown_pending;
+
+static void tlb_flush_local(uint64_t start, uint64_t len) {
+    if (len / PAGE_SIZE > TLB_FLUSH_MAX_PAGES) {
+        uint64_t cr3;
+        __asm__ volatile("mov %%cr3, %0; mov %0, %%cr3" : "=r"(cr3) : : "memory");
+        return;
+    }
+    for (uint64_t addr = start & ~(uint64_t)(PAGE_SIZE - 1); addr < start + len; addr += PAGE_SIZE) {
+        __asm__ volatile("invlpg (%0)" : : "r"(addr) : "memory");
+    }
+}
+
+// CPU đã rời không gian địa chỉ trước khi IPI tới thì không còn gì để xóa, nhưng vẫn phải báo xong
+static trap_frame_t *tlb_shootdown_interrupt(trap_frame_t *frame) {
+    if (this_cpu()->active_mm == shootdown_mm) {
+        tlb_flush_local(shootdown_start, shootdown_len);
+    }
+    __atomic_fetch_sub(&shootdown_pending, 1, __ATOMIC_RELEASE);
+    lapic_eoi();
+    return frame;
+}
+
+void address_space_init() {
+    irq_register_handler(TLB_SHOOTDOWN_VECTOR, tlb_shootdown_interrupt);
+}
+
+/**
+ * Flushes a range of @p as from every TLB that may cache it.
+ *
+ * Targets are CPUs whose active_mm is @p as, read without locks: a CPU that
+ * loads the page table after the scan starts with a clean TLB anyway, and
+ * one that leaves it before the IPI arrives just acknowledges. The caller
+ * waits with interrupts enabled, so two CPUs shooting at each other both
+ * make progress.
+ */
+void address_space_flush_tlb(address_space_t *as, uint64_t start, uint64_t len) {
+    spin_lock(&shootdown_lock);
+    cpu_t *self = this_cpu();
+    if (self->active_mm == as) {
+        tlb_flush_local(start, len);
+    }
+
+    shootdown_mm = as;
+    shootdown_start = start;
+    shootdown_len = len;
+    uint32_t targets = 0;
+    uint64_t mask = 0;
+    for (uint32_t i = 0; i < cpu_count; i++) {
+        if (&cpus[i] != self && cpus[i].online && __atomic_load_n(&cpus[i].active_mm, __ATOMIC_RELAXED) == as) {
+            mask |= 1ULL << i;
+            targets++;
+        }
+    }
+    __atomic_store_n(&shootdown_pending, targets, __ATOMIC_RELEASE);
+    for (uint32_t i = 0; i < cpu_count; i++) {
+        if (mask & (1ULL << i)) {
+            lapic_send_ipi(cpus[i].lapic_id, TLB_SHOOTDOWN_VECTOR);
+        }
+    }
+    while (__atomic_load_n(&shootdown_pending, __ATOMIC_ACQUIRE)) {
+        cpu_relax();
+    }
+    shootdown_mm = NULL;
+    spin_unlock(&shootdown_lock);
+}
+
+/**
+ * Unmaps every page that starts in [@p start, @p end).
+ *
+ * Pages are removed in batches; each batch is flushed from every CPU that
+ * runs the address space before its frames go back to the allocator, so no
+ * thread can keep writing into a frame that someone else already owns.
+ * Without @p free_frames the frames belong to someone else (a shared-memory
+ * object) and are only unmapped.
+ *
+ * @return The number of bytes unmapped.
+ */
+uint64_t address_space_unmap(address_space_t *as, uint64_t start, uint64_t end, bool free_frames) {
+    uint64_t frames[UNMAP_BATCH];
+    uint64_t sizes[UNMAP_BATCH];
+    uint64_t bytes = 0;
+    uint64_t addr = start;
+    while (addr < end) {
+        uint64_t batch_start = addr;
+        uint32_t n = 0;
+        while (addr < end && n < UNMAP_BATCH) {
+            uint64_t size;
+            uint64_t phys = paging_unmap(as->page_table, addr, &size);
+            if (!phys) {
+                addr += PAGE_SIZE;
+                continue;
+            }
+            frames[n] = phys;
+            sizes[n++] = size;
+            addr += size;
+        }
+        address_space_flush_tlb(as, batch_start, addr - batch_start);
+        for (uint32_t i = 0; i < n; i++) {
+            if (free_frames) {
+                free_physical_blocks(frames[i], sizes[i] / BLOCK_SIZE);
+            }
+            bytes += sizes[i];
+        }
+    }
+    return bytes;
+}
+
+address_space_t *address_space_create() {
+    uint64_t phys = allocate_memory_bytes(sizeof(address_space_t));
+    if (!phys) {
+        kprintf("Address space: Failed to allocate memory\n");
+        return NULL;
+    }
+    address_space_t *as = (address_space_t *)PHYS_TO_VIRT(phys);
+    memset(as, 0, sizeof(address_space_t));
+
+    as->page_table = (uint64_t)create_user_page_table();
+    if (!as->page_table) {
+        free_memory_bytes(phys, sizeof(address_space_t));
+        return NULL;
+    }
+    as->refcount = 1;
+    spin_init_named(&as->lock, "address_space");
+    mutex_init(&as->brk_lock);
+    as->pkey_bitmap = 1; // Key 0 luôn được cấp phát
+    return as;
+}
+
+static void address_space_free(rcu_head_t *head) {
+    address_space_t *as = container_of(head, address_space_t, rcu);
+    shm_release(as);
+    free_user_page_table(as->page_table);
+    free_memory_bytes((uint64_t)VIRT_TO_PHYS(as), sizeof(address_space_t));
+}
+
+/**
+ * Drops a reference to @p as.
+ *
+ * The last reference can be dropped by the scheduler while it switches away
+ * from the page table, with the run queue locked, so the teardown is left
+ * to an RCU callback rather than done here.
+ */
+void address_space_put(address_space_t *as) {
+    if (__atomic_sub_fetch(&as->refcount, 1, __ATOMIC_ACQ_REL) == 0) {
+        call_rcu(&as->rcu, address_space_free);
+    }
+}
@@ -0,0 +1,54 @@
+// address_space.h
+#ifndef ADDRESS_SPACE_H
+#define ADDRESS_SPACE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "spinlock.h"
+#include "mutex.h"
+#include "rcu.h"
+
+// Không gian địa chỉ user: dùng chung bởi mọi luồng của một tiến trình.
+// Mỗi luồng giữ một tham chiếu, và mỗi CPU đang nạp page table của nó (kể cả
+// idle và luồng kernel mượn page table) cũng giữ một tham chiếu qua cpu->active_mm.
+typedef struct address_space {
+    uint64_t page_table;          // Địa chỉ vật lý của PML4
+    volatile uint32_t refcount;
+    volatile uint32_t users;      // Số luồng user; về 0 khi tiến trình kết thúc hẳn
+    mutex_t brk_lock;             // Tuần tự hóa sbrk/brk và việc gỡ trang user, bảo vệ ba trường heap (khóa ngủ)
+    uint64_t brk_start;           // Đầu heap (sau segment ELF cao nhất), 0 nếu tiến trình không có heap
+    uint64_t brk;                 // Program break hiện tại
+    uint64_t brk_mapped;          // Cuối phần heap đã ánh xạ, brk <= brk_mapped
+    spinlock_t lock;              // Bảo vệ các trường bên dưới
+    uint16_t pkey_bitmap;         // Các protection key đã cấp phát (bit 0 = key mặc định)
+    struct uring *uring;          // Vòng gửi/nhận của tiến trình, NULL nếu chưa tạo
+    struct shm_mapping *shm_maps; // Các dải đang ánh xạ trong vùng SHM
+    uint64_t shm_next;            // Địa chỉ trống tiếp theo trong vùng SHM, 0 nếu chưa dùng
+    struct shm_message *inbox;    // Các lần chuyển trang chưa được page_recv lấy, theo thứ tự gửi
+    struct shm_waiter *inbox_waiters;
+    rcu_head_t rcu;               // Giải phóng sau grace period
+} address_space_t;
+
+// Tạo không gian địa chỉ mới với nửa kernel dùng chung, refcount = 1. NULL nếu hết bộ nhớ
+address_space_t *address_space_create();
+
+static inline void address_space_get(address_space_t *as) {
+    __atomic_fetch_add(&as->refcount, 1, __ATOMIC_RELAXED);
+}
+
+// Đăng ký handler IPI xóa TLB (gọi một lần trên BSP)
+void address_space_init();
+
+// Xóa TLB của dải [start, start + len) trên mọi CPU đang nạp page table của as, kể cả
+// CPU hiện tại; chờ các CPU khác xong mới trả về. Gọi khi ngắt đang bật, sau khi sửa PTE
+void address_space_flush_tlb(address_space_t *as, uint64_t start, uint64_t len);
+
+// Gỡ mọi trang bắt đầu trong [start, end) và xóa TLB, rồi trả frame về allocator nếu
+// free_frames. Trả về số byte đã gỡ. Gọi khi ngắt đang bật
+uint64_t address_space_unmap(address_space_t *as, uint64_t start, uint64_t end, bool free_frames);
+
+// Bỏ một tham chiếu; tham chiếu cuối giải phóng page table và mọi trang user
+// sau grace period (an toàn trong ngắt và khi giữ khóa hàng đợi)
+void address_space_put(address_space_t *as);
+
+#endif // ADDRESS_SPACE_H
@@ -0,0 +1,90 @@
+// apic.c
+#include "apic.h"
+#include "cpu.h"
+#include "io.h"
+#include "idt.h"
+#include "paging.h"
+#include "graphics.h"
+#include "config.h"
+
+#define PIC1_COMMAND 0x20
+#define PIC1_DATA    0x21
+#define PIC2_COMMAND 0xA0
+#define PIC2_DATA    0xA1
+
+static volatile uint32_t *lapic_base = NULL;
+
+/**
+ * Remaps the legacy 8259 PICs to vectors 0x20-0x2F and masks every line.
+ *
+ * The PICs are unused once the Local APIC delivers interrupts, but they can
+ * still raise spurious IRQ7/IRQ15, so they are moved off the exception
+ * vectors first.
+ */
+void pic_disable() {
+    outb(PIC1_COMMAND, 0x11);
+    outb(PIC2_COMMAND, 0x11);
+    outb(PIC1_DATA, PIC_VECTOR_BASE);
+    outb(PIC2_DATA, PIC_VECTOR_BASE + 8);
+    outb(PIC1_DATA, 0x04);
+    outb(PIC2_DATA, 0x02);
+    outb(PIC1_DATA, 0x01);
+    outb(PIC2_DATA, 0x01);
+
+    outb(PIC1_DATA, 0xFF);
+    outb(PIC2_DATA, 0xFF);
+}
+
+uint32_t lapic_read(uint32_t reg) {
+    return lapic_base[reg / 4];
+}
+
+void lapic_write(uint32_t reg, uint32_t value) {
+    lapic_base[reg / 4] = value;
+}
+
+void lapic_eoi() {
+    lapic_write(LAPIC_REG_EOI, 0);
+}
+
+uint32_t lapic_id() {
+    return lapic_read(LAPIC_REG_ID) >> 24;
+}
+
+/**
+ * Sends a fixed-delivery IPI and waits until the Local APIC has accepted it.
+ *
+ * Writing the low half of the ICR triggers the send, so the destination in
+ * the high half must be written first.
+ */
+void lapic_send_ipi(uint32_t apic_id, uint8_t vector) {
+    lapic_write(LAPIC_REG_ICR_HIGH, apic_id << 24);
+    lapic_write(LAPIC_REG_ICR_LOW, LAPIC_ICR_ASSERT | vector);
+    while (lapic_read(LAPIC_REG_ICR_LOW) & LAPIC_ICR_PENDING) {
+        cpu_relax();
+    }
+}
+
+/**
+ * Enables the Local APIC of the calling CPU in xAPIC mode.
+ *
+ * The register page is mapped uncached into the HHDM the first time, since
+ * Limine only maps RAM there. The spurious vector is set to SPURIOUS_VECTOR
+ * and the timer starts masked.
+ */
+void lapic_init() {
+    uint64_t base = rdmsr(IA32_APIC_BASE_MSR);
+    uint64_t phys = base & 0xFFFFFFFFFF000ULL;
+
+    if (!lapic_base) {
+        if (!paging_map_kernel_mmio(phys, PAGE_SIZE)) {
+            kprintf("APIC: Failed to map Local APIC registers\n");
+            return;
+        }
+        lapic_base = (volatile uint32_t *)PHYS_TO_VIRT(phys);
+    }
+
+    wrmsr(IA32_APIC_BASE_MSR, base | IA32_APIC_BASE_ENABLE);
+    lapic_write(LAPIC_REG_LVT_TIMER, LAPIC_LVT_MASKED);
+    lapic_write(LAPIC_REG_SVR, LAPIC_SVR_ENABLE | SPURIOUS_VECTOR);
+}
@@ -0,0 +1,51 @@
+// apic.h
+#ifndef APIC_H
+#define APIC_H
+
+#include <stdint.h>
+
+#define IA32_APIC_BASE_MSR   0x1B
+#define IA32_APIC_BASE_ENABLE (1ULL << 11)
+
+// Các thanh ghi của Local APIC (offset MMIO)
+#define LAPIC_REG_ID            0x020
+#define LAPIC_REG_EOI           0x0B0
+#define LAPIC_REG_SVR           0x0F0
+#define LAPIC_REG_ICR_LOW       0x300
+#define LAPIC_REG_ICR_HIGH      0x310
+#define LAPIC_REG_LVT_TIMER     0x320
+#define LAPIC_REG_TIMER_INITIAL 0x380
+#define LAPIC_REG_TIMER_CURRENT 0x390
+#define LAPIC_REG_TIMER_DIVIDE  0x3E0
+
+#define LAPIC_SVR_ENABLE        0x100
+#define LAPIC_LVT_MASKED        (1u << 16)
+#define LAPIC_TIMER_ONESHOT     (0u << 17)
+#define LAPIC_TIMER_PERIODIC    (1u << 17)
+#define LAPIC_TIMER_TSC_DEADLINE (2u << 17)
+#define LAPIC_TIMER_DIVIDE_16   0x3
+#define LAPIC_ICR_PENDING       (1u << 12)
+#define LAPIC_ICR_ASSERT        (1u << 14)
+
+// Vị trí của 8259 PIC sau khi remap (chỉ để bắt ngắt giả)
+#define PIC_VECTOR_BASE 0x20
+
+// Remap và che toàn bộ IRQ của 8259 PIC
+void pic_disable();
+
+// Bật Local APIC trên CPU hiện tại
+void lapic_init();
+
+uint32_t lapic_read(uint32_t reg);
+void lapic_write(uint32_t reg, uint32_t value);
+
+// Báo kết thúc ngắt cho Local APIC
+void lapic_eoi();
+
+// ID của Local APIC hiện tại
+uint32_t lapic_id();
+
+// Gửi ngắt liên CPU (fixed delivery) tới CPU có Local APIC ID cho trước
+void lapic_send_ipi(uint32_t apic_id, uint8_t vector);
+
+#endif // APIC_H
@@ -17,10 +17,97 @@
 
 #define PAGE_SIZE 4096
 
+// Trang lớn (mục PD có bit PS)
+#define LARGE_PAGE_SIZE 0x200000
+
+// Địa chỉ ảo cuối cùng (không bao gồm) của không gian người dùng
+#define USER_SPACE_END 0x0000800000000000ULL
+
+// Kích thước kernel stack của mỗi tiến trình (4 khối)
+#define KERNEL_STACK_SIZE (4 * BLOCK_SIZE)
+
+// Tần số ngắt timer của scheduler
+#define TIMER_HZ 250
+
+// CPU rảnh tắt tick định kỳ và chỉ hẹn giờ cho sự kiện kế tiếp, nhưng thức dậy
+// ít nhất mỗi TIMER_IDLE_MAX_MS mili giây để cân bằng tải
+#define TIMER_NOHZ_IDLE     1
+#define TIMER_IDLE_MAX_MS   1000
+
+// Lập lịch công bằng: chu kỳ mục tiêu để mọi tiến trình sẵn sàng được chạy một lần,
+// thời gian chạy tối thiểu trước khi bị chiếm quyền, và ngưỡng chiếm quyền khi thức dậy (mili giây)
+#define SCHED_LATENCY_MS             20
+#define SCHED_MIN_GRANULARITY_MS     4
+#define SCHED_WAKEUP_GRANULARITY_MS  2
+
+// Lập lịch deadline: phần trăm CPU tối đa dành cho tiến trình deadline trên mỗi CPU,
+// phần còn lại luôn để cho lớp công bằng
+#define SCHED_DL_BW_PCT              95
+
+// Cân bằng tải giữa các CPU: chu kỳ (mili giây), ngưỡng chênh lệch tải (phần trăm),
+// và thời gian sau khi chạy mà tiến trình còn được coi là "nóng" trong cache (micro giây)
+#define SCHED_BALANCE_INTERVAL_MS    8
+#define SCHED_IMBALANCE_PCT          125
+#define SCHED_MIGRATION_COST_US      500
+
+// Softirq chạy lúc thoát ngắt tối đa SOFTIRQ_MAX_RESTART vòng hoặc SOFTIRQ_MAX_US micro giây,
+// phần còn lại được giao cho ksoftirqd để không bỏ đói tiến trình
+#define SOFTIRQ_MAX_RESTART          10
+#define SOFTIRQ_MAX_US               2000
+
+// Bảng băm hàng đợi futex có 2^FUTEX_HASH_BITS bucket
+#define FUTEX_HASH_BITS              8
+
+// Vòng gửi/nhận: số SQE tối đa của một vòng, số thao tác TIMEOUT đang chờ tối đa của một
+// vòng, và thời gian luồng SQPOLL quay vòng chờ yêu cầu mới trước khi ngủ (micro giây)
+#define URING_MAX_ENTRIES            256
+#define URING_MAX_TIMEOUTS           64
+#define URING_SQPOLL_IDLE_US         1000
+
+// Bộ đệm console của stdout/stderr (byte), số byte tối đa lấy khỏi bộ đệm cho một lần vẽ,
+// và số ký tự tối đa được vẽ trong một lần giữ khóa console (giữa hai lần có điểm chiếm quyền)
+#define CONSOLE_BUFFER_SIZE          65536
+#define CONSOLE_FLUSH_BATCH          4096
+#define CONSOLE_DRAW_CHUNK           32
+
+// Heap của tiến trình (sbrk/brk): phần đã ánh xạ lớn lên theo từng khối HEAP_CHUNK_SIZE byte
+// (cấp phát và xóa sẵn, không có lỗi trang), tối đa HEAP_MAX_SIZE byte. Với HEAP_LARGE_PAGES,
+// heap vượt qua một mốc 2 MiB được ánh xạ bằng trang 2 MiB từ mốc đó
+#define HEAP_CHUNK_SIZE              (64 * 1024)
+#define HEAP_MAX_SIZE                (1ULL << 30)
+#define HEAP_LARGE_PAGES             1
+
+// Bộ nhớ chia sẻ: số trang tối đa của một đối tượng có tên, và của một lần page_send
+#define SHM_MAX_PAGES                4096
+#define PAGE_SEND_MAX_PAGES          512
+
+// Virtio: thời gian tối đa chờ thiết bị trả lại một chuỗi descriptor, và chu kỳ driver balloon
+// đọc kích thước host yêu cầu và báo cáo trang trống (mili giây)
+#define VIRTQ_TIMEOUT_MS             1000
+#define VIRTIO_BALLOON_POLL_MS       1000
+
+// Đếm số lần lấy khóa, tranh chấp và thời gian giữ khóa cho mọi khóa có tên (tốn thêm rdtsc mỗi lần khóa)
+#ifndef LOCK_STATS
+#define LOCK_STATS 0
+#endif
+
+// Ghi lại đoạn tắt ngắt và tắt chiếm quyền dài nhất trên mỗi CPU (tốn thêm rdtsc mỗi lần)
+#ifndef LATENCY_TRACE
+#define LATENCY_TRACE 0
+#endif
+
 // Các hằng số cờ phân trang
 #define PAGING_PAGE_PRESENT    0x1
 #define PAGING_PAGE_RW         0x2
 #define PAGING_PAGE_USER       0x4
+// Bit 9 dành cho phần mềm: frame được dùng chung (vDSO, bộ nhớ chia sẻ), không thuộc riêng
+// page table này nên không bị giải phóng cùng nó
+#define PAGING_PAGE_SHARED     0x200
+
+// Protection key nằm ở bit 59-62 của PTE lá
+#define PAGING_PAGE_PKEY_SHIFT 59
+#define PAGING_PAGE_PKEY_MASK  (0xFULL << PAGING_PAGE_PKEY_SHIFT)
+#define PAGING_PAGE_PKEY(k)    (((uint64_t)(k) & 0xF) << PAGING_PAGE_PKEY_SHIFT)
 
 // Hằng số phân quyền cụ thể
 #define PERMISSION_READ        0x1
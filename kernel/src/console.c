@@ -0,0 +1,168 @@
+// console.c
+#include "console.h"
+#include "graphics.h"
+#include "spinlock.h"
+#include "workqueue.h"
+#include "preempt.h"
+#include "klibc.h"
+#include "config.h"
+#include "usercopy.h"
+
+// Bộ đệm vòng; head/tail tăng mãi, vị trí = chỉ số % CONSOLE_BUFFER_SIZE
+static char console_buffer[CONSOLE_BUFFER_SIZE];
+static uint64_t console_head;
+static uint64_t console_tail;
+static spinlock_t console_buffer_lock = SPINLOCK_INIT;
+
+// Chỉ một người vẽ mỗi lúc, để các loạt ra màn hình đúng thứ tự; bảo vệ console_batch.
+// Là cờ chứ không phải spinlock: người vẽ giữ nó trong lúc bị chiếm quyền giữa các đoạn
+static volatile bool console_flushing;
+static char console_batch[CONSOLE_FLUSH_BATCH];
+
+// Dữ liệu user được chép ra bộ đệm tạm trên stack theo từng đoạn này, không giữ khóa
+#define CONSOLE_COPY_CHUNK 256
+
+static work_t console_flush_work;
+static volatile bool console_ready;
+
+static uint64_t console_nr_bytes;
+static uint64_t console_nr_batches;
+static uint64_t console_nr_sync_flushes;
+
+static void console_flush_fn(work_t *work) {
+    (void)work;
+    console_flush();
+}
+
+void console_init() {
+    spin_init_named(&console_buffer_lock, "console_buffer");
+    work_init(&console_flush_work, console_flush_fn);
+    __atomic_store_n(&console_ready, true, __ATOMIC_RELEASE);
+}
+
+// Lấy tối đa CONSOLE_FLUSH_BATCH byte đầu bộ đệm vào console_batch (giữ console_flushing)
+static size_t console_take_batch() {
+    uint64_t flags = spin_lock_irqsave(&console_buffer_lock);
+    size_t len = console_tail - console_head;
+    if (len > CONSOLE_FLUSH_BATCH) {
+        len = CONSOLE_FLUSH_BATCH;
+    }
+    size_t start = console_head % CONSOLE_BUFFER_SIZE;
+    size_t first = len < CONSOLE_BUFFER_SIZE - start ? len : CONSOLE_BUFFER_SIZE - start;
+    memcpy(console_batch, console_buffer + start, first);
+    memcpy(console_batch + first, console_buffer, len - first);
+    console_head += len;
+    spin_unlock_irqrestore(&console_buffer_lock, flags);
+    return len;
+}
+
+/**
+ * Renders everything buffered so far, one batch at a time.
+ *
+ * A batch is taken and drawn while holding console_flushing, so batches
+ * reach the screen in order even when the worker and a writer with a full
+ * buffer flush at the same time. console_write() draws the glyphs of the
+ * batch in short chunks and stays preemptible between them, which is why console_flushing
+ * is a flag and not a spinlock; a second flusher waits for it with
+ * cond_resched().
+ */
+void console_flush() {
+    for (;;) {
+        while (__atomic_exchange_n(&console_flushing, true, __ATOMIC_ACQUIRE)) {
+            cond_resched();
+            cpu_relax();
+        }
+        size_t len = console_take_batch();
+        if (len) {
+            console_write(console_batch, len);
+            __atomic_fetch_add(&console_nr_batches, 1, __ATOMIC_RELAXED);
+        }
+        __atomic_store_n(&console_flushing, false, __ATOMIC_RELEASE);
+        if (!len) {
+            return;
+        }
+        cond_resched();
+    }
+}
+
+/**
+ * Appends @p len bytes to the buffer, rendering the backlog whenever the
+ * buffer fills up.
+ *
+ * With @p user set, @p buf is a user address. It is read CONSOLE_COPY_CHUNK
+ * bytes at a time into a bounce buffer with no lock held, so a fault is
+ * handled in process context, and the buffer lock is only taken for the
+ * memcpy into the ring. A chunk that faults is dropped whole, so no partial
+ * data reaches the screen.
+ *
+ * @return The number of bytes appended, or -EFAULT if the first chunk
+ * already faulted.
+ */
+static int64_t console_append(const char *buf, size_t len, bool user) {
+    char bounce[CONSOLE_COPY_CHUNK];
+    size_t done = 0;
+    while (done < len) {
+        const char *src = buf + done;
+        size_t n = len - done;
+        if (user) {
+            n = n < sizeof(bounce) ? n : sizeof(bounce);
+            if (copy_from_user(bounce, src, n)) {
+                return done ? (int64_t)done : -EFAULT;
+            }
+            src = bounce;
+        }
+
+        size_t copied = 0;
+        while (copied < n) {
+            uint64_t flags = spin_lock_irqsave(&console_buffer_lock);
+            size_t room = CONSOLE_BUFFER_SIZE - (console_tail - console_head);
+            size_t m = n - copied < room ? n - copied : room;
+            size_t start = console_tail % CONSOLE_BUFFER_SIZE;
+            size_t first = m < CONSOLE_BUFFER_SIZE - start ? m : CONSOLE_BUFFER_SIZE - start;
+            memcpy(console_buffer + start, src + copied, first);
+            memcpy(console_buffer, src + copied + first, m - first);
+            console_tail += m;
+            spin_unlock_irqrestore(&console_buffer_lock, flags);
+
+            copied += m;
+            __atomic_fetch_add(&console_nr_bytes, m, __ATOMIC_RELAXED);
+            if (m) {
+                queue_work(system_wq, &console_flush_work);
+            }
+            // Bộ đệm đầy: tự vẽ thay vì chờ worker, người ghi nhanh bị chậm lại theo tốc độ màn hình
+            if (copied < n) {
+                __atomic_fetch_add(&console_nr_sync_flushes, 1, __ATOMIC_RELAXED);
+                console_flush();
+            }
+        }
+        done += n;
+    }
+    return (int64_t)done;
+}
+
+void console_buffer_write(const char *buf, size_t len) {
+    if (!__atomic_load_n(&console_ready, __ATOMIC_ACQUIRE)) {
+        console_write(buf, len);
+        return;
+    }
+    console_append(buf, len, false);
+}
+
+int64_t console_buffer_write_user(const char *ubuf, size_t len) {
+    if (!__atomic_load_n(&console_ready, __ATOMIC_ACQUIRE)) {
+        return -EFAULT;
+    }
+    return console_append(ubuf, len, true);
+}
+
+size_t console_pending() {
+    uint64_t flags = spin_lock_irqsave(&console_buffer_lock);
+    size_t len = console_tail - console_head;
+    spin_unlock_irqrestore(&console_buffer_lock, flags);
+    return len;
+}
+
+void console_dump() {
+    kprintf("Console: %llu bytes buffered, %llu batches drawn, %llu synchronous flushes\n",
+            console_nr_bytes, console_nr_batches, console_nr_sync_flushes);
+}
@@ -0,0 +1,31 @@
+// console.h
+#ifndef CONSOLE_H
+#define CONSOLE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Bộ đệm console cho stdout/stderr của tiến trình user: write chỉ chép dữ liệu vào bộ đệm
+// vòng, một worker lấy từng loạt lớn và vẽ ra màn hình bằng console_write. Khi bộ đệm đầy,
+// người ghi tự vẽ phần đang chờ để không mất dữ liệu
+
+// Chuẩn bị việc vẽ nền (gọi sau workqueue_init); trước đó console_buffer_write vẽ ngay
+void console_init();
+
+// Chép len byte vào bộ đệm và hẹn worker vẽ
+void console_buffer_write(const char *buf, size_t len);
+
+// Như trên với buf là địa chỉ user, chép bằng copy_from_user (gọi sau console_init).
+// Trả về số byte đã nhận, hoặc -EFAULT nếu không đọc được byte nào
+int64_t console_buffer_write_user(const char *ubuf, size_t len);
+
+// Vẽ ngay mọi thứ đang chờ trong bộ đệm (theo thứ tự, không xen với worker)
+void console_flush();
+
+// Số byte đang chờ vẽ
+size_t console_pending();
+
+// In số byte đã ghi, số loạt đã vẽ và số lần người ghi phải tự vẽ vì bộ đệm đầy
+void console_dump();
+
+#endif // CONSOLE_H
@@ -4,13 +4,19 @@
 
 #include "process.h"
 
-// Hàm lưu ngữ cảnh của tiến trình hiện tại
-void save_context(process_t *proc);
+// Đổi kernel stack và tập thanh ghi callee-saved từ prev sang next (context_switch.S).
+// Trả về khi prev được chuyển tới lần sau
+void switch_context(cpu_context_t *prev, cpu_context_t *next);
 
-// Hàm tải ngữ cảnh của tiến trình tiếp theo
-void load_context(process_t *proc);
+// Khôi phục trap frame tại RSP và trở về (isr.S); là entry của tiến trình user mới
+void trap_restore(void);
 
-// Hàm chuyển đổi sang user space
-void switch_to_user_space(uint64_t entry_point, uint64_t stack_pointer, uint64_t page_table_phys);
+// Dựng ngữ cảnh mới: lần đầu được chuyển tới, nó chạy entry trên stack cho trước
+// (RSP = stack, như vừa được call) sau khi scheduler hoàn tất việc chuyển
+void context_init(cpu_context_t *ctx, uint64_t stack, void (*entry)(void));
+
+// Lưu/khôi phục PKRU của tiến trình khi chuyển ngữ cảnh (không làm gì nếu không có PKU)
+void context_save_pkru(process_t *proc);
+void context_restore_pkru(process_t *proc);
 
 #endif // CONTEXT_SWITCHER_H
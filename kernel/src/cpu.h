@@ -0,0 +1,87 @@
+// cpu.h
+#ifndef CPU_H
+#define CPU_H
+
+#include <stdint.h>
+
+// Các bit của CR4
+#define CR4_OSFXSR     (1ULL << 9)
+#define CR4_OSXMMEXCPT (1ULL << 10)
+#define CR4_PKE        (1ULL << 22)
+
+// Các MSR dùng cho syscall/sysret
+#define IA32_EFER_MSR  0xC0000080
+#define IA32_STAR_MSR  0xC0000081
+#define IA32_LSTAR_MSR 0xC0000082   // Địa chỉ điểm vào của lệnh syscall
+#define IA32_FMASK_MSR 0xC0000084   // Các bit RFLAGS bị xóa khi vào bằng lệnh syscall
+#define EFER_SCE       (1ULL << 0)
+
+// Các bit RFLAGS
+#define RFLAGS_TF (1ULL << 8)
+#define RFLAGS_IF (1ULL << 9)
+#define RFLAGS_DF (1ULL << 10)
+#define RFLAGS_AC (1ULL << 18)
+
+// Thời điểm TSC mà LAPIC timer ở chế độ TSC-deadline sẽ phát ngắt (ghi 0 để hủy)
+#define IA32_TSC_DEADLINE_MSR   0x6E0
+
+// Các bit tính năng trong CPUID.1:ECX
+#define CPUID_1_ECX_MONITOR      (1u << 3)
+#define CPUID_1_ECX_TSC_DEADLINE (1u << 24)
+
+// Base của GS: vùng dữ liệu per-CPU khi ở kernel, swapgs đổi với KERNEL_GS_BASE
+#define IA32_FS_BASE_MSR        0xC0000100
+#define IA32_GS_BASE_MSR        0xC0000101
+#define IA32_KERNEL_GS_BASE_MSR 0xC0000102
+
+static inline void cpuid(uint32_t leaf, uint32_t subleaf, uint32_t *eax, uint32_t *ebx, uint32_t *ecx, uint32_t *edx) {
+    asm volatile("cpuid"
+                 : "=a"(*eax), "=b"(*ebx), "=c"(*ecx), "=d"(*edx)
+                 : "a"(leaf), "c"(subleaf));
+}
+
+// Địa chỉ gây ra lỗi trang gần nhất
+static inline uint64_t read_cr2(void) {
+    uint64_t cr2;
+    asm volatile("mov %%cr2, %0" : "=r"(cr2));
+    return cr2;
+}
+
+static inline uint64_t read_cr4(void) {
+    uint64_t cr4;
+    asm volatile("mov %%cr4, %0" : "=r"(cr4));
+    return cr4;
+}
+
+static inline void write_cr4(uint64_t cr4) {
+    asm volatile("mov %0, %%cr4" : : "r"(cr4) : "memory");
+}
+
+static inline uint64_t rdmsr(uint32_t msr) {
+    uint32_t low, high;
+    asm volatile("rdmsr" : "=a"(low), "=d"(high) : "c"(msr));
+    return ((uint64_t)high << 32) | low;
+}
+
+static inline void wrmsr(uint32_t msr, uint64_t value) {
+    asm volatile("wrmsr" : : "c"(msr), "a"((uint32_t)value), "d"((uint32_t)(value >> 32)));
+}
+
+static inline uint64_t rdtsc(void) {
+    uint32_t low, high;
+    asm volatile("rdtsc" : "=a"(low), "=d"(high));
+    return ((uint64_t)high << 32) | low;
+}
+
+// Đọc/ghi thanh ghi PKRU (chỉ hợp lệ khi CR4.PKE = 1)
+static inline uint32_t rdpkru(void) {
+    uint32_t pkru, edx;
+    asm volatile("rdpkru" : "=a"(pkru), "=d"(edx) : "c"(0));
+    return pkru;
+}
+
+static inline void wrpkru(uint32_t pkru) {
+    asm volatile("wrpkru" : : "a"(pkru), "c"(0), "d"(0) : "memory");
+}
+
+#endif // CPU_H
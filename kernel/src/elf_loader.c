@@ -7,6 +7,7 @@
 
 #include "bitmap_allocator.h"
 #include "config.h"
+#include "preempt.h"
 
 // Cấu trúc ELF header cho 64-bit
 typedef struct {
@@ -41,7 +42,7 @@ typedef struct {
 // Định nghĩa các loại segment
 #define PT_LOAD 1
 
-uint64_t elf_load(uint64_t page_table_phys, uint8_t *elf_start, uint8_t *elf_end) {
+uint64_t elf_load(uint64_t page_table_phys, uint8_t *elf_start, uint8_t *elf_end, uint64_t *image_end) {
     Elf64_Ehdr *ehdr = (Elf64_Ehdr*)elf_start;
 
     // Kiểm tra magic number
@@ -56,6 +57,8 @@ uint64_t elf_load(uint64_t page_table_phys, uint8_t *elf_start, uint8_t *elf_end
     // Lấy program headers
     Elf64_Phdr *phdr = (Elf64_Phdr*)(elf_start + ehdr->e_phoff);
 
+    *image_end = 0;
+
     // Lặp qua các program headers
     for (int i = 0; i < ehdr->e_phnum; i++) {
         if (phdr[i].p_type == PT_LOAD) {
@@ -63,6 +66,9 @@ uint64_t elf_load(uint64_t page_table_phys, uint8_t *elf_start, uint8_t *elf_end
             uint64_t memsz = phdr[i].p_memsz;
             uint64_t filesz = phdr[i].p_filesz;
             uint64_t offset = phdr[i].p_offset;
+            if (vaddr + memsz > *image_end) {
+                *image_end = vaddr + memsz;
+            }
 
             // Cấp phát trang bộ nhớ cho segment
             uint64_t phys_addr = allocate_memory_bytes(memsz);
@@ -81,9 +87,16 @@ uint64_t elf_load(uint64_t page_table_phys, uint8_t *elf_start, uint8_t *elf_end
             // Sao chép dữ liệu từ ELF vào bộ nhớ
             memcpy(PHYS_TO_VIRT(phys_addr), elf_start + offset, filesz);
 
-            // Nếu p_memsz > p_filesz, cần zero phần còn lại
-            if (memsz > filesz) {
-                memset(PHYS_TO_VIRT(phys_addr + filesz), 0, memsz - filesz);
+            // Nếu p_memsz > p_filesz, cần zero phần còn lại, từng trang một
+            // với điểm chiếm quyền giữa các trang để .bss lớn không giữ CPU quá lâu
+            for (uint64_t off = filesz; off < memsz; ) {
+                uint64_t chunk = PAGE_SIZE - (off % PAGE_SIZE);
+                if (chunk > memsz - off) {
+                    chunk = memsz - off;
+                }
+                memset(PHYS_TO_VIRT(phys_addr + off), 0, chunk);
+                off += chunk;
+                cond_resched();
             }
 
             // Cập nhật entry point nếu cần
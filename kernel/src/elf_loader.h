@@ -5,7 +5,8 @@
 #include <stdint.h>
 #include <stdbool.h>
 
-// Hàm tải ELF vào không gian địa chỉ của tiến trình
-uint64_t elf_load(uint64_t page_table_phys, uint8_t *elf_start, uint8_t *elf_end);
+// Hàm tải ELF vào không gian địa chỉ của tiến trình. Trả về entry point, và địa chỉ cuối
+// của segment cao nhất qua image_end (chỗ bắt đầu heap)
+uint64_t elf_load(uint64_t page_table_phys, uint8_t *elf_start, uint8_t *elf_end, uint64_t *image_end);
 
 #endif // ELF_LOADER_H
@@ -0,0 +1,347 @@
+// futex.c
+#include "futex.h"
+#include "scheduler.h"
+#include "paging.h"
+#include "spinlock.h"
+#include "percpu.h"
+#include "timer.h"
+#include "config.h"
+#include "graphics.h"
+#include "usercopy.h"
+
+typedef struct futex_bucket futex_bucket_t;
+
+// Một luồng đang chờ; nằm trên kernel stack của luồng đó trong suốt futex_wait
+typedef struct futex_waiter {
+    struct futex_waiter *next;
+    struct futex_waiter *prev;
+    uint64_t key;                       // Địa chỉ vật lý của từ futex
+    futex_bucket_t *volatile bucket;    // Bucket đang chứa waiter, NULL khi đã được đánh thức
+    process_t *task;
+    struct futex_waiter *timeout_next;  // Danh sách hết giờ của CPU timeout_cpu, sắp theo expires
+    uint64_t expires;
+    uint32_t timeout_cpu;
+    bool timeout_queued;
+    volatile bool timed_out;
+} futex_waiter_t;
+
+struct futex_bucket {
+    spinlock_t lock;                    // Bảo vệ danh sách và trường bucket/key của waiter trong đó
+    futex_waiter_t *head;
+    futex_waiter_t *tail;
+};
+
+// Waiter có hẹn giờ của một CPU; chỉ CPU đó thêm vào và xử lý hết giờ, waiter tự gỡ khi thức
+typedef struct {
+    spinlock_t lock;
+    futex_waiter_t *head;
+} futex_timeouts_t;
+
+static futex_bucket_t futex_table[1 << FUTEX_HASH_BITS];
+static futex_timeouts_t futex_timeouts[MAX_CPUS];
+
+static uint64_t futex_nr_waits;
+static uint64_t futex_nr_wakes;
+static uint64_t futex_nr_timeouts;
+
+void futex_init() {
+    for (uint32_t i = 0; i < (1 << FUTEX_HASH_BITS); i++) {
+        spin_init_named(&futex_table[i].lock, "futex");
+    }
+    for (uint32_t i = 0; i < MAX_CPUS; i++) {
+        spin_init_named(&futex_timeouts[i].lock, "futex_timeout");
+    }
+}
+
+// Khóa futex là địa chỉ vật lý của uaddr. Trả về 0, -EINVAL nếu uaddr lệch (hoặc không có mm),
+// -EFAULT nếu uaddr chưa được ánh xạ
+static int futex_key(address_space_t *mm, uint64_t uaddr, uint64_t *key) {
+    if (!mm || (uaddr & 3)) {
+        return -EINVAL;
+    }
+    *key = paging_user_phys(mm->page_table, uaddr);
+    return *key ? 0 : -EFAULT;
+}
+
+static futex_bucket_t *futex_bucket(uint64_t key) {
+    return &futex_table[(key * 0x9E3779B97F4A7C15ULL) >> (64 - FUTEX_HASH_BITS)];
+}
+
+static void futex_queue(futex_bucket_t *b, futex_waiter_t *w) {
+    w->next = NULL;
+    w->prev = b->tail;
+    if (b->tail) {
+        b->tail->next = w;
+    } else {
+        b->head = w;
+    }
+    b->tail = w;
+    __atomic_store_n(&w->bucket, b, __ATOMIC_RELEASE);
+}
+
+static void futex_unqueue(futex_bucket_t *b, futex_waiter_t *w) {
+    if (w->prev) {
+        w->prev->next = w->next;
+    } else {
+        b->head = w->next;
+    }
+    if (w->next) {
+        w->next->prev = w->prev;
+    } else {
+        b->tail = w->prev;
+    }
+}
+
+// Gỡ w khỏi bucket và đánh thức luồng của nó; sau khi bucket = NULL, w có thể biến mất bất cứ lúc nào
+static void futex_wake_waiter(futex_bucket_t *b, futex_waiter_t *w) {
+    process_t *task = w->task;
+    futex_unqueue(b, w);
+    __atomic_store_n(&w->bucket, NULL, __ATOMIC_RELEASE);
+    sched_wakeup(task);
+    __atomic_fetch_add(&futex_nr_wakes, 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * Locks the bucket that currently holds @p w.
+ *
+ * futex_requeue can move a waiter to another bucket between reading
+ * w->bucket and taking its lock, so the pointer is checked again under the
+ * lock.
+ *
+ * @return The locked bucket, or NULL if @p w has been woken.
+ */
+static futex_bucket_t *futex_lock_waiter(futex_waiter_t *w, uint64_t *flags) {
+    for (;;) {
+        futex_bucket_t *b = __atomic_load_n(&w->bucket, __ATOMIC_ACQUIRE);
+        if (!b) {
+            return NULL;
+        }
+        *flags = spin_lock_irqsave(&b->lock);
+        if (w->bucket == b) {
+            return b;
+        }
+        spin_unlock_irqrestore(&b->lock, *flags);
+    }
+}
+
+// Hẹn giờ trên CPU hiện tại
+static void futex_timeout_arm(futex_waiter_t *w, uint64_t expires) {
+    uint64_t flags = irq_save();
+    uint32_t cpu = this_cpu()->id;
+    futex_timeouts_t *t = &futex_timeouts[cpu];
+    spin_lock(&t->lock);
+    w->expires = expires;
+    w->timeout_cpu = cpu;
+    futex_waiter_t **link = &t->head;
+    while (*link && (*link)->expires <= expires) {
+        link = &(*link)->timeout_next;
+    }
+    w->timeout_next = *link;
+    *link = w;
+    w->timeout_queued = true;
+    spin_unlock(&t->lock);
+    irq_restore(flags);
+}
+
+// Gỡ hẹn giờ nếu chưa hết; khi trả về, ngắt timer không còn chạm vào w
+static void futex_timeout_cancel(futex_waiter_t *w) {
+    futex_timeouts_t *t = &futex_timeouts[w->timeout_cpu];
+    uint64_t flags = spin_lock_irqsave(&t->lock);
+    if (w->timeout_queued) {
+        futex_waiter_t **link = &t->head;
+        while (*link != w) {
+            link = &(*link)->timeout_next;
+        }
+        *link = w->timeout_next;
+        w->timeout_queued = false;
+    }
+    spin_unlock_irqrestore(&t->lock, flags);
+}
+
+void futex_timeout_tick(uint64_t now) {
+    futex_timeouts_t *t = &futex_timeouts[this_cpu()->id];
+    if (!__atomic_load_n(&t->head, __ATOMIC_RELAXED)) {
+        return;
+    }
+    spin_lock(&t->lock);
+    while (t->head && t->head->expires <= now) {
+        futex_waiter_t *w = t->head;
+        t->head = w->timeout_next;
+        w->timeout_queued = false;
+        // Cặp với rào chắn trong futex_wait: hoặc luồng thấy timed_out, hoặc sched_wakeup thấy nó BLOCKED
+        __atomic_store_n(&w->timed_out, true, __ATOMIC_SEQ_CST);
+        sched_wakeup(w->task);
+    }
+    spin_unlock(&t->lock);
+}
+
+uint64_t futex_next_expiry(void) {
+    futex_timeouts_t *t = &futex_timeouts[this_cpu()->id];
+    if (!__atomic_load_n(&t->head, __ATOMIC_RELAXED)) {
+        return UINT64_MAX;
+    }
+    uint64_t flags = spin_lock_irqsave(&t->lock);
+    uint64_t expires = t->head ? t->head->expires : UINT64_MAX;
+    spin_unlock_irqrestore(&t->lock, flags);
+    return expires;
+}
+
+/**
+ * Sleeps on the futex word at @p uaddr while it still holds @p val.
+ *
+ * The word is read with the bucket locked. A waker changes the word before
+ * calling futex_wake, which needs the same lock, so either this thread sees
+ * the new value or it is already queued when the waker looks.
+ *
+ * The thread marks itself BLOCKED with the bucket locked and then calls
+ * schedule(); a wakeup in between just puts it back to RUNNING. Wakeups
+ * that find the waiter still queued (a late timeout, a stale
+ * sched_wakeup) are treated as spurious and the thread sleeps again.
+ *
+ * @return 0 when woken by futex_wake or futex_requeue, -EINVAL for a
+ * misaligned address or a caller without an address space or task, -EFAULT
+ * for an unmapped address, -EAGAIN if the word no longer holds @p val, or
+ * -ETIMEDOUT if @p timeout_ns elapsed first.
+ */
+int futex_wait(address_space_t *mm, uint64_t uaddr, uint32_t val, uint64_t timeout_ns) {
+    process_t *self = process_current();
+    uint64_t key;
+    int err = futex_key(mm, uaddr, &key);
+    if (err) {
+        return err;
+    }
+    if (!self) {
+        return -EINVAL;
+    }
+    futex_waiter_t w = {.key = key, .task = self};
+    // Hẹn giờ trước khi chặn: bị chiếm quyền lúc đã BLOCKED thì chỉ còn hẹn giờ đánh thức được
+    if (timeout_ns) {
+        futex_timeout_arm(&w, timer_now_ns() + timeout_ns);
+    }
+
+    futex_bucket_t *b = futex_bucket(key);
+    uint64_t flags = spin_lock_irqsave(&b->lock);
+    if (__atomic_load_n((volatile uint32_t *)PHYS_TO_VIRT(key), __ATOMIC_ACQUIRE) != val) {
+        spin_unlock_irqrestore(&b->lock, flags);
+        if (timeout_ns) {
+            futex_timeout_cancel(&w);
+        }
+        return -EAGAIN;
+    }
+    futex_queue(b, &w);
+    self->state = PROCESS_STATE_BLOCKED;
+    spin_unlock_irqrestore(&b->lock, flags);
+    __atomic_fetch_add(&futex_nr_waits, 1, __ATOMIC_RELAXED);
+
+    bool woken;
+    for (;;) {
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        if (__atomic_load_n(&w.timed_out, __ATOMIC_RELAXED)) {
+            self->state = PROCESS_STATE_RUNNING;
+        } else {
+            schedule();
+        }
+        b = futex_lock_waiter(&w, &flags);
+        if (!b) {
+            woken = true;
+            break;
+        }
+        if (w.timed_out) {
+            futex_unqueue(b, &w);
+            spin_unlock_irqrestore(&b->lock, flags);
+            __atomic_fetch_add(&futex_nr_timeouts, 1, __ATOMIC_RELAXED);
+            woken = false;
+            break;
+        }
+        self->state = PROCESS_STATE_BLOCKED;
+        spin_unlock_irqrestore(&b->lock, flags);
+    }
+    if (timeout_ns) {
+        futex_timeout_cancel(&w);
+    }
+    return woken ? 0 : -ETIMEDOUT;
+}
+
+int futex_wake(address_space_t *mm, uint64_t uaddr, uint32_t nr) {
+    uint64_t key;
+    int err = futex_key(mm, uaddr, &key);
+    if (err) {
+        return err;
+    }
+    futex_bucket_t *b = futex_bucket(key);
+    int woken = 0;
+    uint64_t flags = spin_lock_irqsave(&b->lock);
+    futex_waiter_t *w = b->head;
+    while (w && (uint32_t)woken < nr) {
+        futex_waiter_t *next = w->next;
+        if (w->key == key) {
+            futex_wake_waiter(b, w);
+            woken++;
+        }
+        w = next;
+    }
+    spin_unlock_irqrestore(&b->lock, flags);
+    return woken;
+}
+
+/**
+ * Wakes up to @p nr_wake waiters of @p uaddr and moves up to @p nr_requeue
+ * of the rest to @p uaddr2 without waking them, so that releasing a
+ * condition variable wakes one thread instead of the whole herd fighting
+ * for the mutex.
+ *
+ * Both buckets are locked, in address order so that two opposite requeues
+ * cannot deadlock.
+ */
+int futex_requeue(address_space_t *mm, uint64_t uaddr, uint64_t uaddr2, uint32_t nr_wake, uint32_t nr_requeue) {
+    uint64_t key, key2;
+    int err = futex_key(mm, uaddr, &key);
+    if (!err) {
+        err = futex_key(mm, uaddr2, &key2);
+    }
+    if (err) {
+        return err;
+    }
+    // Chuyển sang chính nó không làm gì
+    if (key == key2) {
+        return futex_wake(mm, uaddr, nr_wake);
+    }
+    futex_bucket_t *b = futex_bucket(key);
+    futex_bucket_t *b2 = futex_bucket(key2);
+    uint64_t flags = irq_save();
+    spin_lock(b < b2 ? &b->lock : &b2->lock);
+    if (b != b2) {
+        spin_lock(b < b2 ? &b2->lock : &b->lock);
+    }
+
+    uint32_t woken = 0;
+    uint32_t requeued = 0;
+    futex_waiter_t *w = b->head;
+    while (w && (woken < nr_wake || requeued < nr_requeue)) {
+        // Waiter vừa chuyển sang cùng bucket nằm ở cuối danh sách, nhưng key của nó đã khác nên bị bỏ qua
+        futex_waiter_t *next = w->next;
+        if (w->key == key) {
+            if (woken < nr_wake) {
+                futex_wake_waiter(b, w);
+                woken++;
+            } else {
+                futex_unqueue(b, w);
+                w->key = key2;
+                futex_queue(b2, w);
+                requeued++;
+            }
+        }
+        w = next;
+    }
+
+    if (b != b2) {
+        spin_unlock(&b2->lock);
+    }
+    spin_unlock(&b->lock);
+    irq_restore(flags);
+    return (int)(woken + requeued);
+}
+
+void futex_dump() {
+    kprintf("Futex: %llu waits, %llu wakes, %llu timeouts\n", futex_nr_waits, futex_nr_wakes, futex_nr_timeouts);
+}
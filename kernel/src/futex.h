@@ -0,0 +1,39 @@
+// futex.h
+#ifndef FUTEX_H
+#define FUTEX_H
+
+#include <stdint.h>
+#include "address_space.h"
+
+// Futex: luồng user ngủ trên một từ 32 bit trong bộ nhớ của nó cho tới khi được đánh thức.
+// Hàng đợi được băm theo địa chỉ vật lý, nên hai tiến trình ánh xạ cùng một trang
+// (ở địa chỉ ảo khác nhau) vẫn gặp nhau trên cùng một futex. Địa chỉ uaddr (căn 4 byte)
+// được dịch qua page table của mm; luồng ngủ là luồng đang chạy
+
+// Ngủ nếu *uaddr vẫn bằng val, tối đa timeout_ns (0 = không giới hạn).
+// Trả về 0 khi được đánh thức, -EINVAL nếu uaddr lệch (hoặc không có mm/luồng hiện tại),
+// -EFAULT nếu uaddr chưa ánh xạ, -EAGAIN nếu giá trị đã khác, -ETIMEDOUT nếu hết giờ
+int futex_wait(address_space_t *mm, uint64_t uaddr, uint32_t val, uint64_t timeout_ns);
+
+// Đánh thức tối đa nr luồng đang chờ trên uaddr, trả về số luồng đã đánh thức, hoặc
+// -EINVAL/-EFAULT như futex_wait nếu uaddr lệch hoặc chưa ánh xạ
+int futex_wake(address_space_t *mm, uint64_t uaddr, uint32_t nr);
+
+// Đánh thức tối đa nr_wake luồng chờ trên uaddr, chuyển tối đa nr_requeue luồng còn lại
+// sang chờ trên uaddr2 mà không đánh thức. Trả về số luồng đã đánh thức và chuyển, hoặc
+// -EINVAL/-EFAULT nếu một trong hai địa chỉ lệch hoặc chưa ánh xạ
+int futex_requeue(address_space_t *mm, uint64_t uaddr, uint64_t uaddr2, uint32_t nr_wake, uint32_t nr_requeue);
+
+// Khởi tạo bảng băm và danh sách hết giờ (gọi một lần trên BSP)
+void futex_init();
+
+// Gọi từ ngắt timer: đánh thức các luồng chờ đã hết giờ của CPU hiện tại
+void futex_timeout_tick(uint64_t now);
+
+// Thời điểm hết giờ sớm nhất của CPU hiện tại (ns), UINT64_MAX nếu không có
+uint64_t futex_next_expiry(void);
+
+// In số lần chờ, đánh thức và hết giờ
+void futex_dump();
+
+#endif // FUTEX_H
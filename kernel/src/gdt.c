@@ -1,8 +1,9 @@
 #include "gdt.h"
 #include "stdint.h"
 #include "tss.h"
+#include "percpu.h"
 
-uint8_t gdt[sizeof(GDTEntry32) * 5 + sizeof(GDTEntry64)];
+uint8_t gdt[GDT_SIZE];
 GDTR gdt_ptr;
 
 // Function to set a GDT entry
@@ -29,32 +30,47 @@ void set_tss_descriptor(GDTEntry64 *entry, uint64_t base, uint32_t limit)
     entry->reserved = 0;
 }
 
-void init_gdt() {
+/**
+ * Fills @p table with the kernel/user segments and a TSS descriptor for
+ * @p t, loads it through @p ptr, reloads the segment registers and loads the
+ * task register.
+ */
+static void gdt_setup(uint8_t *table, GDTR *ptr, TSS *t) {
     // Pointers to the entries within the gdt array
-    GDTEntry32 *entries32 = (GDTEntry32 *)gdt;
-    GDTEntry64 *tss_entry = (GDTEntry64 *)(gdt + sizeof(GDTEntry32) * 5);
+    GDTEntry32 *entries32 = (GDTEntry32 *)table;
+    GDTEntry64 *tss_entry = (GDTEntry64 *)(table + sizeof(GDTEntry32) * 5);
 
     // Set up code and data segments
     set_gdt_entry(&entries32[0], 0, 0, 0, 0);          // Null segment
     set_gdt_entry(&entries32[1], 0, 0, 0x9A, 0x20);    // Kernel code segment
     set_gdt_entry(&entries32[2], 0, 0, 0x92, 0x00);    // Kernel data segment
-    set_gdt_entry(&entries32[3], 0, 0, 0xFA, 0x20);    // User code segment
-    set_gdt_entry(&entries32[4], 0, 0, 0xF2, 0x00);    // User data segment
+    set_gdt_entry(&entries32[3], 0, 0, 0xF2, 0x00);    // User data segment
+    set_gdt_entry(&entries32[4], 0, 0, 0xFA, 0x20);    // User code segment
 
-    // Initialize the TSS
-    init_tss();
-    set_tss_descriptor(tss_entry, (uint64_t)&tss, sizeof(TSS));
+    set_tss_descriptor(tss_entry, (uint64_t)t, sizeof(TSS));
 
     // Set up the GDTR
-    gdt_ptr.limit = sizeof(gdt) - 1;
-    gdt_ptr.base = (uint64_t)&gdt;
+    ptr->limit = GDT_SIZE - 1;
+    ptr->base = (uint64_t)table;
 
     // Load the GDT
-    setGdt(gdt_ptr.limit, gdt_ptr.base);
+    setGdt(ptr->limit, ptr->base);
 
     // Reload the segment registers
     reloadSegments();
 
     // Load the TSS (selector = index * 8, TSS is at index 5)
-    load_tss(0x28);
-}
\ No newline at end of file
+    load_tss(GDT_TSS);
+}
+
+void init_gdt() {
+    // Initialize the TSS
+    init_tss();
+    gdt_setup(gdt, &gdt_ptr, &tss);
+}
+
+void gdt_init_cpu(cpu_t *cpu) {
+    tss_setup(&cpu->tss_data, cpu->kernel_stack_top, cpu->ist1_stack_top);
+    cpu->tss = &cpu->tss_data;
+    gdt_setup(cpu->gdt, &cpu->gdt_ptr, cpu->tss);
+}
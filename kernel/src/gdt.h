@@ -36,6 +36,13 @@ typedef struct
     uint64_t base;
 } __attribute__((packed)) GDTR;
 
+// Các selector (user data đứng trước user code theo yêu cầu của sysretq)
+#define GDT_KERNEL_CODE 0x08
+#define GDT_KERNEL_DATA 0x10
+#define GDT_USER_DATA   0x1B    // Mục 3, RPL 3
+#define GDT_USER_CODE   0x23    // Mục 4, RPL 3
+#define GDT_TSS         0x28
+
 // Khai báo các biến toàn cục
 extern uint8_t gdt[];      // Mảng GDT
 extern GDTR gdt_ptr;       // GDTR
@@ -43,8 +50,16 @@ extern GDTR gdt_ptr;       // GDTR
 extern void setGdt(uint16_t limit, uint64_t base);
 extern void reloadSegments(void);
 
+// Kích thước một GDT: 5 mục 8 byte và mô tả TSS 16 byte
+#define GDT_SIZE (sizeof(GDTEntry32) * 5 + sizeof(GDTEntry64))
+
 void init_gdt();
 
+struct cpu;
+
+// Dựng và nạp GDT/TSS riêng của một CPU phụ (AP)
+void gdt_init_cpu(struct cpu *cpu);
+
 extern uint8_t gdt_entries[];
 
 #endif // GDT_H
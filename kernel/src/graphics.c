@@ -2,12 +2,21 @@
 #include "font.h"  // Để truy cập dữ liệu font như `roboto_glyphs`
 #include "limine.h"
 #include "klibc.h"
+#include "spinlock.h"
+#include "config.h"
 #include <stdarg.h>
 
 static graphics_context_t g_ctx;
 
+// Bảo vệ g_ctx và framebuffer; kprintf giữ khóa cho cả thông điệp để các CPU không in xen kẽ nhau
+static spinlock_t console_lock = SPINLOCK_INIT;
+
+// Tổng số dòng đã cuộn, để console_write biết văn bản nó vẽ dở đã bị đẩy lên bao nhiêu dòng
+static uint64_t console_scrolled;
+
 // Hàm khởi tạo graphics context
 void init_graphics(struct limine_framebuffer *fb) {
+    spin_init_named(&console_lock, "console");
     g_ctx.framebuffer = (uint32_t *)fb->address;
     g_ctx.pitch = fb->pitch;
     g_ctx.width = fb->width;
@@ -39,6 +48,22 @@ void draw_glyph(int x, int y, char c) {
     int glyph_x = x + glyph->x_offset;
     int glyph_y = y + glyph->y_offset + FONT_ASCENT;
 
+    // Glyph nằm trọn trong màn hình (trường hợp thường gặp): kiểm tra biên một lần cho cả glyph
+    if (glyph_x >= 0 && glyph_y >= 0 && (size_t)(glyph_x + glyph->width) <= g_ctx.width &&
+        (size_t)(glyph_y + glyph->height) <= g_ctx.height) {
+        uint32_t *line = g_ctx.framebuffer + glyph_y * (g_ctx.pitch / 4) + glyph_x;
+        for (int row = 0; row < glyph->height; row++) {
+            for (int col = 0; col < glyph->width; col++) {
+                if (data[col] > 128) {
+                    line[col] = g_ctx.text_color;
+                }
+            }
+            data += glyph->width;
+            line += g_ctx.pitch / 4;
+        }
+        return;
+    }
+
     for (int row = 0; row < glyph->height; row++) {
         for (int col = 0; col < glyph->width; col++) {
             uint8_t pixel = data[row * glyph->width + col];
@@ -112,22 +137,30 @@ void print_text(const char *text) {
 }
 
 void scroll_screen() {
-    // Tính số byte mỗi dòng
-    size_t row_size = g_ctx.pitch * g_ctx.line_height;
-
-    // Tính số byte cần di chuyển (từ dòng thứ hai đến dòng cuối)
-    size_t move_size = g_ctx.pitch * (g_ctx.height - g_ctx.line_height);
-
-    // Di chuyển vùng nhớ lên trên một dòng
-    memmove(
-        g_ctx.framebuffer,
-        (uint8_t *)g_ctx.framebuffer + row_size,
-        move_size
-    );
-
-    // Xóa dòng cuối cùng
-    size_t last_row_offset = g_ctx.pitch * (g_ctx.height - g_ctx.line_height) / 4;
-    for (size_t y = 0; y < (size_t)g_ctx.line_height; y++) {
+    scroll_screen_lines(1);
+}
+
+void scroll_screen_lines(int lines) {
+    console_scrolled += lines;
+    // Số dòng pixel bị đẩy ra khỏi màn hình; cuộn quá cả màn hình thì chỉ cần xóa hết
+    size_t rows = (size_t)lines * g_ctx.line_height;
+    if (rows > g_ctx.height) {
+        rows = g_ctx.height;
+    }
+
+    // Di chuyển phần còn lại lên trên một lần
+    size_t move_size = g_ctx.pitch * (g_ctx.height - rows);
+    if (move_size) {
+        memmove(
+            g_ctx.framebuffer,
+            (uint8_t *)g_ctx.framebuffer + g_ctx.pitch * rows,
+            move_size
+        );
+    }
+
+    // Xóa các dòng cuối
+    size_t last_row_offset = g_ctx.pitch * (g_ctx.height - rows) / 4;
+    for (size_t y = 0; y < rows; y++) {
         for (size_t x = 0; x < g_ctx.width; x++) {
             g_ctx.framebuffer[last_row_offset + y * (g_ctx.pitch / 4) + x] = g_ctx.background_color;
         }
@@ -169,7 +202,9 @@ void draw_cursor() {
 }
 
 void print(const char *text) {
+    uint64_t flags = spin_lock_irqsave(&console_lock);
     print_text(text);
+    spin_unlock_irqrestore(&console_lock, flags);
 }
 
 // Hàm chuyển đổi số nguyên có dấu thành chuỗi
@@ -233,6 +268,7 @@ void kprintf(const char *format, ...) {
     const char *fmt_ptr;
     va_list args;
     va_start(args, format);
+    uint64_t flags = spin_lock_irqsave(&console_lock);
 
     for (fmt_ptr = format; *fmt_ptr != '\0'; fmt_ptr++) {
         if (*fmt_ptr == '%') {
@@ -351,10 +387,25 @@ void kprintf(const char *format, ...) {
         }
     }
 
+    spin_unlock_irqrestore(&console_lock, flags);
     va_end(args);
 }
 
-void put_char(char c) {
+/**
+ * Reports a kernel bug that cannot be recovered from and halts this CPU.
+ *
+ * Like a fatal exception, the message is printed and the CPU stops with
+ * interrupts disabled, so a context violation is caught where it happens
+ * instead of turning into memory corruption later.
+ *
+ * @param msg Description of the violated invariant.
+ */
+void panic(const char *msg) {
+    kprintf("PANIC: %s\n", msg);
+    while (1) { __asm__ __volatile__("cli; hlt"); }
+}
+
+static void console_put_char(char c) {
     // Xử lý ký tự xuống dòng
     if (c == '\n') {
         g_ctx.cursor_x = 0;  // Đặt con trỏ ngang về đầu dòng
@@ -388,3 +439,83 @@ void put_char(char c) {
         }
     }
 }
+
+void put_char(char c) {
+    uint64_t flags = spin_lock_irqsave(&console_lock);
+    console_put_char(c);
+    spin_unlock_irqrestore(&console_lock, flags);
+}
+
+// Dời vị trí (x, row) qua ký tự c theo đúng quy tắc xuống dòng của console_put_char
+static void console_advance(int *x, int *row, char c) {
+    if (c == '\n') {
+        *x = 0;
+        (*row)++;
+        return;
+    }
+    if (c < 32 || c > 126) {
+        c = '?';
+    }
+    const glyph_t *glyph = &roboto_glyphs[c - 32];
+    *x += glyph->x_advance;
+    if ((size_t)(*x + glyph->width) > g_ctx.width) {
+        *x = 0;
+        (*row)++;
+    }
+}
+
+/**
+ * Writes @p len characters to the console with at most one scroll.
+ *
+ * The whole text is laid out first, under console_lock, to find the row the
+ * cursor ends on. The screen is scrolled once by the overflow and the cursor
+ * moved past the text, which reserves its area: a kprintf while the glyphs
+ * are still being drawn lands after it. Text that this scroll already pushed
+ * off the screen is skipped without drawing. The rest is drawn
+ * CONSOLE_DRAW_CHUNK glyphs per lock hold with cond_resched() in between, so
+ * interrupts are off for one layout and one scroll plus one short chunk at
+ * a time. Each chunk is shifted up by any scroll that happened since the
+ * layout, and glyphs that have gone off the top are not drawn.
+ */
+void console_write(const char *buf, size_t len) {
+    uint64_t flags = spin_lock_irqsave(&console_lock);
+    int last_row = g_ctx.max_rows - 1;
+    int start_x = g_ctx.cursor_x;
+    int start_row = g_ctx.cursor_y / g_ctx.line_height;
+
+    int x = start_x;
+    int row = start_row;
+    for (size_t i = 0; i < len; i++) {
+        console_advance(&x, &row, buf[i]);
+    }
+    int scroll = row > last_row ? row - last_row : 0;
+    if (scroll) {
+        scroll_screen_lines(scroll);
+    }
+    g_ctx.cursor_x = x;
+    g_ctx.cursor_y = (row - scroll) * g_ctx.line_height;
+    // Mốc cuộn mà các hàng row bên dưới được tính theo
+    uint64_t base = console_scrolled - scroll;
+    spin_unlock_irqrestore(&console_lock, flags);
+
+    x = start_x;
+    row = start_row;
+    size_t i = 0;
+    // Phần đã bị chính lần cuộn này đẩy ra khỏi màn hình: chỉ dời vị trí, không cần khóa
+    while (i < len && row < scroll) {
+        console_advance(&x, &row, buf[i++]);
+    }
+    while (i < len) {
+        size_t end = len - i < CONSOLE_DRAW_CHUNK ? len : i + CONSOLE_DRAW_CHUNK;
+        flags = spin_lock_irqsave(&console_lock);
+        uint64_t shift = console_scrolled - base;
+        for (; i < end; i++) {
+            if (buf[i] != '\n' && (uint64_t)row >= shift) {
+                draw_glyph(x, (int)((uint64_t)row - shift) * g_ctx.line_height, buf[i]);
+            }
+            console_advance(&x, &row, buf[i]);
+        }
+        spin_unlock_irqrestore(&console_lock, flags);
+        cond_resched();
+    }
+}
@@ -29,10 +29,17 @@ void draw_glyph(int x, int y, char c);
 void draw_text(int x, int y, const char *text);
 void print_text(const char *text);
 void scroll_screen();
+// Cuộn màn hình lên lines dòng chữ bằng một lần chép
+void scroll_screen_lines(int lines);
 void draw_cursor();
 void erase_cursor();
 void print(const char *text);
 void kprintf(const char *format, ...);
+// In thông báo lỗi không thể phục hồi rồi dừng CPU hiện tại vĩnh viễn
+void panic(const char *msg) __attribute__((noreturn));
 void put_char(char c);
+// Ghi len ký tự ra màn hình, cuộn màn hình nhiều nhất một lần; ký tự được vẽ theo từng đoạn
+// CONSOLE_DRAW_CHUNK ký tự, có điểm chiếm quyền giữa các đoạn
+void console_write(const char *buf, size_t len);
 
 #endif // GRAPHICS_H
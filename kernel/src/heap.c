@@ -0,0 +1,149 @@
+// heap.c
+#include "heap.h"
+#include "paging.h"
+#include "memory_manager.h"
+#include "klibc.h"
+#include "graphics.h"
+#include "config.h"
+
+#define ALIGN_UP(x, align) (((x) + ((align) - 1)) & ~((uint64_t)(align) - 1))
+
+static uint64_t heap_nr_pages;
+static uint64_t heap_nr_large_pages;
+static uint64_t heap_nr_freed_bytes;
+
+void heap_init(address_space_t *as, uint64_t image_end) {
+    uint64_t start = ALIGN_UP(image_end, PAGE_SIZE);
+    as->brk_start = start;
+    as->brk = start;
+    as->brk_mapped = start;
+}
+
+// Gỡ [start, end) của heap và trả các frame về allocator
+static void heap_unmap(address_space_t *as, uint64_t start, uint64_t end) {
+    uint64_t bytes = address_space_unmap(as, start, end, true);
+    __atomic_fetch_add(&heap_nr_freed_bytes, bytes, __ATOMIC_RELAXED);
+}
+
+/**
+ * Maps zeroed memory over [@p start, @p end), both page-aligned.
+ *
+ * With HEAP_LARGE_PAGES, every 2 MiB-aligned slice of the range gets a large
+ * page when an aligned run is free and the PD slot has no page table yet;
+ * otherwise it falls back to 4 KiB pages. On failure whatever was mapped
+ * is undone.
+ *
+ * @return false if memory ran out.
+ */
+static bool heap_map(address_space_t *as, uint64_t start, uint64_t end) {
+    uint64_t flags = PAGING_PAGE_PRESENT | PAGING_PAGE_RW | PAGING_PAGE_USER;
+    uint64_t addr = start;
+    while (addr < end) {
+#if HEAP_LARGE_PAGES
+        if (addr % LARGE_PAGE_SIZE == 0 && end - addr >= LARGE_PAGE_SIZE) {
+            uint64_t phys = allocate_large_page();
+            if (phys) {
+                memset(PHYS_TO_VIRT(phys), 0, LARGE_PAGE_SIZE);
+                if (paging_map_large(as->page_table, addr, phys, flags)) {
+                    __atomic_fetch_add(&heap_nr_large_pages, 1, __ATOMIC_RELAXED);
+                    addr += LARGE_PAGE_SIZE;
+                    continue;
+                }
+                free_physical_blocks(phys, LARGE_PAGE_SIZE / BLOCK_SIZE);
+            }
+        }
+#endif
+        uint64_t phys = allocate_physical_block();
+        if (!phys) {
+            break;
+        }
+        memset(PHYS_TO_VIRT(phys), 0, PAGE_SIZE);
+        if (!map_memory(as->page_table, addr, phys, PAGE_SIZE, flags)) {
+            free_physical_block(phys);
+            break;
+        }
+        __atomic_fetch_add(&heap_nr_pages, 1, __ATOMIC_RELAXED);
+        addr += PAGE_SIZE;
+    }
+    if (addr < end) {
+        heap_unmap(as, start, addr);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * Moves the break to @p new_brk, which the caller has range-checked.
+ *
+ * Growing past brk_mapped maps up to the next HEAP_CHUNK_SIZE boundary
+ * (counted from brk_start); with large pages, growth that crosses a 2 MiB
+ * boundary maps up to the following one, so that the slice above the
+ * boundary can be a single large page. Shrinking unmaps whole chunks above
+ * the new break, except a large page that still holds part of the heap.
+ * Memory between the break and brk_mapped keeps its contents.
+ */
+static bool heap_set_brk(address_space_t *as, uint64_t new_brk) {
+    uint64_t limit = as->brk_start + HEAP_MAX_SIZE;
+    uint64_t target = as->brk_start + ALIGN_UP(new_brk - as->brk_start, HEAP_CHUNK_SIZE);
+    if (new_brk > as->brk_mapped) {
+#if HEAP_LARGE_PAGES
+        if (ALIGN_UP(as->brk_mapped, LARGE_PAGE_SIZE) < target) {
+            target = ALIGN_UP(target, LARGE_PAGE_SIZE);
+        }
+#endif
+        if (target > limit) {
+            target = ALIGN_UP(new_brk, PAGE_SIZE);
+        }
+        if (!heap_map(as, as->brk_mapped, target)) {
+            return false;
+        }
+        as->brk_mapped = target;
+    } else if (target < as->brk_mapped) {
+        if (target % LARGE_PAGE_SIZE != 0 && paging_page_size(as->page_table, target) == LARGE_PAGE_SIZE) {
+            target = ALIGN_UP(target, LARGE_PAGE_SIZE);
+        }
+        if (target < as->brk_mapped) {
+            heap_unmap(as, target, as->brk_mapped);
+            as->brk_mapped = target;
+        }
+    }
+    as->brk = new_brk;
+    return true;
+}
+
+int64_t heap_sbrk(address_space_t *as, int64_t increment) {
+    if (!as || !as->brk_start) {
+        return -1;
+    }
+    mutex_lock(&as->brk_lock);
+    uint64_t old = as->brk;
+    bool ok;
+    if (increment < 0) {
+        uint64_t shrink = 0 - (uint64_t)increment;
+        ok = shrink <= old - as->brk_start && heap_set_brk(as, old - shrink);
+    } else if (increment > 0) {
+        ok = (uint64_t)increment <= as->brk_start + HEAP_MAX_SIZE - old && heap_set_brk(as, old + increment);
+    } else {
+        ok = true;
+    }
+    mutex_unlock(&as->brk_lock);
+    return ok ? (int64_t)old : -1;
+}
+
+uint64_t heap_brk(address_space_t *as, uint64_t addr) {
+    if (!as || !as->brk_start) {
+        return 0;
+    }
+    mutex_lock(&as->brk_lock);
+    if (addr >= as->brk_start && addr <= as->brk_start + HEAP_MAX_SIZE) {
+        heap_set_brk(as, addr);
+    }
+    uint64_t brk = as->brk;
+    mutex_unlock(&as->brk_lock);
+    return brk;
+}
+
+void heap_dump() {
+    kprintf("Heap: %llu pages and %llu large pages mapped, %llu KiB returned\n",
+            heap_nr_pages, heap_nr_large_pages, heap_nr_freed_bytes / 1024);
+}
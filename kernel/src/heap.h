@@ -0,0 +1,27 @@
+// heap.h
+#ifndef HEAP_H
+#define HEAP_H
+
+#include <stdint.h>
+#include "address_space.h"
+
+// Heap của tiến trình: vùng [brk_start, brk) ngay sau segment ELF cao nhất, do sbrk/brk
+// dời. Phần đã ánh xạ (tới brk_mapped) lớn lên theo từng khối HEAP_CHUNK_SIZE, được cấp
+// phát và xóa ngay, nên malloc không gây lỗi trang và phần lớn lần gọi sbrk không phải
+// ánh xạ gì. Thu nhỏ break trả các khối nằm hẳn trên break mới về allocator. brk_lock là khóa
+// ngủ, nên việc cấp phát, xóa trang và chờ TLB shootdown không tắt chiếm quyền
+
+// Đặt heap rỗng bắt đầu ở trang đầu tiên từ image_end (gọi khi tạo tiến trình)
+void heap_init(address_space_t *as, uint64_t image_end);
+
+// Dời break thêm increment byte (âm để thu nhỏ). Trả về break cũ, hoặc -1 nếu ra ngoài
+// [brk_start, brk_start + HEAP_MAX_SIZE], tiến trình không có heap hoặc hết bộ nhớ
+int64_t heap_sbrk(address_space_t *as, int64_t increment);
+
+// Như brk(2) của Linux: đặt break tại addr nếu được, trả về break hiện tại (addr = 0 chỉ đọc)
+uint64_t heap_brk(address_space_t *as, uint64_t addr);
+
+// In số trang 4 KiB, số trang 2 MiB đã ánh xạ cho heap và số byte đã trả lại
+void heap_dump();
+
+#endif // HEAP_H
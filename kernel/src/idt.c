@@ -1,8 +1,15 @@
 // idt.c
 #include "idt.h"
+#include "scheduler.h"
 #include "klibc.h"
 #include "graphics.h"
 #include "syscall_handler.h"
+#include "apic.h"
+#include "percpu.h"
+#include "rcu.h"
+#include "softirq.h"
+#include "usercopy.h"
+#include "cpu.h"
 
 idt_entry_t idt[IDT_SIZE];
 
@@ -89,6 +96,29 @@ void *isr_table[] = {
 
 extern void syscall_handler();
 
+// Được RCU bảo vệ: irq_handler_c đọc không khóa
+static irq_handler_t irq_handlers[IDT_SIZE];
+
+void irq_register_handler(uint8_t vector, irq_handler_t handler) {
+    rcu_assign_pointer(irq_handlers[vector], handler);
+}
+
+/**
+ * Removes the handler of @p vector.
+ *
+ * Returns only after every CPU that might still be running the old handler
+ * has left it, so the caller may then tear down whatever the handler uses.
+ */
+void irq_unregister_handler(uint8_t vector) {
+    rcu_assign_pointer(irq_handlers[vector], NULL);
+    synchronize_rcu();
+}
+
+// Ngắt giả từ 8259 PIC hoặc Local APIC: không gửi EOI
+static trap_frame_t *spurious_interrupt(trap_frame_t *frame) {
+    return frame;
+}
+
 void idt_init() {
     idtr.limit = (sizeof(idt_entry_t) * IDT_SIZE) - 1;
     idtr.base = (uint64_t)&idt;
@@ -102,21 +132,116 @@ void idt_init() {
     // Thiết lập IST cho double fault handler (vector 8)
     set_idt_gate(8, (uint64_t)isr_table[8], 0x08, 0x8E, 1);
 
+    // Các vector 32-255 đều có stub IRQ chung; vector syscall được ghi đè bên dưới
+    for (int i = IRQ_BASE_VECTOR; i < IDT_SIZE; i++) {
+        uint64_t stub = (uint64_t)irq_stub_table + (i - IRQ_BASE_VECTOR) * IRQ_STUB_SIZE;
+        set_idt_gate(i, stub, 0x08, 0x8E, 0);
+    }
+    for (int i = PIC_VECTOR_BASE; i < PIC_VECTOR_BASE + 16; i++) {
+        irq_register_handler(i, spurious_interrupt);
+    }
+    irq_register_handler(SPURIOUS_VECTOR, spurious_interrupt);
+
     set_idt_gate(SYSCALL_VECTOR, (uint64_t)syscall_handler, 0x08, 0xEE, 0);
 
-    __asm__ __volatile__ ("lidt %0" : : "m"(idtr));
+    idt_load();
     __asm__ __volatile__ ("sti");
 }
 
-void isr_handler_c(uint64_t vector_number, isr_stack_t *stack) {
+void idt_load() {
+    __asm__ __volatile__ ("lidt %0" : : "m"(idtr));
+}
+
+/**
+ * Common C entry for hardware interrupts (vectors 32-255).
+ *
+ * The handler registered for the vector is responsible for the EOI. The
+ * returned frame is the one the stub restores, so a handler may switch to
+ * another process by returning that process's saved frame. Handlers should
+ * only acknowledge the device and raise a softirq for the rest, which runs
+ * here once the outermost handler has returned.
+ *
+ * @param frame The register state saved by the stub.
+ * @return The frame to resume.
+ */
+trap_frame_t *irq_handler_c(trap_frame_t *frame) {
+    bool from_user = (frame->cs & 3) == 3;
+    this_cpu()->irq_count++;
+#if LATENCY_TRACE
+    // Cổng ngắt đã tắt ngắt: đo từ đây tới khi ngắt được bật lại
+    if (frame->rflags & 0x200) {
+        latency_irqs_off((void *)frame->rip);
+    }
+#endif
+    rcu_irq_enter();
+    this_cpu()->irq_depth++;
+    rcu_read_lock();
+    irq_handler_t handler = rcu_dereference(irq_handlers[frame->vector]);
+    if (!handler) {
+        kprintf("IRQ: Unhandled vector %d\n", (int)frame->vector);
+        lapic_eoi();
+    } else {
+        frame = handler(frame);
+    }
+    rcu_read_unlock();
+    // Phần việc mà handler đã dời sang softirq chạy ở đây, với ngắt bật
+    this_cpu()->irq_depth--;
+    softirq_irq_exit();
+    // Vùng đọc RCU luôn tắt chiếm quyền, nên ngắt cắt ngang user mode hoặc
+    // code kernel có preempt_count bằng 0 chứng tỏ CPU không ở trong vùng đọc nào
+    if (from_user || preempt_count() == 0) {
+        rcu_note_qs();
+    }
+    rcu_irq_exit();
+    sched_check_resched(frame);
+    latency_irqs_on();
+    return frame;
+}
+
+/**
+ * Common C entry for CPU exceptions (vectors 0-31).
+ *
+ * A page fault or general protection fault raised by kernel code at an
+ * instruction listed in the exception table (a user-memory copy) resumes at
+ * the fixup of that instruction, which makes the copy return an error.
+ * An exception raised in user mode, such as an access that PKRU denies,
+ * only ends the faulting thread. Anything else is fatal: the state is
+ * printed and the CPU halts.
+ *
+ * @param frame The register state saved by the stub; the stub restores it
+ * when this function returns.
+ */
+void isr_handler_c(trap_frame_t *frame) {
+    uint64_t vector_number = frame->vector;
+    if ((vector_number == 13 || vector_number == 14) && (frame->cs & 3) == 0 && exception_table_fixup(frame)) {
+        return;
+    }
+
+    // #DF chạy trên stack IST của CPU, luồng không thể rời CPU từ đó
+    if ((frame->cs & 3) == 3 && vector_number != 8) {
+        process_t *self = process_current();
+        kprintf("Exception: Vector %d in user mode, PID=%llu, RIP: %lx, Error Code: %lx\n", (int)vector_number,
+                self->pid, frame->rip, frame->error_code);
+        if (vector_number == 14) {
+            kprintf("CR2: %lx\n", read_cr2());
+        }
+        // Lỗi của code user chỉ kết thúc luồng gây lỗi; thoát như từ một syscall, với ngắt bật
+        __asm__ __volatile__("sti");
+        process_exit(-1);
+    }
+
     kprintf("Exception: Vector %d\n", (int)vector_number);
-    kprintf("RIP: %lx, CS: %lx, RFLAGS: %lx\n", stack->rip, stack->cs, stack->rflags);
+    kprintf("RIP: %lx, CS: %lx, RFLAGS: %lx\n", frame->rip, frame->cs, frame->rflags);
 
     // If there's an error code, print it
-    if (vector_number == 8 || (vector_number >= 10 && vector_number <= 14) || vector_number == 17 || vector_number == 30) {
-        kprintf("Error Code: %lx\n", stack->error_code);
+    if (vector_number == 8 || (vector_number >= 10 && vector_number <= 14) || vector_number == 17 ||
+        vector_number == 21 || vector_number == 30) {
+        kprintf("Error Code: %lx\n", frame->error_code);
+    }
+    if (vector_number == 14) {
+        kprintf("CR2: %lx\n", read_cr2());
     }
 
     // Halt the system or perform appropriate handling
-    while (1) { __asm__ __volatile__("hlt"); }
+    while (1) { __asm__ __volatile__("cli; hlt"); }
 }
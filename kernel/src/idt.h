@@ -17,18 +17,65 @@ typedef struct {
     uint32_t zero;          // Dự trữ
 } __attribute__((packed)) idt_entry_t;
 
-typedef struct {
-    uint64_t error_code; // Only present if an error code is pushed
+// Trạng thái thanh ghi đầy đủ được lưu bởi các stub ngắt (thứ tự khớp với isr.S)
+typedef struct trap_frame {
+    uint64_t r15;
+    uint64_t r14;
+    uint64_t r13;
+    uint64_t r12;
+    uint64_t r11;
+    uint64_t r10;
+    uint64_t r9;
+    uint64_t r8;
+    uint64_t rbp;
+    uint64_t rdi;
+    uint64_t rsi;
+    uint64_t rdx;
+    uint64_t rcx;
+    uint64_t rbx;
+    uint64_t rax;
+    uint64_t vector;
+    uint64_t error_code;
+    // Phần do CPU đẩy vào
     uint64_t rip;
     uint64_t cs;
     uint64_t rflags;
-} isr_stack_t;
+    uint64_t rsp;
+    uint64_t ss;
+} trap_frame_t;
+
+// Handler ngắt nhận frame hiện tại và trả về frame sẽ được khôi phục
+// (có thể thuộc về tiến trình khác nếu handler chuyển ngữ cảnh)
+typedef trap_frame_t *(*irq_handler_t)(trap_frame_t *frame);
+
+// Các vector ngắt phần cứng
+#define IRQ_BASE_VECTOR 32
+#define TIMER_VECTOR    0x40
+#define RESCHED_VECTOR  0x41    // IPI yêu cầu CPU khác chạy lại scheduler
+#define TLB_SHOOTDOWN_VECTOR 0x42 // IPI yêu cầu CPU khác xóa TLB của một không gian địa chỉ
+#define SPURIOUS_VECTOR 0xFF
+
+// Mỗi stub IRQ trong isr.S chiếm đúng IRQ_STUB_SIZE byte
+#define IRQ_STUB_SIZE 16
+extern char irq_stub_table[];
 
 void idt_init();
-void isr_handler_c(uint64_t vector_number, isr_stack_t *stack);
+
+// Nạp IDT dùng chung vào CPU hiện tại (dùng cho AP)
+void idt_load();
+void irq_register_handler(uint8_t vector, irq_handler_t handler);
+// Gỡ handler và chờ mọi CPU chạy xong nó (không gọi trong ngắt)
+void irq_unregister_handler(uint8_t vector);
+trap_frame_t *irq_handler_c(trap_frame_t *frame);
+
+// Khôi phục frame và trở về bằng iretq (không quay lại)
+void trap_return(trap_frame_t *frame) __attribute__((noreturn));
+// Exception (vector 0-31): chỉ trở về khi lỗi đã được sửa, ngược lại dừng máy
+void isr_handler_c(trap_frame_t *frame);
 void set_idt_gate(int vector, uint64_t handler, uint16_t selector, uint8_t type_attr, uint8_t ist);
 
-ssize_t syscall_handler_c(uint64_t syscall_number, uint64_t arg1, uint64_t arg2, uint64_t arg3);
+ssize_t syscall_handler_c(uint64_t syscall_number, uint64_t arg1, uint64_t arg2, uint64_t arg3,
+                          uint64_t arg4, uint64_t arg5, uint64_t arg6);
 
 #define SYSCALL_VECTOR 0x80
 
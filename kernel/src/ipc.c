@@ -0,0 +1,187 @@
+// ipc.c
+#include "ipc.h"
+#include "scheduler.h"
+#include "klibc.h"
+#include "graphics.h"
+
+// Một khóa cho trạng thái IPC của mọi luồng; mỗi thao tác chỉ giữ nó trong vài lệnh
+static spinlock_t ipc_lock = SPINLOCK_INIT;
+
+static uint64_t ipc_nr_calls;
+static uint64_t ipc_nr_direct;
+static uint64_t ipc_nr_blocked;
+
+// Nối proc vào cuối danh sách (giữ ipc_lock)
+static void ipc_append(process_t **list, process_t *proc) {
+    proc->ipc_next = NULL;
+    while (*list) {
+        list = &(*list)->ipc_next;
+    }
+    *list = proc;
+}
+
+// Chuyển thông điệp của caller cho server; caller chuyển sang chờ trả lời (giữ ipc_lock)
+static void ipc_deliver(process_t *server, process_t *caller) {
+    memcpy(server->ipc_msg, caller->ipc_msg, sizeof(server->ipc_msg));
+    server->ipc_from = caller->pid;
+    server->ipc_state = IPC_IDLE;
+    caller->ipc_state = IPC_WAIT_REPLY;
+    ipc_append(&server->ipc_clients, caller);
+}
+
+/**
+ * Sleeps until @p self is back in IPC_IDLE. The caller has set @p self
+ * BLOCKED under ipc_lock and, if @p next is given, made it ready to run
+ * and entered an RCU read section before dropping the lock.
+ *
+ * @p next gets the CPU directly when the scheduler allows it; otherwise it
+ * is woken and this thread goes through schedule() like any sleeper. Every
+ * wakeup that ends the wait is made after the state changed under
+ * ipc_lock, so re-checking under the lock cannot miss one, and stray
+ * wakeups only cost another pass.
+ */
+static void ipc_block(process_t *self, process_t *next) {
+    if (next && sched_switch_direct(next)) {
+        __atomic_fetch_add(&ipc_nr_direct, 1, __ATOMIC_RELAXED);
+    } else {
+        __atomic_fetch_add(&ipc_nr_blocked, 1, __ATOMIC_RELAXED);
+        if (!next) {
+            schedule();
+        }
+    }
+    for (;;) {
+        uint64_t flags = spin_lock_irqsave(&ipc_lock);
+        if (self->ipc_state == IPC_IDLE) {
+            spin_unlock_irqrestore(&ipc_lock, flags);
+            return;
+        }
+        self->state = PROCESS_STATE_BLOCKED;
+        spin_unlock_irqrestore(&ipc_lock, flags);
+        schedule();
+    }
+}
+
+/**
+ * Sends @p msg to thread @p pid and waits for its reply.
+ *
+ * The server is found under RCU. Past the lookup it is only touched under
+ * ipc_lock, or inside the read section until the handoff: an exiting
+ * thread marks itself IPC_DEAD and empties its lists under ipc_lock, and
+ * its memory outlives any read section that saw it.
+ *
+ * Fast path: the server is waiting in ipc_reply_wait, so the message is
+ * copied straight into it and the CPU is handed over. Otherwise the caller
+ * queues on the server and sleeps until the server receives and replies.
+ */
+int ipc_call(uint64_t pid, uint64_t msg[IPC_MSG_WORDS]) {
+    process_t *self = process_current();
+    if (!self) {
+        return -1;
+    }
+    rcu_read_lock();
+    process_t *server = process_find(pid);
+    uint64_t flags = spin_lock_irqsave(&ipc_lock);
+    if (!server || server == self || server->ipc_state == IPC_DEAD) {
+        spin_unlock_irqrestore(&ipc_lock, flags);
+        rcu_read_unlock();
+        return -1;
+    }
+    memcpy(self->ipc_msg, msg, sizeof(self->ipc_msg));
+    process_t *next = NULL;
+    if (server->ipc_state == IPC_RECEIVING) {
+        ipc_deliver(server, self);
+        next = server;
+    } else {
+        self->ipc_state = IPC_SENDING;
+        ipc_append(&server->ipc_senders, self);
+    }
+    self->state = PROCESS_STATE_BLOCKED;
+    spin_unlock_irqrestore(&ipc_lock, flags);
+    // Đường nhanh: sched_switch_direct kết thúc vùng đọc
+    if (!next) {
+        rcu_read_unlock();
+    }
+    __atomic_fetch_add(&ipc_nr_calls, 1, __ATOMIC_RELAXED);
+
+    ipc_block(self, next);
+    memcpy(msg, self->ipc_msg, sizeof(self->ipc_msg));
+    return self->ipc_result;
+}
+
+/**
+ * Replies to @p reply_to and receives the next call.
+ *
+ * When a caller is already queued its message is taken at once and the
+ * reply only wakes the client. Otherwise the server goes to sleep, and the
+ * client it just answered is the natural thread to run next: on the same
+ * CPU it gets the CPU directly, so a call/reply round trip costs two
+ * direct switches and no pick from the ready queue.
+ */
+int64_t ipc_reply_wait(uint64_t reply_to, uint64_t msg[IPC_MSG_WORDS]) {
+    process_t *self = process_current();
+    if (!self) {
+        return -1;
+    }
+    uint64_t flags = spin_lock_irqsave(&ipc_lock);
+    process_t *client = NULL;
+    if (reply_to) {
+        process_t **link = &self->ipc_clients;
+        while (*link && (*link)->pid != reply_to) {
+            link = &(*link)->ipc_next;
+        }
+        client = *link;
+        if (!client) {
+            spin_unlock_irqrestore(&ipc_lock, flags);
+            return -1;
+        }
+        *link = client->ipc_next;
+        memcpy(client->ipc_msg, msg, sizeof(client->ipc_msg));
+        client->ipc_result = 0;
+        client->ipc_state = IPC_IDLE;
+    }
+
+    process_t *sender = self->ipc_senders;
+    if (sender) {
+        self->ipc_senders = sender->ipc_next;
+        ipc_deliver(self, sender);
+        if (client) {
+            sched_wakeup(client);
+        }
+        spin_unlock_irqrestore(&ipc_lock, flags);
+    } else {
+        self->ipc_state = IPC_RECEIVING;
+        self->state = PROCESS_STATE_BLOCKED;
+        // Giữ client tồn tại tới khi sched_switch_direct xem xong
+        if (client) {
+            rcu_read_lock();
+        }
+        spin_unlock_irqrestore(&ipc_lock, flags);
+        ipc_block(self, client);
+    }
+    memcpy(msg, self->ipc_msg, sizeof(self->ipc_msg));
+    return (int64_t)self->ipc_from;
+}
+
+void ipc_exit(process_t *self) {
+    uint64_t flags = spin_lock_irqsave(&ipc_lock);
+    self->ipc_state = IPC_DEAD;
+    process_t *lists[2] = {self->ipc_senders, self->ipc_clients};
+    for (int i = 0; i < 2; i++) {
+        process_t *proc = lists[i];
+        while (proc) {
+            process_t *next = proc->ipc_next;
+            proc->ipc_result = -1;
+            proc->ipc_state = IPC_IDLE;
+            sched_wakeup(proc);
+            proc = next;
+        }
+    }
+    self->ipc_senders = NULL;
+    self->ipc_clients = NULL;
+    spin_unlock_irqrestore(&ipc_lock, flags);
+}
+
+void ipc_dump() {
+    kprintf("IPC: %llu calls, %llu direct switches, %llu blocking waits\n",
+            ipc_nr_calls, ipc_nr_direct, ipc_nr_blocked);
+}
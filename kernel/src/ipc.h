@@ -0,0 +1,36 @@
+// ipc.h
+#ifndef IPC_H
+#define IPC_H
+
+#include <stdint.h>
+#include "process.h"
+
+// IPC đồng bộ kiểu L4 giữa các luồng: caller gửi một thông điệp ngắn bằng ipc_call và chờ
+// trả lời; server nhận bằng ipc_reply_wait, lệnh này đồng thời trả lời caller trước đó.
+// Khi bên kia đang chờ sẵn, kernel chép thông điệp rồi chuyển thẳng CPU sang nó
+// (sched_switch_direct), không qua hàng đợi sẵn sàng. Qua syscall, thông điệp đi và về
+// trong các thanh ghi rsi, rdx, r10, r8, r9
+
+// Trạng thái IPC của một luồng (process_t.ipc_state)
+#define IPC_IDLE       0
+#define IPC_SENDING    1    // call: trong ipc_senders của server, chờ server nhận
+#define IPC_WAIT_REPLY 2    // call: server đã nhận, trong ipc_clients của server, chờ trả lời
+#define IPC_RECEIVING  3    // reply_wait: chờ caller
+#define IPC_DEAD       4    // Luồng đã kết thúc, không nhận call mới
+
+// Gửi msg tới luồng pid và chờ trả lời, được ghi đè vào msg. Trả về 0, hoặc -1 nếu không
+// có luồng đó, hoặc nó kết thúc trước khi trả lời
+int ipc_call(uint64_t pid, uint64_t msg[IPC_MSG_WORDS]);
+
+// Nếu reply_to khác 0: trả lời msg cho caller reply_to (phải là caller mà luồng này đã nhận
+// và chưa trả lời, nếu không thì trả về -1 ngay). Rồi chờ call kế tiếp; thông điệp của nó
+// được ghi vào msg. Trả về PID của caller mới
+int64_t ipc_reply_wait(uint64_t reply_to, uint64_t msg[IPC_MSG_WORDS]);
+
+// Gọi khi luồng kết thúc: mọi caller đang chờ nó nhận hoặc trả lời nhận -1
+void ipc_exit(process_t *self);
+
+// In số lần call và số lần chuyển thẳng
+void ipc_dump();
+
+#endif // IPC_H
@@ -4,6 +4,9 @@
 
 #include <stddef.h>
 
+// Lấy con trỏ tới cấu trúc chứa thành viên member từ con trỏ tới thành viên đó
+#define container_of(ptr, type, member) ((type *)((char *)(ptr) - offsetof(type, member)))
+
 // Khai báo các hàm
 void *memcpy(void *dest, const void *src, size_t n);
 void *memset(void *s, int c, size_t n);
@@ -0,0 +1,87 @@
+// kthread.c
+#include "kthread.h"
+#include "context_switcher.h"
+#include "scheduler.h"
+#include "config.h"
+#include "percpu.h"
+#include "paging.h"
+#include "ipc.h"
+
+/**
+ * First code run by a new kernel thread.
+ *
+ * Like every new context it arrives from context_trampoline with interrupts
+ * still disabled by the scheduler, so it enables them before calling the
+ * thread function.
+ */
+static void kthread_trampoline(void) {
+    process_t *self = process_current();
+    irq_restore(0x200);
+    self->kthread_fn(self->kthread_arg);
+    kthread_exit();
+}
+
+process_t *kthread_create(void (*fn)(void *arg), void *arg, int cpu) {
+    if (cpu >= (int)MAX_CPUS) {
+        return NULL;
+    }
+    process_t *proc = process_alloc();
+    if (!proc) {
+        return NULL;
+    }
+    uint64_t cr3;
+    __asm__ volatile("mov %%cr3, %0" : "=r"(cr3));
+
+    // Chỉ dùng nửa kernel, giống nhau ở mọi page table; scheduler cho luồng mượn page table đang nạp
+    proc->page_table = cr3;
+    proc->kthread = true;
+    proc->kthread_fn = fn;
+    proc->kthread_arg = arg;
+    proc->cpus_allowed = cpu >= 0 ? 1ULL << cpu : UINT64_MAX;
+    context_init(&proc->context, proc->kernel_stack_top - 8, kthread_trampoline);
+
+    process_hash(proc);
+    sched_new_task(proc);
+    return proc;
+}
+
+void kthread_exit(void) {
+    process_t *self = process_current();
+    process_unhash(self);
+    // Nhóm chỉ bỏ thành viên đã kết thúc khi tính lại trọng số, mà bộ nhớ của luồng sắp bị giải phóng
+    if (self->group) {
+        sched_group_attach(self, NULL);
+    }
+    ipc_exit(self);
+    self->state = PROCESS_STATE_TERMINATED;
+    schedule();
+    // schedule() không bao giờ chọn lại tiến trình đã kết thúc
+    for (;;) {
+        __asm__ volatile("hlt");
+    }
+}
+
+/**
+ * Adopts @p mm as the address space of the calling kernel thread.
+ *
+ * From now on the scheduler loads the page table of @p mm whenever this
+ * thread runs instead of lending it the previous one. The page table is
+ * loaded here too, with the same active_mm bookkeeping as a context switch.
+ */
+void kthread_use_mm(address_space_t *mm) {
+    process_t *self = process_current();
+    address_space_get(mm);
+    uint64_t flags = irq_save();
+    cpu_t *cpu = this_cpu();
+    self->mm = mm;
+    self->page_table = mm->page_table;
+    if (cpu->active_mm != mm) {
+        switch_page_table((void *)mm->page_table);
+        address_space_get(mm);
+        if (cpu->active_mm) {
+            address_space_put(cpu->active_mm);
+        }
+        cpu->active_mm = mm;
+    }
+    irq_restore(flags);
+}
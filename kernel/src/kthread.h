@@ -0,0 +1,24 @@
+// kthread.h
+#ifndef KTHREAD_H
+#define KTHREAD_H
+
+#include "process.h"
+#include "address_space.h"
+
+// Luồng kernel: tiến trình chỉ chạy ở ring 0, không có không gian user riêng.
+// Được lập lịch như mọi tiến trình công bằng khác (nice, affinity, nhóm).
+
+// Tạo luồng chạy fn(arg) trên kernel stack riêng và đưa vào hàng đợi; cpu >= 0 gắn
+// luồng vào CPU đó, cpu < 0 cho chạy trên mọi CPU. Trả về NULL nếu hết bộ nhớ
+process_t *kthread_create(void (*fn)(void *arg), void *arg, int cpu);
+
+// Kết thúc luồng kernel đang chạy (cũng xảy ra khi fn trả về). Bộ nhớ của luồng
+// được giải phóng sau khi CPU đã rời stack của nó và sau một grace period
+void kthread_exit(void) __attribute__((noreturn));
+
+// Cho luồng kernel đang chạy dùng hẳn không gian địa chỉ mm (giữ một tham chiếu tới khi
+// luồng kết thúc): page table của mm được nạp mỗi khi luồng chạy, nên luồng truy cập
+// được bộ nhớ user của tiến trình
+void kthread_use_mm(address_space_t *mm);
+
+#endif // KTHREAD_H
@@ -9,9 +9,22 @@
 #include "tss.h"
 #include "memory_manager.h"
 #include "process.h"
+#include "virtio_balloon.h"
+#include "pkey.h"
+#include "timer.h"
+#include "syscall_handler.h"
+#include "percpu.h"
+#include "smp.h"
+#include "scheduler.h"
+#include "softirq.h"
+#include "workqueue.h"
+#include "futex.h"
+#include "vdso.h"
+#include "console.h"
 
 #ifdef TEST
 void run_all_tests();
+void run_all_benchmarks();
 #endif
 
 // Set the base revision to 2, this is recommended as this is the latest
@@ -93,12 +106,29 @@ void kmain(void)
     // Khởi tạo graphics context
     init_graphics(fb);
     init_gdt();
+    percpu_init_bsp();
+    syscall_init();
     idt_init(); // Nạp IDT
 
     memory_manager_init();
+    pku_init();
+    timer_init();
+    sched_init();
+    address_space_init();
+    futex_init();
+    smp_init();
+    vdso_init();
+    // Cần mọi CPU đã online: mỗi CPU một ksoftirqd và một worker
+    softirq_init();
+    workqueue_init();
+    console_init();
+
+    // Balloon là tùy chọn: chỉ có khi QEMU chạy với -device virtio-balloon-pci
+    virtio_balloon_init();
 
 #ifdef TEST
     run_all_tests();
+    run_all_benchmarks();
     hcf();
 #else
     // Tạo tiến trình đầu tiên từ ELF binary
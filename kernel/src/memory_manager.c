@@ -2,6 +2,8 @@
 #include "bitmap_allocator.h"
 #include <limine.h>
 #include "config.h"
+#include "spinlock.h"
+#include <stdbool.h>
 
 // Yêu cầu MEMMAP từ Limine
 extern volatile struct limine_memmap_request memmap_request;
@@ -9,16 +11,35 @@ extern volatile struct limine_memmap_request memmap_request;
 // Biến toàn cục cho allocator
 bitmap_allocator_t phys_allocator;
 
+// Bảo vệ phys_allocator và report_dirty; MCS vì mọi CPU cùng cấp phát trang qua đây
+static mcs_lock_t phys_lock;
+
 // Vùng nhớ cho bitmap (tùy chỉnh kích thước phù hợp với tổng bộ nhớ)
 #define BITMAP_MEMORY_SIZE  0x10000 // 64KB cho bitmap (quản lý đến ~2GB bộ nhớ)
 
 uint8_t bitmap_memory[BITMAP_MEMORY_SIZE] __attribute__((aligned(4096)));
 
+// Số byte bitmap ứng với một vùng báo cáo
+#define REPORT_RUN_BITMAP_BYTES (FREE_PAGE_REPORT_RUN_BLOCKS / 8)
+
+// Mỗi bit ứng với một vùng 2 MiB: 1 nghĩa là vùng có khối được giải phóng kể từ lần báo cáo trước
+static uint8_t report_dirty[BITMAP_MEMORY_SIZE / REPORT_RUN_BITMAP_BYTES / 8];
+
+static void mark_report_dirty(uint64_t start_block, uint64_t count) {
+    uint64_t first_run = start_block / FREE_PAGE_REPORT_RUN_BLOCKS;
+    uint64_t last_run = (start_block + count - 1) / FREE_PAGE_REPORT_RUN_BLOCKS;
+    for (uint64_t run = first_run; run <= last_run && run / 8 < sizeof(report_dirty); run++) {
+        report_dirty[run / 8] |= (1 << (run % 8));
+    }
+}
+
 
 void memory_manager_init() {
     // Chờ Limine cung cấp phản hồi về MEMMAP
     while (!memmap_request.response);
 
+    mcs_init_named(&phys_lock, "phys_allocator");
+
     // Khởi tạo bitmap allocator
     bitmap_allocator_init(&phys_allocator, bitmap_memory, BITMAP_MEMORY_SIZE);
 
@@ -47,6 +68,11 @@ void memory_manager_init() {
             }
         }
     }
+
+    // Chưa có vùng nào được báo cáo cho hypervisor
+    for (uint64_t i = 0; i < sizeof(report_dirty); i++) {
+        report_dirty[i] = 0xFF;
+    }
 }
 
 /**
@@ -59,7 +85,10 @@ void memory_manager_init() {
  * @return The physical address of the allocated block or 0 on failure.
  */
 uint64_t allocate_physical_block() {
+    mcs_node_t node;
+    uint64_t flags = mcs_lock_irqsave(&phys_lock, &node);
     uint64_t block_index = bitmap_alloc(&phys_allocator);
+    mcs_unlock_irqrestore(&phys_lock, &node, flags);
     if (block_index == (uint64_t)-1) {
         return 0; // Thất bại trong việc cấp phát
     }
@@ -82,7 +111,11 @@ void free_physical_block(uint64_t phys_address) {
 
     // Calculate the block index
     uint64_t block_index = phys_address / BLOCK_SIZE;
+    mcs_node_t node;
+    uint64_t flags = mcs_lock_irqsave(&phys_lock, &node);
     bitmap_free(&phys_allocator, block_index);
+    mark_report_dirty(block_index, 1);
+    mcs_unlock_irqrestore(&phys_lock, &node, flags);
 }
 
 /*************  ✨ Codeium Command ⭐  *************/
@@ -120,7 +153,10 @@ uint64_t allocate_physical_blocks(uint64_t count) {
         return 0; // Số lượng không hợp lệ
     }
 
+    mcs_node_t node;
+    uint64_t flags = mcs_lock_irqsave(&phys_lock, &node);
     uint64_t start_block = bitmap_alloc_contiguous(&phys_allocator, count);
+    mcs_unlock_irqrestore(&phys_lock, &node, flags);
     if (start_block == (uint64_t)-1) {
         return 0; // Thất bại trong việc cấp phát
     }
@@ -144,7 +180,11 @@ void free_physical_blocks(uint64_t phys_address, uint64_t count) {
     }
 
     uint64_t start_block = phys_address / BLOCK_SIZE;
+    mcs_node_t node;
+    uint64_t flags = mcs_lock_irqsave(&phys_lock, &node);
     bitmap_free_contiguous(&phys_allocator, start_block, count);
+    mark_report_dirty(start_block, count);
+    mcs_unlock_irqrestore(&phys_lock, &node, flags);
 }
 
 /**
@@ -237,3 +277,110 @@ void free_memory_bytes(uint64_t phys_address, uint64_t size) {
     // Giải phóng các trang
     free_physical_blocks(phys_address, pages_to_free);
 }
+
+/**
+ * Allocates one 2 MiB-aligned run of FREE_PAGE_REPORT_RUN_BLOCKS blocks,
+ * suitable as a large page.
+ *
+ * Like the reporting scan, runs are tested 64 bits of bitmap at a time, so
+ * a partly used run is rejected after one word load.
+ *
+ * @return The physical address of the run, or 0 if no aligned run is free.
+ */
+uint64_t allocate_large_page() {
+    uint64_t total_runs = phys_allocator.total_blocks / FREE_PAGE_REPORT_RUN_BLOCKS;
+    mcs_node_t node;
+    uint64_t flags = mcs_lock_irqsave(&phys_lock, &node);
+
+    for (uint64_t run = 0; run < total_runs; run++) {
+        uint64_t *words = (uint64_t *)(phys_allocator.bitmap + run * REPORT_RUN_BITMAP_BYTES);
+        bool all_free = true;
+        for (uint64_t w = 0; w < REPORT_RUN_BITMAP_BYTES / sizeof(uint64_t); w++) {
+            if (words[w] != 0) {
+                all_free = false;
+                break;
+            }
+        }
+        if (!all_free) {
+            continue;
+        }
+        for (uint64_t w = 0; w < REPORT_RUN_BITMAP_BYTES / sizeof(uint64_t); w++) {
+            words[w] = ~0ULL;
+        }
+        mcs_unlock_irqrestore(&phys_lock, &node, flags);
+        return run * FREE_PAGE_REPORT_RUN_BLOCKS * BLOCK_SIZE;
+    }
+    mcs_unlock_irqrestore(&phys_lock, &node, flags);
+    return 0;
+}
+
+/**
+ * Isolates fully free, not-yet-reported 2 MiB runs for free page reporting.
+ *
+ * A run qualifies when all FREE_PAGE_REPORT_RUN_BLOCKS blocks are free in the
+ * bitmap and at least one of them was freed since the run was last reported.
+ * Qualifying runs are marked allocated so nobody can reuse the frames while
+ * the hypervisor discards them; the caller must hand them back through
+ * memory_manager_release_reported_runs().
+ *
+ * Runs are checked 64 bits of bitmap at a time, so a full scan of 2 GiB costs
+ * about 8K word loads.
+ *
+ * @param runs Output array receiving the physical address of each run.
+ * @param max_runs The capacity of @p runs.
+ * @return The number of runs isolated.
+ */
+uint64_t memory_manager_isolate_free_runs(uint64_t *runs, uint64_t max_runs) {
+    uint64_t total_runs = phys_allocator.total_blocks / FREE_PAGE_REPORT_RUN_BLOCKS;
+    uint64_t found = 0;
+    mcs_node_t node;
+    uint64_t flags = mcs_lock_irqsave(&phys_lock, &node);
+
+    for (uint64_t run = 0; run < total_runs && found < max_runs; run++) {
+        if (!(report_dirty[run / 8] & (1 << (run % 8)))) {
+            continue;
+        }
+
+        uint64_t *words = (uint64_t *)(phys_allocator.bitmap + run * REPORT_RUN_BITMAP_BYTES);
+        bool all_free = true;
+        for (uint64_t w = 0; w < REPORT_RUN_BITMAP_BYTES / sizeof(uint64_t); w++) {
+            if (words[w] != 0) {
+                all_free = false;
+                break;
+            }
+        }
+        if (!all_free) {
+            continue;
+        }
+
+        // Chiếm toàn bộ vùng để không ai dùng lại trong lúc báo cáo
+        for (uint64_t w = 0; w < REPORT_RUN_BITMAP_BYTES / sizeof(uint64_t); w++) {
+            words[w] = ~0ULL;
+        }
+        runs[found++] = run * FREE_PAGE_REPORT_RUN_BLOCKS * BLOCK_SIZE;
+    }
+    mcs_unlock_irqrestore(&phys_lock, &node, flags);
+    return found;
+}
+
+/**
+ * Returns reported runs to the allocator and marks them clean.
+ *
+ * Unlike free_physical_blocks() this does not mark the run dirty, so the run
+ * is skipped by later reporting passes until one of its blocks is allocated
+ * and freed again.
+ *
+ * @param runs The physical addresses returned by
+ *             memory_manager_isolate_free_runs().
+ * @param count The number of runs.
+ */
+void memory_manager_release_reported_runs(const uint64_t *runs, uint64_t count) {
+    mcs_node_t node;
+    uint64_t flags = mcs_lock_irqsave(&phys_lock, &node);
+    for (uint64_t i = 0; i < count; i++) {
+        uint64_t run = runs[i] / BLOCK_SIZE / FREE_PAGE_REPORT_RUN_BLOCKS;
+        bitmap_free_contiguous(&phys_allocator, run * FREE_PAGE_REPORT_RUN_BLOCKS, FREE_PAGE_REPORT_RUN_BLOCKS);
+        report_dirty[run / 8] &= ~(1 << (run % 8));
+    }
+    mcs_unlock_irqrestore(&phys_lock, &node, flags);
+}
@@ -5,6 +5,9 @@
 
 #include "bitmap_allocator.h"
 
+// Allocator toàn cục quản lý bộ nhớ vật lý
+extern bitmap_allocator_t phys_allocator;
+
 // Hàm khởi tạo Memory Manager
 void memory_manager_init();
 
@@ -41,4 +44,19 @@ uint64_t allocate_memory_bytes(uint64_t size);
 // Nhận vào địa chỉ vật lý và kích thước của vùng nhớ cần giải phóng
 void free_memory_bytes(uint64_t phys_address, uint64_t size);
 
+// Số khối trong một vùng báo cáo trang trống (512 khối = 2 MiB)
+#define FREE_PAGE_REPORT_RUN_BLOCKS 512
+
+// Cấp phát một vùng FREE_PAGE_REPORT_RUN_BLOCKS khối căn chỉnh 2 MiB (một trang lớn).
+// Trả về địa chỉ vật lý hoặc 0; giải phóng bằng free_physical_blocks
+uint64_t allocate_large_page();
+
+// Cô lập tối đa max_runs vùng trống trọn vẹn, căn chỉnh 2 MiB và chưa được báo cáo.
+// Các vùng được đánh dấu đã cấp phát cho đến khi gọi memory_manager_release_reported_runs.
+// Trả về số vùng đã ghi vào runs (địa chỉ vật lý)
+uint64_t memory_manager_isolate_free_runs(uint64_t *runs, uint64_t max_runs);
+
+// Trả các vùng đã báo cáo về allocator và ghi nhớ rằng chúng sạch (không cần báo lại)
+void memory_manager_release_reported_runs(const uint64_t *runs, uint64_t count);
+
 #endif // MEMORY_MANAGER_H
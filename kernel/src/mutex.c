@@ -0,0 +1,52 @@
+// mutex.c
+#include "mutex.h"
+#include "process.h"
+#include "scheduler.h"
+
+/**
+ * Takes @p mutex, blocking while someone else holds it.
+ *
+ * The unlocker hands the mutex straight to the first waiter and sets its
+ * granted flag, so a waiter never has to compete again after waking up and
+ * a spurious wakeup just goes back to sleep.
+ */
+void mutex_lock(mutex_t *mutex) {
+    uint64_t flags = spin_lock_irqsave(&mutex->wait_lock);
+    if (!mutex->locked) {
+        mutex->locked = true;
+        spin_unlock_irqrestore(&mutex->wait_lock, flags);
+        return;
+    }
+    process_t *self = process_current();
+    mutex_waiter_t w = {.next = 0, .task = self, .granted = false};
+    if (mutex->tail) {
+        mutex->tail->next = &w;
+    } else {
+        mutex->head = &w;
+    }
+    mutex->tail = &w;
+    while (!w.granted) {
+        self->state = PROCESS_STATE_BLOCKED;
+        spin_unlock_irqrestore(&mutex->wait_lock, flags);
+        schedule();
+        flags = spin_lock_irqsave(&mutex->wait_lock);
+    }
+    spin_unlock_irqrestore(&mutex->wait_lock, flags);
+}
+
+// Người chờ còn bị chặn tới khi thấy granted, nên w và task còn sống lúc được đánh thức
+void mutex_unlock(mutex_t *mutex) {
+    uint64_t flags = spin_lock_irqsave(&mutex->wait_lock);
+    mutex_waiter_t *w = mutex->head;
+    if (w) {
+        mutex->head = w->next;
+        if (!mutex->head) {
+            mutex->tail = 0;
+        }
+        w->granted = true;
+        sched_wakeup(w->task);
+    } else {
+        mutex->locked = false;
+    }
+    spin_unlock_irqrestore(&mutex->wait_lock, flags);
+}
@@ -0,0 +1,39 @@
+// mutex.h
+#ifndef MUTEX_H
+#define MUTEX_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "spinlock.h"
+
+// Khóa ngủ: người chờ bị chặn thay vì quay vòng và chủ khóa vẫn có thể bị chiếm quyền, nên
+// giữ được qua việc dài (cấp phát và xóa trang, chờ TLB shootdown). Chỉ dùng trong ngữ cảnh
+// tiến trình và không lấy khi đang giữ spinlock. Khóa được trao cho người chờ theo thứ tự đến
+
+struct process;
+
+// Một người chờ, nằm trên kernel stack của nó
+typedef struct mutex_waiter {
+    struct mutex_waiter *next;
+    struct process *task;
+    bool granted;                   // Chủ cũ đã trao khóa cho người chờ này
+} mutex_waiter_t;
+
+typedef struct {
+    spinlock_t wait_lock;           // Bảo vệ các trường bên dưới
+    bool locked;
+    mutex_waiter_t *head;
+    mutex_waiter_t *tail;
+} mutex_t;
+
+static inline void mutex_init(mutex_t *mutex) {
+    spin_init(&mutex->wait_lock);
+    mutex->locked = false;
+    mutex->head = 0;
+    mutex->tail = 0;
+}
+
+void mutex_lock(mutex_t *mutex);
+void mutex_unlock(mutex_t *mutex);
+
+#endif // MUTEX_H
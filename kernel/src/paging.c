@@ -13,6 +13,11 @@
 #define PD_INDEX(x)   (((x) >> 21) & 0x1FF)
 #define PT_INDEX(x)   (((x) >> 12) & 0x1FF)
 
+#define PAGING_PAGE_PWT   0x8
+#define PAGING_PAGE_PCD   0x10
+#define PAGING_PAGE_LARGE 0x80
+#define PAGING_ADDR_MASK  0x000FFFFFFFFFF000ULL
+
 /**
  * Reads the current value of CR3.
  *
@@ -73,6 +78,55 @@ void *create_user_page_table()
     return (void *)phys_pml4;
 }
 
+// Giải phóng một bảng cấp level (3 = PDPT ... 1 = PT) cùng mọi thứ nó trỏ tới
+static void free_table_level(uint64_t table_phys, int level)
+{
+    uint64_t *table = PHYS_TO_VIRT(table_phys);
+    for (int i = 0; i < 512; i++)
+    {
+        uint64_t entry = table[i];
+        if (!(entry & PAGING_PAGE_PRESENT))
+        {
+            continue;
+        }
+        if (level == 1 || (entry & PAGING_PAGE_LARGE))
+        {
+            // Trang user do kernel cấp phát riêng cho không gian địa chỉ này (4 KiB, hoặc 2 MiB
+            // ở cấp PD), trừ trang dùng chung mà chủ của nó tự giải phóng
+            if (!(entry & PAGING_PAGE_SHARED))
+            {
+                free_physical_blocks(entry & PAGING_ADDR_MASK, level == 1 ? 1 : LARGE_PAGE_SIZE / BLOCK_SIZE);
+            }
+            continue;
+        }
+        free_table_level(entry & PAGING_ADDR_MASK, level - 1);
+    }
+    free_physical_block(table_phys);
+}
+
+/**
+ * Frees a user page table created by create_user_page_table().
+ *
+ * Only the lower half (PML4 entries 0-255) belongs to the address space;
+ * the upper half points at the kernel's shared tables and is left alone.
+ * Every mapped user page is owned by this address space unless its PTE is
+ * marked PAGING_PAGE_SHARED.
+ *
+ * @param pml4_phys The physical address of the PML4.
+ */
+void free_user_page_table(uintptr_t pml4_phys)
+{
+    uint64_t *pml4 = PHYS_TO_VIRT(pml4_phys);
+    for (int i = 0; i < 256; i++)
+    {
+        if (pml4[i] & PAGING_PAGE_PRESENT)
+        {
+            free_table_level(pml4[i] & PAGING_ADDR_MASK, 3);
+        }
+    }
+    free_physical_block(pml4_phys);
+}
+
 /**
  * Maps a range of physical memory to a range of virtual memory.
  *
@@ -107,6 +161,9 @@ bool map_memory(uintptr_t pml4_phys, uint64_t virt_addr, uint64_t phys_addr, uin
         num_pages++;
     }
 
+    // Protection key chỉ có nghĩa ở PTE lá, không đặt vào các bảng trung gian
+    uint64_t table_flags = flags & ~(PAGING_PAGE_PKEY_MASK | PAGING_PAGE_SHARED);
+
     // map each page
     for (uint64_t i = 0; i < num_pages; i++)
     {
@@ -133,7 +190,7 @@ bool map_memory(uintptr_t pml4_phys, uint64_t virt_addr, uint64_t phys_addr, uin
             // clear pdpt entry
             memset(PHYS_TO_VIRT(pdpt), 0, 4096);
             // set pdpt entry
-            pml4_virtual[pml4_index] = pdpt & 0xFFFFFFFFFFFFF000 | flags | PAGING_PAGE_PRESENT;
+            pml4_virtual[pml4_index] = pdpt & 0xFFFFFFFFFFFFF000 | table_flags | PAGING_PAGE_PRESENT;
         }
 
         // get pdpt virtual address
@@ -151,7 +208,7 @@ bool map_memory(uintptr_t pml4_phys, uint64_t virt_addr, uint64_t phys_addr, uin
             // clear pd entry
             memset(PHYS_TO_VIRT(pd), 0, 4096);
             // set pd entry
-            pdpt[pdpt_index] = pd & 0xFFFFFFFFFFFFF000 | flags | PAGING_PAGE_PRESENT;
+            pdpt[pdpt_index] = pd & 0xFFFFFFFFFFFFF000 | table_flags | PAGING_PAGE_PRESENT;
         }
 
         // get pd virtual address
@@ -169,7 +226,13 @@ bool map_memory(uintptr_t pml4_phys, uint64_t virt_addr, uint64_t phys_addr, uin
             // clear pt entry
             memset(PHYS_TO_VIRT(pt), 0, 4096);
             // set pt entry
-            pd[pd_index] = pt & 0xFFFFFFFFFFFFF000 | flags | PAGING_PAGE_PRESENT;
+            pd[pd_index] = pt & 0xFFFFFFFFFFFFF000 | table_flags | PAGING_PAGE_PRESENT;
+        }
+
+        if (pd[pd_index] & PAGING_PAGE_LARGE)
+        {
+            kprintf("Paging: Page already mapped\n");
+            return false;
         }
 
         // get pt virtual address
@@ -188,3 +251,269 @@ bool map_memory(uintptr_t pml4_phys, uint64_t virt_addr, uint64_t phys_addr, uin
     }
     return true;
 }
+
+/**
+ * Maps one 2 MiB page with a PD entry.
+ *
+ * The intermediate tables are created as in map_memory(). The PD slot must
+ * be empty: a page table already hanging there (some 4 KiB pages of the same
+ * 2 MiB range) makes the call fail rather than being replaced.
+ *
+ * @param pml4_phys The physical address of the PML4.
+ * @param virt_addr The 2 MiB-aligned virtual address.
+ * @param phys_addr The 2 MiB-aligned physical address.
+ * @param flags The flags for the mapping.
+ *
+ * @return true if the page was mapped.
+ */
+bool paging_map_large(uintptr_t pml4_phys, uint64_t virt_addr, uint64_t phys_addr, uint64_t flags)
+{
+    if (virt_addr % LARGE_PAGE_SIZE != 0 || phys_addr % LARGE_PAGE_SIZE != 0)
+    {
+        return false;
+    }
+    uint64_t table_flags = flags & ~(PAGING_PAGE_PKEY_MASK | PAGING_PAGE_SHARED);
+    uint64_t *table = PHYS_TO_VIRT(pml4_phys);
+    uint64_t indices[2] = {PML4_INDEX(virt_addr), PDPT_INDEX(virt_addr)};
+
+    for (int level = 0; level < 2; level++)
+    {
+        uint64_t *entry = &table[indices[level]];
+        if (!(*entry & PAGING_PAGE_PRESENT))
+        {
+            uint64_t next = allocate_physical_block();
+            if (!next)
+            {
+                kprintf("Paging: Failed to allocate page table\n");
+                return false;
+            }
+            memset(PHYS_TO_VIRT(next), 0, PAGE_SIZE);
+            *entry = next | table_flags | PAGING_PAGE_PRESENT;
+        }
+        else if (*entry & PAGING_PAGE_LARGE)
+        {
+            return false;
+        }
+        table = PHYS_TO_VIRT(*entry & PAGING_ADDR_MASK);
+    }
+
+    uint64_t *pde = &table[PD_INDEX(virt_addr)];
+    if (*pde & PAGING_PAGE_PRESENT)
+    {
+        return false;
+    }
+    *pde = phys_addr | flags | PAGING_PAGE_LARGE | PAGING_PAGE_PRESENT;
+    __asm__ volatile("invlpg (%0)" : : "r" (virt_addr) : "memory");
+    return true;
+}
+
+// Mục lá (PTE, hoặc mục PD của trang 2 MiB) ánh xạ virt_addr và kích thước trang, NULL nếu chưa ánh xạ
+static uint64_t *paging_get_leaf(uintptr_t pml4_phys, uint64_t virt_addr, uint64_t *page_size)
+{
+    uint64_t *table = PHYS_TO_VIRT(pml4_phys);
+    uint64_t indices[3] = {PML4_INDEX(virt_addr), PDPT_INDEX(virt_addr), PD_INDEX(virt_addr)};
+
+    for (int level = 0; level < 3; level++)
+    {
+        uint64_t *entry = &table[indices[level]];
+        if (!(*entry & PAGING_PAGE_PRESENT))
+        {
+            return NULL;
+        }
+        if (*entry & PAGING_PAGE_LARGE)
+        {
+            // Nửa user chỉ có trang lớn ở cấp PD
+            if (level != 2)
+            {
+                return NULL;
+            }
+            *page_size = LARGE_PAGE_SIZE;
+            return entry;
+        }
+        table = PHYS_TO_VIRT(*entry & PAGING_ADDR_MASK);
+    }
+
+    uint64_t *pte = &table[PT_INDEX(virt_addr)];
+    if (!(*pte & PAGING_PAGE_PRESENT))
+    {
+        return NULL;
+    }
+    *page_size = PAGE_SIZE;
+    return pte;
+}
+
+uint64_t paging_page_size(uintptr_t pml4_phys, uint64_t virt_addr)
+{
+    uint64_t page_size;
+    return paging_get_leaf(pml4_phys, virt_addr, &page_size) ? page_size : 0;
+}
+
+/**
+ * Removes the page that starts at @p virt_addr.
+ *
+ * The TLB is not touched: the caller flushes every CPU that may cache the
+ * mapping (address_space_flush_tlb) before it frees the returned frame.
+ * Page tables that become empty are kept until the address space dies.
+ *
+ * @param pml4_phys The physical address of the PML4.
+ * @param virt_addr The start of a mapped page (2 MiB-aligned for a large page).
+ * @param page_size Receives the size of the removed page.
+ *
+ * @return The physical address of the removed page, or 0 if nothing starts
+ *         at @p virt_addr.
+ */
+uint64_t paging_unmap(uintptr_t pml4_phys, uint64_t virt_addr, uint64_t *page_size)
+{
+    uint64_t *entry = paging_get_leaf(pml4_phys, virt_addr, page_size);
+    if (!entry || virt_addr % *page_size != 0)
+    {
+        return 0;
+    }
+    uint64_t phys = *entry & PAGING_ADDR_MASK;
+    *entry = 0;
+    return phys;
+}
+
+/**
+ * Returns a pointer to the leaf PTE mapping a virtual address.
+ *
+ * Only 4 KiB mappings are resolved; the walk stops at any non-present entry
+ * or at a large page.
+ *
+ * @param pml4_phys The physical address of the PML4.
+ * @param virt_addr The virtual address to look up.
+ *
+ * @return A pointer (through the HHDM) to the PTE, or NULL if the address is
+ *         not mapped by a 4 KiB page.
+ */
+uint64_t *paging_get_pte(uintptr_t pml4_phys, uint64_t virt_addr)
+{
+    uint64_t *table = PHYS_TO_VIRT(pml4_phys);
+    uint64_t indices[3] = {PML4_INDEX(virt_addr), PDPT_INDEX(virt_addr), PD_INDEX(virt_addr)};
+
+    for (int level = 0; level < 3; level++)
+    {
+        uint64_t entry = table[indices[level]];
+        if (!(entry & PAGING_PAGE_PRESENT) || (entry & PAGING_PAGE_LARGE))
+        {
+            return NULL;
+        }
+        table = PHYS_TO_VIRT(entry & PAGING_ADDR_MASK);
+    }
+
+    uint64_t *pte = &table[PT_INDEX(virt_addr)];
+    if (!(*pte & PAGING_PAGE_PRESENT))
+    {
+        return NULL;
+    }
+    return pte;
+}
+
+uint64_t paging_user_phys(uintptr_t pml4_phys, uint64_t virt_addr)
+{
+    if (virt_addr >= USER_SPACE_END)
+    {
+        return 0;
+    }
+    uint64_t page_size;
+    uint64_t *entry = paging_get_leaf(pml4_phys, virt_addr, &page_size);
+    if (!entry || !(*entry & PAGING_PAGE_USER))
+    {
+        return 0;
+    }
+    return (*entry & PAGING_ADDR_MASK) + (virt_addr & (page_size - 1));
+}
+
+/**
+ * Assigns a protection key to every page of an already mapped range.
+ *
+ * The key is written into bits 59-62 of each leaf PTE and the TLB entry is
+ * invalidated, so the new key takes effect immediately when @p pml4_phys is
+ * the active page table.
+ *
+ * @param pml4_phys The physical address of the PML4.
+ * @param virt_addr The page-aligned start of the range.
+ * @param size The size of the range in bytes.
+ * @param pkey The protection key (0-15).
+ *
+ * @return true if every page in the range was mapped and updated, false
+ *         otherwise (pages before the first unmapped one are still updated).
+ */
+bool paging_set_pkey(uintptr_t pml4_phys, uint64_t virt_addr, uint64_t size, int pkey)
+{
+    if (virt_addr % PAGE_SIZE != 0 || pkey < 0 || pkey > 15)
+    {
+        return false;
+    }
+
+    for (uint64_t offset = 0; offset < size; offset += PAGE_SIZE)
+    {
+        uint64_t *pte = paging_get_pte(pml4_phys, virt_addr + offset);
+        if (!pte)
+        {
+            return false;
+        }
+        *pte = (*pte & ~PAGING_PAGE_PKEY_MASK) | PAGING_PAGE_PKEY(pkey);
+        __asm__ volatile("invlpg (%0)" : : "r" (virt_addr + offset) : "memory");
+    }
+    return true;
+}
+
+/**
+ * Maps a physical MMIO range into the HHDM of the kernel page table.
+ *
+ * Limine only maps RAM into the higher half, so device registers such as the
+ * Local APIC need their own mapping. Pages are mapped uncached (PCD | PWT);
+ * pages already covered by an existing mapping, including a large page, are
+ * left untouched. Because user page tables share the kernel PML4 entries,
+ * the mapping is visible from every address space.
+ *
+ * @param phys_addr The page-aligned physical address of the range.
+ * @param size The size of the range in bytes.
+ *
+ * @return true on success, false if a page table could not be allocated.
+ */
+bool paging_map_kernel_mmio(uint64_t phys_addr, uint64_t size)
+{
+    uint64_t *pml4 = PHYS_TO_VIRT(read_cr3() & PAGING_ADDR_MASK);
+
+    for (uint64_t offset = 0; offset < size; offset += PAGE_SIZE)
+    {
+        uint64_t phys_page = phys_addr + offset;
+        uint64_t virt_page = (uint64_t)PHYS_TO_VIRT(phys_page);
+        uint64_t indices[3] = {PML4_INDEX(virt_page), PDPT_INDEX(virt_page), PD_INDEX(virt_page)};
+        uint64_t *table = pml4;
+        bool covered = false;
+
+        for (int level = 0; level < 3; level++)
+        {
+            uint64_t *entry = &table[indices[level]];
+            if (!(*entry & PAGING_PAGE_PRESENT))
+            {
+                uint64_t next = allocate_physical_block();
+                if (!next)
+                {
+                    kprintf("Paging: Failed to allocate MMIO page table\n");
+                    return false;
+                }
+                memset(PHYS_TO_VIRT(next), 0, PAGE_SIZE);
+                *entry = next | PAGING_PAGE_PRESENT | PAGING_PAGE_RW;
+            }
+            else if (*entry & PAGING_PAGE_LARGE)
+            {
+                covered = true;
+                break;
+            }
+            table = PHYS_TO_VIRT(*entry & PAGING_ADDR_MASK);
+        }
+
+        uint64_t *pte = &table[PT_INDEX(virt_page)];
+        if (covered || (*pte & PAGING_PAGE_PRESENT))
+        {
+            continue;
+        }
+        *pte = phys_page | PAGING_PAGE_PRESENT | PAGING_PAGE_RW | PAGING_PAGE_PWT | PAGING_PAGE_PCD;
+        __asm__ volatile("invlpg (%0)" : : "r" (virt_page) : "memory");
+    }
+    return true;
+}
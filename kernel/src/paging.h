@@ -10,9 +10,35 @@
 // create user page table
 void* create_user_page_table();
 
+// Giải phóng nửa user của page table (bảng trung gian và mọi trang đã ánh xạ) rồi chính PML4.
+// Page table không được đang nạp trên CPU nào
+void free_user_page_table(uintptr_t pml4_phys);
+
 // Ánh xạ địa chỉ ảo tới địa chỉ vật lý
 bool map_memory(uintptr_t pml4_phys, uint64_t virt_addr, uint64_t phys_addr, uint64_t size, uint64_t flags);
 
+// Ánh xạ một trang 2 MiB (virt và phys căn 2 MiB); false nếu chỗ đó đã có ánh xạ
+bool paging_map_large(uintptr_t pml4_phys, uint64_t virt_addr, uint64_t phys_addr, uint64_t flags);
+
+// Kích thước trang (PAGE_SIZE hoặc LARGE_PAGE_SIZE) ánh xạ virt_addr, 0 nếu chưa ánh xạ
+uint64_t paging_page_size(uintptr_t pml4_phys, uint64_t virt_addr);
+
+// Gỡ trang bắt đầu tại virt_addr mà không xóa TLB. Trả về địa chỉ vật lý của trang và
+// kích thước của nó qua page_size, 0 nếu không có trang nào bắt đầu ở đó
+uint64_t paging_unmap(uintptr_t pml4_phys, uint64_t virt_addr, uint64_t *page_size);
+
+// Lấy con trỏ tới PTE lá (trang 4 KiB) của một địa chỉ ảo, NULL nếu chưa ánh xạ
+uint64_t *paging_get_pte(uintptr_t pml4_phys, uint64_t virt_addr);
+
+// Địa chỉ vật lý của một địa chỉ user đã ánh xạ với quyền user, 0 nếu không có
+uint64_t paging_user_phys(uintptr_t pml4_phys, uint64_t virt_addr);
+
+// Gán protection key cho một dải địa chỉ đã được ánh xạ
+bool paging_set_pkey(uintptr_t pml4_phys, uint64_t virt_addr, uint64_t size, int pkey);
+
+// Ánh xạ vùng MMIO vật lý vào HHDM của kernel (không cache)
+bool paging_map_kernel_mmio(uint64_t phys_addr, uint64_t size);
+
 // Hàm chuyển đổi page table
 void switch_page_table(void *page_table);
 
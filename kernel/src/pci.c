@@ -0,0 +1,99 @@
+// pci.c
+#include "pci.h"
+#include "io.h"
+
+static uint32_t pci_config_address(uint8_t bus, uint8_t slot, uint8_t function, uint8_t offset) {
+    return (1u << 31) | ((uint32_t)bus << 16) | ((uint32_t)(slot & 0x1F) << 11) |
+           ((uint32_t)(function & 0x7) << 8) | (offset & 0xFC);
+}
+
+uint32_t pci_config_read32(uint8_t bus, uint8_t slot, uint8_t function, uint8_t offset) {
+    outl(PCI_CONFIG_ADDRESS, pci_config_address(bus, slot, function, offset));
+    return inl(PCI_CONFIG_DATA);
+}
+
+uint16_t pci_config_read16(uint8_t bus, uint8_t slot, uint8_t function, uint8_t offset) {
+    uint32_t value = pci_config_read32(bus, slot, function, offset);
+    return (uint16_t)(value >> ((offset & 2) * 8));
+}
+
+void pci_config_write32(uint8_t bus, uint8_t slot, uint8_t function, uint8_t offset, uint32_t value) {
+    outl(PCI_CONFIG_ADDRESS, pci_config_address(bus, slot, function, offset));
+    outl(PCI_CONFIG_DATA, value);
+}
+
+void pci_config_write16(uint8_t bus, uint8_t slot, uint8_t function, uint8_t offset, uint16_t value) {
+    uint32_t old = pci_config_read32(bus, slot, function, offset);
+    int shift = (offset & 2) * 8;
+    old &= ~(0xFFFFu << shift);
+    old |= (uint32_t)value << shift;
+    pci_config_write32(bus, slot, function, offset, old);
+}
+
+/**
+ * Scans every bus/slot/function for a device with the given IDs.
+ *
+ * Functions 1-7 are only probed when function 0 reports a multi-function
+ * header, so the scan touches at most 256 * 32 config headers for a
+ * single-function topology.
+ *
+ * @param vendor_id The PCI vendor ID to look for.
+ * @param device_id The PCI device ID to look for.
+ * @param out Filled with the device location when found.
+ * @return true if a matching device was found, false otherwise.
+ */
+bool pci_find_device(uint16_t vendor_id, uint16_t device_id, pci_device_t *out) {
+    for (int bus = 0; bus < 256; bus++) {
+        for (int slot = 0; slot < 32; slot++) {
+            if (pci_config_read16(bus, slot, 0, PCI_VENDOR_ID) == 0xFFFF) {
+                continue;
+            }
+
+            uint8_t header_type = (uint8_t)pci_config_read16(bus, slot, 0, PCI_HEADER_TYPE);
+            int functions = (header_type & 0x80) ? 8 : 1;
+
+            for (int function = 0; function < functions; function++) {
+                uint16_t vendor = pci_config_read16(bus, slot, function, PCI_VENDOR_ID);
+                if (vendor != vendor_id) {
+                    continue;
+                }
+                uint16_t device = pci_config_read16(bus, slot, function, PCI_DEVICE_ID);
+                if (device != device_id) {
+                    continue;
+                }
+                out->bus = bus;
+                out->slot = slot;
+                out->function = function;
+                out->vendor_id = vendor;
+                out->device_id = device;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+uint64_t pci_read_bar(const pci_device_t *dev, int bar, bool *is_io) {
+    uint8_t offset = PCI_BAR0 + bar * 4;
+    uint32_t low = pci_config_read32(dev->bus, dev->slot, dev->function, offset);
+
+    if (low & 0x1) {
+        *is_io = true;
+        return low & ~0x3u;
+    }
+
+    *is_io = false;
+    uint64_t address = low & ~0xFu;
+    // BAR 64-bit chiếm hai thanh ghi liên tiếp
+    if (((low >> 1) & 0x3) == 0x2) {
+        uint32_t high = pci_config_read32(dev->bus, dev->slot, dev->function, offset + 4);
+        address |= (uint64_t)high << 32;
+    }
+    return address;
+}
+
+void pci_enable_device(const pci_device_t *dev) {
+    uint16_t command = pci_config_read16(dev->bus, dev->slot, dev->function, PCI_COMMAND);
+    command |= PCI_COMMAND_IO | PCI_COMMAND_MEMORY | PCI_COMMAND_MASTER;
+    pci_config_write16(dev->bus, dev->slot, dev->function, PCI_COMMAND, command);
+}
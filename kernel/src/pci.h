@@ -0,0 +1,47 @@
+// pci.h
+#ifndef PCI_H
+#define PCI_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define PCI_CONFIG_ADDRESS 0xCF8
+#define PCI_CONFIG_DATA    0xCFC
+
+// Các offset trong không gian cấu hình PCI
+#define PCI_VENDOR_ID      0x00
+#define PCI_DEVICE_ID      0x02
+#define PCI_COMMAND        0x04
+#define PCI_HEADER_TYPE    0x0E
+#define PCI_BAR0           0x10
+
+// Các bit của thanh ghi COMMAND
+#define PCI_COMMAND_IO     0x1
+#define PCI_COMMAND_MEMORY 0x2
+#define PCI_COMMAND_MASTER 0x4
+
+// Vị trí của một thiết bị PCI trên bus
+typedef struct {
+    uint8_t bus;
+    uint8_t slot;
+    uint8_t function;
+    uint16_t vendor_id;
+    uint16_t device_id;
+} pci_device_t;
+
+// Đọc/ghi không gian cấu hình qua cơ chế #1 (cổng 0xCF8/0xCFC)
+uint32_t pci_config_read32(uint8_t bus, uint8_t slot, uint8_t function, uint8_t offset);
+uint16_t pci_config_read16(uint8_t bus, uint8_t slot, uint8_t function, uint8_t offset);
+void pci_config_write32(uint8_t bus, uint8_t slot, uint8_t function, uint8_t offset, uint32_t value);
+void pci_config_write16(uint8_t bus, uint8_t slot, uint8_t function, uint8_t offset, uint16_t value);
+
+// Tìm thiết bị đầu tiên khớp vendor/device. Trả về true nếu tìm thấy
+bool pci_find_device(uint16_t vendor_id, uint16_t device_id, pci_device_t *out);
+
+// Đọc BAR; trả về địa chỉ cổng I/O hoặc địa chỉ MMIO (đã bỏ các bit cờ)
+uint64_t pci_read_bar(const pci_device_t *dev, int bar, bool *is_io);
+
+// Bật giải mã I/O, memory và bus mastering cho thiết bị
+void pci_enable_device(const pci_device_t *dev);
+
+#endif // PCI_H
@@ -0,0 +1,35 @@
+// percpu.c
+#include "percpu.h"
+#include "cpu.h"
+#include "stacks.h"
+
+cpu_t cpus[MAX_CPUS];
+uint32_t cpu_count = 1;
+
+/**
+ * Points GS base at @p cpu for the calling CPU.
+ *
+ * Loading a segment selector into GS clears the base, so this must run after
+ * reloadSegments. KERNEL_GS_BASE starts at zero and holds the user GS base
+ * while the CPU is in the kernel; the entry stubs swapgs on every transition
+ * from and to user mode.
+ */
+void percpu_load(cpu_t *cpu) {
+    cpu->self = cpu;
+    wrmsr(IA32_GS_BASE_MSR, (uint64_t)cpu);
+    wrmsr(IA32_KERNEL_GS_BASE_MSR, 0);
+}
+
+void percpu_init_bsp() {
+    uint32_t eax, ebx, ecx, edx;
+    cpu_t *cpu = &cpus[0];
+
+    cpuid(1, 0, &eax, &ebx, &ecx, &edx);
+    cpu->id = 0;
+    cpu->lapic_id = ebx >> 24;
+    cpu->tss = &tss;
+    cpu->kernel_stack_top = kernel_stack_top;
+    cpu->ist1_stack_top = ist1_stack_top;
+    cpu->online = true;
+    percpu_load(cpu);
+}
@@ -0,0 +1,96 @@
+// percpu.h
+#ifndef PERCPU_H
+#define PERCPU_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "gdt.h"
+#include "tss.h"
+
+// Số CPU tối đa được hỗ trợ
+#define MAX_CPUS 64
+
+struct process;
+struct rcu_head;
+struct tasklet;
+struct address_space;
+
+// Dữ liệu riêng của mỗi CPU, truy cập qua GS base
+typedef struct cpu {
+    struct cpu *self;               // Phải ở offset 0: this_cpu() đọc %gs:0
+    // Hai trường sau phải ở offset 8 và 16: syscall_entry (syscall_handler.S) dùng chúng
+    // khi chưa có stack nào
+    uint64_t user_rsp;              // RSP của user lúc vào lệnh syscall
+    uint64_t syscall_rsp;           // Đỉnh kernel stack của tiến trình đang chạy (bằng tss->rsp0)
+    uint32_t id;                    // Chỉ số logic (0 = BSP)
+    uint32_t lapic_id;              // ID của Local APIC
+    struct process *current;        // Tiến trình đang chạy trên CPU này
+    TSS *tss;                       // TSS đang được nạp (BSP dùng tss toàn cục)
+    uint64_t kernel_stack_top;      // Stack kernel của CPU khi chưa chạy tiến trình nào
+    uint64_t ist1_stack_top;        // Stack IST1 cho double fault
+    volatile bool online;           // Đặt khi CPU đã khởi tạo xong
+    volatile bool need_resched;     // Tiến trình đang chạy cần nhường CPU ở điểm chiếm quyền kế tiếp
+    volatile bool polling;          // Đang MWAIT trên need_resched: đánh thức bằng cách ghi, không cần IPI
+    bool tick_stopped;              // Tick định kỳ đang tắt vì CPU rảnh
+    uint64_t next_tick_tsc;         // Thời điểm TSC của tick định kỳ kế tiếp
+    uint32_t preempt_count;         // > 0: không được chiếm quyền (spinlock, vùng đọc RCU)
+    struct address_space *active_mm; // Không gian địa chỉ có page table đang nạp (giữ một tham chiếu)
+    uint64_t fs_base;               // FS base đang nạp trong MSR
+
+    // Đo độ trễ (chỉ khi LATENCY_TRACE = 1), tính bằng chu kỳ TSC
+    uint64_t preempt_off_start;
+    void *preempt_off_ip;
+    uint64_t max_preempt_off;
+    void *max_preempt_off_ip;       // Nơi bắt đầu đoạn tắt chiếm quyền dài nhất
+    uint64_t irqs_off_start;
+    void *irqs_off_ip;
+    uint64_t max_irqs_off;
+    void *max_irqs_off_ip;          // Nơi bắt đầu đoạn tắt ngắt dài nhất
+
+    // Trạng thái RCU của CPU
+    volatile bool rcu_idle;         // Đang halt: coi như tĩnh
+    bool rcu_irq_from_idle;         // Ngắt hiện tại đánh thức CPU khỏi trạng thái idle của RCU
+    volatile uint64_t rcu_qs_seq;   // Grace period mới nhất mà CPU đã đi qua trạng thái tĩnh
+    struct rcu_head *rcu_next;      // Callback chưa gắn với grace period nào
+    struct rcu_head *rcu_wait;      // Callback chờ grace period rcu_wait_seq kết thúc
+    uint64_t rcu_wait_seq;
+    struct rcu_head *rcu_done;      // Callback có grace period đã kết thúc, chạy trong softirq
+
+    // Softirq: phần việc của ngắt được dời ra khỏi lúc tắt ngắt
+    uint32_t irq_depth;             // Số handler ngắt cứng đang chạy lồng nhau
+    volatile uint32_t softirq_pending; // Bit i: softirq i cần chạy
+    bool in_softirq;                // Đang chạy handler softirq trên CPU này
+    struct process *ksoftirqd;      // Luồng kernel chạy softirq khi chúng quá nhiều để chạy lúc thoát ngắt
+    struct tasklet *tasklets;       // Tasklet đang chờ chạy
+
+    // Bộ đếm thống kê
+    uint64_t ticks;                 // Số ngắt timer
+    uint64_t irq_count;             // Số ngắt phần cứng đã xử lý
+    uint64_t syscall_count;         // Số syscall đã xử lý
+    uint64_t context_switches;      // Số lần chuyển tiến trình
+    uint64_t idle_entries;          // Số lần vào trạng thái ngủ khi rảnh
+    uint64_t softirq_count;         // Số lần chạy handler softirq
+
+    // GDT và TSS riêng của AP
+    uint8_t gdt[GDT_SIZE] __attribute__((aligned(16)));
+    GDTR gdt_ptr;
+    TSS tss_data;
+} cpu_t;
+
+extern cpu_t cpus[MAX_CPUS];
+extern uint32_t cpu_count;
+
+// Dữ liệu per-CPU của CPU đang chạy
+static inline cpu_t *this_cpu(void) {
+    cpu_t *cpu;
+    __asm__ volatile("movq %%gs:0, %0" : "=r"(cpu));
+    return cpu;
+}
+
+// Gắn vùng per-CPU vào GS base của CPU đang chạy (gọi sau khi nạp GDT)
+void percpu_load(cpu_t *cpu);
+
+// Khởi tạo dữ liệu per-CPU của BSP, dùng GDT/TSS/stack toàn cục
+void percpu_init_bsp();
+
+#endif // PERCPU_H
@@ -0,0 +1,127 @@
+// pkey.c
+#include "pkey.h"
+#include "cpu.h"
+#include "paging.h"
+#include "graphics.h"
+#include "config.h"
+
+bool pku_supported = false;
+
+/**
+ * Enables memory protection keys when the CPU supports them.
+ *
+ * Support is reported by CPUID.(EAX=7,ECX=0):ECX[3]. Under QEMU this needs a
+ * CPU model with the pku flag, e.g. -cpu qemu64,+pku (TCG emulates it).
+ *
+ * @return true if CR4.PKE was enabled.
+ */
+bool pku_init() {
+    uint32_t eax, ebx, ecx, edx;
+    cpuid(0, 0, &eax, &ebx, &ecx, &edx);
+    if (eax < 7) {
+        return false;
+    }
+
+    cpuid(7, 0, &eax, &ebx, &ecx, &edx);
+    if (!(ecx & (1u << 3))) {
+        kprintf("PKU: Not supported by this CPU\n");
+        return false;
+    }
+
+    write_cr4(read_cr4() | CR4_PKE);
+    wrpkru(PKRU_DEFAULT);
+    pku_supported = true;
+    kprintf("PKU: Enabled\n");
+    return true;
+}
+
+/**
+ * Enables PKU on an application processor when the BSP found it supported.
+ */
+void pku_init_ap() {
+    if (!pku_supported) {
+        return;
+    }
+    write_cr4(read_cr4() | CR4_PKE);
+    wrpkru(PKRU_DEFAULT);
+}
+
+/**
+ * Allocates a free protection key for @p proc.
+ *
+ * The access rights of the new key are applied to the live PKRU right away,
+ * since the caller is the running process; the live value is read back first
+ * because user code may have changed it with WRPKRU since the last switch.
+ *
+ * @param proc The calling process.
+ * @param flags Reserved, must be 0.
+ * @param access_rights PKEY_DISABLE_ACCESS and/or PKEY_DISABLE_WRITE.
+ *
+ * @return The allocated key (1-15) or -1 on failure.
+ */
+int pkey_alloc(process_t *proc, uint32_t flags, uint32_t access_rights) {
+    if (!pku_supported || !proc || !proc->mm || flags != 0 ||
+        (access_rights & ~(PKEY_DISABLE_ACCESS | PKEY_DISABLE_WRITE))) {
+        return -1;
+    }
+
+    address_space_t *mm = proc->mm;
+    for (int pkey = 1; pkey < PKEY_COUNT; pkey++) {
+        uint64_t flags_saved = spin_lock_irqsave(&mm->lock);
+        if (mm->pkey_bitmap & (1u << pkey)) {
+            spin_unlock_irqrestore(&mm->lock, flags_saved);
+            continue;
+        }
+        mm->pkey_bitmap |= (1u << pkey);
+        spin_unlock_irqrestore(&mm->lock, flags_saved);
+
+        // Quyền của key nằm trong PKRU của luồng gọi; các luồng khác bắt đầu với key bị cấm
+        uint32_t pkru = rdpkru();
+        pkru &= ~(0x3u << (pkey * 2));
+        pkru |= access_rights << (pkey * 2);
+        proc->pkru = pkru;
+        wrpkru(pkru);
+        return pkey;
+    }
+    return -1;
+}
+
+int pkey_free(process_t *proc, int pkey) {
+    if (!pku_supported || !proc || !proc->mm || pkey <= 0 || pkey >= PKEY_COUNT) {
+        return -1;
+    }
+    address_space_t *mm = proc->mm;
+    uint64_t flags = spin_lock_irqsave(&mm->lock);
+    int ret = (mm->pkey_bitmap & (1u << pkey)) ? 0 : -1;
+    mm->pkey_bitmap &= ~(1u << pkey);
+    spin_unlock_irqrestore(&mm->lock, flags);
+    return ret;
+}
+
+/**
+ * Tags the pages of a user range with a protection key.
+ *
+ * @param proc The calling process.
+ * @param addr The page-aligned start of the range.
+ * @param len The length of the range in bytes.
+ * @param pkey An allocated key, or 0 to restore the default key.
+ *
+ * @return 0 on success, -1 if the key is not allocated or the range is not
+ *         entirely mapped user memory.
+ */
+int pkey_mprotect(process_t *proc, uint64_t addr, uint64_t len, int pkey) {
+    if (!pku_supported || !proc || !proc->mm || pkey < 0 || pkey >= PKEY_COUNT) {
+        return -1;
+    }
+    if (pkey != 0 && !(__atomic_load_n(&proc->mm->pkey_bitmap, __ATOMIC_RELAXED) & (1u << pkey))) {
+        return -1;
+    }
+    if (addr % PAGE_SIZE != 0 || len == 0 || addr + len < addr || addr + len > USER_SPACE_END) {
+        return -1;
+    }
+
+    bool ok = paging_set_pkey(proc->mm->page_table, addr, len, pkey);
+    // Các luồng khác của tiến trình có thể đang chạy trên CPU khác với PTE cũ trong TLB
+    address_space_flush_tlb(proc->mm, addr, len);
+    return ok ? 0 : -1;
+}
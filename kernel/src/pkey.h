@@ -0,0 +1,37 @@
+// pkey.h
+#ifndef PKEY_H
+#define PKEY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "process.h"
+
+// Số protection key phần cứng hỗ trợ
+#define PKEY_COUNT 16
+
+// Quyền truy cập cho từng key (2 bit trong PKRU)
+#define PKEY_DISABLE_ACCESS 0x1
+#define PKEY_DISABLE_WRITE  0x2
+
+// PKRU mặc định: key 0 được truy cập tự do, các key khác bị cấm
+#define PKRU_DEFAULT 0x55555554
+
+// true nếu CPU hỗ trợ PKU và CR4.PKE đã được bật
+extern bool pku_supported;
+
+// Kiểm tra CPUID và bật CR4.PKE nếu được hỗ trợ
+bool pku_init();
+
+// Bật PKU trên AP nếu BSP đã xác nhận CPU hỗ trợ
+void pku_init_ap();
+
+// Cấp phát một key cho tiến trình và đặt quyền ban đầu. Trả về key hoặc -1
+int pkey_alloc(process_t *proc, uint32_t flags, uint32_t access_rights);
+
+// Giải phóng một key đã cấp phát. Trả về 0 hoặc -1
+int pkey_free(process_t *proc, int pkey);
+
+// Gán key cho các trang của dải [addr, addr + len) trong không gian địa chỉ của tiến trình
+int pkey_mprotect(process_t *proc, uint64_t addr, uint64_t len, int pkey);
+
+#endif // PKEY_H
@@ -0,0 +1,90 @@
+// preempt.c
+#include "preempt.h"
+#include "graphics.h"
+#include "timer.h"
+#include "scheduler.h"
+
+#if LATENCY_TRACE
+
+// Các hàm dưới đây chạy khi đã tắt chiếm quyền hoặc tắt ngắt, nên this_cpu() ổn định
+
+void latency_preempt_off(void *ip) {
+    cpu_t *cpu = this_cpu();
+    cpu->preempt_off_start = rdtsc();
+    cpu->preempt_off_ip = ip;
+}
+
+void latency_preempt_on(void) {
+    cpu_t *cpu = this_cpu();
+    if (!cpu->preempt_off_start) {
+        return;
+    }
+    uint64_t cycles = rdtsc() - cpu->preempt_off_start;
+    cpu->preempt_off_start = 0;
+    if (cycles > cpu->max_preempt_off) {
+        cpu->max_preempt_off = cycles;
+        cpu->max_preempt_off_ip = cpu->preempt_off_ip;
+    }
+}
+
+void latency_irqs_off(void *ip) {
+    cpu_t *cpu = this_cpu();
+    cpu->irqs_off_start = rdtsc();
+    cpu->irqs_off_ip = ip;
+}
+
+/**
+ * Closes the interrupts-off section opened by latency_irqs_off().
+ *
+ * Sections are tracked per CPU rather than per process: if the process that
+ * disabled interrupts switches away, the one that re-enables them closes the
+ * section, which is exactly how long this CPU could not take an interrupt.
+ */
+void latency_irqs_on(void) {
+    cpu_t *cpu = this_cpu();
+    if (!cpu->irqs_off_start) {
+        return;
+    }
+    uint64_t cycles = rdtsc() - cpu->irqs_off_start;
+    cpu->irqs_off_start = 0;
+    if (cycles > cpu->max_irqs_off) {
+        cpu->max_irqs_off = cycles;
+        cpu->max_irqs_off_ip = cpu->irqs_off_ip;
+    }
+}
+
+// Đổi chu kỳ TSC sang micro giây
+static uint64_t cycles_to_us(uint64_t cycles) {
+    return tsc_per_ms ? cycles * 1000 / tsc_per_ms : 0;
+}
+
+/**
+ * Prints the longest interrupts-off and preemption-off sections seen on each
+ * CPU, with the code address that opened them, and the worst scheduling
+ * latency. A wakeup waits at most for the longest of these sections plus one
+ * pass through the scheduler.
+ */
+void latency_trace_dump(void) {
+    kprintf("Latency trace (longest sections, microseconds):\n");
+    for (uint32_t i = 0; i < cpu_count; i++) {
+        cpu_t *cpu = &cpus[i];
+        if (!cpu->online) {
+            continue;
+        }
+        kprintf("  CPU %u: irqs-off %llu at %p, preempt-off %llu at %p\n", i,
+                cycles_to_us(cpu->max_irqs_off), cpu->max_irqs_off_ip,
+                cycles_to_us(cpu->max_preempt_off), cpu->max_preempt_off_ip);
+    }
+    kprintf("  Worst scheduling latency: %llu\n", sched_latency_max_ns / 1000);
+}
+
+void latency_trace_reset(void) {
+    for (uint32_t i = 0; i < cpu_count; i++) {
+        cpus[i].max_irqs_off = 0;
+        cpus[i].max_irqs_off_ip = 0;
+        cpus[i].max_preempt_off = 0;
+        cpus[i].max_preempt_off_ip = 0;
+    }
+}
+
+#endif
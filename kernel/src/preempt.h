@@ -0,0 +1,88 @@
+// preempt.h
+#ifndef PREEMPT_H
+#define PREEMPT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "config.h"
+#include "percpu.h"
+
+// Kernel có thể bị chiếm quyền bất cứ khi nào preempt_count của CPU bằng 0 và ngắt đang bật.
+// Spinlock và vùng đọc RCU tăng preempt_count; preempt_enable về 0 sẽ nhường CPU nếu cần.
+
+// Đo đoạn tắt ngắt/tắt chiếm quyền dài nhất; latency_trace_dump() in kết quả của mỗi CPU
+#if LATENCY_TRACE
+void latency_preempt_off(void *ip);
+void latency_preempt_on(void);
+void latency_irqs_off(void *ip);
+void latency_irqs_on(void);
+void latency_trace_dump(void);
+void latency_trace_reset(void);
+#else
+#define latency_preempt_off(ip) ((void)0)
+#define latency_preempt_on() ((void)0)
+#define latency_irqs_off(ip) ((void)0)
+#define latency_irqs_on() ((void)0)
+#define latency_trace_dump() ((void)0)
+#define latency_trace_reset() ((void)0)
+#endif
+
+// Nhường CPU nếu CPU đang chạy một tiến trình và preempt_count bằng 0 (định nghĩa trong scheduler.c)
+void preempt_schedule(void);
+
+static inline uint32_t preempt_count(void) {
+    uint32_t count;
+    // Đọc qua GS trong một lệnh: không thể bị chuyển sang CPU khác giữa chừng
+    __asm__ volatile("movl %%gs:%c1, %0" : "=r"(count) : "i"(offsetof(cpu_t, preempt_count)));
+    return count;
+}
+
+static inline bool irqs_enabled(void) {
+    uint64_t flags;
+    __asm__ volatile("pushfq; popq %0" : "=r"(flags));
+    return flags & 0x200;
+}
+
+static inline void preempt_disable(void) {
+    __asm__ volatile("incl %%gs:%c0" : : "i"(offsetof(cpu_t, preempt_count)) : "memory");
+#if LATENCY_TRACE
+    if (preempt_count() == 1) {
+        latency_preempt_off(__builtin_return_address(0));
+    }
+#endif
+}
+
+// Giảm preempt_count mà không kiểm tra need_resched (dùng khi sắp tự gọi schedule())
+static inline bool preempt_enable_no_resched(void) {
+    bool zero;
+#if LATENCY_TRACE
+    if (preempt_count() == 1) {
+        latency_preempt_on();
+    }
+#endif
+    __asm__ volatile("decl %%gs:%c1" : "=@ccz"(zero) : "i"(offsetof(cpu_t, preempt_count)) : "memory");
+    return zero;
+}
+
+// Chiếm quyền ngay nếu cần và được phép (dùng sau khi bật lại ngắt)
+static inline void preempt_check_resched(void) {
+    if (this_cpu()->need_resched && preempt_count() == 0 && irqs_enabled()) {
+        preempt_schedule();
+    }
+}
+
+static inline void preempt_enable(void) {
+    if (preempt_enable_no_resched()) {
+        preempt_check_resched();
+    }
+}
+
+// Điểm chiếm quyền tường minh cho vòng lặp dài, kể cả khi ngắt đang tắt
+static inline void cond_resched(void) {
+    if (this_cpu()->need_resched && preempt_count() == 0) {
+        preempt_schedule();
+    }
+}
+
+#endif // PREEMPT_H
@@ -1,44 +1,159 @@
 // process.c
 #include "process.h"
 #include "elf_loader.h"
+#include "heap.h"
 #include "context_switcher.h"
 #include "paging.h"
 #include "klibc.h"
 #include "graphics.h"
 
 #include "bitmap_allocator.h"
+#include "pkey.h"
+#include "scheduler.h"
+#include "gdt.h"
+#include "sched_fair.h"
+#include "timer.h"
+#include "percpu.h"
+#include "vdso.h"
+#include "uring.h"
+#include "ipc.h"
 
 #include <stddef.h>
 #include "config.h"
+#include "cpu.h"
 
-static process_t *ready_queue_head = NULL;
-static process_t *ready_queue_tail = NULL;
 uint64_t current_pid = 1;
 
+// Bảng băm PID -> tiến trình: reader dùng RCU, writer tuần tự hóa bằng pid_lock
+#define PID_HASH_SIZE 256
+static rcu_hlist_head_t pid_table[PID_HASH_SIZE];
+static spinlock_t pid_lock = SPINLOCK_INIT;
+
+uint64_t process_alloc_pid() {
+    return __atomic_fetch_add(&current_pid, 1, __ATOMIC_RELAXED);
+}
+
+void process_hash(process_t *proc) {
+    uint64_t flags = spin_lock_irqsave(&pid_lock);
+    rcu_hlist_add_head(&proc->pid_node, rcu_hash_bucket(pid_table, PID_HASH_SIZE, proc->pid));
+    spin_unlock_irqrestore(&pid_lock, flags);
+}
+
+void process_unhash(process_t *proc) {
+    uint64_t flags = spin_lock_irqsave(&pid_lock);
+    if (!rcu_hlist_unhashed(&proc->pid_node)) {
+        rcu_hlist_del(&proc->pid_node);
+    }
+    spin_unlock_irqrestore(&pid_lock, flags);
+}
+
+process_t *process_find(uint64_t pid) {
+    process_t *proc;
+    rcu_hlist_for_each_entry(proc, rcu_hash_bucket(pid_table, PID_HASH_SIZE, pid), process_t, pid_node) {
+        if (proc->pid == pid) {
+            return proc;
+        }
+    }
+    return NULL;
+}
+process_t *process_current() {
+    return this_cpu()->current;
+}
+
+void process_set_current(process_t *proc) {
+    this_cpu()->current = proc;
+}
+
 void process_enqueue(process_t *proc) {
     if (!proc) return;
 
-    proc->next = NULL;
-    if (ready_queue_tail) {
-        ready_queue_tail->next = proc;
-    } else {
-        ready_queue_head = proc;
-    }
-    ready_queue_tail = proc;
+    runqueue_t *rq = &runqueues[proc->cpu];
+    uint64_t flags = spin_lock_irqsave(&rq->lock);
+    proc->wait_start = timer_now_ns();
+    fair_enqueue(&rq->fair, proc);
+    spin_unlock_irqrestore(&rq->lock, flags);
 }
 
 process_t *process_dequeue() {
-    if (!ready_queue_head) return NULL;
+    runqueue_t *rq = this_rq();
+    uint64_t flags = spin_lock_irqsave(&rq->lock);
+    process_t *proc = fair_first(&rq->fair);
+    if (proc) {
+        fair_dequeue(&rq->fair, proc);
+    }
+    spin_unlock_irqrestore(&rq->lock, flags);
+    return proc;
+}
 
-    process_t *proc = ready_queue_head;
-    ready_queue_head = ready_queue_head->next;
-    if (!ready_queue_head) {
-        ready_queue_tail = NULL;
+process_t *process_alloc() {
+    uint64_t proc_phys = allocate_memory_bytes(sizeof(process_t));
+    if (!proc_phys) {
+        kprintf("Process Manager: Failed to allocate memory for process\n");
+        return NULL;
+    }
+    // Kernel stack riêng: mọi ngắt và syscall của tiến trình chạy trên stack này
+    uint64_t kernel_stack_phys = allocate_physical_blocks(KERNEL_STACK_SIZE / BLOCK_SIZE);
+    if (!kernel_stack_phys) {
+        kprintf("Process Manager: Failed to allocate kernel stack\n");
+        free_memory_bytes(proc_phys, sizeof(process_t));
+        return NULL;
     }
-    proc->next = NULL;
+
+    process_t *proc = (process_t *)PHYS_TO_VIRT(proc_phys);
+    memset(proc, 0, sizeof(process_t));
+    proc->pid = process_alloc_pid();
+    proc->tgid = proc->pid;
+    proc->pkru = PKRU_DEFAULT;
+    proc->kernel_stack = (uint64_t)PHYS_TO_VIRT(kernel_stack_phys);
+    proc->kernel_stack_top = proc->kernel_stack + KERNEL_STACK_SIZE;
     return proc;
 }
 
+// Giải phóng process_t và kernel stack của tiến trình (không còn ai dùng)
+static void process_free(process_t *proc) {
+    if (proc->mm) {
+        address_space_put(proc->mm);
+    }
+    free_physical_blocks((uint64_t)VIRT_TO_PHYS(proc->kernel_stack), KERNEL_STACK_SIZE / BLOCK_SIZE);
+    free_memory_bytes((uint64_t)VIRT_TO_PHYS(proc), sizeof(process_t));
+}
+
+static void process_free_rcu(rcu_head_t *head) {
+    process_free(container_of(head, process_t, rcu));
+}
+
+/**
+ * Frees a terminated process.
+ *
+ * The scheduler calls this once another context runs on the CPU, so the
+ * kernel stack is no longer in use. process_find() readers may still hold
+ * the pointer until the end of the current grace period.
+ */
+void process_reap(process_t *proc) {
+    call_rcu(&proc->rcu, process_free_rcu);
+}
+
+/**
+ * Builds the initial trap frame of a user thread at the top of its kernel
+ * stack, marked as if it had just entered through a syscall so that its
+ * first run returns to @p entry with sysretq.
+ */
+static void process_init_user_frame(process_t *proc, uint64_t entry, uint64_t stack, uint64_t arg) {
+    trap_frame_t *frame = (trap_frame_t *)(proc->kernel_stack_top - sizeof(trap_frame_t));
+    memset(frame, 0, sizeof(trap_frame_t));
+    frame->vector = SYSCALL_VECTOR;
+    frame->rip = entry;
+    frame->cs = GDT_USER_CODE;
+    frame->rflags = 0x202;                 // IF = 1
+    frame->rsp = stack;
+    frame->ss = GDT_USER_DATA;
+    frame->rdi = arg;
+    proc->frame = frame;
+
+    // Lần chạy đầu tiên đi thẳng tới trap_restore với RSP trỏ vào frame
+    context_init(&proc->context, (uint64_t)frame, trap_restore);
+}
+
 // Hàm tạo một tiến trình mới từ ELF binary
 process_t *process_create(uint8_t *elf_start, uint8_t *elf_end)
 {
@@ -47,66 +162,148 @@ process_t *process_create(uint8_t *elf_start, uint8_t *elf_end)
         return NULL;
     }
 
-    process_t *proc = (process_t *)PHYS_TO_VIRT(allocate_memory_bytes(sizeof(process_t)));
+    process_t *proc = process_alloc();
     if (!proc) {
-        kprintf("Process Manager: Failed to allocate memory for process\n");
         return NULL;
     }
 
-    memset(proc, 0, sizeof(process_t));
-
-    proc->pid = current_pid++;
-    proc->state = PROCESS_STATE_READY;
-
-     proc->page_table = (uint64_t)create_user_page_table();
-    if (!proc->page_table) {
+    proc->mm = address_space_create();
+    if (!proc->mm) {
         kprintf("Process Manager: Failed to create page table\n");
-        free_memory_bytes(VIRT_TO_PHYS(proc), sizeof(process_t));
+        process_free(proc);
         return NULL;
     }
+    proc->page_table = proc->mm->page_table;
+    proc->mm->users = 1;
 
-    uint64_t entry_point = elf_load(proc->page_table, elf_start, elf_end);
+    uint64_t image_end;
+    uint64_t entry_point = elf_load(proc->page_table, elf_start, elf_end, &image_end);
     if (!entry_point) {
         kprintf("Process Manager: Failed to load ELF binary\n");
-        free_memory_bytes(VIRT_TO_PHYS(proc), sizeof(process_t));
-        // Also free page table and any allocated resources
+        process_free(proc);
         return NULL;
     }
+    heap_init(proc->mm, image_end);
 
     // Allocate and map user stack
     uint64_t user_stack_phys = allocate_physical_block();
     if (!user_stack_phys) {
         kprintf("Process Manager: Failed to allocate user stack\n");
-        free_memory_bytes(VIRT_TO_PHYS(proc), sizeof(process_t));
-        // Also free page table and any allocated resources
+        process_free(proc);
         return NULL;
     }
 
     uint64_t user_stack_virt = 0x7FFFFFFF0000;
     if (!map_memory(proc->page_table, user_stack_virt - BLOCK_SIZE, user_stack_phys, BLOCK_SIZE, PAGING_PAGE_PRESENT | PAGING_PAGE_RW | PAGING_PAGE_USER)) {
         kprintf("Process Manager: Failed to map user stack\n");
-        free_memory_bytes(VIRT_TO_PHYS(proc), sizeof(process_t));
-        // Free other resources
+        free_physical_block(user_stack_phys);
+        process_free(proc);
         return NULL;
     }
 
-    proc->context.rip = entry_point;
-    proc->context.rsp = user_stack_virt - 16; // 16-byte aligned
+    if (!vdso_map(proc->mm, proc->tgid)) {
+        kprintf("Process Manager: Failed to map vDSO\n");
+        process_free(proc);
+        return NULL;
+    }
 
-    process_enqueue(proc);
+    process_init_user_frame(proc, entry_point, user_stack_virt - 16, 0); // 16-byte aligned
+
+    process_hash(proc);
+    sched_new_task(proc);
     kprintf("Process Manager: Created process PID=%llu\n", proc->pid);
     return proc;
 }
 
-// Hàm chạy tiến trình đầu tiên
+/**
+ * Creates a thread in the address space of @p parent.
+ *
+ * The thread shares the parent's page table, protection keys and thread
+ * group, inherits its PKRU, nice level, CPU mask and task group, and starts
+ * with FS base 0. The caller provides the user stack; the kernel does not
+ * free it when the thread exits.
+ *
+ * @param parent A user thread (must have an address space).
+ * @param entry User address the thread starts at.
+ * @param stack Top of the thread's user stack.
+ * @param arg Passed to @p entry in rdi.
+ * @return The new thread, already queued, or NULL.
+ */
+process_t *thread_create(process_t *parent, uint64_t entry, uint64_t stack, uint64_t arg) {
+    if (!parent || !parent->mm || !entry || entry >= USER_SPACE_END || !stack || stack > USER_SPACE_END) {
+        return NULL;
+    }
+    process_t *proc = process_alloc();
+    if (!proc) {
+        return NULL;
+    }
+
+    address_space_get(parent->mm);
+    __atomic_fetch_add(&parent->mm->users, 1, __ATOMIC_RELAXED);
+    proc->mm = parent->mm;
+    proc->page_table = parent->mm->page_table;
+    proc->tgid = parent->tgid;
+    proc->pkru = parent->pkru;
+    proc->nice = parent->nice;
+    // Luồng mới thuộc lớp công bằng: nhận mặt nạ của cha, không phải CPU mà lớp deadline gắn cha vào
+    proc->cpus_allowed = parent->policy == SCHED_POLICY_DEADLINE ? parent->dl_cpus_allowed : parent->cpus_allowed;
+    // Lệnh call đặt địa chỉ trả về lên stack: entry thấy RSP + 8 căn 16 byte như một hàm bình thường
+    process_init_user_frame(proc, entry, (stack & ~0xFULL) - 8, arg);
+
+    process_hash(proc);
+    // Vào nhóm trước khi được xếp hàng: luồng không được chạy dù chỉ một lát với trọng số ngoài nhóm
+    if (parent->group) {
+        sched_group_attach(proc, parent->group);
+    }
+    sched_new_task(proc);
+    return proc;
+}
+
+/**
+ * Terminates the calling thread.
+ *
+ * The process_t, its kernel stack and its address space reference are freed
+ * once the scheduler has switched away. The page table stays loaded until
+ * this CPU switches to another one, because the CPU holds its own reference
+ * through active_mm.
+ */
+void process_exit(int status) {
+    process_t *self = process_current();
+    kprintf("Process Manager: PID=%llu (TGID=%llu) exited with status %d\n", self->pid, self->tgid, status);
+    process_unhash(self);
+    // Nhóm chỉ bỏ thành viên đã kết thúc khi tính lại trọng số, mà bộ nhớ của luồng sắp bị giải phóng
+    if (self->group) {
+        sched_group_attach(self, NULL);
+    }
+    ipc_exit(self);
+    // Luồng user cuối cùng: không ai còn dùng vòng gửi/nhận
+    if (self->mm && __atomic_sub_fetch(&self->mm->users, 1, __ATOMIC_ACQ_REL) == 0) {
+        uring_release(self->mm);
+    }
+    self->state = PROCESS_STATE_TERMINATED;
+    schedule();
+    // schedule() không bao giờ chọn lại tiến trình đã kết thúc
+    for (;;) {
+        __asm__ volatile("hlt");
+    }
+}
+
+int process_set_fs_base(uint64_t fs_base) {
+    process_t *self = process_current();
+    if (!self || !self->mm || fs_base >= USER_SPACE_END) {
+        return -1;
+    }
+    // Tắt ngắt để MSR và bản ghi của CPU không lệch nhau nếu bị chiếm quyền giữa chừng
+    uint64_t flags = irq_save();
+    self->fs_base = fs_base;
+    this_cpu()->fs_base = fs_base;
+    wrmsr(IA32_FS_BASE_MSR, fs_base);
+    irq_restore(flags);
+    return 0;
+}
+
+// Hàm chạy tiến trình đầu tiên: kmain trở thành tiến trình idle của BSP
 void process_run()
 {
-    process_t *proc = process_dequeue();
-    if (!proc)
-    {
-        kprintf("Process Manager: No process to run\n");
-        return;
-    }
-    proc->state = PROCESS_STATE_RUNNING;
-    switch_to_user_space(proc->context.rip, proc->context.rsp, proc->page_table);
+    sched_idle_loop();
 }
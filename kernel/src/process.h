@@ -6,6 +6,10 @@
 #include <stdbool.h>
 #include "memory_manager.h"
 #include "paging.h"
+#include "idt.h"
+#include "rbtree.h"
+#include "rcu.h"
+#include "address_space.h"
 
 // Định nghĩa trạng thái của tiến trình
 typedef enum {
@@ -15,7 +19,16 @@ typedef enum {
     PROCESS_STATE_TERMINATED
 } process_state_t;
 
-// Cấu trúc ngữ cảnh CPU
+// Lớp lập lịch: deadline (EDF) luôn được chạy trước công bằng
+typedef enum {
+    SCHED_POLICY_FAIR,
+    SCHED_POLICY_DEADLINE
+} sched_policy_t;
+
+// Số từ 64 bit của một thông điệp IPC đồng bộ (các thanh ghi rsi, rdx, r10, r8, r9)
+#define IPC_MSG_WORDS 5
+
+// Cấu trúc ngữ cảnh CPU (bố cục khớp với context_switch.S)
 typedef struct cpu_context {
     uint64_t rsp;
     uint64_t rbp;
@@ -27,25 +40,111 @@ typedef struct cpu_context {
     uint64_t rip;
 } cpu_context_t;
 
-// Cấu trúc cho một tiến trình
+// Cấu trúc cho một tiến trình: một luồng thực thi. Các luồng của cùng một chương trình
+// dùng chung mm và tgid; mỗi luồng có ngữ cảnh, kernel stack, user stack và FS base riêng
 typedef struct process {
-    uint64_t pid;                      // ID của tiến trình
-    uint64_t page_table;               // Địa chỉ vật lý của page table
+    uint64_t pid;                      // ID của luồng (duy nhất)
+    uint64_t tgid;                     // ID của tiến trình = pid của luồng đầu tiên
+    address_space_t *mm;               // Không gian địa chỉ user (NULL với luồng kernel)
+    uint64_t page_table;               // PML4 đang dùng: mm->page_table, hoặc page table mượn (idle, luồng kernel)
+    uint64_t fs_base;                  // FS base của luồng (thread-local storage)
     process_state_t state;             // Trạng thái của tiến trình
-    cpu_context_t context;            // Ngữ cảnh CPU
-    struct process *next;              // Con trỏ đến tiến trình kế tiếp (dùng trong hàng đợi)
+    cpu_context_t context;            // Ngữ cảnh kernel được switch_context lưu/nạp
+    uint64_t kernel_stack;             // Địa chỉ ảo (HHDM) của kernel stack riêng
+    uint64_t kernel_stack_top;         // Đỉnh kernel stack, nạp vào tss.rsp0 khi chuyển tới tiến trình
+    trap_frame_t *frame;               // Thanh ghi user đã lưu khi vào kernel (luôn ở đỉnh kernel stack)
+    int nice;                          // Mức nice (-20..19), quyết định weight
+    uint32_t weight;                   // Trọng số trong lập lịch công bằng
+    uint64_t vruntime;                 // Thời gian chạy ảo (ns, chia theo trọng số)
+    uint64_t exec_start;               // Thời điểm bắt đầu được tính thời gian chạy
+    uint64_t sum_exec_runtime;         // Tổng thời gian chạy thực (ns)
+    uint64_t slice_exec_start;         // sum_exec_runtime khi được chọn chạy lần gần nhất
+    uint64_t wait_start;               // Thời điểm vào hàng đợi sẵn sàng
+    uint64_t wait_max_ns;              // Độ trễ lập lịch lớn nhất đã đo
+    uint64_t wait_sum_ns;              // Tổng độ trễ lập lịch
+    uint64_t wait_count;               // Số lần được chọn chạy từ hàng đợi
+    uint32_t pkru;                     // Giá trị PKRU được lưu khi tiến trình không chạy
+    rb_node_t run_node;                // Nút trong cây hàng đợi sẵn sàng (của lớp lập lịch hiện tại)
+    sched_policy_t policy;             // Lớp lập lịch
+    uint64_t dl_runtime;               // Deadline: ngân sách CPU mỗi chu kỳ (ns)
+    uint64_t dl_deadline;              // Deadline: hạn chót tính từ đầu chu kỳ (ns)
+    uint64_t dl_period;                // Deadline: chu kỳ (ns)
+    uint64_t dl_bw;                    // Băng thông đã được nhận (dl_runtime / dl_deadline)
+    uint64_t dl_period_start;          // Đầu chu kỳ của job hiện tại
+    uint64_t dl_abs_deadline;          // Hạn chót tuyệt đối của job hiện tại
+    int64_t dl_budget;                 // Ngân sách còn lại của job hiện tại (âm khi chạy lố)
+    uint64_t dl_next_period;           // Thời điểm nạp lại ngân sách khi đang bị tạm dừng
+    bool dl_throttled;                 // Đang chờ chu kỳ kế tiếp, không nằm trong hàng đợi
+    struct process *dl_throttled_next; // Danh sách tạm dừng của CPU
+    uint64_t dl_misses;                // Số job kết thúc sau hạn chót
+    uint64_t dl_throttles;             // Số lần bị tạm dừng vì hết ngân sách
+    struct task_group *group;          // Nhóm giới hạn CPU (NULL nếu không thuộc nhóm nào)
+    struct process *group_next;        // Thành viên kế tiếp trong nhóm
+    bool group_throttled;              // Đang chờ trong danh sách của CPU vì nhóm hết quota
+    struct process *throttled_next;    // Danh sách chờ đó
+    uint64_t cpus_allowed;             // Mặt nạ CPU được phép chạy (bit i = CPU i)
+    uint64_t dl_cpus_allowed;          // Deadline: mặt nạ được khôi phục khi rời lớp deadline
+    uint32_t cpu;                      // CPU có hàng đợi chứa tiến trình / chạy nó gần nhất
+    uint64_t last_ran;                 // Thời điểm rời CPU gần nhất, dùng để đánh giá cache còn nóng
+    rcu_hlist_node_t pid_node;         // Nút trong bảng PID
+    rcu_head_t rcu;                    // Dùng để giải phóng sau grace period
+    bool kthread;                      // Luồng kernel: không có không gian user, mượn page table của tiến trình trước
+    void (*kthread_fn)(void *arg);     // Hàm thân của luồng kernel
+    void *kthread_arg;
+    uint32_t ipc_state;                // Trạng thái IPC đồng bộ (IPC_IDLE...); các trường ipc_* do ipc_lock bảo vệ
+    int ipc_result;                    // Kết quả của ipc_call: 0, hoặc -1 nếu server kết thúc trước khi trả lời
+    uint64_t ipc_msg[IPC_MSG_WORDS];   // Thông điệp đang gửi, hoặc vừa nhận được
+    uint64_t ipc_from;                 // PID của caller mà ipc_reply_wait vừa nhận
+    struct process *ipc_senders;       // Caller chờ luồng này nhận, theo thứ tự gọi
+    struct process *ipc_clients;       // Caller luồng này đã nhận và chưa trả lời
+    struct process *ipc_next;          // Mắt xích trong ipc_senders hoặc ipc_clients của server
 } process_t;
 
 // Hàm tạo một tiến trình mới từ ELF binary
 process_t* process_create(uint8_t *elf_start, uint8_t *elf_end);
 
-// Hàm chạy tiến trình đầu tiên
+// Tạo luồng mới trong không gian địa chỉ của parent, chạy entry(arg) ở user mode trên
+// user stack cho trước. Trả về luồng mới hoặc NULL nếu tham số sai hay hết bộ nhớ
+process_t *thread_create(process_t *parent, uint64_t entry, uint64_t stack, uint64_t arg);
+
+// Kết thúc luồng đang chạy; luồng cuối của tiến trình giải phóng không gian địa chỉ
+void process_exit(int status) __attribute__((noreturn));
+
+// Cấp process_t đã xóa trắng cùng PID và kernel stack riêng (NULL nếu hết bộ nhớ)
+process_t *process_alloc();
+
+// Giải phóng luồng đã kết thúc sau grace period (scheduler gọi khi đã rời stack của nó)
+void process_reap(process_t *proc);
+
+// Đặt FS base của luồng đang chạy (chỉ địa chỉ user). Trả về 0 hoặc -1
+int process_set_fs_base(uint64_t fs_base);
+
+// Hàm chạy tiến trình đầu tiên: bắt đầu lập lịch trên BSP, không trả về
 void process_run();
 
-// Hàm thêm tiến trình vào hàng đợi sẵn sàng
+// Trả về tiến trình đang chạy trên CPU hiện tại (NULL nếu chưa có)
+process_t* process_current();
+
+// Đặt tiến trình đang chạy (chỉ scheduler dùng)
+void process_set_current(process_t *proc);
+
+// Cấp một PID mới
+uint64_t process_alloc_pid();
+
+// Đưa tiến trình vào bảng PID để process_find thấy được
+void process_hash(process_t *proc);
+
+// Gỡ tiến trình khỏi bảng PID; reader có thể còn giữ con trỏ tới hết grace period
+void process_unhash(process_t *proc);
+
+// Tìm tiến trình theo PID (NULL nếu không có). Không khóa: phải gọi trong
+// rcu_read_lock() và chỉ dùng kết quả trước rcu_read_unlock()
+process_t *process_find(uint64_t pid);
+
+// Hàm thêm tiến trình vào hàng đợi sẵn sàng của CPU proc->cpu (sắp theo vruntime)
 void process_enqueue(process_t *proc);
 
-// Hàm lấy tiến trình tiếp theo từ hàng đợi sẵn sàng
+// Hàm lấy tiến trình có vruntime nhỏ nhất từ hàng đợi của CPU hiện tại
 process_t* process_dequeue();
 
 #endif // PROCESS_H
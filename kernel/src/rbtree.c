@@ -0,0 +1,272 @@
+// rbtree.c
+#include "rbtree.h"
+
+static void rb_rotate_left(rb_tree_t *tree, rb_node_t *x) {
+    rb_node_t *y = x->right;
+    x->right = y->left;
+    if (y->left) {
+        y->left->parent = x;
+    }
+    y->parent = x->parent;
+    if (!x->parent) {
+        tree->root = y;
+    } else if (x == x->parent->left) {
+        x->parent->left = y;
+    } else {
+        x->parent->right = y;
+    }
+    y->left = x;
+    x->parent = y;
+}
+
+static void rb_rotate_right(rb_tree_t *tree, rb_node_t *x) {
+    rb_node_t *y = x->left;
+    x->left = y->right;
+    if (y->right) {
+        y->right->parent = x;
+    }
+    y->parent = x->parent;
+    if (!x->parent) {
+        tree->root = y;
+    } else if (x == x->parent->right) {
+        x->parent->right = y;
+    } else {
+        x->parent->left = y;
+    }
+    y->right = x;
+    x->parent = y;
+}
+
+// Thay cây con gốc u bằng cây con gốc v (v có thể NULL)
+static void rb_transplant(rb_tree_t *tree, rb_node_t *u, rb_node_t *v) {
+    if (!u->parent) {
+        tree->root = v;
+    } else if (u == u->parent->left) {
+        u->parent->left = v;
+    } else {
+        u->parent->right = v;
+    }
+    if (v) {
+        v->parent = u->parent;
+    }
+}
+
+static rb_node_t *rb_min(rb_node_t *node) {
+    while (node->left) {
+        node = node->left;
+    }
+    return node;
+}
+
+static bool rb_is_red(const rb_node_t *node) {
+    return node && node->red;
+}
+
+/**
+ * Inserts @p node into @p tree.
+ *
+ * Equal keys are placed to the right of existing ones, so nodes with the same
+ * key come out in insertion order.
+ *
+ * @param tree The tree.
+ * @param node The node to insert; must not already be in a tree.
+ * @param less Ordering predicate.
+ */
+void rb_insert(rb_tree_t *tree, rb_node_t *node, rb_less_t less) {
+    rb_node_t *parent = NULL;
+    rb_node_t **link = &tree->root;
+    bool leftmost = true;
+
+    while (*link) {
+        parent = *link;
+        if (less(node, parent)) {
+            link = &parent->left;
+        } else {
+            link = &parent->right;
+            leftmost = false;
+        }
+    }
+
+    node->parent = parent;
+    node->left = NULL;
+    node->right = NULL;
+    node->red = true;
+    *link = node;
+    if (leftmost) {
+        tree->leftmost = node;
+    }
+
+    // Khôi phục tính chất đỏ-đen
+    rb_node_t *p;
+    while ((p = node->parent) && p->red) {
+        rb_node_t *g = p->parent;
+        if (p == g->left) {
+            rb_node_t *u = g->right;
+            if (rb_is_red(u)) {
+                p->red = false;
+                u->red = false;
+                g->red = true;
+                node = g;
+                continue;
+            }
+            if (node == p->right) {
+                rb_rotate_left(tree, p);
+                node = p;
+                p = node->parent;
+            }
+            p->red = false;
+            g->red = true;
+            rb_rotate_right(tree, g);
+        } else {
+            rb_node_t *u = g->left;
+            if (rb_is_red(u)) {
+                p->red = false;
+                u->red = false;
+                g->red = true;
+                node = g;
+                continue;
+            }
+            if (node == p->left) {
+                rb_rotate_right(tree, p);
+                node = p;
+                p = node->parent;
+            }
+            p->red = false;
+            g->red = true;
+            rb_rotate_left(tree, g);
+        }
+    }
+    tree->root->red = false;
+}
+
+/**
+ * Rebalances after a black node was removed; @p x (possibly NULL) took its
+ * place under @p parent.
+ */
+static void rb_erase_fixup(rb_tree_t *tree, rb_node_t *x, rb_node_t *parent) {
+    while (x != tree->root && !rb_is_red(x)) {
+        if (x == parent->left) {
+            rb_node_t *w = parent->right;
+            if (w->red) {
+                w->red = false;
+                parent->red = true;
+                rb_rotate_left(tree, parent);
+                w = parent->right;
+            }
+            if (!rb_is_red(w->left) && !rb_is_red(w->right)) {
+                w->red = true;
+                x = parent;
+                parent = x->parent;
+            } else {
+                if (!rb_is_red(w->right)) {
+                    w->left->red = false;
+                    w->red = true;
+                    rb_rotate_right(tree, w);
+                    w = parent->right;
+                }
+                w->red = parent->red;
+                parent->red = false;
+                if (w->right) {
+                    w->right->red = false;
+                }
+                rb_rotate_left(tree, parent);
+                x = tree->root;
+            }
+        } else {
+            rb_node_t *w = parent->left;
+            if (w->red) {
+                w->red = false;
+                parent->red = true;
+                rb_rotate_right(tree, parent);
+                w = parent->left;
+            }
+            if (!rb_is_red(w->left) && !rb_is_red(w->right)) {
+                w->red = true;
+                x = parent;
+                parent = x->parent;
+            } else {
+                if (!rb_is_red(w->left)) {
+                    w->right->red = false;
+                    w->red = true;
+                    rb_rotate_left(tree, w);
+                    w = parent->left;
+                }
+                w->red = parent->red;
+                parent->red = false;
+                if (w->left) {
+                    w->left->red = false;
+                }
+                rb_rotate_right(tree, parent);
+                x = tree->root;
+            }
+        }
+    }
+    if (x) {
+        x->red = false;
+    }
+}
+
+/**
+ * Removes @p node from @p tree.
+ *
+ * @param tree The tree.
+ * @param node A node currently linked into @p tree.
+ */
+void rb_erase(rb_tree_t *tree, rb_node_t *node) {
+    if (tree->leftmost == node) {
+        tree->leftmost = rb_next(node);
+    }
+
+    rb_node_t *child;
+    rb_node_t *parent;
+    bool removed_red;
+
+    if (!node->left || !node->right) {
+        child = node->left ? node->left : node->right;
+        parent = node->parent;
+        removed_red = node->red;
+        rb_transplant(tree, node, child);
+    } else {
+        // Hai con: thay nút bằng nút kế tiếp nhỏ nhất của cây con phải
+        rb_node_t *y = rb_min(node->right);
+        removed_red = y->red;
+        child = y->right;
+        if (y->parent == node) {
+            parent = y;
+        } else {
+            parent = y->parent;
+            rb_transplant(tree, y, y->right);
+            y->right = node->right;
+            y->right->parent = y;
+        }
+        rb_transplant(tree, node, y);
+        y->left = node->left;
+        y->left->parent = y;
+        y->red = node->red;
+    }
+
+    if (!removed_red) {
+        rb_erase_fixup(tree, child, parent);
+    }
+    node->parent = node->left = node->right = NULL;
+}
+
+rb_node_t *rb_next(const rb_node_t *node) {
+    if (node->right) {
+        return rb_min(node->right);
+    }
+    const rb_node_t *parent = node->parent;
+    while (parent && node == parent->right) {
+        node = parent;
+        parent = parent->parent;
+    }
+    return (rb_node_t *)parent;
+}
+
+rb_node_t *rb_last(const rb_tree_t *tree) {
+    rb_node_t *node = tree->root;
+    while (node && node->right) {
+        node = node->right;
+    }
+    return node;
+}
@@ -0,0 +1,46 @@
+// rbtree.h
+#ifndef RBTREE_H
+#define RBTREE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "klibc.h"
+
+// Nút cây đỏ-đen, nhúng trực tiếp vào cấu trúc chứa nó
+typedef struct rb_node {
+    struct rb_node *parent;
+    struct rb_node *left;
+    struct rb_node *right;
+    bool red;
+} rb_node_t;
+
+// Cây đỏ-đen với nút nhỏ nhất được cache để lấy trong O(1)
+typedef struct rb_tree {
+    rb_node_t *root;
+    rb_node_t *leftmost;
+} rb_tree_t;
+
+// Hàm so sánh: true nếu a phải đứng trước b
+typedef bool (*rb_less_t)(const rb_node_t *a, const rb_node_t *b);
+
+// Lấy con trỏ tới cấu trúc chứa nút
+#define rb_entry(ptr, type, member) container_of(ptr, type, member)
+
+// Chèn nút vào cây; các khóa bằng nhau giữ thứ tự chèn
+void rb_insert(rb_tree_t *tree, rb_node_t *node, rb_less_t less);
+
+// Gỡ nút khỏi cây
+void rb_erase(rb_tree_t *tree, rb_node_t *node);
+
+// Nút nhỏ nhất (NULL nếu cây rỗng)
+static inline rb_node_t *rb_first(const rb_tree_t *tree) {
+    return tree->leftmost;
+}
+
+// Nút kế tiếp theo thứ tự (NULL nếu là nút cuối)
+rb_node_t *rb_next(const rb_node_t *node);
+
+// Nút lớn nhất (NULL nếu cây rỗng)
+rb_node_t *rb_last(const rb_tree_t *tree);
+
+#endif // RBTREE_H
@@ -0,0 +1,165 @@
+// rcu.c
+#include "rcu.h"
+#include "scheduler.h"
+#include "spinlock.h"
+#include "graphics.h"
+#include "softirq.h"
+
+// Số thứ tự của grace period mới nhất đã bắt đầu
+static volatile uint64_t rcu_gp_seq;
+
+/**
+ * Records that this CPU is outside any read-side section.
+ *
+ * The fence orders every read of the finished sections before the report, so
+ * an updater that sees the report knows those reads are done.
+ */
+void rcu_note_qs(void) {
+    cpu_t *cpu = this_cpu();
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    cpu->rcu_qs_seq = __atomic_load_n(&rcu_gp_seq, __ATOMIC_ACQUIRE);
+}
+
+void rcu_idle_enter(void) {
+    rcu_note_qs();
+    __atomic_store_n(&this_cpu()->rcu_idle, true, __ATOMIC_SEQ_CST);
+}
+
+/**
+ * Leaves the idle extended quiescent state.
+ *
+ * The store/fence pair pairs with the fence in rcu_gp_done(): either the
+ * updater sees this CPU awake and waits for it, or this CPU sees the updater's
+ * removal in every read that follows.
+ */
+void rcu_idle_exit(void) {
+    cpu_t *cpu = this_cpu();
+    __atomic_store_n(&cpu->rcu_idle, false, __ATOMIC_SEQ_CST);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    cpu->rcu_qs_seq = __atomic_load_n(&rcu_gp_seq, __ATOMIC_ACQUIRE);
+}
+
+void rcu_irq_enter(void) {
+    cpu_t *cpu = this_cpu();
+    if (cpu->rcu_idle) {
+        rcu_idle_exit();
+        cpu->rcu_irq_from_idle = true;
+    }
+}
+
+void rcu_irq_exit(void) {
+    cpu_t *cpu = this_cpu();
+    if (cpu->rcu_irq_from_idle) {
+        cpu->rcu_irq_from_idle = false;
+        rcu_idle_enter();
+    }
+}
+
+void rcu_cpu_online(cpu_t *cpu) {
+    cpu->rcu_qs_seq = __atomic_load_n(&rcu_gp_seq, __ATOMIC_ACQUIRE);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+// Bắt đầu một grace period mới, trả về số thứ tự của nó
+static uint64_t rcu_start_gp(void) {
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    return __atomic_add_fetch(&rcu_gp_seq, 1, __ATOMIC_SEQ_CST);
+}
+
+/**
+ * Checks whether grace period @p seq has ended.
+ *
+ * It has ended once every online CPU has reported a quiescent state after it
+ * started, or is halted in idle (and so cannot be inside a read section).
+ */
+static bool rcu_gp_done(uint64_t seq) {
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    for (uint32_t i = 0; i < cpu_count; i++) {
+        cpu_t *cpu = &cpus[i];
+        if (!cpu->online || __atomic_load_n(&cpu->rcu_idle, __ATOMIC_SEQ_CST)) {
+            continue;
+        }
+        if (cpu->rcu_qs_seq < seq) {
+            return false;
+        }
+    }
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    return true;
+}
+
+static void rcu_invoke(rcu_head_t *list) {
+    while (list) {
+        rcu_head_t *next = list->next;
+        list->func(list);
+        list = next;
+    }
+}
+
+/**
+ * Per-CPU RCU work from the timer interrupt.
+ *
+ * Callbacks queued with call_rcu() wait on this CPU: the batch waiting for a
+ * grace period is handed to SOFTIRQ_RCU once it ends, so frees run with
+ * interrupts enabled, then newly queued callbacks start the next one. Only
+ * this CPU touches its lists, with interrupts disabled, so no lock is needed.
+ */
+void rcu_tick(void) {
+    cpu_t *cpu = this_cpu();
+    if (cpu->rcu_wait && rcu_gp_done(cpu->rcu_wait_seq)) {
+        rcu_head_t **tail = &cpu->rcu_done;
+        while (*tail) {
+            tail = &(*tail)->next;
+        }
+        *tail = cpu->rcu_wait;
+        cpu->rcu_wait = NULL;
+        raise_softirq(SOFTIRQ_RCU);
+    }
+    if (!cpu->rcu_wait && cpu->rcu_next) {
+        cpu->rcu_wait = cpu->rcu_next;
+        cpu->rcu_next = NULL;
+        cpu->rcu_wait_seq = rcu_start_gp();
+    }
+}
+
+void rcu_process_callbacks(void) {
+    uint64_t flags = irq_save();
+    cpu_t *cpu = this_cpu();
+    rcu_head_t *done = cpu->rcu_done;
+    cpu->rcu_done = NULL;
+    irq_restore(flags);
+    rcu_invoke(done);
+}
+
+void call_rcu(rcu_head_t *head, void (*func)(rcu_head_t *head)) {
+    uint64_t flags = irq_save();
+    cpu_t *cpu = this_cpu();
+    head->func = func;
+    head->next = cpu->rcu_next;
+    cpu->rcu_next = head;
+    irq_restore(flags);
+}
+
+/**
+ * Waits for a full grace period.
+ *
+ * The caller's own CPU is quiescent here by definition. While other CPUs
+ * catch up the caller yields if it is a scheduled process, so the wait costs
+ * at most one tick on each busy CPU and nothing on idle ones. Calling it
+ * with preemption disabled (inside a read-side section or under a spinlock)
+ * is a bug and panics.
+ */
+void synchronize_rcu(void) {
+    if (preempt_count()) {
+        panic("RCU: synchronize_rcu called inside a read-side section or with a lock held");
+    }
+    uint64_t seq = rcu_start_gp();
+    rcu_note_qs();
+    while (!rcu_gp_done(seq)) {
+        if (process_current() && this_rq()->idle_started) {
+            sched_yield();
+        } else {
+            cpu_relax();
+        }
+        rcu_note_qs();
+    }
+}
@@ -0,0 +1,112 @@
+// rcu.h
+#ifndef RCU_H
+#define RCU_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "percpu.h"
+#include "preempt.h"
+
+// Read-copy-update: reader không khóa, writer thay con trỏ rồi chờ một grace period
+// (mọi CPU đều đi qua một trạng thái tĩnh: chuyển ngữ cảnh, idle, hoặc đang ở user mode)
+// trước khi giải phóng bản cũ.
+
+// Callback chạy sau grace period, thường nhúng trong đối tượng cần giải phóng
+typedef struct rcu_head {
+    struct rcu_head *next;
+    void (*func)(struct rcu_head *head);
+} rcu_head_t;
+
+// Đọc con trỏ được RCU bảo vệ bên trong vùng đọc
+#define rcu_dereference(p) __atomic_load_n(&(p), __ATOMIC_CONSUME)
+
+// Công bố con trỏ mới: mọi ghi khởi tạo đối tượng phải nhìn thấy được trước con trỏ
+#define rcu_assign_pointer(p, v) __atomic_store_n(&(p), (v), __ATOMIC_RELEASE)
+
+// Vùng đọc: tắt chiếm quyền, không được ngủ hay gọi schedule() bên trong
+static inline void rcu_read_lock(void) {
+    preempt_disable();
+}
+
+static inline void rcu_read_unlock(void) {
+    preempt_enable();
+}
+
+// Báo trạng thái tĩnh của CPU hiện tại (gọi bởi scheduler)
+void rcu_note_qs(void);
+
+// CPU sắp/vừa halt: trong lúc ngủ nó được coi là tĩnh mà không cần tick
+void rcu_idle_enter(void);
+void rcu_idle_exit(void);
+
+// Handler ngắt có thể đọc dữ liệu RCU: tạm rời trạng thái idle trong lúc xử lý ngắt
+void rcu_irq_enter(void);
+void rcu_irq_exit(void);
+
+// Gọi khi CPU vào trạng thái online
+void rcu_cpu_online(cpu_t *cpu);
+
+// Gọi từ ngắt timer: giao callback có grace period đã kết thúc cho softirq và bắt đầu grace period cho callback mới
+void rcu_tick(void);
+
+// Softirq SOFTIRQ_RCU: chạy các callback mà rcu_tick đã giao, với ngắt bật
+void rcu_process_callbacks(void);
+
+// Đăng ký func(head) chạy sau grace period hiện tại (an toàn trong ngắt)
+void call_rcu(rcu_head_t *head, void (*func)(rcu_head_t *head));
+
+// Chờ cho tới khi mọi vùng đọc đang diễn ra kết thúc (không gọi trong vùng đọc hay trong ngắt)
+void synchronize_rcu(void);
+
+// Danh sách liên kết cho RCU: reader duyệt bằng rcu_hlist_for_each_entry,
+// writer thêm/xóa dưới khóa của riêng cấu trúc dữ liệu
+typedef struct rcu_hlist_node {
+    struct rcu_hlist_node *next;
+    struct rcu_hlist_node **pprev;
+} rcu_hlist_node_t;
+
+typedef struct {
+    rcu_hlist_node_t *first;
+} rcu_hlist_head_t;
+
+static inline void rcu_hlist_add_head(rcu_hlist_node_t *node, rcu_hlist_head_t *head) {
+    rcu_hlist_node_t *first = head->first;
+    node->next = first;
+    node->pprev = &head->first;
+    if (first) {
+        first->pprev = &node->next;
+    }
+    rcu_assign_pointer(head->first, node);
+}
+
+// Gỡ nút khỏi danh sách; reader đang đứng ở nút vẫn đi tiếp được, nên chỉ giải phóng sau grace period
+static inline void rcu_hlist_del(rcu_hlist_node_t *node) {
+    rcu_hlist_node_t *next = node->next;
+    rcu_assign_pointer(*node->pprev, next);
+    if (next) {
+        next->pprev = node->pprev;
+    }
+    node->pprev = NULL;
+}
+
+static inline bool rcu_hlist_unhashed(const rcu_hlist_node_t *node) {
+    return node->pprev == NULL;
+}
+
+#define rcu_hlist_entry(ptr, type, member) \
+    ((type *)((char *)(ptr) - offsetof(type, member)))
+
+// Duyệt danh sách trong vùng đọc
+#define rcu_hlist_for_each_entry(pos, head, type, member)                                  \
+    for (rcu_hlist_node_t *__n = rcu_dereference((head)->first);                            \
+         __n && ((pos) = rcu_hlist_entry(__n, type, member), 1);                            \
+         __n = rcu_dereference(__n->next))
+
+// Bảng băm gồm size (lũy thừa của 2, ít nhất 2) danh sách RCU
+static inline rcu_hlist_head_t *rcu_hash_bucket(rcu_hlist_head_t *table, uint64_t size, uint64_t key) {
+    // Băm nhân Fibonacci để các khóa liên tiếp rải đều
+    return &table[(key * 0x9E3779B97F4A7C15ULL) >> (64 - __builtin_ctzll(size))];
+}
+
+#endif // RCU_H
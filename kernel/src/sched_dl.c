@@ -0,0 +1,181 @@
+// sched_dl.c
+#include "sched_dl.h"
+#include "config.h"
+
+#define DL_BW_LIMIT (SCHED_DL_BW_PCT * DL_BW_UNIT / 100)
+
+uint64_t dl_bandwidth(uint64_t runtime, uint64_t interval) {
+    return interval ? (runtime << DL_BW_SHIFT) / interval : DL_BW_UNIT;
+}
+
+bool dl_params_valid(uint64_t runtime, uint64_t deadline, uint64_t period) {
+    return runtime >= DL_MIN_RUNTIME_NS && runtime <= deadline && deadline <= period &&
+           period <= DL_MAX_PERIOD_NS;
+}
+
+/**
+ * Admission control for one CPU.
+ *
+ * Bandwidth is runtime/deadline (the task's density), which for deadlines
+ * shorter than the period is stricter than runtime/period. EDF meets every
+ * deadline on a CPU whose total density is at most 100%; the limit leaves
+ * 100 - SCHED_DL_BW_PCT percent for the fair class.
+ *
+ * @param rq The CPU's deadline queue.
+ * @param old_bw Bandwidth the task already holds on this CPU (0 if none).
+ * @param new_bw Bandwidth it asks for.
+ * @return true if accepted, in which case total_bw has been updated.
+ */
+bool dl_admit(dl_rq_t *rq, uint64_t old_bw, uint64_t new_bw) {
+    uint64_t total = rq->total_bw - old_bw + new_bw;
+    if (total > DL_BW_LIMIT) {
+        return false;
+    }
+    rq->total_bw = total;
+    return true;
+}
+
+bool dl_earlier(const process_t *a, const process_t *b) {
+    return (int64_t)(a->dl_abs_deadline - b->dl_abs_deadline) <= 0;
+}
+
+static bool dl_less(const rb_node_t *a, const rb_node_t *b) {
+    const process_t *pa = rb_entry(a, process_t, run_node);
+    const process_t *pb = rb_entry(b, process_t, run_node);
+    return (int64_t)(pa->dl_abs_deadline - pb->dl_abs_deadline) < 0;
+}
+
+void dl_enqueue(dl_rq_t *rq, process_t *proc) {
+    rb_insert(&rq->tasks, &proc->run_node, dl_less);
+    rq->nr_queued++;
+}
+
+void dl_dequeue(dl_rq_t *rq, process_t *proc) {
+    rb_erase(&rq->tasks, &proc->run_node);
+    rq->nr_queued--;
+}
+
+process_t *dl_first(dl_rq_t *rq) {
+    rb_node_t *node = rb_first(&rq->tasks);
+    return node ? rb_entry(node, process_t, run_node) : NULL;
+}
+
+void dl_start_period(process_t *proc, uint64_t now) {
+    proc->dl_period_start = now;
+    proc->dl_abs_deadline = now + proc->dl_deadline;
+    proc->dl_budget = (int64_t)proc->dl_runtime;
+}
+
+/**
+ * Charges the running deadline process for the time since it last started
+ * running.
+ *
+ * @param curr The running process (not in the tree).
+ * @param now Current time in nanoseconds.
+ * @return true if its budget for the current job is used up.
+ */
+bool dl_update_curr(process_t *curr, uint64_t now) {
+    if (now > curr->exec_start) {
+        uint64_t delta = now - curr->exec_start;
+        curr->exec_start = now;
+        curr->sum_exec_runtime += delta;
+        curr->dl_budget -= (int64_t)delta;
+    }
+    return curr->dl_budget <= 0;
+}
+
+/**
+ * Stops @p proc until its next period.
+ *
+ * A job that ends after its absolute deadline counts as a miss. The budget
+ * is only checked at ticks, so an overrun can exceed the runtime by up to a
+ * tick; that debt is paid back from the following periods in dl_replenish.
+ *
+ * @param rq The deadline queue of the CPU the process is pinned to.
+ * @param proc The process, which must not be in the tree.
+ * @param now Current time in nanoseconds.
+ * @param overrun True if the budget ran out, false if the job finished early.
+ */
+void dl_throttle(dl_rq_t *rq, process_t *proc, uint64_t now, bool overrun) {
+    if (proc->dl_throttled) {
+        return;
+    }
+    if (now > proc->dl_abs_deadline) {
+        proc->dl_misses++;
+        rq->nr_misses++;
+    }
+    if (overrun) {
+        proc->dl_throttles++;
+        rq->nr_throttles++;
+    } else {
+        // Job đã xong: phần ngân sách còn lại không được dùng dồn sang chu kỳ sau
+        proc->dl_budget = 0;
+    }
+    proc->dl_next_period = proc->dl_period_start + proc->dl_period;
+    proc->dl_throttled = true;
+    proc->dl_throttled_next = rq->throttled;
+    rq->throttled = proc;
+}
+
+void dl_unthrottle(dl_rq_t *rq, process_t *proc) {
+    if (!proc->dl_throttled) {
+        return;
+    }
+    for (process_t **link = &rq->throttled; *link; link = &(*link)->dl_throttled_next) {
+        if (*link == proc) {
+            *link = proc->dl_throttled_next;
+            break;
+        }
+    }
+    proc->dl_throttled = false;
+    proc->dl_throttled_next = NULL;
+}
+
+/**
+ * Finds a throttled process whose next period has begun and starts a new job
+ * for it. Periods that the remaining overrun debt still covers are skipped.
+ *
+ * @return The process (no longer throttled, not yet queued), or NULL.
+ */
+process_t *dl_replenish(dl_rq_t *rq, uint64_t now) {
+    for (process_t **link = &rq->throttled; *link; link = &(*link)->dl_throttled_next) {
+        process_t *proc = *link;
+        if (proc->dl_next_period > now) {
+            continue;
+        }
+        *link = proc->dl_throttled_next;
+        proc->dl_throttled = false;
+        proc->dl_throttled_next = NULL;
+
+        int64_t debt = proc->dl_budget < 0 ? proc->dl_budget : 0;
+        uint64_t start = proc->dl_next_period;
+        while (debt + (int64_t)proc->dl_runtime <= 0) {
+            debt += (int64_t)proc->dl_runtime;
+            start += proc->dl_period;
+        }
+        // Tick trễ: không bắt đầu chu kỳ trong quá khứ, nếu không hạn chót sẽ đã qua ngay khi chạy
+        if (start + proc->dl_deadline <= now) {
+            start = now;
+        }
+        dl_start_period(proc, start);
+        proc->dl_budget += debt;
+        return proc;
+    }
+    return NULL;
+}
+
+/**
+ * Constant bandwidth server wakeup rule.
+ *
+ * A process that slept keeps its current deadline and remaining budget only
+ * if using that budget before the deadline stays within its reserved
+ * bandwidth; otherwise it starts a new job now. This stops a task from
+ * saving budget across a sleep and then running in a burst that would push
+ * others past their deadlines.
+ */
+void dl_wakeup(process_t *proc, uint64_t now) {
+    if (now >= proc->dl_abs_deadline || proc->dl_budget <= 0 ||
+        dl_bandwidth((uint64_t)proc->dl_budget, proc->dl_abs_deadline - now) > proc->dl_bw) {
+        dl_start_period(proc, now);
+    }
+}
@@ -0,0 +1,65 @@
+// sched_dl.h
+#ifndef SCHED_DL_H
+#define SCHED_DL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "rbtree.h"
+#include "process.h"
+
+// Băng thông dạng số cố định: DL_BW_UNIT = 100% một CPU
+#define DL_BW_SHIFT 20
+#define DL_BW_UNIT  (1ULL << DL_BW_SHIFT)
+
+// Giới hạn tham số (ns): ngân sách quá nhỏ thì tick không đo được, chu kỳ quá dài thì tràn số
+#define DL_MIN_RUNTIME_NS 100000ULL
+#define DL_MAX_PERIOD_NS  10000000000ULL
+
+// Hàng đợi của lớp deadline (EDF) trên một CPU; được ưu tiên hơn lớp công bằng
+typedef struct dl_rq {
+    rb_tree_t tasks;          // Tiến trình sẵn sàng còn ngân sách, sắp theo hạn chót tuyệt đối
+    uint32_t nr_queued;       // Số tiến trình trong cây
+    uint64_t total_bw;        // Tổng băng thông đã nhận vào CPU này
+    process_t *throttled;     // Tiến trình đã hết ngân sách, chờ chu kỳ kế tiếp
+    uint64_t nr_misses;       // Số job kết thúc sau hạn chót
+    uint64_t nr_throttles;    // Số lần tiến trình dùng hết ngân sách trước khi xong job
+} dl_rq_t;
+
+// Băng thông runtime/interval
+uint64_t dl_bandwidth(uint64_t runtime, uint64_t interval);
+
+// Kiểm tra runtime <= deadline <= period và các giới hạn
+bool dl_params_valid(uint64_t runtime, uint64_t deadline, uint64_t period);
+
+// Admission control: thay old_bw bằng new_bw nếu tổng không vượt SCHED_DL_BW_PCT
+bool dl_admit(dl_rq_t *rq, uint64_t old_bw, uint64_t new_bw);
+
+// Thêm/gỡ tiến trình khỏi cây
+void dl_enqueue(dl_rq_t *rq, process_t *proc);
+void dl_dequeue(dl_rq_t *rq, process_t *proc);
+
+// Tiến trình có hạn chót sớm nhất (không gỡ khỏi cây)
+process_t *dl_first(dl_rq_t *rq);
+
+// Bắt đầu job mới tại thời điểm now với ngân sách đầy đủ
+void dl_start_period(process_t *proc, uint64_t now);
+
+// Trừ thời gian chạy vào ngân sách; trả về true khi ngân sách đã hết
+bool dl_update_curr(process_t *curr, uint64_t now);
+
+// Tạm dừng tiến trình tới chu kỳ kế tiếp: vì hết ngân sách (overrun) hoặc vì đã xong job
+void dl_throttle(dl_rq_t *rq, process_t *proc, uint64_t now, bool overrun);
+
+// Gỡ tiến trình khỏi danh sách tạm dừng (nếu có)
+void dl_unthrottle(dl_rq_t *rq, process_t *proc);
+
+// Lấy một tiến trình tạm dừng đã tới chu kỳ mới và nạp lại ngân sách (NULL nếu không có)
+process_t *dl_replenish(dl_rq_t *rq, uint64_t now);
+
+// Tiến trình thức dậy: giữ job hiện tại nếu còn dùng được mà không vượt băng thông, không thì bắt đầu job mới
+void dl_wakeup(process_t *proc, uint64_t now);
+
+// a có hạn chót sớm hơn (hoặc bằng) b
+bool dl_earlier(const process_t *a, const process_t *b);
+
+#endif // SCHED_DL_H
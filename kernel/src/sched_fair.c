@@ -0,0 +1,177 @@
+// sched_fair.c
+#include "sched_fair.h"
+#include "config.h"
+
+uint64_t sched_latency_ns = SCHED_LATENCY_MS * 1000000ULL;
+uint64_t sched_min_granularity_ns = SCHED_MIN_GRANULARITY_MS * 1000000ULL;
+uint64_t sched_wakeup_granularity_ns = SCHED_WAKEUP_GRANULARITY_MS * 1000000ULL;
+
+// Bảng trọng số cho nice -20..19, cùng giá trị với Linux
+static const uint32_t nice_to_weight[40] = {
+    88761, 71755, 56483, 46273, 36291,
+    29154, 23254, 18705, 14949, 11916,
+    9548,  7620,  6100,  4904,  3906,
+    3121,  2501,  1991,  1586,  1277,
+    1024,  820,   655,   526,   423,
+    335,   272,   215,   172,   137,
+    110,   87,    70,    56,    45,
+    36,    29,    23,    18,    15,
+};
+
+uint32_t fair_nice_to_weight(int nice) {
+    if (nice < NICE_MIN) nice = NICE_MIN;
+    if (nice > NICE_MAX) nice = NICE_MAX;
+    return nice_to_weight[nice - NICE_MIN];
+}
+
+// So sánh có tính tràn số, vruntime chỉ dùng dưới dạng hiệu
+static inline int64_t vruntime_diff(uint64_t a, uint64_t b) {
+    return (int64_t)(a - b);
+}
+
+// Đổi thời gian thực sang thời gian ảo theo trọng số
+static inline uint64_t calc_delta_fair(uint64_t delta, uint32_t weight) {
+    if (weight == NICE_0_WEIGHT) {
+        return delta;
+    }
+    // delta * 1024 chỉ tràn số khi một lần đo dài hơn 200 ngày
+    return delta * NICE_0_WEIGHT / weight;
+}
+
+static bool fair_less(const rb_node_t *a, const rb_node_t *b) {
+    const process_t *pa = rb_entry(a, process_t, run_node);
+    const process_t *pb = rb_entry(b, process_t, run_node);
+    return vruntime_diff(pa->vruntime, pb->vruntime) < 0;
+}
+
+/**
+ * Advances min_vruntime towards the smaller of the running process and the
+ * leftmost queued one, never moving it backwards.
+ */
+static void fair_update_min_vruntime(fair_rq_t *rq, process_t *curr) {
+    uint64_t vruntime = rq->min_vruntime;
+    process_t *first = fair_first(rq);
+
+    if (curr) {
+        vruntime = curr->vruntime;
+    }
+    if (first && (!curr || vruntime_diff(first->vruntime, vruntime) < 0)) {
+        vruntime = first->vruntime;
+    }
+    if (vruntime_diff(vruntime, rq->min_vruntime) > 0) {
+        rq->min_vruntime = vruntime;
+    }
+}
+
+void fair_enqueue(fair_rq_t *rq, process_t *proc) {
+    rb_insert(&rq->tasks, &proc->run_node, fair_less);
+    rq->load_weight += proc->weight;
+    rq->nr_queued++;
+}
+
+void fair_dequeue(fair_rq_t *rq, process_t *proc) {
+    rb_erase(&rq->tasks, &proc->run_node);
+    rq->load_weight -= proc->weight;
+    rq->nr_queued--;
+    fair_update_min_vruntime(rq, NULL);
+}
+
+process_t *fair_first(fair_rq_t *rq) {
+    rb_node_t *node = rb_first(&rq->tasks);
+    return node ? rb_entry(node, process_t, run_node) : NULL;
+}
+
+/**
+ * Charges the running process for the time since it last started running.
+ *
+ * @param rq The run queue @p curr belongs to.
+ * @param curr The running process (not in the tree).
+ * @param now Current time in nanoseconds.
+ */
+void fair_update_curr(fair_rq_t *rq, process_t *curr, uint64_t now) {
+    if (!curr || now <= curr->exec_start) {
+        return;
+    }
+    uint64_t delta = now - curr->exec_start;
+    curr->exec_start = now;
+    curr->sum_exec_runtime += delta;
+    curr->vruntime += calc_delta_fair(delta, curr->weight);
+    fair_update_min_vruntime(rq, curr);
+}
+
+/**
+ * Length of one scheduling period: the latency target, stretched so that
+ * every runnable process still gets at least the minimum granularity.
+ */
+static uint64_t fair_period(uint32_t nr_running) {
+    uint64_t nr_latency = sched_latency_ns / sched_min_granularity_ns;
+    if (nr_running > nr_latency) {
+        return nr_running * sched_min_granularity_ns;
+    }
+    return sched_latency_ns;
+}
+
+uint64_t fair_slice(fair_rq_t *rq, process_t *proc) {
+    uint64_t load = rq->load_weight + proc->weight;
+    uint64_t slice = fair_period(rq->nr_queued + 1) * proc->weight / load;
+    return slice > sched_min_granularity_ns ? slice : sched_min_granularity_ns;
+}
+
+/**
+ * Places a process that is about to enter the tree.
+ *
+ * New processes start one virtual slice after min_vruntime so a stream of
+ * new processes cannot starve the ones already queued. Woken processes get
+ * at most half a latency period of credit for the time they slept, keeping
+ * them responsive without letting a long sleeper monopolise the CPU.
+ *
+ * @param rq The run queue.
+ * @param proc The process to place.
+ * @param initial True for a newly created process.
+ */
+void fair_place(fair_rq_t *rq, process_t *proc, bool initial) {
+    uint64_t vruntime = rq->min_vruntime;
+
+    if (initial) {
+        proc->vruntime = vruntime + calc_delta_fair(fair_slice(rq, proc), proc->weight);
+        return;
+    }
+
+    vruntime -= sched_latency_ns / 2;
+    if (vruntime_diff(vruntime, proc->vruntime) > 0) {
+        proc->vruntime = vruntime;
+    }
+}
+
+/**
+ * Decides at a timer tick whether the running process should yield.
+ *
+ * It is preempted once it has run longer than its ideal slice, or, after at
+ * least the minimum granularity, when it is more than a slice of virtual
+ * time ahead of the leftmost queued process.
+ *
+ * @param rq The run queue.
+ * @param curr The running process, already updated by fair_update_curr.
+ * @return True if a reschedule is needed.
+ */
+bool fair_tick_preempt(fair_rq_t *rq, process_t *curr) {
+    process_t *first = fair_first(rq);
+    if (!first) {
+        return false;
+    }
+
+    uint64_t ideal = fair_slice(rq, curr);
+    uint64_t ran = curr->sum_exec_runtime - curr->slice_exec_start;
+    if (ran > ideal) {
+        return true;
+    }
+    if (ran < sched_min_granularity_ns) {
+        return false;
+    }
+    return vruntime_diff(curr->vruntime, first->vruntime) > (int64_t)ideal;
+}
+
+bool fair_wakeup_preempt(process_t *curr, process_t *woken) {
+    uint64_t gran = calc_delta_fair(sched_wakeup_granularity_ns, woken->weight);
+    return vruntime_diff(curr->vruntime, woken->vruntime) > (int64_t)gran;
+}
@@ -0,0 +1,53 @@
+// sched_fair.h
+#ifndef SCHED_FAIR_H
+#define SCHED_FAIR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "rbtree.h"
+#include "process.h"
+
+// Trọng số của nice 0; vruntime của tiến trình nice 0 tăng đúng bằng thời gian thực
+#define NICE_0_WEIGHT 1024
+#define NICE_MIN (-20)
+#define NICE_MAX 19
+
+// Hàng đợi sẵn sàng của lớp lập lịch công bằng
+typedef struct fair_rq {
+    rb_tree_t tasks;        // Tiến trình sẵn sàng, sắp theo vruntime (không gồm tiến trình đang chạy)
+    uint64_t min_vruntime;  // vruntime nhỏ nhất, chỉ tăng; mốc để đặt tiến trình mới và vừa thức dậy
+    uint64_t load_weight;   // Tổng trọng số của các tiến trình trong cây
+    uint32_t nr_queued;     // Số tiến trình trong cây
+} fair_rq_t;
+
+// Tham số điều chỉnh (nano giây)
+extern uint64_t sched_latency_ns;
+extern uint64_t sched_min_granularity_ns;
+extern uint64_t sched_wakeup_granularity_ns;
+
+// Trọng số tương ứng với mức nice (mỗi mức chênh khoảng 1.25 lần)
+uint32_t fair_nice_to_weight(int nice);
+
+// Thêm/gỡ tiến trình khỏi cây
+void fair_enqueue(fair_rq_t *rq, process_t *proc);
+void fair_dequeue(fair_rq_t *rq, process_t *proc);
+
+// Tiến trình có vruntime nhỏ nhất (không gỡ khỏi cây)
+process_t *fair_first(fair_rq_t *rq);
+
+// Cộng thời gian chạy từ exec_start tới now vào tiến trình đang chạy
+void fair_update_curr(fair_rq_t *rq, process_t *curr, uint64_t now);
+
+// Đặt vruntime cho tiến trình mới (initial) hoặc vừa thức dậy trước khi enqueue
+void fair_place(fair_rq_t *rq, process_t *proc, bool initial);
+
+// Thời gian chạy lý tưởng của một tiến trình không nằm trong cây trong một chu kỳ lập lịch
+uint64_t fair_slice(fair_rq_t *rq, process_t *proc);
+
+// Tiến trình đang chạy đã dùng hết phần của nó chưa
+bool fair_tick_preempt(fair_rq_t *rq, process_t *curr);
+
+// Tiến trình vừa thức dậy có nên chiếm quyền tiến trình đang chạy không
+bool fair_wakeup_preempt(process_t *curr, process_t *woken);
+
+#endif // SCHED_FAIR_H
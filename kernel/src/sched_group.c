@@ -0,0 +1,127 @@
+// sched_group.c
+#include "sched_group.h"
+#include "sched_fair.h"
+#include "timer.h"
+#include "graphics.h"
+
+// Danh sách nhóm đã đăng ký, chỉ được thêm vào (đẩy không khóa bằng CAS)
+static task_group_t *task_groups;
+
+void task_group_init(task_group_t *group, const char *name, uint32_t shares) {
+    group->name = name;
+    spin_init_named(&group->lock, "task_group");
+    group->members = NULL;
+    group->shares = shares ? shares : NICE_0_WEIGHT;
+    spin_init_named(&group->bw_lock, "task_group_bw");
+    group->quota_ns = 0;
+    group->period_ns = 0;
+    group->period_start = 0;
+    group->period_used = 0;
+    group->throttled = false;
+    group->throttle_start = 0;
+    group->usage_ns = 0;
+    group->throttled_ns = 0;
+    group->nr_throttled = 0;
+
+    task_group_t *head = __atomic_load_n(&task_groups, __ATOMIC_RELAXED);
+    do {
+        group->next = head;
+    } while (!__atomic_compare_exchange_n(&task_groups, &head, group, true,
+                                          __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+// Kết thúc đợt tạm dừng đang diễn ra (bw_lock phải được giữ)
+static void task_group_unthrottle(task_group_t *group, uint64_t now) {
+    if (group->throttled) {
+        group->throttled_ns += now - group->throttle_start;
+        group->throttled = false;
+    }
+}
+
+int task_group_set_bandwidth(task_group_t *group, uint64_t quota_ns, uint64_t period_ns) {
+    if (quota_ns && (period_ns < TASK_GROUP_MIN_PERIOD_NS || period_ns > TASK_GROUP_MAX_PERIOD_NS)) {
+        return -1;
+    }
+    uint64_t now = timer_now_ns();
+    uint64_t flags = spin_lock_irqsave(&group->bw_lock);
+    group->quota_ns = quota_ns;
+    group->period_ns = quota_ns ? period_ns : 0;
+    group->period_start = now;
+    group->period_used = 0;
+    task_group_unthrottle(group, now);
+    spin_unlock_irqrestore(&group->bw_lock, flags);
+    return 0;
+}
+
+/**
+ * Weight of one member in the fair class.
+ *
+ * The group as a whole weighs @p shares, split between its members in
+ * proportion to their nice weights, so a group competes with other groups
+ * and lone processes by its shares no matter how many processes it has.
+ *
+ * @param nice_weight The member's own weight from its nice level.
+ * @param total_nice_weight Sum of nice weights of all members.
+ */
+uint32_t task_group_member_weight(task_group_t *group, uint32_t nice_weight, uint64_t total_nice_weight) {
+    if (!total_nice_weight) {
+        return group->shares;
+    }
+    uint64_t weight = (uint64_t)group->shares * nice_weight / total_nice_weight;
+    // Trọng số 0 sẽ làm calc_delta_fair chia cho 0
+    return weight > 2 ? (uint32_t)weight : 2;
+}
+
+// Sang chu kỳ mới nếu đã hết chu kỳ, giữ các chu kỳ thẳng hàng với lần đặt quota (bw_lock phải được giữ)
+static void task_group_refresh_locked(task_group_t *group, uint64_t now) {
+    if (!group->quota_ns || now < group->period_start + group->period_ns) {
+        return;
+    }
+    group->period_start = now - (now - group->period_start) % group->period_ns;
+    group->period_used = 0;
+    task_group_unthrottle(group, now);
+}
+
+void task_group_refresh(task_group_t *group, uint64_t now) {
+    uint64_t flags = spin_lock_irqsave(&group->bw_lock);
+    task_group_refresh_locked(group, now);
+    spin_unlock_irqrestore(&group->bw_lock, flags);
+}
+
+/**
+ * Charges @p delta ns of CPU time used by a member.
+ *
+ * The charge is made at every tick and context switch, so a group can
+ * overrun its quota by up to one tick per CPU it runs on before it is
+ * throttled.
+ *
+ * @return true if the group is throttled and its members must stop running.
+ */
+bool task_group_charge(task_group_t *group, uint64_t delta, uint64_t now) {
+    uint64_t flags = spin_lock_irqsave(&group->bw_lock);
+    task_group_refresh_locked(group, now);
+    group->usage_ns += delta;
+    if (group->quota_ns) {
+        group->period_used += delta;
+        if (!group->throttled && group->period_used >= group->quota_ns) {
+            group->throttled = true;
+            group->throttle_start = now;
+            group->nr_throttled++;
+        }
+    }
+    bool throttled = group->throttled;
+    spin_unlock_irqrestore(&group->bw_lock, flags);
+    return throttled;
+}
+
+/**
+ * Prints every registered group's usage. Counters are read without the
+ * locks, so the figures are approximate while the groups are running.
+ */
+void task_group_dump(void) {
+    for (task_group_t *g = __atomic_load_n(&task_groups, __ATOMIC_ACQUIRE); g; g = g->next) {
+        kprintf("Group %s: shares %u, quota %llu/%llu us, used %llu ms, throttled %llu ms (%llu periods)\n",
+                g->name, g->shares, g->quota_ns / 1000, g->period_ns / 1000, g->usage_ns / 1000000,
+                g->throttled_ns / 1000000, g->nr_throttled);
+    }
+}
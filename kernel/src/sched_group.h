@@ -0,0 +1,54 @@
+// sched_group.h
+#ifndef SCHED_GROUP_H
+#define SCHED_GROUP_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "process.h"
+#include "spinlock.h"
+
+// Nhóm tiến trình chia CPU theo shares và bị giới hạn quota mỗi period.
+// Chỉ áp dụng cho lớp công bằng; tiến trình deadline đã có ngân sách riêng.
+typedef struct task_group {
+    const char *name;
+    spinlock_t lock;              // Bảo vệ danh sách thành viên; lấy trước khóa hàng đợi
+    process_t *members;           // Thành viên, nối qua group_next
+    uint32_t shares;              // Trọng số của cả nhóm (NICE_0_WEIGHT = một tiến trình nice 0)
+
+    spinlock_t bw_lock;           // Bảo vệ các trường băng thông; lấy sau khóa hàng đợi
+    uint64_t quota_ns;            // Thời gian CPU được dùng mỗi chu kỳ trên mọi CPU cộng lại, 0 = không giới hạn
+    uint64_t period_ns;           // Độ dài chu kỳ
+    uint64_t period_start;        // Đầu chu kỳ hiện tại
+    uint64_t period_used;         // Thời gian đã dùng trong chu kỳ hiện tại
+    volatile bool throttled;      // Đã hết quota: thành viên không được chạy tới chu kỳ sau
+    uint64_t throttle_start;      // Thời điểm bắt đầu bị tạm dừng
+
+    uint64_t usage_ns;            // Tổng thời gian CPU đã dùng
+    uint64_t throttled_ns;        // Tổng thời gian bị tạm dừng
+    uint64_t nr_throttled;        // Số chu kỳ bị tạm dừng
+    struct task_group *next;      // Danh sách nhóm cho task_group_dump()
+} task_group_t;
+
+// Giới hạn của chu kỳ (ns): quá ngắn thì tick không đo kịp, quá dài thì giới hạn vô nghĩa
+#define TASK_GROUP_MIN_PERIOD_NS 1000000ULL
+#define TASK_GROUP_MAX_PERIOD_NS 1000000000ULL
+
+// Khởi tạo và đăng ký nhóm (mỗi nhóm một lần), không giới hạn băng thông
+void task_group_init(task_group_t *group, const char *name, uint32_t shares);
+
+// Đặt quota mỗi period (ns); quota = 0 bỏ giới hạn. Trả về 0 hoặc -1 nếu tham số sai
+int task_group_set_bandwidth(task_group_t *group, uint64_t quota_ns, uint64_t period_ns);
+
+// Trọng số của một thành viên: phần của nó trong shares, theo tỉ lệ trọng số nice
+uint32_t task_group_member_weight(task_group_t *group, uint32_t nice_weight, uint64_t total_nice_weight);
+
+// Cộng thời gian chạy vào nhóm; trả về true nếu nhóm đang bị tạm dừng
+bool task_group_charge(task_group_t *group, uint64_t delta, uint64_t now);
+
+// Sang chu kỳ mới nếu chu kỳ hiện tại đã hết (nạp lại quota, bỏ tạm dừng)
+void task_group_refresh(task_group_t *group, uint64_t now);
+
+// In thời gian CPU đã dùng và thời gian bị tạm dừng của mọi nhóm
+void task_group_dump(void);
+
+#endif // SCHED_GROUP_H
@@ -0,0 +1,1253 @@
+// scheduler.c
+#include "scheduler.h"
+#include "context_switcher.h"
+#include "paging.h"
+#include "timer.h"
+#include "apic.h"
+#include "pkey.h"
+#include "klibc.h"
+#include "config.h"
+#include "rcu.h"
+#include "graphics.h"
+#include "cpu.h"
+
+runqueue_t runqueues[MAX_CPUS];
+uint64_t sched_latency_max_ns = 0;
+
+#define SCHED_BALANCE_INTERVAL_TICKS \
+    ((SCHED_BALANCE_INTERVAL_MS * TIMER_HZ + 999) / 1000)
+#define SCHED_MIGRATION_COST_NS (SCHED_MIGRATION_COST_US * 1000ULL)
+// Số tiến trình tối đa kéo về trong một lần cân bằng
+#define SCHED_BALANCE_MAX_PULL 8
+
+static inline uint64_t cpu_bit(uint32_t cpu) {
+    return 1ULL << cpu;
+}
+
+static inline bool is_idle(runqueue_t *rq, process_t *proc) {
+    return proc == &rq->idle;
+}
+
+static inline bool is_dl(process_t *proc) {
+    return proc->policy == SCHED_POLICY_DEADLINE;
+}
+
+// Tiến trình sẵn sàng nằm trong một cây hàng đợi (tiến trình bị tạm dừng thì không)
+static inline bool task_queued(process_t *proc) {
+    return proc->state == PROCESS_STATE_READY && !(is_dl(proc) && proc->dl_throttled) &&
+           !proc->group_throttled;
+}
+
+// Tiến trình không được chạy tiếp: hết ngân sách deadline, hoặc nhóm của nó hết quota
+static inline bool task_throttled(process_t *proc) {
+    if (is_dl(proc)) {
+        return proc->dl_throttled;
+    }
+    return proc->group && proc->group->throttled;
+}
+
+// a được chạy trước b: lớp deadline trước lớp công bằng, trong cùng lớp theo hạn chót / vruntime
+static bool task_runs_first(process_t *a, process_t *b) {
+    if (is_dl(a) != is_dl(b)) {
+        return is_dl(a);
+    }
+    if (is_dl(a)) {
+        return dl_earlier(a, b);
+    }
+    return (int64_t)(a->vruntime - b->vruntime) <= 0;
+}
+
+// Tải của hàng đợi: tổng trọng số của tiến trình sẵn sàng và đang chạy (không tính idle)
+static uint64_t rq_load(runqueue_t *rq) {
+    process_t *curr = cpus[rq->cpu].current;
+    uint64_t load = rq->fair.load_weight;
+    if (curr && !is_idle(rq, curr) && curr->state == PROCESS_STATE_RUNNING) {
+        load += curr->weight;
+    }
+    return load;
+}
+
+static uint32_t rq_nr_running(runqueue_t *rq) {
+    process_t *curr = cpus[rq->cpu].current;
+    return rq->dl.nr_queued + rq->fair.nr_queued + (curr && !is_idle(rq, curr) ? 1 : 0);
+}
+
+uint64_t sched_online_mask() {
+    uint64_t mask = 0;
+    for (uint32_t i = 0; i < cpu_count; i++) {
+        if (cpus[i].online) {
+            mask |= cpu_bit(i);
+        }
+    }
+    return mask;
+}
+
+/**
+ * Records how long @p proc waited in the ready queue before running.
+ */
+static void sched_account_wait(process_t *proc, uint64_t now) {
+    uint64_t wait = now > proc->wait_start ? now - proc->wait_start : 0;
+    proc->wait_sum_ns += wait;
+    proc->wait_count++;
+    if (wait > proc->wait_max_ns) {
+        proc->wait_max_ns = wait;
+    }
+    if (wait > sched_latency_max_ns) {
+        sched_latency_max_ns = wait;
+    }
+}
+
+// Thêm tiến trình vào hàng đợi của lớp lập lịch của nó (rq->lock phải được giữ)
+static void rq_enqueue(runqueue_t *rq, process_t *proc) {
+    proc->cpu = rq->cpu;
+    proc->wait_start = timer_now_ns();
+    if (is_dl(proc)) {
+        dl_enqueue(&rq->dl, proc);
+    } else {
+        fair_enqueue(&rq->fair, proc);
+    }
+}
+
+static void rq_dequeue(runqueue_t *rq, process_t *proc) {
+    if (is_dl(proc)) {
+        dl_dequeue(&rq->dl, proc);
+    } else {
+        fair_dequeue(&rq->fair, proc);
+    }
+}
+
+// Tiến trình sẽ được chạy kế tiếp trong hàng đợi (không gỡ khỏi cây)
+static process_t *rq_first(runqueue_t *rq) {
+    process_t *proc = dl_first(&rq->dl);
+    return proc ? proc : fair_first(&rq->fair);
+}
+
+/**
+ * Charges the running process of @p rq. A deadline process that has used
+ * its budget is throttled here and asked to leave the CPU.
+ */
+static void rq_update_curr(runqueue_t *rq, process_t *curr, uint64_t now) {
+    if (!is_dl(curr)) {
+        uint64_t before = curr->sum_exec_runtime;
+        fair_update_curr(&rq->fair, curr, now);
+        if (curr->group && task_group_charge(curr->group, curr->sum_exec_runtime - before, now)) {
+            cpus[rq->cpu].need_resched = true;
+        }
+        return;
+    }
+    if (dl_update_curr(curr, now) && !curr->dl_throttled) {
+        dl_throttle(&rq->dl, curr, now, true);
+        cpus[rq->cpu].need_resched = true;
+    }
+}
+
+// Đưa tiến trình (không nằm trong cây) vào danh sách chờ quota của rq
+static void rq_group_throttle(runqueue_t *rq, process_t *proc) {
+    proc->group_throttled = true;
+    proc->throttled_next = rq->throttled;
+    rq->throttled = proc;
+}
+
+static void rq_group_unthrottle(runqueue_t *rq, process_t *proc) {
+    for (process_t **link = &rq->throttled; *link; link = &(*link)->throttled_next) {
+        if (*link == proc) {
+            *link = proc->throttled_next;
+            break;
+        }
+    }
+    proc->group_throttled = false;
+    proc->throttled_next = NULL;
+}
+
+// Tiến trình đầu hàng đợi được phép chạy; tiến trình có nhóm hết quota được chuyển sang danh sách chờ
+static process_t *rq_pick_first(runqueue_t *rq) {
+    process_t *proc;
+    while ((proc = rq_first(rq)) && !is_dl(proc) && task_throttled(proc)) {
+        fair_dequeue(&rq->fair, proc);
+        rq_group_throttle(rq, proc);
+    }
+    return proc;
+}
+
+// Tiến trình vừa vào hàng đợi có nên chiếm quyền tiến trình đang chạy không
+static bool task_preempts(process_t *curr, process_t *proc) {
+    if (is_dl(proc) || is_dl(curr)) {
+        return !task_runs_first(curr, proc);
+    }
+    return fair_wakeup_preempt(curr, proc);
+}
+
+/**
+ * Moves a queued process from @p src to @p dst; both locks must be held.
+ *
+ * vruntime is only meaningful relative to its queue's min_vruntime, so it is
+ * rebased onto the destination queue.
+ */
+static void rq_migrate(runqueue_t *src, runqueue_t *dst, process_t *proc) {
+    fair_dequeue(&src->fair, proc);
+    proc->vruntime = proc->vruntime - src->fair.min_vruntime + dst->fair.min_vruntime;
+    rq_enqueue(dst, proc);
+    dst->nr_migrations++;
+}
+
+// Bắt CPU khác chạy lại scheduler: ghi need_resched nếu nó đang MWAIT trên cờ đó, không thì gửi IPI
+static void sched_kick(uint32_t cpu) {
+    if (cpu == this_cpu()->id) {
+        return;
+    }
+    if (cpus[cpu].polling) {
+        cpus[cpu].need_resched = true;
+        return;
+    }
+    lapic_send_ipi(cpus[cpu].lapic_id, RESCHED_VECTOR);
+}
+
+// Có việc thừa: đánh thức một CPU đã tắt tick để nó tự lấy việc qua work stealing
+static void sched_nohz_kick() {
+    for (uint32_t i = 0; i < cpu_count; i++) {
+        if (cpus[i].online && cpus[i].tick_stopped) {
+            sched_kick(i);
+            return;
+        }
+    }
+}
+
+static trap_frame_t *resched_interrupt(trap_frame_t *frame) {
+    lapic_eoi();
+    return frame;
+}
+
+/**
+ * Picks the run queue for a process that is becoming runnable.
+ *
+ * The previous CPU wins while it is idle, since its caches may still hold
+ * the process's working set; otherwise the least loaded allowed CPU is used.
+ * Remote queues are read without their locks: the result is only a hint.
+ */
+static uint32_t select_task_rq(process_t *proc) {
+    uint64_t allowed = proc->cpus_allowed & sched_online_mask();
+    if (!allowed) {
+        return this_cpu()->id;
+    }
+    if ((allowed & cpu_bit(proc->cpu)) && rq_nr_running(&runqueues[proc->cpu]) == 0) {
+        return proc->cpu;
+    }
+
+    uint32_t best = proc->cpu;
+    uint64_t best_load = UINT64_MAX;
+    for (uint32_t i = 0; i < cpu_count; i++) {
+        if (!(allowed & cpu_bit(i))) {
+            continue;
+        }
+        uint64_t load = rq_load(&runqueues[i]);
+        if (load < best_load || (load == best_load && i == proc->cpu)) {
+            best = i;
+            best_load = load;
+        }
+    }
+    return best;
+}
+
+/**
+ * Locks the run queue that @p proc currently belongs to. The queue can change
+ * while waiting for the lock (stealing moves processes), hence the re-check.
+ */
+static runqueue_t *task_rq_lock(process_t *proc, uint64_t *flags) {
+    for (;;) {
+        runqueue_t *rq = &runqueues[proc->cpu];
+        *flags = spin_lock_irqsave(&rq->lock);
+        if (rq == &runqueues[proc->cpu]) {
+            return rq;
+        }
+        spin_unlock_irqrestore(&rq->lock, *flags);
+    }
+}
+
+// Tiến trình vừa chạy gần đây: chuyển nó sang CPU khác sẽ mất cache
+static bool task_hot(process_t *proc, uint64_t now) {
+    return now - proc->last_ran < SCHED_MIGRATION_COST_NS;
+}
+
+/**
+ * Pulls up to @p max processes from @p src into @p dst, stopping once the
+ * moved weight reaches @p max_load. Both locks must be held.
+ *
+ * @param allow_hot Also take cache-hot processes (used when @p dst is idle).
+ * @return The number of processes moved.
+ */
+static int rq_pull(runqueue_t *src, runqueue_t *dst, int max, uint64_t max_load, bool allow_hot) {
+    uint64_t now = timer_now_ns();
+    uint64_t moved_load = 0;
+    int moved = 0;
+
+    rb_node_t *node = rb_first(&src->fair.tasks);
+    while (node && moved < max && moved_load < max_load) {
+        process_t *proc = rb_entry(node, process_t, run_node);
+        node = rb_next(node);
+
+        if (!(proc->cpus_allowed & cpu_bit(dst->cpu))) {
+            continue;
+        }
+        if (!allow_hot && task_hot(proc, now)) {
+            continue;
+        }
+        rq_migrate(src, dst, proc);
+        moved_load += proc->weight;
+        moved++;
+    }
+    return moved;
+}
+
+/**
+ * Idle balancing: @p rq has nothing to run, so take one process from the
+ * queue with the most waiting processes. rq->lock is held; the remote lock is
+ * only try-locked so two CPUs stealing from each other cannot deadlock.
+ *
+ * @return true if a process was moved into @p rq.
+ */
+static bool sched_steal(runqueue_t *rq) {
+    runqueue_t *busiest = NULL;
+    for (uint32_t i = 0; i < cpu_count; i++) {
+        runqueue_t *other = &runqueues[i];
+        if (other == rq || !cpus[i].online || !other->fair.nr_queued) {
+            continue;
+        }
+        if (!busiest || other->fair.nr_queued > busiest->fair.nr_queued) {
+            busiest = other;
+        }
+    }
+    if (!busiest || !spin_trylock(&busiest->lock)) {
+        return false;
+    }
+
+    // Ưu tiên tiến trình đã nguội cache, nếu không có thì nhận bất kỳ
+    int moved = rq_pull(busiest, rq, 1, UINT64_MAX, false);
+    if (!moved) {
+        moved = rq_pull(busiest, rq, 1, UINT64_MAX, true);
+    }
+    spin_unlock(&busiest->lock);
+    return moved > 0;
+}
+
+/**
+ * Periodic load balancing, run from the tick with rq->lock held.
+ *
+ * When the busiest queue carries more than SCHED_IMBALANCE_PCT percent of
+ * this queue's load, cache-cold processes are pulled until about half of the
+ * difference has moved.
+ *
+ * @return true if any process was moved into @p rq.
+ */
+static bool sched_balance(runqueue_t *rq) {
+    uint64_t this_load = rq_load(rq);
+    runqueue_t *busiest = NULL;
+    uint64_t busiest_load = 0;
+
+    for (uint32_t i = 0; i < cpu_count; i++) {
+        runqueue_t *other = &runqueues[i];
+        if (other == rq || !cpus[i].online || rq_nr_running(other) < 2) {
+            continue;
+        }
+        uint64_t load = rq_load(other);
+        if (load > busiest_load) {
+            busiest = other;
+            busiest_load = load;
+        }
+    }
+    if (!busiest || busiest_load * 100 <= this_load * SCHED_IMBALANCE_PCT) {
+        return false;
+    }
+    if (!spin_trylock(&busiest->lock)) {
+        return false;
+    }
+    int moved = rq_pull(busiest, rq, SCHED_BALANCE_MAX_PULL, (busiest_load - this_load) / 2, false);
+    spin_unlock(&busiest->lock);
+    return moved > 0;
+}
+
+void sched_init() {
+    for (uint32_t i = 0; i < MAX_CPUS; i++) {
+        spin_init_named(&runqueues[i].lock, "runqueue");
+        runqueues[i].cpu = i;
+    }
+    irq_register_handler(RESCHED_VECTOR, resched_interrupt);
+}
+
+/**
+ * Makes @p next the running process on this CPU.
+ *
+ * Saves the outgoing PKRU, points tss.rsp0 and syscall_rsp at the incoming
+ * process's own kernel stack so its next interrupt or syscall lands there,
+ * loads its page table, FS base and PKRU, and starts a new slice for
+ * runtime accounting.
+ * The idle process and kernel threads without an address space of their own
+ * (see kthread_use_mm) borrow the previous page table instead of loading
+ * one, so going idle or running a worker and then back to the same process
+ * costs no TLB flush. Threads of one process share a page table, so
+ * switching between them does not flush either.
+ *
+ * The CPU keeps a reference to the address space whose page table is loaded
+ * (active_mm), so that page table stays valid while it is borrowed even if
+ * every thread of its process has exited.
+ *
+ * @param prev The process being switched away from, or NULL.
+ * @param next The process to run.
+ */
+void sched_switch_to(process_t *prev, process_t *next) {
+    uint64_t now = timer_now_ns();
+    cpu_t *cpu = this_cpu();
+    runqueue_t *rq = &runqueues[cpu->id];
+
+    if (prev) {
+        context_save_pkru(prev);
+        prev->last_ran = now;
+    }
+
+    if (!is_idle(rq, next)) {
+        sched_account_wait(next, now);
+    }
+    next->state = PROCESS_STATE_RUNNING;
+    next->cpu = cpu->id;
+    next->exec_start = now;
+    next->slice_exec_start = next->sum_exec_runtime;
+    process_set_current(next);
+
+    cpu->context_switches++;
+    cpu->tss->rsp0 = next->kernel_stack_top;
+    cpu->syscall_rsp = next->kernel_stack_top;
+    if (prev && (is_idle(rq, next) || (next->kthread && !next->mm))) {
+        next->page_table = prev->page_table;
+    }
+    // Cùng không gian địa chỉ thì không ghi CR3, tránh xóa TLB vô ích
+    if (!prev || prev->page_table != next->page_table) {
+        switch_page_table((void *)next->page_table);
+        if (next->mm != cpu->active_mm) {
+            if (next->mm) {
+                address_space_get(next->mm);
+            }
+            if (cpu->active_mm) {
+                address_space_put(cpu->active_mm);
+            }
+            cpu->active_mm = next->mm;
+        }
+    }
+    // Kernel không dùng FS: chỉ ghi MSR khi luồng user cần giá trị khác
+    if (next->mm && next->fs_base != cpu->fs_base) {
+        wrmsr(IA32_FS_BASE_MSR, next->fs_base);
+        cpu->fs_base = next->fs_base;
+    }
+    context_restore_pkru(next);
+}
+
+/**
+ * Switches from @p prev to @p next on this CPU.
+ *
+ * Only the callee-saved registers and the kernel stack are swapped; the
+ * user state of both processes already sits in trap frames on their own
+ * kernel stacks.
+ *
+ * @param prev The running process.
+ * @param next The process to run.
+ */
+void sched_context_switch(process_t *prev, process_t *next) {
+    sched_switch_to(prev, next);
+    switch_context(&prev->context, &next->context);
+}
+
+/**
+ * Completes a switch on the incoming side.
+ *
+ * The switching CPU holds its rq->lock across switch_context so that the
+ * outgoing process cannot be stolen by another CPU before its registers are
+ * saved; whoever runs next releases it here. A process whose affinity no
+ * longer allows this CPU is handed to its new queue only now, for the same
+ * reason, and a thread that has exited is freed now that nothing runs on its
+ * stack.
+ */
+void sched_finish_switch() {
+    runqueue_t *rq = this_rq();
+    process_t *migrate = rq->migrate;
+    process_t *dead = rq->dead;
+    rq->migrate = NULL;
+    rq->dead = NULL;
+    spin_unlock(&rq->lock);
+
+    if (dead) {
+        process_reap(dead);
+    }
+
+    if (migrate) {
+        uint32_t cpu = select_task_rq(migrate);
+        runqueue_t *dst = &runqueues[cpu];
+        spin_lock(&dst->lock);
+        migrate->vruntime += dst->fair.min_vruntime;
+        rq_enqueue(dst, migrate);
+        // Tiến trình deadline vừa được nhận vào CPU đích không nên chờ tới tick kế tiếp
+        process_t *curr = cpus[cpu].current;
+        if (is_dl(migrate) && curr && (is_idle(dst, curr) || task_preempts(curr, migrate))) {
+            cpus[cpu].need_resched = true;
+        }
+        spin_unlock(&dst->lock);
+        sched_kick(cpu);
+    }
+}
+
+/**
+ * Core of schedule() and sched_yield().
+ *
+ * The running process is kept out of the tree. It keeps the CPU when it is
+ * still runnable here and either nothing is queued or (unless yielding) it
+ * would still be picked first: deadline processes by earliest deadline,
+ * ahead of fair processes by smallest vruntime. An empty queue first tries
+ * to steal from another CPU, then falls back to the idle process.
+ *
+ * A deadline process that yields has finished its job and sleeps until its
+ * next period; one whose budget ran out is not queued again until then.
+ */
+static void sched_pick_and_switch(bool yield) {
+    cpu_t *cpu = this_cpu();
+    // Gọi schedule() nghĩa là không còn ở trong vùng đọc RCU nào
+    rcu_note_qs();
+    runqueue_t *rq = &runqueues[cpu->id];
+    uint64_t flags = spin_lock_irqsave(&rq->lock);
+    process_t *prev = cpu->current;
+
+    cpu->need_resched = false;
+    if (!prev) {
+        spin_unlock_irqrestore(&rq->lock, flags);
+        return;
+    }
+
+    bool prev_idle = is_idle(rq, prev);
+    bool prev_running = prev->state == PROCESS_STATE_RUNNING;
+    bool prev_allowed = (prev->cpus_allowed & cpu_bit(cpu->id)) != 0;
+    if (!prev_idle) {
+        uint64_t now = timer_now_ns();
+        rq_update_curr(rq, prev, now);
+        if (is_dl(prev) && yield && prev_running) {
+            dl_throttle(&rq->dl, prev, now, false);
+        }
+        if (is_dl(prev) && prev->state == PROCESS_STATE_TERMINATED) {
+            dl_unthrottle(&rq->dl, prev);
+            rq->dl.total_bw -= prev->dl_bw;
+            prev->policy = SCHED_POLICY_FAIR;
+        }
+    }
+    bool prev_throttled = !prev_idle && task_throttled(prev);
+    // Chưa có idle loop thì không có chỗ để rời CPU, tiến trình phải ở lại
+    bool prev_can_stay = prev_idle ||
+                         (prev_running && ((prev_allowed && !prev_throttled) || !rq->idle_started));
+
+    process_t *next;
+    for (;;) {
+        next = rq_pick_first(rq);
+        if (!next && sched_steal(rq)) {
+            next = rq_pick_first(rq);
+        }
+        if (next) {
+            break;
+        }
+        if (prev_can_stay) {
+            prev->slice_exec_start = prev->sum_exec_runtime;
+            spin_unlock_irqrestore(&rq->lock, flags);
+            return;
+        }
+        if (rq->idle_started) {
+            next = &rq->idle;
+            break;
+        }
+        // Không còn gì để chạy và chưa có idle: chờ một ngắt đánh thức tiến trình nào đó
+        spin_unlock(&rq->lock);
+        __asm__ volatile("sti; hlt; cli" ::: "memory");
+        spin_lock(&rq->lock);
+    }
+
+    if (!is_idle(rq, next)) {
+        if (!yield && !prev_idle && prev_running && prev_allowed && !prev_throttled &&
+            task_runs_first(prev, next)) {
+            prev->slice_exec_start = prev->sum_exec_runtime;
+            spin_unlock_irqrestore(&rq->lock, flags);
+            return;
+        }
+        rq_dequeue(rq, next);
+    }
+
+    if (prev_running && !prev_idle) {
+        prev->state = PROCESS_STATE_READY;
+        // Tiến trình bị tạm dừng chờ trong danh sách riêng (deadline: đã nằm trong đó),
+        // tick đưa nó vào hàng đợi ở chu kỳ mới
+        if (!prev_allowed) {
+            prev->vruntime -= rq->fair.min_vruntime;
+            rq->migrate = prev;
+        } else if (!prev_throttled) {
+            rq_enqueue(rq, prev);
+        } else if (!is_dl(prev)) {
+            rq_group_throttle(rq, prev);
+        }
+    }
+    // Chỉ luồng do kernel cấp phát (có mm hoặc là luồng kernel) mới được giải phóng
+    if (prev->state == PROCESS_STATE_TERMINATED && (prev->kthread || prev->mm)) {
+        rq->dead = prev;
+    }
+
+    sched_context_switch(prev, next);
+    sched_finish_switch();
+    irq_restore(flags);
+}
+
+void schedule() {
+    // preempt_count là của CPU, không lưu theo tiến trình: ngủ khi nó khác 0 sẽ để lại nó cho tiến trình kế tiếp
+    if (preempt_count()) {
+        panic("Scheduler: schedule() called with preemption disabled");
+    }
+    sched_pick_and_switch(false);
+}
+
+void sched_yield() {
+    sched_pick_and_switch(true);
+}
+
+/**
+ * Hands the CPU to the blocked process @p next, as the synchronous IPC
+ * path does: the caller has just set itself BLOCKED and @p next is the
+ * partner it has made ready to run.
+ *
+ * When possible @p next goes from BLOCKED to running here without ever
+ * being queued, so the switch skips the ready queue and the pick. That is
+ * only done when the pick could not have gone differently in a way that
+ * matters: both are fair-class processes, @p next may run on this CPU and
+ * is not throttled, no deadline process is waiting here and no reschedule
+ * is pending. @p next may have last run on another CPU; it is pulled over
+ * if that queue's lock can be taken without waiting, the same rule
+ * sched_wakeup uses. The caller may already have been woken again (its
+ * state is back to RUNNING); then it is queued like any preempted process.
+ * Otherwise @p next is woken normally and the caller calls schedule().
+ *
+ * The caller is inside rcu_read_lock(), which keeps @p next allocated until
+ * it is checked; the read section ends here. Once both queues are locked
+ * and @p next is found BLOCKED, nobody can wake it (and so it cannot exit)
+ * before the switch.
+ *
+ * @return true if the CPU went to @p next directly. Either way the function
+ * returns when the caller runs again.
+ */
+bool sched_switch_direct(process_t *next) {
+    cpu_t *cpu = this_cpu();
+    runqueue_t *rq = &runqueues[cpu->id];
+    uint64_t flags = spin_lock_irqsave(&rq->lock);
+    process_t *prev = cpu->current;
+    runqueue_t *src = &runqueues[next->cpu];
+    bool locked = src == rq || spin_trylock(&src->lock);
+    bool ok = locked && prev && !is_idle(rq, prev) && prev != next && !cpu->need_resched && rq->idle_started &&
+              next->state == PROCESS_STATE_BLOCKED && cpus[src->cpu].current != next &&
+              (next->cpus_allowed & cpu_bit(cpu->id)) && !is_dl(prev) && !is_dl(next) &&
+              !task_throttled(next) && !dl_first(&rq->dl) &&
+              (prev->state == PROCESS_STATE_BLOCKED || prev->state == PROCESS_STATE_RUNNING);
+    if (locked && src != rq) {
+        if (ok) {
+            next->vruntime = next->vruntime - src->fair.min_vruntime + rq->fair.min_vruntime;
+            next->cpu = rq->cpu;
+            rq->nr_migrations++;
+        }
+        spin_unlock(&src->lock);
+    }
+    if (!ok) {
+        spin_unlock_irqrestore(&rq->lock, flags);
+        sched_wakeup(next);
+        rcu_read_unlock();
+        schedule();
+        return false;
+    }
+    rcu_read_unlock();
+
+    rcu_note_qs();
+    uint64_t now = timer_now_ns();
+    rq_update_curr(rq, prev, now);
+    fair_place(&rq->fair, next, false);
+    // Không chờ trong hàng đợi nên không tính vào độ trễ lập lịch
+    next->wait_start = now;
+    if (prev->state == PROCESS_STATE_RUNNING) {
+        prev->state = PROCESS_STATE_READY;
+        rq_enqueue(rq, prev);
+    }
+    sched_context_switch(prev, next);
+    sched_finish_switch();
+    irq_restore(flags);
+    return true;
+}
+
+/**
+ * Sleeps until an interrupt arrives or, with MWAIT, until another CPU writes
+ * this CPU's need_resched. Called and returns with interrupts disabled.
+ *
+ * MWAIT lets sched_kick wake an idle CPU with a plain store instead of an
+ * IPI. Without it (or if the flag is already set) HLT is used as before.
+ */
+static void sched_idle_wait(cpu_t *cpu, bool use_mwait) {
+    if (!use_mwait) {
+        // sti có hiệu lực sau lệnh kế tiếp nên ngắt không thể lọt vào giữa sti và hlt
+        __asm__ volatile("sti; hlt; cli" ::: "memory");
+        return;
+    }
+    cpu->polling = true;
+    // polling phải hiện ra trước khi đọc need_resched, nếu không có thể lỡ một lần ghi
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    __asm__ volatile("monitor" : : "a"(&cpu->need_resched), "c"(0), "d"(0));
+    if (!cpu->need_resched) {
+        // Như hlt: ngắt đến trong lúc chờ sẽ đánh thức CPU sau sti
+        __asm__ volatile("sti; mwait; cli" : : "a"(0), "c"(0) : "memory");
+    }
+    cpu->polling = false;
+}
+
+/**
+ * Runs the scheduler on this CPU forever, with the caller's context as the
+ * CPU's idle process. Called at the end of kmain on the BSP and of ap_main
+ * on every AP.
+ */
+void sched_idle_loop() {
+    cpu_t *cpu = this_cpu();
+    runqueue_t *rq = &runqueues[cpu->id];
+    process_t *idle = &rq->idle;
+    uint64_t cr3;
+
+    __asm__ volatile("cli");
+    __asm__ volatile("mov %%cr3, %0" : "=r"(cr3));
+    memset(idle, 0, sizeof(process_t));
+    idle->page_table = cr3;
+    idle->state = PROCESS_STATE_RUNNING;
+    idle->cpu = cpu->id;
+    idle->cpus_allowed = cpu_bit(cpu->id);
+    idle->kernel_stack_top = cpu->kernel_stack_top;
+    idle->weight = NICE_0_WEIGHT;
+    idle->pkru = PKRU_DEFAULT;
+
+    spin_lock(&rq->lock);
+    process_set_current(idle);
+    rq->idle_started = true;
+    spin_unlock(&rq->lock);
+
+    uint32_t eax, ebx, ecx, edx;
+    cpuid(1, 0, &eax, &ebx, &ecx, &edx);
+    bool use_mwait = ecx & CPUID_1_ECX_MONITOR;
+
+    for (;;) {
+        schedule();
+        rcu_idle_enter();
+        timer_idle_enter();
+        cpu->idle_entries++;
+        sched_idle_wait(cpu, use_mwait);
+        timer_idle_exit();
+        rcu_idle_exit();
+    }
+}
+
+void sched_new_task(process_t *proc) {
+    uint64_t flags;
+
+    if (!proc->weight) {
+        proc->weight = fair_nice_to_weight(proc->nice);
+    }
+    if (!proc->cpus_allowed) {
+        proc->cpus_allowed = UINT64_MAX;
+    }
+    proc->state = PROCESS_STATE_READY;
+    proc->cpu = select_task_rq(proc);
+
+    runqueue_t *rq = &runqueues[proc->cpu];
+    flags = spin_lock_irqsave(&rq->lock);
+    fair_place(&rq->fair, proc, true);
+    rq_enqueue(rq, proc);
+    spin_unlock_irqrestore(&rq->lock, flags);
+    sched_kick(rq->cpu);
+}
+
+/**
+ * Makes a blocked process runnable again.
+ *
+ * The process's current queue is locked first: a process that has set
+ * itself BLOCKED but not yet left its CPU is still running there and only
+ * needs its state put back, otherwise it is queued on the CPU chosen by
+ * select_task_rq. That queue is only try-locked while the old one is held;
+ * if it is busy the process stays on its old CPU when allowed, and the
+ * wakeup is retried otherwise.
+ *
+ * The woken process is placed close to min_vruntime of its new queue; if
+ * that puts it far enough behind the process running there, that CPU is
+ * asked to reschedule. A deadline process goes back to its own CPU with the
+ * constant bandwidth server rule applied, or stays out of the queue until
+ * its next period if it is still throttled.
+ *
+ * @param proc A process in PROCESS_STATE_BLOCKED (any other state is ignored).
+ */
+void sched_wakeup(process_t *proc) {
+    uint64_t flags;
+    runqueue_t *rq;
+    for (;;) {
+        rq = task_rq_lock(proc, &flags);
+        if (proc->state != PROCESS_STATE_BLOCKED) {
+            spin_unlock_irqrestore(&rq->lock, flags);
+            return;
+        }
+        if (cpus[rq->cpu].current == proc) {
+            proc->state = PROCESS_STATE_RUNNING;
+            spin_unlock_irqrestore(&rq->lock, flags);
+            return;
+        }
+        if (is_dl(proc)) {
+            break;
+        }
+        uint32_t cpu = select_task_rq(proc);
+        if (cpu == rq->cpu) {
+            break;
+        }
+        runqueue_t *dst = &runqueues[cpu];
+        if (spin_trylock(&dst->lock)) {
+            proc->cpu = cpu;
+            spin_unlock(&rq->lock);
+            rq = dst;
+            break;
+        }
+        if (proc->cpus_allowed & cpu_bit(rq->cpu)) {
+            break;
+        }
+        spin_unlock_irqrestore(&rq->lock, flags);
+        cpu_relax();
+    }
+
+    uint32_t cpu = rq->cpu;
+    uint64_t now = timer_now_ns();
+    process_t *curr = cpus[cpu].current;
+    if (curr && !is_idle(rq, curr)) {
+        rq_update_curr(rq, curr, now);
+    }
+
+    proc->state = PROCESS_STATE_READY;
+    if (is_dl(proc)) {
+        if (proc->dl_throttled) {
+            spin_unlock_irqrestore(&rq->lock, flags);
+            return;
+        }
+        dl_wakeup(proc, now);
+    } else {
+        fair_place(&rq->fair, proc, false);
+    }
+    rq_enqueue(rq, proc);
+
+    bool preempt = !curr || is_idle(rq, curr) || task_preempts(curr, proc);
+    if (preempt) {
+        cpus[cpu].need_resched = true;
+    }
+    spin_unlock_irqrestore(&rq->lock, flags);
+    if (preempt) {
+        sched_kick(cpu);
+    }
+}
+
+// Đổi trọng số của tiến trình trong lớp công bằng
+static void sched_reweight(process_t *proc, uint32_t weight) {
+    uint64_t flags;
+
+    // Trọng số là một phần của tổng tải của cây nên phải gỡ ra trước khi đổi
+    runqueue_t *rq = task_rq_lock(proc, &flags);
+    bool queued = task_queued(proc) && !is_dl(proc);
+    if (queued) {
+        fair_dequeue(&rq->fair, proc);
+    }
+    proc->weight = weight;
+    if (queued) {
+        fair_enqueue(&rq->fair, proc);
+    }
+    spin_unlock_irqrestore(&rq->lock, flags);
+}
+
+/**
+ * Recomputes the weight of every member of @p group from its shares.
+ * group->lock must be held. Terminated members are dropped from the list
+ * here, so an exiting process does not have to leave its group itself.
+ */
+static void sched_group_reweight(task_group_t *group) {
+    uint64_t total = 0;
+    for (process_t **link = &group->members; *link;) {
+        process_t *proc = *link;
+        if (proc->state == PROCESS_STATE_TERMINATED) {
+            *link = proc->group_next;
+            proc->group = NULL;
+            proc->group_next = NULL;
+            continue;
+        }
+        total += fair_nice_to_weight(proc->nice);
+        link = &proc->group_next;
+    }
+    for (process_t *proc = group->members; proc; proc = proc->group_next) {
+        sched_reweight(proc, task_group_member_weight(group, fair_nice_to_weight(proc->nice), total));
+    }
+}
+
+int sched_set_nice(process_t *proc, int nice) {
+    if (nice < NICE_MIN) nice = NICE_MIN;
+    if (nice > NICE_MAX) nice = NICE_MAX;
+
+    proc->nice = nice;
+    task_group_t *group = proc->group;
+    if (group) {
+        uint64_t flags = spin_lock_irqsave(&group->lock);
+        sched_group_reweight(group);
+        spin_unlock_irqrestore(&group->lock, flags);
+    } else {
+        sched_reweight(proc, fair_nice_to_weight(nice));
+    }
+    return nice;
+}
+
+/**
+ * Moves @p proc into @p group, or out of its group if @p group is NULL.
+ *
+ * Both the old and the new group have their members reweighted so that each
+ * group keeps weighing its shares in total. A process waiting for its old
+ * group's quota is queued again right away.
+ */
+void sched_group_attach(process_t *proc, task_group_t *group) {
+    uint64_t flags;
+    task_group_t *old = proc->group;
+    if (old == group) {
+        return;
+    }
+
+    if (old) {
+        flags = spin_lock_irqsave(&old->lock);
+        for (process_t **link = &old->members; *link; link = &(*link)->group_next) {
+            if (*link == proc) {
+                *link = proc->group_next;
+                break;
+            }
+        }
+        proc->group_next = NULL;
+        sched_group_reweight(old);
+        spin_unlock_irqrestore(&old->lock, flags);
+    }
+
+    runqueue_t *rq = task_rq_lock(proc, &flags);
+    if (proc->group_throttled) {
+        rq_group_unthrottle(rq, proc);
+        rq_enqueue(rq, proc);
+    }
+    proc->group = group;
+    spin_unlock_irqrestore(&rq->lock, flags);
+
+    if (group) {
+        flags = spin_lock_irqsave(&group->lock);
+        proc->group_next = group->members;
+        group->members = proc;
+        sched_group_reweight(group);
+        spin_unlock_irqrestore(&group->lock, flags);
+    } else {
+        sched_reweight(proc, fair_nice_to_weight(proc->nice));
+    }
+}
+
+/**
+ * Changes the set of CPUs @p proc may run on.
+ *
+ * A queued process on a CPU that is no longer allowed moves right away; the
+ * running process moves at its next reschedule, which is requested here.
+ *
+ * A deadline process holds bandwidth on one CPU and cannot be moved off it;
+ * its new mask is stored and takes effect when it leaves the deadline class.
+ *
+ * @param proc The process.
+ * @param mask Bit i allows CPU i; offline CPUs are ignored.
+ * @return 0 on success, -1 if @p mask contains no online CPU.
+ */
+int sched_set_affinity(process_t *proc, uint64_t mask) {
+    uint64_t flags;
+
+    if (!(mask & sched_online_mask())) {
+        return -1;
+    }
+
+    runqueue_t *rq = task_rq_lock(proc, &flags);
+    if (is_dl(proc)) {
+        proc->dl_cpus_allowed = mask;
+        spin_unlock_irqrestore(&rq->lock, flags);
+        return 0;
+    }
+    proc->cpus_allowed = mask;
+    bool allowed = (mask & cpu_bit(rq->cpu)) != 0;
+
+    // Tiến trình đang chờ quota trên CPU không còn được phép: đưa lại vào cây để chuyển đi như bình thường
+    if (!allowed && proc->group_throttled) {
+        rq_group_unthrottle(rq, proc);
+        rq_enqueue(rq, proc);
+    }
+
+    if (!allowed && task_queued(proc)) {
+        uint32_t cpu = select_task_rq(proc);
+        runqueue_t *dst = &runqueues[cpu];
+        // Khóa đích chỉ được try-lock khi đang giữ khóa nguồn; nếu bận thì nhả cả hai rồi thử lại
+        while (!spin_trylock(&dst->lock)) {
+            spin_unlock_irqrestore(&rq->lock, flags);
+            cpu_relax();
+            rq = task_rq_lock(proc, &flags);
+        }
+        if (task_queued(proc) && proc->cpu == rq->cpu) {
+            rq_migrate(rq, dst, proc);
+        }
+        spin_unlock(&dst->lock);
+        spin_unlock_irqrestore(&rq->lock, flags);
+        sched_kick(cpu);
+        return 0;
+    }
+
+    if (!allowed && cpus[rq->cpu].current == proc) {
+        cpus[rq->cpu].need_resched = true;
+    }
+    spin_unlock_irqrestore(&rq->lock, flags);
+    if (!allowed) {
+        sched_kick(rq->cpu);
+    }
+    return 0;
+}
+
+/**
+ * Switches the calling process between the fair and the deadline class.
+ *
+ * Partitioned EDF: the process is pinned to the first CPU, starting with its
+ * own, that can admit its bandwidth. Moving to another CPU happens right
+ * away through the usual affinity path. The mask the process had before is
+ * saved and restored when it goes back to the fair class; if that mask no
+ * longer contains the current CPU, the process moves at once.
+ *
+ * @param runtime CPU time the process needs per period (ns), or 0 to leave
+ *        the deadline class.
+ * @param deadline Time from the start of each period by which the runtime
+ *        must have been received (ns).
+ * @param period Activation period (ns).
+ * @return 0 on success, -1 on invalid parameters or if no CPU has enough
+ *         free bandwidth.
+ */
+int sched_set_deadline(uint64_t runtime, uint64_t deadline, uint64_t period) {
+    process_t *proc = process_current();
+    uint64_t flags;
+    if (!proc) {
+        return -1;
+    }
+
+    if (runtime == 0) {
+        runqueue_t *rq = task_rq_lock(proc, &flags);
+        if (is_dl(proc)) {
+            uint64_t now = timer_now_ns();
+            dl_update_curr(proc, now);
+            dl_unthrottle(&rq->dl, proc);
+            rq->dl.total_bw -= proc->dl_bw;
+            proc->policy = SCHED_POLICY_FAIR;
+            proc->vruntime = rq->fair.min_vruntime;
+            proc->exec_start = now;
+            proc->cpus_allowed = proc->dl_cpus_allowed;
+            if (!(proc->cpus_allowed & cpu_bit(rq->cpu))) {
+                cpus[rq->cpu].need_resched = true;
+            }
+        }
+        spin_unlock_irqrestore(&rq->lock, flags);
+        return 0;
+    }
+
+    if (!dl_params_valid(runtime, deadline, period)) {
+        return -1;
+    }
+    uint64_t bw = dl_bandwidth(runtime, deadline);
+    uint64_t allowed = proc->cpus_allowed & sched_online_mask();
+    uint32_t home = proc->cpu;
+    // Tiến trình deadline chỉ được phép chạy trên CPU của nó, nên đổi tham số luôn giữ CPU đó
+    uint64_t old_bw = is_dl(proc) ? proc->dl_bw : 0;
+    int target = -1;
+    for (uint32_t n = 0; n < cpu_count && target < 0; n++) {
+        uint32_t i = (home + n) % cpu_count;
+        if (!(allowed & cpu_bit(i))) {
+            continue;
+        }
+        runqueue_t *rq = &runqueues[i];
+        flags = spin_lock_irqsave(&rq->lock);
+        if (dl_admit(&rq->dl, i == home ? old_bw : 0, bw)) {
+            target = i;
+        }
+        spin_unlock_irqrestore(&rq->lock, flags);
+    }
+    if (target < 0) {
+        kprintf("Scheduler: deadline task PID=%llu rejected, no CPU has %llu%% free\n",
+                proc->pid, bw * 100 / DL_BW_UNIT);
+        return -1;
+    }
+
+    runqueue_t *rq = task_rq_lock(proc, &flags);
+    uint64_t now = timer_now_ns();
+    if (is_dl(proc)) {
+        dl_update_curr(proc, now);
+        dl_unthrottle(&rq->dl, proc);
+    } else {
+        fair_update_curr(&rq->fair, proc, now);
+        proc->dl_cpus_allowed = proc->cpus_allowed;
+    }
+    proc->policy = SCHED_POLICY_DEADLINE;
+    proc->dl_runtime = runtime;
+    proc->dl_deadline = deadline;
+    proc->dl_period = period;
+    proc->dl_bw = bw;
+    dl_start_period(proc, now);
+    proc->cpus_allowed = cpu_bit(target);
+    if ((uint32_t)target != rq->cpu) {
+        cpus[rq->cpu].need_resched = true;
+    }
+    // Nhả khóa với preempt_enable: need_resched đưa tiến trình sang CPU mới ngay
+    spin_unlock_irqrestore(&rq->lock, flags);
+    return 0;
+}
+
+void sched_dl_dump() {
+    for (uint32_t i = 0; i < cpu_count; i++) {
+        dl_rq_t *dl = &runqueues[i].dl;
+        if (!dl->total_bw && !dl->nr_misses && !dl->nr_throttles) {
+            continue;
+        }
+        uint64_t pct = dl->total_bw * 10000 / DL_BW_UNIT;
+        kprintf("Deadline: CPU %u: %llu.%02llu%% reserved, %llu deadline misses, %llu throttles\n",
+                i, pct / 100, pct % 100, dl->nr_misses, dl->nr_throttles);
+    }
+}
+
+/**
+ * Starts a new job for every throttled deadline process of @p rq whose next
+ * period has begun, and asks for a reschedule if one of them should run
+ * before @p curr. Called from the tick with rq->lock held.
+ */
+static void sched_dl_replenish(runqueue_t *rq, process_t *curr, uint64_t now) {
+    process_t *proc;
+    while ((proc = dl_replenish(&rq->dl, now))) {
+        // Đang chạy (chưa kịp rời CPU) hay đang ngủ: chỉ cần chu kỳ mới, không vào hàng đợi
+        if (proc == curr || proc->state != PROCESS_STATE_READY) {
+            continue;
+        }
+        rq_enqueue(rq, proc);
+        if (is_idle(rq, curr) || task_preempts(curr, proc)) {
+            cpus[rq->cpu].need_resched = true;
+        }
+    }
+}
+
+/**
+ * Puts back into the queue every process of @p rq whose group has entered a
+ * new period with fresh quota. Called from the tick with rq->lock held; the
+ * periods of a fully throttled group are advanced here, since none of its
+ * members runs to do it.
+ */
+static void sched_group_replenish(runqueue_t *rq, process_t *curr, uint64_t now) {
+    for (process_t **link = &rq->throttled; *link;) {
+        process_t *proc = *link;
+        task_group_refresh(proc->group, now);
+        if (proc->group->throttled) {
+            link = &proc->throttled_next;
+            continue;
+        }
+        *link = proc->throttled_next;
+        proc->group_throttled = false;
+        proc->throttled_next = NULL;
+        // min_vruntime đã tiến lên trong lúc chờ: đặt lại như tiến trình vừa thức dậy
+        fair_place(&rq->fair, proc, false);
+        rq_enqueue(rq, proc);
+        if (is_idle(rq, curr) || task_preempts(curr, proc)) {
+            cpus[rq->cpu].need_resched = true;
+        }
+    }
+}
+
+/**
+ * Timer tick hook.
+ *
+ * Charges the running process and requests a reschedule once it has used its
+ * share (or a deadline process its budget, or its group its quota), refills
+ * throttled processes whose period has begun, and runs the periodic load
+ * balancer. The switch itself is deferred
+ * to sched_check_resched on the way out of the interrupt, or to the next
+ * preempt_enable() if the interrupted code had preemption disabled.
+ *
+ * @param frame The interrupted register state.
+ * @return @p frame.
+ */
+trap_frame_t *sched_tick(trap_frame_t *frame) {
+    cpu_t *cpu = this_cpu();
+    runqueue_t *rq = &runqueues[cpu->id];
+    process_t *current = cpu->current;
+    if (!current) {
+        return frame;
+    }
+
+    spin_lock(&rq->lock);
+    uint64_t now = timer_now_ns();
+    if (!is_idle(rq, current)) {
+        rq_update_curr(rq, current, now);
+        if (!is_dl(current) && (rq->dl.nr_queued || fair_tick_preempt(&rq->fair, current))) {
+            cpu->need_resched = true;
+        }
+    } else if (rq->dl.nr_queued || rq->fair.nr_queued) {
+        cpu->need_resched = true;
+    }
+    if (rq->dl.throttled) {
+        sched_dl_replenish(rq, current, now);
+    }
+    if (rq->throttled) {
+        sched_group_replenish(rq, current, now);
+    }
+
+    if (rq->idle_started && cpu->ticks >= rq->next_balance) {
+        rq->next_balance = cpu->ticks + SCHED_BALANCE_INTERVAL_TICKS;
+        if (sched_balance(rq) && is_idle(rq, current)) {
+            cpu->need_resched = true;
+        }
+        // CPU đã tắt tick không tự cân bằng được, nên CPU bận gọi nó dậy
+        if (TIMER_NOHZ_IDLE && rq->fair.nr_queued) {
+            sched_nohz_kick();
+        }
+    }
+    spin_unlock(&rq->lock);
+    return frame;
+}
+
+bool sched_can_stop_tick() {
+    runqueue_t *rq = this_rq();
+    return rq->dl.throttled == NULL && rq->throttled == NULL;
+}
+
+/**
+ * Performs a pending reschedule before @p frame is restored.
+ *
+ * Returning to user mode always allows a switch. Kernel code is preempted
+ * only if its preempt_count is zero; the idle process is never preempted
+ * here because its loop calls schedule() as soon as hlt returns. A tick that
+ * arrives before the first process runs (on the boot stack) never switches.
+ *
+ * @param frame The register state about to be restored.
+ */
+void sched_check_resched(trap_frame_t *frame) {
+    cpu_t *cpu = this_cpu();
+    if (!cpu->need_resched || !cpu->current) {
+        return;
+    }
+    if ((frame->cs & 3) == 3 ||
+        (cpu->preempt_count == 0 && !is_idle(&runqueues[cpu->id], cpu->current))) {
+        schedule();
+    }
+}
+
+/**
+ * Preemption point used by preempt_enable() and cond_resched().
+ *
+ * The caller has already checked need_resched and that preempt_count is
+ * zero; a CPU that is not running a process (still on the boot stack) keeps
+ * going.
+ */
+void preempt_schedule(void) {
+    if (!this_cpu()->current) {
+        return;
+    }
+    schedule();
+}
@@ -0,0 +1,105 @@
+// scheduler.h
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "process.h"
+#include "sched_fair.h"
+#include "sched_dl.h"
+#include "sched_group.h"
+#include "spinlock.h"
+#include "percpu.h"
+#include "idt.h"
+
+// Hàng đợi chạy của một CPU
+typedef struct runqueue {
+    spinlock_t lock;          // Bảo vệ mọi trường bên dưới; được giữ xuyên qua switch_context
+    dl_rq_t dl;               // Tiến trình deadline của CPU này (chạy trước lớp công bằng)
+    fair_rq_t fair;           // Tiến trình sẵn sàng của CPU này
+    process_t *throttled;     // Tiến trình có nhóm đã hết quota, chờ chu kỳ mới của nhóm
+    uint32_t cpu;             // Chỉ số CPU sở hữu
+    process_t idle;           // Tiến trình idle, chạy khi hàng đợi rỗng
+    bool idle_started;        // Idle loop đã chạy, ngữ cảnh của idle hợp lệ
+    process_t *migrate;       // Tiến trình cần chuyển sang CPU khác khi switch xong
+    process_t *dead;          // Luồng kernel vừa kết thúc, giải phóng khi switch xong
+    uint64_t next_balance;    // Giá trị cpu->ticks của lần cân bằng tải kế tiếp
+    uint64_t nr_migrations;   // Số tiến trình đã kéo về CPU này
+} runqueue_t;
+
+extern runqueue_t runqueues[MAX_CPUS];
+
+// Độ trễ lập lịch lớn nhất đã đo trên mọi tiến trình (ns)
+extern uint64_t sched_latency_max_ns;
+
+// Hàng đợi của CPU hiện tại
+static inline runqueue_t *this_rq(void) {
+    return &runqueues[this_cpu()->id];
+}
+
+// Khởi tạo các hàng đợi và handler IPI reschedule
+void sched_init();
+
+// Biến ngữ cảnh hiện tại thành tiến trình idle của CPU và chạy scheduler mãi mãi
+void sched_idle_loop() __attribute__((noreturn));
+
+// Gọi từ ngắt timer: tính thời gian chạy, đặt need_resched khi hết phần và cân bằng tải định kỳ
+trap_frame_t *sched_tick(trap_frame_t *frame);
+
+// CPU hiện tại có thể tắt tick khi rảnh: không còn tiến trình deadline hay nhóm nào chờ nạp lại
+bool sched_can_stop_tick();
+
+// Gọi trước khi trở về user mode: chuyển tiến trình nếu need_resched của CPU được đặt
+void sched_check_resched(trap_frame_t *frame);
+
+// Chọn tiến trình deadline có hạn chót sớm nhất, không có thì tiến trình có vruntime
+// nhỏ nhất; tiến trình hiện tại tiếp tục nếu vẫn đứng đầu. Trả về khi tiến trình
+// hiện tại được chạy lại (có thể trên CPU khác)
+void schedule();
+
+// Nhường CPU cho một tiến trình khác nếu có, kể cả khi vruntime của nó lớn hơn.
+// Tiến trình deadline gọi hàm này để báo đã xong job, và ngủ tới chu kỳ kế tiếp
+void sched_yield();
+
+// Nhường CPU cho tiến trình next đang bị chặn (IPC đồng bộ); tiến trình gọi vừa tự đặt
+// BLOCKED. Nếu được, next chạy ngay mà không qua hàng đợi; nếu không, next được đánh thức
+// và tiến trình gọi schedule(). Gọi trong rcu_read_lock() để next còn tồn tại, vùng đọc
+// kết thúc bên trong. Trả về true nếu đã chuyển thẳng, khi tiến trình gọi được chạy lại
+bool sched_switch_direct(process_t *next);
+
+// Đưa tiến trình mới tạo vào hàng đợi của CPU ít tải nhất mà nó được phép chạy
+void sched_new_task(process_t *proc);
+
+// Đánh thức tiến trình đang bị chặn; có thể yêu cầu chiếm quyền tiến trình đang chạy
+void sched_wakeup(process_t *proc);
+
+// Đổi mức nice của tiến trình, trả về mức mới
+int sched_set_nice(process_t *proc, int nice);
+
+// Đặt mặt nạ CPU được phép chạy (bit i = CPU i). Trả về 0 hoặc -1 nếu không còn CPU hợp lệ
+int sched_set_affinity(process_t *proc, uint64_t mask);
+
+// Chuyển tiến trình đang chạy sang lớp deadline với ngân sách runtime mỗi period và
+// hạn chót deadline (ns); runtime = 0 đưa nó về lớp công bằng. Tiến trình được gắn vào
+// CPU đầu tiên còn đủ băng thông. Trả về 0, hoặc -1 nếu tham số sai hay không CPU nào nhận
+int sched_set_deadline(uint64_t runtime, uint64_t deadline, uint64_t period);
+
+// Đưa tiến trình vào nhóm (NULL: rời nhóm hiện tại); trọng số của mọi thành viên được tính lại
+void sched_group_attach(process_t *proc, task_group_t *group);
+
+// In băng thông deadline đã nhận và số lần trễ hạn/bị tạm dừng của mỗi CPU
+void sched_dl_dump();
+
+// Mặt nạ các CPU đang online
+uint64_t sched_online_mask();
+
+// Cập nhật trạng thái CPU (tiến trình hiện tại, tss.rsp0, CR3, PKRU) để chạy next
+void sched_switch_to(process_t *prev, process_t *next);
+
+// sched_switch_to rồi đổi kernel stack bằng switch_context
+void sched_context_switch(process_t *prev, process_t *next);
+
+// Gọi ngay sau khi được chuyển tới: nhả khóa hàng đợi do bên chuyển giữ
+void sched_finish_switch();
+
+#endif // SCHEDULER_H
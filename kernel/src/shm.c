@@ -0,0 +1,446 @@
+// shm.c
+#include "shm.h"
+#include "paging.h"
+#include "memory_manager.h"
+#include "scheduler.h"
+#include "usercopy.h"
+#include "klibc.h"
+#include "graphics.h"
+#include "config.h"
+
+// Các đối tượng còn tên
+static shm_object_t *shm_objects;
+static spinlock_t shm_lock = SPINLOCK_INIT;
+
+static uint32_t shm_nr_objects;
+static uint64_t shm_nr_transfers;
+static uint64_t shm_nr_transferred_pages;
+
+static void *shm_alloc(uint64_t size) {
+    uint64_t phys = allocate_memory_bytes(size);
+    return phys ? PHYS_TO_VIRT(phys) : NULL;
+}
+
+static void shm_free(void *ptr, uint64_t size) {
+    free_memory_bytes((uint64_t)VIRT_TO_PHYS(ptr), size);
+}
+
+static void shm_put(shm_object_t *obj) {
+    if (__atomic_sub_fetch(&obj->refcount, 1, __ATOMIC_ACQ_REL)) {
+        return;
+    }
+    for (uint64_t i = 0; i < obj->pages; i++) {
+        free_physical_block(obj->frames[i]);
+    }
+    shm_free(obj->frames, obj->pages * sizeof(uint64_t));
+    shm_free(obj, sizeof(shm_object_t));
+    __atomic_fetch_sub(&shm_nr_objects, 1, __ATOMIC_RELAXED);
+}
+
+// Tạo đối tượng chưa có tên trong danh sách, với các trang đã xóa; refcount = 1
+static shm_object_t *shm_object_create(const char name[SHM_NAME_MAX], uint64_t pages) {
+    shm_object_t *obj = shm_alloc(sizeof(shm_object_t));
+    if (!obj) {
+        return NULL;
+    }
+    obj->frames = shm_alloc(pages * sizeof(uint64_t));
+    if (!obj->frames) {
+        shm_free(obj, sizeof(shm_object_t));
+        return NULL;
+    }
+    memcpy(obj->name, name, SHM_NAME_MAX);
+    obj->refcount = 1;
+    obj->next = NULL;
+    obj->pages = 0;
+    __atomic_fetch_add(&shm_nr_objects, 1, __ATOMIC_RELAXED);
+    while (obj->pages < pages) {
+        uint64_t phys = allocate_physical_block();
+        if (!phys) {
+            shm_put(obj);
+            return NULL;
+        }
+        memset(PHYS_TO_VIRT(phys), 0, PAGE_SIZE);
+        obj->frames[obj->pages++] = phys;
+    }
+    return obj;
+}
+
+// Đối tượng có tên name trong danh sách (giữ shm_lock)
+static shm_object_t **shm_lookup(const char name[SHM_NAME_MAX]) {
+    shm_object_t **link = &shm_objects;
+    while (*link && memcmp((*link)->name, name, SHM_NAME_MAX) != 0) {
+        link = &(*link)->next;
+    }
+    return link;
+}
+
+// Chép tên vào buffer đệm 0; false nếu tên rỗng hoặc quá dài
+static bool shm_copy_name(char dst[SHM_NAME_MAX], const char *name) {
+    memset(dst, 0, SHM_NAME_MAX);
+    for (uint32_t i = 0; i < SHM_NAME_MAX; i++) {
+        if (!name[i]) {
+            return i > 0;
+        }
+        dst[i] = name[i];
+    }
+    return false;
+}
+
+/**
+ * Returns the object called @p name with a reference for the caller,
+ * creating it with @p size bytes if it does not exist.
+ *
+ * The pages of a new object are allocated and zeroed without shm_lock held;
+ * if another process created the same name in the meantime, its object
+ * wins and the new one is dropped.
+ */
+static shm_object_t *shm_open_object(const char name[SHM_NAME_MAX], uint64_t size) {
+    uint64_t pages = (size + PAGE_SIZE - 1) / PAGE_SIZE;
+    shm_object_t *created = NULL;
+    for (;;) {
+        spin_lock(&shm_lock);
+        shm_object_t *obj = *shm_lookup(name);
+        if (obj) {
+            if (pages > obj->pages) {
+                obj = NULL;
+            } else {
+                __atomic_fetch_add(&obj->refcount, 1, __ATOMIC_RELAXED);
+            }
+            spin_unlock(&shm_lock);
+            if (created) {
+                shm_put(created);
+            }
+            return obj;
+        }
+        if (created) {
+            // Một tham chiếu cho tên, một cho người gọi
+            created->refcount = 2;
+            created->next = shm_objects;
+            shm_objects = created;
+            spin_unlock(&shm_lock);
+            return created;
+        }
+        spin_unlock(&shm_lock);
+        if (!pages || pages > SHM_MAX_PAGES) {
+            return NULL;
+        }
+        created = shm_object_create(name, pages);
+        if (!created) {
+            return NULL;
+        }
+    }
+}
+
+// Cấp một dải len byte trong vùng SHM của mm (giữ mm->lock); 0 nếu hết chỗ
+static uint64_t shm_reserve(address_space_t *mm, uint64_t len) {
+    if (!mm->shm_next) {
+        mm->shm_next = SHM_MAP_BASE;
+    }
+    if (len > SHM_MAP_END - mm->shm_next) {
+        return 0;
+    }
+    uint64_t addr = mm->shm_next;
+    mm->shm_next += len;
+    return addr;
+}
+
+/**
+ * Reserves a range in @p mm, maps @p frames there and records the mapping
+ * (which the caller allocated, so nothing is allocated with the lock held
+ * except page tables).
+ *
+ * A failed mapping is undone with a TLB flush before returning, since a
+ * thread may already have touched the first pages.
+ *
+ * @return The address of the range, or 0.
+ */
+static uint64_t shm_map_frames(address_space_t *mm, shm_mapping_t *map, const uint64_t *frames, uint64_t pages,
+                               uint64_t flags) {
+    uint64_t len = pages * PAGE_SIZE;
+    uint64_t irq = spin_lock_irqsave(&mm->lock);
+    uint64_t addr = shm_reserve(mm, len);
+    if (!addr) {
+        spin_unlock_irqrestore(&mm->lock, irq);
+        return 0;
+    }
+    uint64_t i = 0;
+    while (i < pages && map_memory(mm->page_table, addr + i * PAGE_SIZE, frames[i], PAGE_SIZE, flags)) {
+        i++;
+    }
+    if (i == pages) {
+        map->addr = addr;
+        map->len = len;
+        map->next = mm->shm_maps;
+        mm->shm_maps = map;
+    }
+    spin_unlock_irqrestore(&mm->lock, irq);
+    if (i < pages) {
+        address_space_unmap(mm, addr, addr + i * PAGE_SIZE, false);
+        return 0;
+    }
+    return addr;
+}
+
+int64_t shm_map(address_space_t *mm, const char *name, uint64_t size) {
+    char key[SHM_NAME_MAX];
+    if (!mm || !shm_copy_name(key, name)) {
+        return -1;
+    }
+    shm_object_t *obj = shm_open_object(key, size);
+    if (!obj) {
+        return -1;
+    }
+    shm_mapping_t *map = shm_alloc(sizeof(shm_mapping_t));
+    if (!map) {
+        shm_put(obj);
+        return -1;
+    }
+    map->obj = obj;
+    // Frame thuộc về đối tượng, không bị giải phóng cùng page table
+    uint64_t flags = PAGING_PAGE_PRESENT | PAGING_PAGE_RW | PAGING_PAGE_USER | PAGING_PAGE_SHARED;
+    uint64_t addr = shm_map_frames(mm, map, obj->frames, obj->pages, flags);
+    if (!addr) {
+        shm_free(map, sizeof(shm_mapping_t));
+        shm_put(obj);
+        return -1;
+    }
+    return (int64_t)addr;
+}
+
+/**
+ * Unmaps the range that starts at @p addr.
+ *
+ * brk_lock is held across the unmap so that a page_send of pages from the
+ * same received range cannot take a page out from under it.
+ */
+int shm_unmap(address_space_t *mm, uint64_t addr) {
+    if (!mm) {
+        return -1;
+    }
+    mutex_lock(&mm->brk_lock);
+    uint64_t irq = spin_lock_irqsave(&mm->lock);
+    shm_mapping_t **link = &mm->shm_maps;
+    while (*link && (*link)->addr != addr) {
+        link = &(*link)->next;
+    }
+    shm_mapping_t *map = *link;
+    if (map) {
+        *link = map->next;
+    }
+    spin_unlock_irqrestore(&mm->lock, irq);
+    if (!map) {
+        mutex_unlock(&mm->brk_lock);
+        return -1;
+    }
+    address_space_unmap(mm, map->addr, map->addr + map->len, !map->obj);
+    mutex_unlock(&mm->brk_lock);
+
+    if (map->obj) {
+        shm_put(map->obj);
+    }
+    shm_free(map, sizeof(shm_mapping_t));
+    return 0;
+}
+
+int shm_unlink(const char *name) {
+    char key[SHM_NAME_MAX];
+    if (!shm_copy_name(key, name)) {
+        return -1;
+    }
+    spin_lock(&shm_lock);
+    shm_object_t **link = shm_lookup(key);
+    shm_object_t *obj = *link;
+    if (obj) {
+        *link = obj->next;
+    }
+    spin_unlock(&shm_lock);
+    if (!obj) {
+        return -1;
+    }
+    shm_put(obj);
+    return 0;
+}
+
+// Kiểm tra các trang sắp gửi và lấy frame của chúng (giữ brk_lock và mm->lock của from)
+static bool shm_collect_frames(address_space_t *from, uint64_t addr, uint64_t pages, uint64_t *frames) {
+    uint64_t need = PAGING_PAGE_PRESENT | PAGING_PAGE_RW | PAGING_PAGE_USER;
+    for (uint64_t i = 0; i < pages; i++) {
+        uint64_t *pte = paging_get_pte(from->page_table, addr + i * PAGE_SIZE);
+        if (!pte || (*pte & need) != need || (*pte & PAGING_PAGE_SHARED)) {
+            return false;
+        }
+        frames[i] = paging_user_phys(from->page_table, addr + i * PAGE_SIZE);
+    }
+    return true;
+}
+
+/**
+ * Moves the pages [@p addr, @p addr + @p len) from @p from to @p to.
+ *
+ * No data is copied: the frames are mapped into a fresh range of @p to
+ * first, then their PTEs in @p from are cleared and flushed, and only then
+ * is the message queued, so the receiver never sees pages the sender can
+ * still write. Until the flush the sender may still write to them, which
+ * is the same as writing just before the call. The sender's brk_lock is
+ * held throughout, which keeps sbrk, shm_unmap and other transfers from
+ * changing the same PTEs; each mm->lock is only held for short sections
+ * and never nested, so two processes can send to each other at once.
+ *
+ * Only private 4 KiB pages can be sent: large heap pages, vDSO and ring
+ * pages, and pages of shared-memory objects are refused. A failure leaves
+ * @p from untouched.
+ *
+ * @return 0, or -1 on failure.
+ */
+int shm_transfer(address_space_t *from, address_space_t *to, uint64_t addr, uint64_t len, uint64_t sender) {
+    uint64_t pages = (len + PAGE_SIZE - 1) / PAGE_SIZE;
+    if (!from || !to || addr % PAGE_SIZE || !pages || pages > PAGE_SEND_MAX_PAGES ||
+        !access_ok(addr, pages * PAGE_SIZE) || !__atomic_load_n(&to->users, __ATOMIC_ACQUIRE)) {
+        return -1;
+    }
+    uint64_t *frames = shm_alloc(pages * sizeof(uint64_t));
+    shm_mapping_t *map = shm_alloc(sizeof(shm_mapping_t));
+    shm_message_t *message = shm_alloc(sizeof(shm_message_t));
+    int ret = -1;
+    if (!frames || !map || !message) {
+        goto out;
+    }
+
+    mutex_lock(&from->brk_lock);
+    uint64_t irq = spin_lock_irqsave(&from->lock);
+    bool ok = shm_collect_frames(from, addr, pages, frames);
+    spin_unlock_irqrestore(&from->lock, irq);
+    uint64_t dest = 0;
+    if (ok) {
+        map->obj = NULL;
+        dest = shm_map_frames(to, map, frames, pages, PAGING_PAGE_PRESENT | PAGING_PAGE_RW | PAGING_PAGE_USER);
+    }
+    if (!dest) {
+        mutex_unlock(&from->brk_lock);
+        goto out;
+    }
+    map = NULL;
+    irq = spin_lock_irqsave(&from->lock);
+    for (uint64_t i = 0; i < pages; i++) {
+        uint64_t size;
+        paging_unmap(from->page_table, addr + i * PAGE_SIZE, &size);
+    }
+    spin_unlock_irqrestore(&from->lock, irq);
+    address_space_flush_tlb(from, addr, pages * PAGE_SIZE);
+    mutex_unlock(&from->brk_lock);
+
+    message->msg.addr = dest;
+    message->msg.len = pages * PAGE_SIZE;
+    message->msg.sender = sender;
+    message->next = NULL;
+    irq = spin_lock_irqsave(&to->lock);
+    shm_message_t **tail = &to->inbox;
+    while (*tail) {
+        tail = &(*tail)->next;
+    }
+    *tail = message;
+    message = NULL;
+    for (shm_waiter_t *w = to->inbox_waiters; w; w = w->next) {
+        w->queued = false;
+        sched_wakeup(w->task);
+    }
+    to->inbox_waiters = NULL;
+    spin_unlock_irqrestore(&to->lock, irq);
+
+    __atomic_fetch_add(&shm_nr_transfers, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&shm_nr_transferred_pages, pages, __ATOMIC_RELAXED);
+    ret = 0;
+out:
+    if (frames) {
+        shm_free(frames, pages * sizeof(uint64_t));
+    }
+    if (map) {
+        shm_free(map, sizeof(shm_mapping_t));
+    }
+    if (message) {
+        shm_free(message, sizeof(shm_message_t));
+    }
+    return ret;
+}
+
+// Tiến trình đích được tìm trong RCU: mm của nó chỉ bị bỏ sau grace period nên lấy tham chiếu được
+int shm_page_send(uint64_t pid, uint64_t addr, uint64_t len) {
+    process_t *self = process_current();
+    if (!self || !self->mm) {
+        return -1;
+    }
+    rcu_read_lock();
+    process_t *target = process_find(pid);
+    address_space_t *to = target ? target->mm : NULL;
+    if (to) {
+        address_space_get(to);
+    }
+    rcu_read_unlock();
+    if (!to) {
+        return -1;
+    }
+    int ret = shm_transfer(self->mm, to, addr, len, self->tgid);
+    address_space_put(to);
+    return ret;
+}
+
+int shm_page_recv(address_space_t *mm, shm_msg_t *msg, uint32_t flags) {
+    if (!mm || (flags & ~PAGE_RECV_NONBLOCK)) {
+        return -1;
+    }
+    process_t *self = process_current();
+    shm_waiter_t w = {.task = self};
+    for (;;) {
+        uint64_t irq = spin_lock_irqsave(&mm->lock);
+        shm_message_t *message = mm->inbox;
+        if (message || (flags & PAGE_RECV_NONBLOCK)) {
+            if (w.queued) {
+                shm_waiter_t **link = &mm->inbox_waiters;
+                while (*link != &w) {
+                    link = &(*link)->next;
+                }
+                *link = w.next;
+            }
+            if (message) {
+                mm->inbox = message->next;
+            }
+            spin_unlock_irqrestore(&mm->lock, irq);
+            if (!message) {
+                return -1;
+            }
+            *msg = message->msg;
+            shm_free(message, sizeof(shm_message_t));
+            return 0;
+        }
+        if (!w.queued) {
+            w.next = mm->inbox_waiters;
+            mm->inbox_waiters = &w;
+            w.queued = true;
+        }
+        self->state = PROCESS_STATE_BLOCKED;
+        spin_unlock_irqrestore(&mm->lock, irq);
+        schedule();
+    }
+}
+
+// Chạy trong callback RCU của address_space_free, khi không còn ai dùng as
+void shm_release(address_space_t *as) {
+    while (as->shm_maps) {
+        shm_mapping_t *map = as->shm_maps;
+        as->shm_maps = map->next;
+        if (map->obj) {
+            shm_put(map->obj);
+        }
+        shm_free(map, sizeof(shm_mapping_t));
+    }
+    while (as->inbox) {
+        shm_message_t *message = as->inbox;
+        as->inbox = message->next;
+        shm_free(message, sizeof(shm_message_t));
+    }
+}
+
+void shm_dump() {
+    kprintf("Shared memory: %u objects, %llu transfers moved %llu pages\n",
+            shm_nr_objects, shm_nr_transfers, shm_nr_transferred_pages);
+}
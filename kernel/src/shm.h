@@ -0,0 +1,93 @@
+// shm.h
+#ifndef SHM_H
+#define SHM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "address_space.h"
+#include "process.h"
+
+// Bộ nhớ chia sẻ giữa các tiến trình, không chép dữ liệu:
+// - Đối tượng có tên: shm_map tạo (hoặc mở) một dãy frame và ánh xạ chúng vào tiến trình
+//   gọi; mọi tiến trình mở cùng tên thấy cùng các frame. Đối tượng sống tới khi tên bị
+//   shm_unlink và ánh xạ cuối cùng bị gỡ.
+// - Chuyển trang: page_send gỡ các trang riêng của người gửi và ánh xạ chính các frame đó
+//   vào tiến trình nhận, thay vì chép; người nhận lấy địa chỉ qua page_recv.
+// Mọi ánh xạ nằm trong [SHM_MAP_BASE, SHM_MAP_END), cấp tăng dần và không dùng lại
+
+#define SHM_MAP_BASE 0x7E0000000000ULL
+#define SHM_MAP_END  0x7F0000000000ULL
+
+// Độ dài tên tối đa, kể cả NUL
+#define SHM_NAME_MAX 32
+
+// Cờ của page_recv
+#define PAGE_RECV_NONBLOCK 0x1
+
+// Một lần chuyển trang mà tiến trình nhận đọc bằng page_recv (bố cục khớp với thư viện user)
+typedef struct {
+    uint64_t addr;                  // Nơi các trang được ánh xạ trong tiến trình nhận
+    uint64_t len;                   // Số byte (bội của PAGE_SIZE)
+    uint64_t sender;                // TGID của người gửi
+} shm_msg_t;
+
+typedef struct shm_object {
+    struct shm_object *next;
+    char name[SHM_NAME_MAX];        // Đệm 0 tới hết mảng để so sánh bằng memcmp
+    volatile uint32_t refcount;     // Tên (khi còn trong danh sách) và mỗi ánh xạ
+    uint64_t pages;
+    uint64_t *frames;               // Địa chỉ vật lý của từng trang
+} shm_object_t;
+
+// Một dải trong vùng SHM của một không gian địa chỉ
+typedef struct shm_mapping {
+    struct shm_mapping *next;
+    uint64_t addr;
+    uint64_t len;
+    shm_object_t *obj;              // NULL: các trang nhận qua page_send, thuộc về page table
+} shm_mapping_t;
+
+// Một lần chuyển trang chưa được page_recv lấy
+typedef struct shm_message {
+    struct shm_message *next;
+    shm_msg_t msg;
+} shm_message_t;
+
+// Một chờ trong page_recv, nằm trên kernel stack của luồng chờ
+typedef struct shm_waiter {
+    struct shm_waiter *next;
+    process_t *task;
+    bool queued;                    // Còn trong danh sách; người đánh thức xóa cả danh sách
+} shm_waiter_t;
+
+// Ánh xạ đối tượng tên name vào mm, tạo mới với size byte nếu chưa có (size = 0 chỉ mở).
+// Trả về địa chỉ, hoặc -1 nếu tên sai, đối tượng có sẵn nhỏ hơn size hoặc hết bộ nhớ
+int64_t shm_map(address_space_t *mm, const char *name, uint64_t size);
+
+// Gỡ dải bắt đầu tại addr do shm_map hoặc page_recv trả về. Các trang nhận được
+// trả về allocator; trang của đối tượng chỉ bị gỡ. -1 nếu không có dải nào ở đó
+int shm_unmap(address_space_t *mm, uint64_t addr);
+
+// Bỏ tên; đối tượng còn sống tới khi ánh xạ cuối cùng bị gỡ. -1 nếu không có tên này
+int shm_unlink(const char *name);
+
+// Chuyển các trang [addr, addr + len) của from sang to và xếp một thông điệp vào hộp thư
+// của to. Các trang phải là trang 4 KiB riêng, ghi được; sau khi trả về 0 chúng không còn
+// trong from. -1 nếu không chuyển được (from không đổi)
+int shm_transfer(address_space_t *from, address_space_t *to, uint64_t addr, uint64_t len, uint64_t sender);
+
+// page_send: chuyển trang của tiến trình gọi sang tiến trình pid
+int shm_page_send(uint64_t pid, uint64_t addr, uint64_t len);
+
+// page_recv: lấy thông điệp đầu tiên trong hộp thư của mm, chờ nếu trống (trừ khi
+// có PAGE_RECV_NONBLOCK). -1 nếu trống và không chờ
+int shm_page_recv(address_space_t *mm, shm_msg_t *msg, uint32_t flags);
+
+// Gọi khi giải phóng không gian địa chỉ: bỏ tham chiếu tới các đối tượng và xóa hộp thư.
+// Frame của các trang nhận được do page table giải phóng
+void shm_release(address_space_t *as);
+
+// In số đối tượng, số lần và số trang đã chuyển
+void shm_dump();
+
+#endif // SHM_H
@@ -0,0 +1,137 @@
+// smp.c
+#include "smp.h"
+#include "limine.h"
+#include "percpu.h"
+#include "gdt.h"
+#include "idt.h"
+#include "cpu.h"
+#include "pkey.h"
+#include "vdso.h"
+#include "timer.h"
+#include "scheduler.h"
+#include "rcu.h"
+#include "syscall_handler.h"
+#include "memory_manager.h"
+#include "graphics.h"
+#include "io.h"
+#include "config.h"
+
+// Thời gian chờ một AP báo online trước khi bỏ qua nó
+#define AP_STARTUP_TIMEOUT_MS 1000
+
+__attribute__((used, section(".requests"))) static volatile struct limine_smp_request smp_request = {
+    .id = LIMINE_SMP_REQUEST,
+    .revision = 0,
+    .flags = 0
+};
+
+// Page table của kernel mà mọi AP dùng chung
+static uint64_t kernel_cr3;
+
+/**
+ * Per-CPU initialisation of an application processor, running on its own
+ * kernel stack. Mirrors what kmain does for the BSP, then idles.
+ */
+static __attribute__((noreturn)) void ap_main(cpu_t *cpu) {
+    __asm__ volatile("mov %0, %%cr3" : : "r"(kernel_cr3) : "memory");
+    write_cr4(read_cr4() | CR4_OSFXSR | CR4_OSXMMEXCPT);
+
+    gdt_init_cpu(cpu);
+    percpu_load(cpu);
+    idt_load();
+    syscall_init();
+    pku_init_ap();
+    vdso_init_cpu();
+    timer_init_ap();
+
+    rcu_cpu_online(cpu);
+    __atomic_store_n(&cpu->online, true, __ATOMIC_RELEASE);
+    sched_idle_loop();
+}
+
+/**
+ * Limine entry point of an AP. Limine's stack lives in bootloader-reclaimable
+ * memory, so the AP moves to its own stack before doing anything else.
+ */
+static void ap_entry(struct limine_smp_info *info) {
+    cpu_t *cpu = (cpu_t *)info->extra_argument;
+    __asm__ volatile(
+        "mov %0, %%rsp\n\t"
+        "xor %%ebp, %%ebp\n\t"
+        "call *%1"
+        :
+        : "r"(cpu->kernel_stack_top), "r"(ap_main), "D"(cpu)
+        : "memory");
+    __builtin_unreachable();
+}
+
+// Cấp phát stack kernel và IST1 cho một AP, trả về false nếu hết bộ nhớ
+static bool ap_alloc_stacks(cpu_t *cpu) {
+    uint64_t stack = allocate_physical_blocks(KERNEL_STACK_SIZE / BLOCK_SIZE);
+    uint64_t ist = allocate_physical_block();
+    if (!stack || !ist) {
+        if (stack) free_physical_blocks(stack, KERNEL_STACK_SIZE / BLOCK_SIZE);
+        if (ist) free_physical_block(ist);
+        return false;
+    }
+    cpu->kernel_stack_top = (uint64_t)PHYS_TO_VIRT(stack) + KERNEL_STACK_SIZE;
+    cpu->ist1_stack_top = (uint64_t)PHYS_TO_VIRT(ist) + BLOCK_SIZE;
+    return true;
+}
+
+/**
+ * Starts every AP reported by Limine, one at a time.
+ *
+ * Each AP is released by writing its goto_address and must report online
+ * before the next one starts, so bring-up code (GDT loading, MSR setup) never
+ * runs concurrently. Must be called after the memory manager, IDT and timer
+ * are initialised on the BSP.
+ *
+ * @return The number of CPUs online, including the BSP.
+ */
+uint32_t smp_init() {
+    struct limine_smp_response *response = smp_request.response;
+    if (!response) {
+        kprintf("SMP: No response from bootloader, running on BSP only\n");
+        return cpu_count;
+    }
+
+    __asm__ volatile("mov %%cr3, %0" : "=r"(kernel_cr3));
+    cpus[0].lapic_id = response->bsp_lapic_id;
+
+    for (uint64_t i = 0; i < response->cpu_count; i++) {
+        struct limine_smp_info *info = response->cpus[i];
+        if (info->lapic_id == response->bsp_lapic_id) {
+            continue;
+        }
+        if (cpu_count >= MAX_CPUS) {
+            kprintf("SMP: Ignoring CPUs beyond %d\n", MAX_CPUS);
+            break;
+        }
+
+        cpu_t *cpu = &cpus[cpu_count];
+        cpu->id = cpu_count;
+        cpu->lapic_id = info->lapic_id;
+        if (!ap_alloc_stacks(cpu)) {
+            kprintf("SMP: Out of memory for CPU %u stacks\n", cpu->lapic_id);
+            break;
+        }
+
+        info->extra_argument = (uint64_t)cpu;
+        __atomic_store_n(&info->goto_address, ap_entry, __ATOMIC_SEQ_CST);
+
+        uint64_t deadline = rdtsc() + tsc_per_ms * AP_STARTUP_TIMEOUT_MS;
+        while (!__atomic_load_n(&cpu->online, __ATOMIC_ACQUIRE) && rdtsc() < deadline) {
+            cpu_relax();
+        }
+        if (!cpu->online) {
+            // AP có thể vẫn khởi động muộn với slot này, nên không dùng lại nó
+            kprintf("SMP: CPU with LAPIC ID %u did not start\n", cpu->lapic_id);
+            break;
+        }
+        cpu_count++;
+    }
+
+    kprintf("SMP: %u CPUs online\n", cpu_count);
+    return cpu_count;
+}
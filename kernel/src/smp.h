@@ -0,0 +1,10 @@
+// smp.h
+#ifndef SMP_H
+#define SMP_H
+
+#include <stdint.h>
+
+// Khởi động tất cả AP qua yêu cầu SMP của Limine. Trả về số CPU đang chạy
+uint32_t smp_init();
+
+#endif // SMP_H
@@ -0,0 +1,186 @@
+// softirq.c
+#include "softirq.h"
+#include "kthread.h"
+#include "scheduler.h"
+#include "workqueue.h"
+#include "spinlock.h"
+#include "preempt.h"
+#include "timer.h"
+#include "cpu.h"
+#include "rcu.h"
+#include "graphics.h"
+#include "config.h"
+
+static void tasklet_action(void);
+
+// Handler của từng softirq, cố định lúc biên dịch
+static void (*const softirq_handlers[NR_SOFTIRQS])(void) = {
+    [SOFTIRQ_TIMER] = delayed_work_run,
+    [SOFTIRQ_RCU] = rcu_process_callbacks,
+    [SOFTIRQ_TASKLET] = tasklet_action,
+};
+
+bool in_interrupt() {
+    cpu_t *cpu = this_cpu();
+    return cpu->irq_depth || cpu->in_softirq;
+}
+
+// Đánh thức ksoftirqd của CPU hiện tại (nếu đã có)
+static void softirq_wake_thread(cpu_t *cpu) {
+    if (cpu->ksoftirqd) {
+        sched_wakeup(cpu->ksoftirqd);
+    }
+}
+
+/**
+ * Marks softirq @p nr pending on this CPU.
+ *
+ * From an interrupt handler it runs when the outermost handler returns.
+ * Raised from process context there is no such exit point, so the CPU's
+ * ksoftirqd is woken to run it instead.
+ */
+void raise_softirq(softirq_nr_t nr) {
+    uint64_t flags = irq_save();
+    cpu_t *cpu = this_cpu();
+    __atomic_fetch_or(&cpu->softirq_pending, 1u << nr, __ATOMIC_RELAXED);
+    if (!in_interrupt()) {
+        softirq_wake_thread(cpu);
+    }
+    irq_restore(flags);
+}
+
+/**
+ * Runs pending softirqs on this CPU. Called and returns with interrupts
+ * disabled; handlers run with them enabled.
+ *
+ * Preemption stays disabled throughout, so the handlers cannot sleep. A
+ * softirq raised while the handlers run (for instance by a nested interrupt)
+ * is picked up by the next round. After SOFTIRQ_MAX_RESTART rounds or
+ * SOFTIRQ_MAX_US microseconds the rest is left to ksoftirqd, so a flood of
+ * interrupts cannot starve the interrupted process.
+ */
+static void softirq_run(cpu_t *cpu) {
+    uint64_t start = rdtsc();
+    uint64_t budget = tsc_per_ms * SOFTIRQ_MAX_US / 1000;
+    int rounds = 0;
+
+    preempt_disable();
+    cpu->in_softirq = true;
+    uint32_t pending;
+    while ((pending = __atomic_exchange_n(&cpu->softirq_pending, 0, __ATOMIC_ACQUIRE))) {
+        irq_restore(0x200);
+        for (uint32_t nr = 0; pending; nr++, pending >>= 1) {
+            if (pending & 1) {
+                softirq_handlers[nr]();
+                cpu->softirq_count++;
+            }
+        }
+        irq_save();
+        if (++rounds >= SOFTIRQ_MAX_RESTART || rdtsc() - start > budget) {
+            break;
+        }
+    }
+    cpu->in_softirq = false;
+    // Ngắt đang tắt nên không chiếm quyền ở đây; điểm chiếm quyền là lúc thoát ngắt
+    preempt_enable();
+
+    if (cpu->softirq_pending) {
+        softirq_wake_thread(cpu);
+    }
+}
+
+/**
+ * Interrupt exit hook, called by irq_handler_c with interrupts disabled.
+ *
+ * Softirqs run only when leaving the outermost handler and only if the
+ * interrupted code held no lock (preempt_count is zero): a handler taking a
+ * lock the interrupted code already holds would deadlock. Otherwise they are
+ * left to ksoftirqd, which runs as soon as that code lets the CPU go.
+ */
+void softirq_irq_exit() {
+    cpu_t *cpu = this_cpu();
+    if (cpu->irq_depth || cpu->in_softirq || !cpu->softirq_pending) {
+        return;
+    }
+    if (preempt_count()) {
+        softirq_wake_thread(cpu);
+        return;
+    }
+    softirq_run(cpu);
+}
+
+// Thân của ksoftirqd: chạy softirq còn dồn lại, ngủ khi không còn gì
+static void ksoftirqd_main(void *arg) {
+    cpu_t *cpu = arg;
+    process_t *self = process_current();
+    for (;;) {
+        uint64_t flags = irq_save();
+        if (cpu->softirq_pending) {
+            softirq_run(cpu);
+            irq_restore(flags);
+            cond_resched();
+            continue;
+        }
+        // raise_softirq đến sau lúc này thấy BLOCKED và đánh thức lại, nên không lỡ lần nào
+        self->state = PROCESS_STATE_BLOCKED;
+        irq_restore(flags);
+        schedule();
+    }
+}
+
+void softirq_init() {
+    for (uint32_t i = 0; i < cpu_count; i++) {
+        if (!cpus[i].online) {
+            continue;
+        }
+        cpus[i].ksoftirqd = kthread_create(ksoftirqd_main, &cpus[i], (int)i);
+        if (!cpus[i].ksoftirqd) {
+            kprintf("softirq: Failed to start ksoftirqd on CPU %u\n", i);
+        }
+    }
+}
+
+bool tasklet_schedule(tasklet_t *t) {
+    if (__atomic_fetch_or(&t->state, TASKLET_SCHEDULED, __ATOMIC_ACQ_REL) & TASKLET_SCHEDULED) {
+        return false;
+    }
+    uint64_t flags = irq_save();
+    cpu_t *cpu = this_cpu();
+    t->next = cpu->tasklets;
+    cpu->tasklets = t;
+    irq_restore(flags);
+    raise_softirq(SOFTIRQ_TASKLET);
+    return true;
+}
+
+/**
+ * Runs the tasklets scheduled on this CPU.
+ *
+ * A tasklet still running on another CPU (scheduled again there while it
+ * ran) is put back and retried in a later round, so it never runs twice at
+ * the same time. SCHEDULED is cleared before the call, so the function may
+ * schedule its own tasklet again.
+ */
+static void tasklet_action(void) {
+    uint64_t flags = irq_save();
+    cpu_t *cpu = this_cpu();
+    tasklet_t *list = cpu->tasklets;
+    cpu->tasklets = NULL;
+    irq_restore(flags);
+
+    while (list) {
+        tasklet_t *t = list;
+        list = t->next;
+        if (__atomic_fetch_or(&t->state, TASKLET_RUNNING, __ATOMIC_ACQUIRE) & TASKLET_RUNNING) {
+            flags = irq_save();
+            t->next = cpu->tasklets;
+            cpu->tasklets = t;
+            irq_restore(flags);
+            raise_softirq(SOFTIRQ_TASKLET);
+            continue;
+        }
+        __atomic_fetch_and(&t->state, ~TASKLET_SCHEDULED, __ATOMIC_ACQ_REL);
+        t->func(t->data);
+        __atomic_fetch_and(&t->state, ~TASKLET_RUNNING, __ATOMIC_RELEASE);
+    }
+}
@@ -0,0 +1,53 @@
+// softirq.h
+#ifndef SOFTIRQ_H
+#define SOFTIRQ_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Softirq: nửa sau của xử lý ngắt. Handler ngắt cứng chỉ xác nhận thiết bị và
+// raise_softirq(); phần còn lại chạy với ngắt đã bật khi thoát handler ngắt ngoài cùng,
+// hoặc trong ksoftirqd của CPU khi quá nhiều việc dồn lại. Số nhỏ hơn chạy trước.
+typedef enum {
+    SOFTIRQ_TIMER,      // Delayed work đã tới hạn
+    SOFTIRQ_RCU,        // Callback RCU có grace period đã kết thúc
+    SOFTIRQ_TASKLET,    // Tasklet do driver lên lịch
+    NR_SOFTIRQS
+} softirq_nr_t;
+
+// Tasklet: một hàm lên lịch từ handler ngắt, chạy trong softirq trên CPU đã lên lịch nó.
+// Không bao giờ chạy song song với chính nó; lên lịch nhiều lần trước khi chạy chỉ chạy một lần
+typedef struct tasklet {
+    struct tasklet *next;
+    void (*func)(void *data);
+    void *data;
+    volatile uint32_t state;    // TASKLET_SCHEDULED | TASKLET_RUNNING
+} tasklet_t;
+
+#define TASKLET_SCHEDULED 1u
+#define TASKLET_RUNNING   2u
+
+// Tạo luồng ksoftirqd cho mỗi CPU online (gọi sau smp_init)
+void softirq_init();
+
+// Đánh dấu softirq nr cần chạy trên CPU hiện tại (an toàn trong ngắt)
+void raise_softirq(softirq_nr_t nr);
+
+// Gọi cuối irq_handler_c khi đã tắt ngắt: chạy softirq đang chờ nếu vừa thoát ngắt ngoài cùng
+void softirq_irq_exit();
+
+// Đang trong handler ngắt cứng hoặc softirq: không được ngủ
+bool in_interrupt();
+
+static inline void tasklet_init(tasklet_t *t, void (*func)(void *data), void *data) {
+    t->next = NULL;
+    t->func = func;
+    t->data = data;
+    t->state = 0;
+}
+
+// Lên lịch tasklet trên CPU hiện tại; trả về false nếu nó đã đang chờ chạy
+bool tasklet_schedule(tasklet_t *t);
+
+#endif // SOFTIRQ_H
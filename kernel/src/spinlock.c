@@ -0,0 +1,55 @@
+// spinlock.c
+#include "spinlock.h"
+#include "graphics.h"
+
+#if LOCK_STATS
+
+// Danh sách khóa đã đăng ký, chỉ được thêm vào (đẩy không khóa bằng CAS)
+static lock_stats_t *lock_stats_list;
+
+/**
+ * Adds a lock's counters to the list printed by lock_stats_dump().
+ *
+ * Registration is lock-free so it can be used for the locks that protect
+ * everything else, including the console lock.
+ */
+void lock_stats_register(lock_stats_t *stats, const char *name) {
+    stats->name = name;
+    stats->acquisitions = 0;
+    stats->contended = 0;
+    stats->spins = 0;
+    stats->max_hold_cycles = 0;
+    lock_stats_t *head = __atomic_load_n(&lock_stats_list, __ATOMIC_RELAXED);
+    do {
+        stats->next = head;
+    } while (!__atomic_compare_exchange_n(&lock_stats_list, &head, stats, true,
+                                          __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+/**
+ * Prints the counters of every registered lock that has been taken.
+ *
+ * Counters are read without the locks held, so a dump taken while other
+ * CPUs are busy is approximate.
+ */
+void lock_stats_dump(void) {
+    kprintf("Lock statistics (acquired / contended / spins / max hold cycles):\n");
+    for (lock_stats_t *s = __atomic_load_n(&lock_stats_list, __ATOMIC_ACQUIRE); s; s = s->next) {
+        if (s->acquisitions == 0) {
+            continue;
+        }
+        kprintf("  %s %p: %llu / %llu / %llu / %llu\n", s->name, s,
+                s->acquisitions, s->contended, s->spins, s->max_hold_cycles);
+    }
+}
+
+void lock_stats_reset(void) {
+    for (lock_stats_t *s = __atomic_load_n(&lock_stats_list, __ATOMIC_ACQUIRE); s; s = s->next) {
+        s->acquisitions = 0;
+        s->contended = 0;
+        s->spins = 0;
+        s->max_hold_cycles = 0;
+    }
+}
+
+#endif
@@ -0,0 +1,407 @@
+// spinlock.h
+#ifndef SPINLOCK_H
+#define SPINLOCK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "config.h"
+#include "cpu.h"
+#include "io.h"
+#include "preempt.h"
+
+// Thống kê tranh chấp cho mỗi khóa (chỉ khi LOCK_STATS = 1), đọc bằng lock_stats_dump()
+typedef struct lock_stats {
+    const char *name;
+    uint64_t acquisitions;      // Số lần lấy khóa
+    uint64_t contended;         // Số lần phải chờ
+    uint64_t spins;             // Tổng số vòng chờ
+    uint64_t max_hold_cycles;   // Thời gian giữ khóa lâu nhất (chu kỳ TSC)
+    uint64_t hold_start;
+    struct lock_stats *next;    // Danh sách mọi khóa đã đăng ký
+} lock_stats_t;
+
+#if LOCK_STATS
+#define LOCK_STATS_FIELD lock_stats_t stats;
+
+void lock_stats_register(lock_stats_t *stats, const char *name);
+void lock_stats_dump(void);
+void lock_stats_reset(void);
+
+// Gọi bởi chủ khóa ngay sau khi lấy được khóa, nên không cần atomic
+static inline void lock_stat_acquired(lock_stats_t *stats, uint64_t spins) {
+    stats->acquisitions++;
+    if (spins) {
+        stats->contended++;
+        stats->spins += spins;
+    }
+    stats->hold_start = rdtsc();
+}
+
+static inline void lock_stat_released(lock_stats_t *stats) {
+    uint64_t held = rdtsc() - stats->hold_start;
+    if (held > stats->max_hold_cycles) {
+        stats->max_hold_cycles = held;
+    }
+}
+#else
+#define LOCK_STATS_FIELD
+#define lock_stats_register(stats, name) ((void)(name))
+#define lock_stats_dump() ((void)0)
+#define lock_stats_reset() ((void)0)
+#define lock_stat_acquired(stats, spins) ((void)(spins))
+#define lock_stat_released(stats) ((void)0)
+#endif
+
+// Lưu RFLAGS rồi tắt ngắt
+static inline uint64_t irq_save(void) {
+    uint64_t flags;
+    __asm__ volatile("pushfq; popq %0; cli" : "=r"(flags) : : "memory");
+#if LATENCY_TRACE
+    if (flags & 0x200) {
+        latency_irqs_off(__builtin_return_address(0));
+    }
+#endif
+    return flags;
+}
+
+// Bật lại ngắt nếu nó đã bật khi irq_save được gọi
+static inline void irq_restore(uint64_t flags) {
+    if (flags & 0x200) {
+        latency_irqs_on();
+        __asm__ volatile("sti" : : : "memory");
+    }
+}
+
+// Mọi khóa bên dưới đều tắt chiếm quyền trong lúc giữ khóa. Biến thể _irqsave
+// nhả khóa và bật lại ngắt trước khi cho phép chiếm quyền trở lại.
+
+/* ---------------------------------------------------------------------------
+ * Ticket spinlock: các CPU lấy khóa theo thứ tự đến (FIFO), không bị bỏ đói
+ * ------------------------------------------------------------------------- */
+
+typedef struct {
+    union {
+        volatile uint32_t val;
+        struct {
+            volatile uint16_t owner;    // Vé đang được phục vụ
+            volatile uint16_t next;     // Vé tiếp theo sẽ được phát
+        };
+    };
+    LOCK_STATS_FIELD
+} spinlock_t;
+
+#define SPINLOCK_INIT { .val = 0 }
+
+static inline void spin_init(spinlock_t *lock) {
+    lock->val = 0;
+}
+
+// Khởi tạo và đăng ký khóa với tên để theo dõi tranh chấp
+static inline void spin_init_named(spinlock_t *lock, const char *name) {
+    spin_init(lock);
+    lock_stats_register(&lock->stats, name);
+}
+
+static inline bool spin_is_locked(spinlock_t *lock) {
+    uint32_t v = __atomic_load_n(&lock->val, __ATOMIC_RELAXED);
+    return (uint16_t)v != (uint16_t)(v >> 16);
+}
+
+static inline bool spin_trylock(spinlock_t *lock) {
+    uint32_t v = __atomic_load_n(&lock->val, __ATOMIC_RELAXED);
+    if ((uint16_t)v != (uint16_t)(v >> 16)) {
+        return false;
+    }
+    preempt_disable();
+    if (!__atomic_compare_exchange_n(&lock->val, &v, v + (1U << 16), false,
+                                     __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        preempt_enable();
+        return false;
+    }
+    lock_stat_acquired(&lock->stats, 0);
+    return true;
+}
+
+static inline void spin_lock(spinlock_t *lock) {
+    preempt_disable();
+    uint16_t ticket = __atomic_fetch_add(&lock->val, 1U << 16, __ATOMIC_ACQUIRE) >> 16;
+    uint64_t spins = 0;
+    // Chỉ đọc trong lúc chờ để không tranh cache line bằng lệnh ghi
+    while (__atomic_load_n(&lock->owner, __ATOMIC_ACQUIRE) != ticket) {
+        cpu_relax();
+        spins++;
+    }
+    lock_stat_acquired(&lock->stats, spins);
+}
+
+// Nhả khóa nhưng chưa cho phép chiếm quyền lại
+static inline void spin_release(spinlock_t *lock) {
+    lock_stat_released(&lock->stats);
+    // Chỉ chủ khóa ghi owner, nên không cần lệnh atomic read-modify-write
+    __atomic_store_n(&lock->owner, (uint16_t)(lock->owner + 1), __ATOMIC_RELEASE);
+}
+
+static inline void spin_unlock(spinlock_t *lock) {
+    spin_release(lock);
+    preempt_enable();
+}
+
+// Khóa với ngắt bị tắt trên CPU hiện tại, dùng cho dữ liệu cũng được truy cập trong handler ngắt
+static inline uint64_t spin_lock_irqsave(spinlock_t *lock) {
+    uint64_t flags = irq_save();
+    spin_lock(lock);
+    return flags;
+}
+
+static inline void spin_unlock_irqrestore(spinlock_t *lock, uint64_t flags) {
+    spin_release(lock);
+    irq_restore(flags);
+    preempt_enable();
+}
+
+/* ---------------------------------------------------------------------------
+ * MCS lock: mỗi CPU chờ trên node của chính nó, nên khi tranh chấp nặng
+ * chỉ có một cache line bị chuyển giao mỗi lần nhả khóa
+ * ------------------------------------------------------------------------- */
+
+typedef struct mcs_node {
+    struct mcs_node *volatile next;
+    volatile uint32_t locked;
+} mcs_node_t;
+
+typedef struct {
+    mcs_node_t *volatile tail;
+    LOCK_STATS_FIELD
+} mcs_lock_t;
+
+#define MCS_LOCK_INIT { .tail = 0 }
+
+static inline void mcs_init(mcs_lock_t *lock) {
+    lock->tail = 0;
+}
+
+static inline void mcs_init_named(mcs_lock_t *lock, const char *name) {
+    mcs_init(lock);
+    lock_stats_register(&lock->stats, name);
+}
+
+// node phải sống (thường trên stack) cho tới khi mcs_unlock trả về
+static inline void mcs_lock(mcs_lock_t *lock, mcs_node_t *node) {
+    uint64_t spins = 0;
+    preempt_disable();
+    node->next = 0;
+    node->locked = 1;
+    mcs_node_t *prev = __atomic_exchange_n(&lock->tail, node, __ATOMIC_ACQ_REL);
+    if (prev) {
+        __atomic_store_n(&prev->next, node, __ATOMIC_RELEASE);
+        while (__atomic_load_n(&node->locked, __ATOMIC_ACQUIRE)) {
+            cpu_relax();
+            spins++;
+        }
+    }
+    lock_stat_acquired(&lock->stats, spins);
+}
+
+static inline bool mcs_trylock(mcs_lock_t *lock, mcs_node_t *node) {
+    mcs_node_t *expected = 0;
+    node->next = 0;
+    node->locked = 0;
+    preempt_disable();
+    if (!__atomic_compare_exchange_n(&lock->tail, &expected, node, false,
+                                     __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        preempt_enable();
+        return false;
+    }
+    lock_stat_acquired(&lock->stats, 0);
+    return true;
+}
+
+static inline void mcs_release(mcs_lock_t *lock, mcs_node_t *node) {
+    lock_stat_released(&lock->stats);
+    mcs_node_t *next = __atomic_load_n(&node->next, __ATOMIC_ACQUIRE);
+    if (!next) {
+        mcs_node_t *expected = node;
+        if (__atomic_compare_exchange_n(&lock->tail, &expected, 0, false,
+                                        __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+            return;
+        }
+        // Có CPU vừa xếp hàng nhưng chưa kịp nối vào node của ta
+        while (!(next = __atomic_load_n(&node->next, __ATOMIC_ACQUIRE))) {
+            cpu_relax();
+        }
+    }
+    __atomic_store_n(&next->locked, 0, __ATOMIC_RELEASE);
+}
+
+static inline void mcs_unlock(mcs_lock_t *lock, mcs_node_t *node) {
+    mcs_release(lock, node);
+    preempt_enable();
+}
+
+static inline uint64_t mcs_lock_irqsave(mcs_lock_t *lock, mcs_node_t *node) {
+    uint64_t flags = irq_save();
+    mcs_lock(lock, node);
+    return flags;
+}
+
+static inline void mcs_unlock_irqrestore(mcs_lock_t *lock, mcs_node_t *node, uint64_t flags) {
+    mcs_release(lock, node);
+    irq_restore(flags);
+    preempt_enable();
+}
+
+/* ---------------------------------------------------------------------------
+ * Reader-writer lock: nhiều reader cùng lúc hoặc một writer; writer đang chờ
+ * chặn reader mới để không bị bỏ đói
+ * ------------------------------------------------------------------------- */
+
+#define RWLOCK_WRITER   0x80000000U
+#define RWLOCK_WAITING  0x40000000U
+#define RWLOCK_READERS  0x3FFFFFFFU
+
+typedef struct {
+    volatile uint32_t state;    // Bit 31: writer giữ khóa, bit 30: writer đang chờ, còn lại: số reader
+    LOCK_STATS_FIELD
+} rwlock_t;
+
+#define RWLOCK_INIT { .state = 0 }
+
+static inline void rwlock_init(rwlock_t *lock) {
+    lock->state = 0;
+}
+
+static inline void rwlock_init_named(rwlock_t *lock, const char *name) {
+    rwlock_init(lock);
+    lock_stats_register(&lock->stats, name);
+}
+
+static inline void read_lock(rwlock_t *lock) {
+    preempt_disable();
+    for (;;) {
+        uint32_t s = __atomic_load_n(&lock->state, __ATOMIC_RELAXED);
+        if (!(s & (RWLOCK_WRITER | RWLOCK_WAITING)) &&
+            __atomic_compare_exchange_n(&lock->state, &s, s + 1, false,
+                                        __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            return;
+        }
+        cpu_relax();
+    }
+}
+
+static inline void read_unlock(rwlock_t *lock) {
+    __atomic_fetch_sub(&lock->state, 1, __ATOMIC_RELEASE);
+    preempt_enable();
+}
+
+static inline void write_lock(rwlock_t *lock) {
+    uint64_t spins = 0;
+    preempt_disable();
+    for (;;) {
+        uint32_t s = __atomic_load_n(&lock->state, __ATOMIC_RELAXED);
+        if (!(s & ~RWLOCK_WAITING) &&
+            __atomic_compare_exchange_n(&lock->state, &s, RWLOCK_WRITER, false,
+                                        __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            break;
+        }
+        // Writer trước có thể đã xóa cờ chờ khi lấy khóa: đặt lại cho chính mình
+        if (!(s & RWLOCK_WAITING)) {
+            __atomic_fetch_or(&lock->state, RWLOCK_WAITING, __ATOMIC_RELAXED);
+        }
+        cpu_relax();
+        spins++;
+    }
+    lock_stat_acquired(&lock->stats, spins);
+}
+
+static inline void write_unlock(rwlock_t *lock) {
+    lock_stat_released(&lock->stats);
+    __atomic_fetch_and(&lock->state, ~RWLOCK_WRITER, __ATOMIC_RELEASE);
+    preempt_enable();
+}
+
+static inline uint64_t read_lock_irqsave(rwlock_t *lock) {
+    uint64_t flags = irq_save();
+    read_lock(lock);
+    return flags;
+}
+
+static inline void read_unlock_irqrestore(rwlock_t *lock, uint64_t flags) {
+    __atomic_fetch_sub(&lock->state, 1, __ATOMIC_RELEASE);
+    irq_restore(flags);
+    preempt_enable();
+}
+
+static inline uint64_t write_lock_irqsave(rwlock_t *lock) {
+    uint64_t flags = irq_save();
+    write_lock(lock);
+    return flags;
+}
+
+static inline void write_unlock_irqrestore(rwlock_t *lock, uint64_t flags) {
+    lock_stat_released(&lock->stats);
+    __atomic_fetch_and(&lock->state, ~RWLOCK_WRITER, __ATOMIC_RELEASE);
+    irq_restore(flags);
+    preempt_enable();
+}
+
+/* ---------------------------------------------------------------------------
+ * Sequence lock: reader không ghi gì cả và thử lại nếu writer chen vào,
+ * hợp với dữ liệu nhỏ được đọc thường xuyên và hiếm khi ghi
+ * ------------------------------------------------------------------------- */
+
+typedef struct {
+    volatile uint32_t seq;      // Lẻ khi writer đang ghi
+    spinlock_t lock;            // Tuần tự hóa các writer
+} seqlock_t;
+
+#define SEQLOCK_INIT { .seq = 0, .lock = SPINLOCK_INIT }
+
+static inline void seqlock_init(seqlock_t *sl) {
+    sl->seq = 0;
+    spin_init(&sl->lock);
+}
+
+static inline void seqlock_init_named(seqlock_t *sl, const char *name) {
+    sl->seq = 0;
+    spin_init_named(&sl->lock, name);
+}
+
+static inline uint32_t read_seqbegin(const seqlock_t *sl) {
+    uint32_t seq;
+    while ((seq = __atomic_load_n(&sl->seq, __ATOMIC_ACQUIRE)) & 1) {
+        cpu_relax();
+    }
+    return seq;
+}
+
+// true nếu dữ liệu vừa đọc có thể không nhất quán và phải đọc lại
+static inline bool read_seqretry(const seqlock_t *sl, uint32_t start) {
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    return __atomic_load_n(&sl->seq, __ATOMIC_RELAXED) != start;
+}
+
+static inline void write_seqlock(seqlock_t *sl) {
+    spin_lock(&sl->lock);
+    __atomic_store_n(&sl->seq, sl->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static inline void write_sequnlock(seqlock_t *sl) {
+    __atomic_store_n(&sl->seq, sl->seq + 1, __ATOMIC_RELEASE);
+    spin_unlock(&sl->lock);
+}
+
+static inline uint64_t write_seqlock_irqsave(seqlock_t *sl) {
+    uint64_t flags = irq_save();
+    write_seqlock(sl);
+    return flags;
+}
+
+static inline void write_sequnlock_irqrestore(seqlock_t *sl, uint64_t flags) {
+    __atomic_store_n(&sl->seq, sl->seq + 1, __ATOMIC_RELEASE);
+    spin_release(&sl->lock);
+    irq_restore(flags);
+    preempt_enable();
+}
+
+#endif // SPINLOCK_H
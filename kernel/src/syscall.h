@@ -16,7 +16,43 @@ typedef enum {
     SYSCALL_EXIT,
     SYSCALL_KILL,
     SYSCALL_GETPID,
+    SYSCALL_PKEY_ALLOC,
+    SYSCALL_PKEY_FREE,
+    SYSCALL_PKEY_MPROTECT,
+    SYSCALL_NICE,
+    SYSCALL_SCHED_SETAFFINITY,
+    SYSCALL_SCHED_GETAFFINITY,
+    SYSCALL_SCHED_SETDEADLINE,
+    SYSCALL_SCHED_YIELD,
+    SYSCALL_SCHED_GETDLSTATS,
+    SYSCALL_THREAD_CREATE,
+    SYSCALL_GETTID,
+    SYSCALL_SET_FS_BASE,
+    SYSCALL_FUTEX_WAIT,
+    SYSCALL_FUTEX_WAKE,
+    SYSCALL_FUTEX_REQUEUE,
+    SYSCALL_GETSTATS,
+    SYSCALL_URING_SETUP,
+    SYSCALL_URING_ENTER,
+    SYSCALL_BRK,
+    SYSCALL_SHM_MAP,
+    SYSCALL_SHM_UNMAP,
+    SYSCALL_SHM_UNLINK,
+    SYSCALL_PAGE_SEND,
+    SYSCALL_PAGE_RECV,
+    SYSCALL_IPC_CALL,
+    SYSCALL_IPC_REPLY_WAIT,
     // Add more syscalls here as needed
+    SYSCALL_MAX
 } syscall_number_t;
 
+// Thống kê của mỗi syscall: hist[i] đếm số lần gọi mất [2^i, 2^(i+1)) chu kỳ TSC
+// (ô cuối gom mọi lần lâu hơn)
+#define SYSCALL_HIST_BUCKETS 32
+
+typedef struct {
+    uint64_t count;
+    uint64_t hist[SYSCALL_HIST_BUCKETS];
+} syscall_stats_t;
+
 #endif // SYSCALL_H
@@ -5,132 +5,449 @@
 #include "graphics.h"
 #include "process.h"
 #include "memory_manager.h"
+#include "pkey.h"
+#include "cpu.h"
+#include "gdt.h"
+#include "scheduler.h"
+#include "percpu.h"
+#include "futex.h"
+#include "uring.h"
+#include "console.h"
+#include "usercopy.h"
+#include "heap.h"
+#include "shm.h"
+#include "ipc.h"
 
 typedef int pid_t;
 typedef long off_t;
+struct stat;
+
+// Thống kê của mỗi syscall, đọc được từ user space qua SYSCALL_GETSTATS
+static syscall_stats_t syscall_stats[SYSCALL_MAX];
 
 /**
  * Implementation of the write syscall. Writes data from a buffer to a file
  * descriptor.
  *
  * @param fd The file descriptor to write to. Currently only fd=1 (standard
- * output) is supported.
+ * output) and fd=2 (standard error) are supported; both go to the console
+ * buffer and reach the screen asynchronously.
  * @param buf The buffer to write from.
  * @param count The number of bytes to write from @p buf.
  *
- * @return The number of bytes written, or -1 on failure.
+ * @return The number of bytes written, or -1 on failure (including a
+ * @p buf that is not readable user memory).
  */
-ssize_t syscall_write(int fd, const void *buf, size_t count) {
-    if (fd == 1) { // Standard output
-        const char *str = (const char *)buf;
-        for (size_t i = 0; i < count; i++) {
-            put_char(str[i]);
-        }
-        return count;
+SYSCALL_DEFINE3(write, int, fd, const void *, buf, size_t, count) {
+    if (fd == 1 || fd == 2) { // Standard output, standard error
+        int64_t written = console_buffer_write_user((const char *)buf, count);
+        return written < 0 ? -1 : written;
     }
 
     // Handle other file descriptors if needed
     return -1; // Unsupported file descriptor
 }
 
-// Implement the exit syscall
-void syscall_exit(int status) {
-    kprintf("Process exited with status %d\n", status);
-    // Implement process termination logic here
-    // process_exit(status);
+// Khác Linux (exit_group): chỉ kết thúc luồng gọi; tiến trình kết thúc khi luồng cuối cùng thoát
+SYSCALL_DEFINE1(exit, int, status) {
+    process_exit(status);
+}
+
+// Các luồng của một tiến trình có cùng PID (tgid), mỗi luồng có TID riêng
+SYSCALL_DEFINE0(getpid) {
+    process_t *proc = process_current();
+    return proc ? (ssize_t)proc->tgid : -1;
+}
+
+SYSCALL_DEFINE0(gettid) {
+    process_t *proc = process_current();
+    return proc ? (ssize_t)proc->pid : -1;
+}
+
+// Tạo luồng chạy entry(arg) trên user stack cho trước, trong không gian địa chỉ của tiến trình gọi.
+// Trả về TID của luồng mới
+SYSCALL_DEFINE3(thread_create, uint64_t, entry, uint64_t, stack, uint64_t, arg) {
+    process_t *thread = thread_create(process_current(), entry, stack, arg);
+    return thread ? (ssize_t)thread->pid : -1;
+}
+
+// Giống arch_prctl(ARCH_SET_FS): đặt FS base của luồng gọi cho thread-local storage
+SYSCALL_DEFINE1(set_fs_base, uint64_t, fs_base) {
+    return process_set_fs_base(fs_base);
+}
+
+// Khác Linux (futex(2) với op): mỗi thao tác là một syscall riêng. timeout_ns tương đối, 0 = chờ mãi
+SYSCALL_DEFINE3(futex_wait, uint64_t, uaddr, uint32_t, val, uint64_t, timeout_ns) {
+    process_t *proc = process_current();
+    return proc ? futex_wait(proc->mm, uaddr, val, timeout_ns) : -1;
 }
 
-extern uint64_t current_pid;
-// Implement the getpid syscall
-pid_t syscall_getpid() {
-    return current_pid;
+SYSCALL_DEFINE2(futex_wake, uint64_t, uaddr, uint32_t, nr) {
+    process_t *proc = process_current();
+    return proc ? futex_wake(proc->mm, uaddr, nr) : -1;
 }
 
-ssize_t syscall_read(int fd, void *buf, size_t count) {
+SYSCALL_DEFINE4(futex_requeue, uint64_t, uaddr, uint64_t, uaddr2, uint32_t, nr_wake, uint32_t, nr_requeue) {
+    process_t *proc = process_current();
+    return proc ? futex_requeue(proc->mm, uaddr, uaddr2, nr_wake, nr_requeue) : -1;
+}
+
+SYSCALL_DEFINE3(read, int, fd, void *, buf, size_t, count) {
     // Implement read functionality
     // For now, return -1 to indicate it's not implemented
     return -1;
 }
 
-ssize_t syscall_close(int fd) {
+// Trả về break cũ, hoặc -1 (con trỏ (void *)-1 phía user)
+SYSCALL_DEFINE1(sbrk, int64_t, increment) {
+    process_t *proc = process_current();
+    return proc ? heap_sbrk(proc->mm, increment) : -1;
+}
+
+// Như brk(2) của Linux: trả về break hiện tại, không đổi nếu addr không hợp lệ
+SYSCALL_DEFINE1(brk, uint64_t, addr) {
+    process_t *proc = process_current();
+    return proc ? (ssize_t)heap_brk(proc->mm, addr) : -1;
+}
+
+SYSCALL_DEFINE1(close, int, fd) {
     // Implement close functionality
     return -1;
 }
 
-ssize_t syscall_fstat(int fd, struct stat *statbuf) {
+SYSCALL_DEFINE2(fstat, int, fd, struct stat *, statbuf) {
     // Implement fstat functionality
     return -1;
 }
 
-ssize_t syscall_isatty(int fd) {
+SYSCALL_DEFINE1(isatty, int, fd) {
     // Implement isatty functionality
     return -1;
 }
 
-ssize_t syscall_lseek(int fd, off_t offset, int whence) {
+SYSCALL_DEFINE3(lseek, int, fd, off_t, offset, int, whence) {
     // Implement lseek functionality
     return -1;
 }
 
-ssize_t syscall_kill(pid_t pid, int sig) {
+SYSCALL_DEFINE2(kill, pid_t, pid, int, sig) {
     // Implement kill functionality
     return -1;
 }
 
+// Giống nice(2): cộng inc vào mức nice hiện tại và trả về mức mới
+SYSCALL_DEFINE1(nice, int, inc) {
+    process_t *proc = process_current();
+    if (!proc) {
+        return -1;
+    }
+    return sched_set_nice(proc, proc->nice + inc);
+}
+
+// Khác Linux: chỉ áp dụng cho tiến trình gọi, mặt nạ là một số 64 bit (bit i = CPU i)
+SYSCALL_DEFINE1(sched_setaffinity, uint64_t, mask) {
+    process_t *proc = process_current();
+    if (!proc) {
+        return -1;
+    }
+    return sched_set_affinity(proc, mask);
+}
+
+SYSCALL_DEFINE0(sched_getaffinity) {
+    process_t *proc = process_current();
+    if (!proc) {
+        return -1;
+    }
+    return (ssize_t)(proc->cpus_allowed & sched_online_mask());
+}
+
+// Khác Linux (sched_setattr): chỉ áp dụng cho tiến trình gọi, tham số tính bằng nano giây
+SYSCALL_DEFINE3(sched_setdeadline, uint64_t, runtime, uint64_t, deadline, uint64_t, period) {
+    return sched_set_deadline(runtime, deadline, period);
+}
+
+// Với tiến trình deadline: báo đã xong job của chu kỳ này
+SYSCALL_DEFINE0(sched_yield) {
+    sched_yield();
+    return 0;
+}
+
+// Ghi số lần trễ hạn và số lần bị tạm dừng của tiến trình gọi vào stats[0], stats[1]
+SYSCALL_DEFINE1(sched_getdlstats, uint64_t *, stats) {
+    process_t *proc = process_current();
+    if (!proc) {
+        return -1;
+    }
+    uint64_t values[2] = {proc->dl_misses, proc->dl_throttles};
+    return copy_to_user(stats, values, sizeof(values)) ? -1 : 0;
+}
+
+SYSCALL_DEFINE2(pkey_alloc, uint32_t, flags, uint32_t, access_rights) {
+    return pkey_alloc(process_current(), flags, access_rights);
+}
+
+SYSCALL_DEFINE1(pkey_free, int, pkey) {
+    return pkey_free(process_current(), pkey);
+}
+
+// Khác Linux: không có tham số prot, quyền truy cập của trang được giữ nguyên
+SYSCALL_DEFINE3(pkey_mprotect, uint64_t, addr, uint64_t, len, int, pkey) {
+    return pkey_mprotect(process_current(), addr, len, pkey);
+}
+
+// Ghi thống kê của syscall nr vào buf (count rồi SYSCALL_HIST_BUCKETS ô histogram)
+SYSCALL_DEFINE2(getstats, uint64_t, nr, syscall_stats_t *, buf) {
+    if (nr >= SYSCALL_MAX || !buf) {
+        return -1;
+    }
+    return copy_to_user(buf, &syscall_stats[nr], sizeof(syscall_stats_t)) ? -1 : 0;
+}
+
+// Khác Linux (io_uring_setup): không có fd, mỗi tiến trình một vòng, trả về địa chỉ của vòng
+SYSCALL_DEFINE2(uring_setup, uint32_t, entries, uint32_t, flags) {
+    return uring_setup(entries, flags);
+}
+
+SYSCALL_DEFINE3(uring_enter, uint32_t, to_submit, uint32_t, min_complete, uint32_t, flags) {
+    return uring_enter(to_submit, min_complete, flags);
+}
+
+// Tên được chép vào kernel trước khi tìm; tên dài hơn SHM_NAME_MAX - 1 byte bị từ chối
+static bool syscall_copy_shm_name(char name[SHM_NAME_MAX], const char *uname) {
+    int64_t len = strncpy_from_user(name, uname, SHM_NAME_MAX);
+    return len > 0 && len < SHM_NAME_MAX;
+}
+
+// Khác Linux (shm_open + mmap): một lệnh vừa mở/tạo vừa ánh xạ cả đối tượng, trả về địa chỉ
+SYSCALL_DEFINE2(shm_map, const char *, uname, uint64_t, size) {
+    process_t *proc = process_current();
+    char name[SHM_NAME_MAX];
+    if (!proc || !syscall_copy_shm_name(name, uname)) {
+        return -1;
+    }
+    return shm_map(proc->mm, name, size);
+}
+
+SYSCALL_DEFINE1(shm_unmap, uint64_t, addr) {
+    process_t *proc = process_current();
+    return proc ? shm_unmap(proc->mm, addr) : -1;
+}
+
+SYSCALL_DEFINE1(shm_unlink, const char *, uname) {
+    char name[SHM_NAME_MAX];
+    if (!syscall_copy_shm_name(name, uname)) {
+        return -1;
+    }
+    return shm_unlink(name);
+}
+
+SYSCALL_DEFINE3(page_send, uint64_t, pid, uint64_t, addr, uint64_t, len) {
+    return shm_page_send(pid, addr, len);
+}
+
+// Thông điệp đã lấy ra mà không chép được cho user thì bị mất; các trang vẫn được
+// ánh xạ và được giải phóng khi tiến trình kết thúc
+SYSCALL_DEFINE2(page_recv, shm_msg_t *, umsg, uint32_t, flags) {
+    process_t *proc = process_current();
+    shm_msg_t msg;
+    if (!proc || !access_ok((uint64_t)umsg, sizeof(msg)) || shm_page_recv(proc->mm, &msg, flags)) {
+        return -1;
+    }
+    return copy_to_user(umsg, &msg, sizeof(msg)) ? -1 : 0;
+}
+
+// Thông điệp nhận được trở về user trong chính các thanh ghi đã mang thông điệp đi
+static void syscall_ipc_set_msg(const uint64_t msg[IPC_MSG_WORDS]) {
+    trap_frame_t *frame = process_current()->frame;
+    frame->rsi = msg[0];
+    frame->rdx = msg[1];
+    frame->r10 = msg[2];
+    frame->r8 = msg[3];
+    frame->r9 = msg[4];
+}
+
+// Gửi thông điệp trong rsi, rdx, r10, r8, r9 tới luồng pid; trả lời về trong cùng các thanh ghi
+SYSCALL_DEFINE6(ipc_call, uint64_t, pid, uint64_t, m0, uint64_t, m1, uint64_t, m2, uint64_t, m3, uint64_t, m4) {
+    uint64_t msg[IPC_MSG_WORDS] = {m0, m1, m2, m3, m4};
+    if (ipc_call(pid, msg)) {
+        return -1;
+    }
+    syscall_ipc_set_msg(msg);
+    return 0;
+}
+
+// Trả lời reply_to (0: không trả lời ai) rồi chờ call kế tiếp; trả về PID của caller
+SYSCALL_DEFINE6(ipc_reply_wait, uint64_t, reply_to, uint64_t, m0, uint64_t, m1, uint64_t, m2, uint64_t, m3, uint64_t, m4) {
+    uint64_t msg[IPC_MSG_WORDS] = {m0, m1, m2, m3, m4};
+    int64_t from = ipc_reply_wait(reply_to, msg);
+    if (from < 0) {
+        return -1;
+    }
+    syscall_ipc_set_msg(msg);
+    return from;
+}
+
+// Không ép kiểu: mọi hàm SYSCALL_DEFINEn đã có đúng kiểu syscall_fn_t, trình biên dịch kiểm tra bảng
+#define SYSCALL_ENTRY(nr, fn) [nr] = fn
+
+// Ô NULL là syscall chưa được cài đặt: trả về -1
+static const syscall_fn_t syscall_table[SYSCALL_MAX] = {
+    SYSCALL_ENTRY(SYSCALL_WRITE, syscall_write),
+    SYSCALL_ENTRY(SYSCALL_READ, syscall_read),
+    SYSCALL_ENTRY(SYSCALL_CLOSE, syscall_close),
+    SYSCALL_ENTRY(SYSCALL_FSTAT, syscall_fstat),
+    SYSCALL_ENTRY(SYSCALL_ISATTY, syscall_isatty),
+    SYSCALL_ENTRY(SYSCALL_LSEEK, syscall_lseek),
+    SYSCALL_ENTRY(SYSCALL_SBRK, syscall_sbrk),
+    SYSCALL_ENTRY(SYSCALL_EXIT, syscall_exit),
+    SYSCALL_ENTRY(SYSCALL_KILL, syscall_kill),
+    SYSCALL_ENTRY(SYSCALL_GETPID, syscall_getpid),
+    SYSCALL_ENTRY(SYSCALL_PKEY_ALLOC, syscall_pkey_alloc),
+    SYSCALL_ENTRY(SYSCALL_PKEY_FREE, syscall_pkey_free),
+    SYSCALL_ENTRY(SYSCALL_PKEY_MPROTECT, syscall_pkey_mprotect),
+    SYSCALL_ENTRY(SYSCALL_NICE, syscall_nice),
+    SYSCALL_ENTRY(SYSCALL_SCHED_SETAFFINITY, syscall_sched_setaffinity),
+    SYSCALL_ENTRY(SYSCALL_SCHED_GETAFFINITY, syscall_sched_getaffinity),
+    SYSCALL_ENTRY(SYSCALL_SCHED_SETDEADLINE, syscall_sched_setdeadline),
+    SYSCALL_ENTRY(SYSCALL_SCHED_YIELD, syscall_sched_yield),
+    SYSCALL_ENTRY(SYSCALL_SCHED_GETDLSTATS, syscall_sched_getdlstats),
+    SYSCALL_ENTRY(SYSCALL_THREAD_CREATE, syscall_thread_create),
+    SYSCALL_ENTRY(SYSCALL_GETTID, syscall_gettid),
+    SYSCALL_ENTRY(SYSCALL_SET_FS_BASE, syscall_set_fs_base),
+    SYSCALL_ENTRY(SYSCALL_FUTEX_WAIT, syscall_futex_wait),
+    SYSCALL_ENTRY(SYSCALL_FUTEX_WAKE, syscall_futex_wake),
+    SYSCALL_ENTRY(SYSCALL_FUTEX_REQUEUE, syscall_futex_requeue),
+    SYSCALL_ENTRY(SYSCALL_GETSTATS, syscall_getstats),
+    SYSCALL_ENTRY(SYSCALL_URING_SETUP, syscall_uring_setup),
+    SYSCALL_ENTRY(SYSCALL_URING_ENTER, syscall_uring_enter),
+    SYSCALL_ENTRY(SYSCALL_BRK, syscall_brk),
+    SYSCALL_ENTRY(SYSCALL_SHM_MAP, syscall_shm_map),
+    SYSCALL_ENTRY(SYSCALL_SHM_UNMAP, syscall_shm_unmap),
+    SYSCALL_ENTRY(SYSCALL_SHM_UNLINK, syscall_shm_unlink),
+    SYSCALL_ENTRY(SYSCALL_PAGE_SEND, syscall_page_send),
+    SYSCALL_ENTRY(SYSCALL_PAGE_RECV, syscall_page_recv),
+    SYSCALL_ENTRY(SYSCALL_IPC_CALL, syscall_ipc_call),
+    SYSCALL_ENTRY(SYSCALL_IPC_REPLY_WAIT, syscall_ipc_reply_wait),
+};
+
+// Tên để in thống kê
+static const char *const syscall_names[SYSCALL_MAX] = {
+    [SYSCALL_WRITE] = "write", [SYSCALL_READ] = "read", [SYSCALL_CLOSE] = "close",
+    [SYSCALL_FSTAT] = "fstat", [SYSCALL_ISATTY] = "isatty", [SYSCALL_LSEEK] = "lseek",
+    [SYSCALL_SBRK] = "sbrk", [SYSCALL_EXIT] = "exit", [SYSCALL_KILL] = "kill",
+    [SYSCALL_GETPID] = "getpid", [SYSCALL_PKEY_ALLOC] = "pkey_alloc", [SYSCALL_PKEY_FREE] = "pkey_free",
+    [SYSCALL_PKEY_MPROTECT] = "pkey_mprotect", [SYSCALL_NICE] = "nice",
+    [SYSCALL_SCHED_SETAFFINITY] = "sched_setaffinity", [SYSCALL_SCHED_GETAFFINITY] = "sched_getaffinity",
+    [SYSCALL_SCHED_SETDEADLINE] = "sched_setdeadline", [SYSCALL_SCHED_YIELD] = "sched_yield",
+    [SYSCALL_SCHED_GETDLSTATS] = "sched_getdlstats", [SYSCALL_THREAD_CREATE] = "thread_create",
+    [SYSCALL_GETTID] = "gettid", [SYSCALL_SET_FS_BASE] = "set_fs_base", [SYSCALL_FUTEX_WAIT] = "futex_wait",
+    [SYSCALL_FUTEX_WAKE] = "futex_wake", [SYSCALL_FUTEX_REQUEUE] = "futex_requeue",
+    [SYSCALL_GETSTATS] = "getstats", [SYSCALL_URING_SETUP] = "uring_setup", [SYSCALL_URING_ENTER] = "uring_enter",
+    [SYSCALL_BRK] = "brk", [SYSCALL_SHM_MAP] = "shm_map", [SYSCALL_SHM_UNMAP] = "shm_unmap",
+    [SYSCALL_SHM_UNLINK] = "shm_unlink", [SYSCALL_PAGE_SEND] = "page_send", [SYSCALL_PAGE_RECV] = "page_recv",
+    [SYSCALL_IPC_CALL] = "ipc_call", [SYSCALL_IPC_REPLY_WAIT] = "ipc_reply_wait",
+};
 
 /**
- * The syscall handler function. This function is called by the kernel whenever
- * a user process invokes a syscall. It takes the syscall number and up to 3
- * arguments, and dispatches to the correct syscall handler. If the syscall is
- * not supported, it prints an error message and returns -1. If the syscall is
- * supported, it calls the appropriate syscall handler and returns the result.
+ * Dispatches a syscall through syscall_table and records its cost.
  *
- * @param syscall_number The syscall number to handle.
- * @param arg1 The first argument to the syscall.
- * @param arg2 The second argument to the syscall.
- * @param arg3 The third argument to the syscall.
+ * Arguments follow the Linux convention; the syscall instruction clobbers
+ * rcx, so the fourth argument travels in r10. The time spent in the
+ * syscall, including any time it sleeps, goes into a log2 histogram of TSC
+ * cycles. The counters are shared by all CPUs and updated with relaxed
+ * atomics: cheap enough to keep on in production, and a rare lost race only
+ * costs one sample.
  *
- * @return The result of the syscall, or -1 on error.
+ * @return The result of the syscall, or -1 for an unknown number.
  */
-ssize_t syscall_handler_c(uint64_t syscall_number, uint64_t arg1, uint64_t arg2, uint64_t arg3) {
-    ssize_t ret = -1; // Default return value for errors
-
-    switch (syscall_number) {
-        case SYSCALL_WRITE:
-            ret = syscall_write((int)arg1, (const void *)arg2, (size_t)arg3);
-            break;
-        case SYSCALL_READ:
-            ret = syscall_read((int)arg1, (void *)arg2, (size_t)arg3);
-            break;
-        case SYSCALL_CLOSE:
-            ret = syscall_close((int)arg1);
-            break;
-        case SYSCALL_FSTAT:
-            ret = syscall_fstat((int)arg1, (struct stat *)arg2);
-            break;
-        case SYSCALL_ISATTY:
-            ret = syscall_isatty((int)arg1);
-            break;
-        case SYSCALL_LSEEK:
-            ret = syscall_lseek((int)arg1, (off_t)arg2, (int)arg3);
-            break;
-        case SYSCALL_SBRK:
-            // ret = syscall_sbrk((intptr_t)arg1);
-            break;
-        case SYSCALL_EXIT:
-            syscall_exit((int)arg1);
-            break;
-        case SYSCALL_KILL:
-            ret = syscall_kill((pid_t)arg1, (int)arg2);
-            break;
-        case SYSCALL_GETPID:
-            ret = syscall_getpid();
-            break;
-        // Add more syscalls here
-        default:
-            kprintf("Syscall Handler: Unknown syscall number %llu\n", syscall_number);
-            break;
+ssize_t syscall_handler_c(uint64_t syscall_number, uint64_t arg1, uint64_t arg2, uint64_t arg3,
+                          uint64_t arg4, uint64_t arg5, uint64_t arg6) {
+    if (syscall_number >= SYSCALL_MAX) {
+        kprintf("Syscall Handler: Unknown syscall number %llu\n", syscall_number);
+        return -1;
+    }
+    syscall_fn_t fn = syscall_table[syscall_number];
+    if (!fn) {
+        return -1;
     }
 
+    uint64_t start = rdtsc();
+    ssize_t ret = fn(arg1, arg2, arg3, arg4, arg5, arg6);
+    uint64_t cycles = rdtsc() - start;
+
+    syscall_stats_t *stats = &syscall_stats[syscall_number];
+    uint32_t bucket = cycles ? 63 - __builtin_clzll(cycles) : 0;
+    if (bucket >= SYSCALL_HIST_BUCKETS) {
+        bucket = SYSCALL_HIST_BUCKETS - 1;
+    }
+    __atomic_fetch_add(&stats->count, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&stats->hist[bucket], 1, __ATOMIC_RELAXED);
     return ret;
-}
\ No newline at end of file
+}
+
+void syscall_stats_dump() {
+    for (uint32_t nr = 0; nr < SYSCALL_MAX; nr++) {
+        syscall_stats_t *stats = &syscall_stats[nr];
+        if (!stats->count) {
+            continue;
+        }
+        // Trung vị: ô histogram chứa lần gọi thứ count/2
+        uint64_t seen = 0;
+        uint32_t median = 0;
+        uint32_t max = 0;
+        for (uint32_t i = 0; i < SYSCALL_HIST_BUCKETS; i++) {
+            if (stats->hist[i]) {
+                max = i;
+                if (seen <= stats->count / 2) {
+                    median = i;
+                }
+                seen += stats->hist[i];
+            }
+        }
+        kprintf("Syscall %s: %llu calls, median < %llu cycles, max < %llu cycles\n",
+                syscall_names[nr] ? syscall_names[nr] : "?", stats->count, 2ULL << median, 2ULL << max);
+    }
+}
+// Điểm vào của lệnh syscall (syscall_handler.S) đọc cpu->user_rsp và cpu->syscall_rsp theo offset cố định
+_Static_assert(offsetof(cpu_t, user_rsp) == 8 && offsetof(cpu_t, syscall_rsp) == 16,
+               "syscall_entry expects user_rsp at 8 and syscall_rsp at 16");
+
+/**
+ * C entry point of the int 0x80 and syscall stubs.
+ *
+ * Arguments are taken from the saved user registers (rax = number,
+ * rdi/rsi/rdx/r10/r8/r9 = arguments) and the result is stored back into the saved rax,
+ * so the syscall may block or switch processes before the frame is restored.
+ *
+ * Both entries run with interrupts disabled (the interrupt gate, or FMASK
+ * for the syscall instruction). They are re-enabled for
+ * the body of the syscall, so a long syscall can be interrupted and, outside
+ * locked sections, preempted. They are disabled again before the exit path,
+ * which swaps GS and must not be interrupted.
+ *
+ * @param frame The trap frame built by syscall_handler or syscall_entry.
+ */
+void syscall_entry_c(trap_frame_t *frame) {
+    this_cpu()->syscall_count++;
+    __asm__ volatile("sti" ::: "memory");
+    frame->rax = syscall_handler_c(frame->rax, frame->rdi, frame->rsi, frame->rdx, frame->r10, frame->r8, frame->r9);
+    __asm__ volatile("cli" ::: "memory");
+    sched_check_resched(frame);
+}
+
+/**
+ * Enables the syscall/sysret instructions on the calling CPU.
+ *
+ * STAR selects the segments: syscall loads CS from STAR[47:32] and SS from
+ * the next entry, and sysretq loads CS from STAR[63:48] + 16 and SS from
+ * STAR[63:48] + 8, which is why the GDT places the user data segment
+ * directly before the user code segment. LSTAR points at syscall_entry, and
+ * FMASK clears IF there, because the stub still runs on the user stack
+ * until it has switched to the kernel stack.
+ */
+void syscall_init() {
+    wrmsr(IA32_EFER_MSR, rdmsr(IA32_EFER_MSR) | EFER_SCE);
+    wrmsr(IA32_STAR_MSR, ((uint64_t)((GDT_USER_DATA & ~3) - 8) << 48) | ((uint64_t)GDT_KERNEL_CODE << 32));
+    wrmsr(IA32_LSTAR_MSR, (uint64_t)syscall_entry);
+    wrmsr(IA32_FMASK_MSR, RFLAGS_IF | RFLAGS_DF | RFLAGS_TF | RFLAGS_AC);
+}
@@ -4,13 +4,59 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include "idt.h"
 
 typedef long ssize_t;
 
-// Syscall handler function
-ssize_t syscall_handler_c(uint64_t syscall_number, uint64_t arg1, uint64_t arg2, uint64_t arg3);
+// Gọi syscall theo số qua bảng syscall, tham số theo quy ước Linux (rdi, rsi, rdx, r10, r8, r9)
+ssize_t syscall_handler_c(uint64_t syscall_number, uint64_t arg1, uint64_t arg2, uint64_t arg3,
+                          uint64_t arg4, uint64_t arg5, uint64_t arg6);
 
-// Declare the write syscall function
-ssize_t syscall_write(int fd, const void *buf, size_t count);
+// In số lần gọi và phân bố số chu kỳ của mọi syscall đã được gọi
+void syscall_stats_dump();
+
+// Điểm vào C của stub int 0x80 và lệnh syscall: đọc tham số từ frame và ghi kết quả vào frame->rax
+void syscall_entry_c(trap_frame_t *frame);
+
+// Điểm vào lệnh syscall trong syscall_handler.S (được nạp vào LSTAR)
+extern void syscall_entry();
+
+// Bật lệnh syscall/sysretq trên CPU hiện tại: EFER.SCE, STAR, LSTAR và FMASK
+void syscall_init();
+
+// Kiểu chung của mọi hàm syscall: sáu thanh ghi tham số (rdi, rsi, rdx, r10, r8, r9) dạng uint64_t
+typedef ssize_t (*syscall_fn_t)(uint64_t, uint64_t, uint64_t, uint64_t, uint64_t, uint64_t);
+
+#define SYSCALL_PARAMS                                                          \
+    __attribute__((unused)) uint64_t a1, __attribute__((unused)) uint64_t a2,  \
+    __attribute__((unused)) uint64_t a3, __attribute__((unused)) uint64_t a4,  \
+    __attribute__((unused)) uint64_t a5, __attribute__((unused)) uint64_t a6
+
+// SYSCALL_DEFINEn(name, kiểu1, tên1, ...) định nghĩa syscall_name có kiểu syscall_fn_t: nó thu
+// hẹp n thanh ghi đầu về kiểu đã khai báo rồi gọi thân hàm viết ngay sau macro
+#define SYSCALL_DEFINE_TYPED(name, params, args)                                \
+    static ssize_t do_syscall_##name params;                                    \
+    ssize_t syscall_##name(SYSCALL_PARAMS) {                                    \
+        return do_syscall_##name args;                                          \
+    }                                                                           \
+    static ssize_t do_syscall_##name params
+
+#define SYSCALL_DEFINE0(name) SYSCALL_DEFINE_TYPED(name, (void), ())
+#define SYSCALL_DEFINE1(name, t1, n1) SYSCALL_DEFINE_TYPED(name, (t1 n1), ((t1)a1))
+#define SYSCALL_DEFINE2(name, t1, n1, t2, n2) \
+    SYSCALL_DEFINE_TYPED(name, (t1 n1, t2 n2), ((t1)a1, (t2)a2))
+#define SYSCALL_DEFINE3(name, t1, n1, t2, n2, t3, n3) \
+    SYSCALL_DEFINE_TYPED(name, (t1 n1, t2 n2, t3 n3), ((t1)a1, (t2)a2, (t3)a3))
+#define SYSCALL_DEFINE4(name, t1, n1, t2, n2, t3, n3, t4, n4) \
+    SYSCALL_DEFINE_TYPED(name, (t1 n1, t2 n2, t3 n3, t4 n4), ((t1)a1, (t2)a2, (t3)a3, (t4)a4))
+#define SYSCALL_DEFINE5(name, t1, n1, t2, n2, t3, n3, t4, n4, t5, n5) \
+    SYSCALL_DEFINE_TYPED(name, (t1 n1, t2 n2, t3 n3, t4 n4, t5 n5), ((t1)a1, (t2)a2, (t3)a3, (t4)a4, (t5)a5))
+#define SYSCALL_DEFINE6(name, t1, n1, t2, n2, t3, n3, t4, n4, t5, n5, t6, n6)                      \
+    SYSCALL_DEFINE_TYPED(name, (t1 n1, t2 n2, t3 n3, t4 n4, t5 n5, t6 n6),                        \
+                         ((t1)a1, (t2)a2, (t3)a3, (t4)a4, (t5)a5, (t6)a6))
+
+// write/read cũng được uring gọi trực tiếp: fd, địa chỉ user, số byte; ba tham số sau không dùng
+ssize_t syscall_write(SYSCALL_PARAMS);
+ssize_t syscall_read(SYSCALL_PARAMS);
 
 #endif // SYSCALL_HANDLER_H
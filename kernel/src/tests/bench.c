@@ -0,0 +1,542 @@
+// tests/bench.c
+#include <stdint.h>
+#include "bench.h"
+#include "graphics.h"
+#include "process.h"
+#include "scheduler.h"
+#include "memory_manager.h"
+#include "paging.h"
+#include "pkey.h"
+#include "timer.h"
+#include "tss.h"
+#include "stacks.h"
+#include "cpu.h"
+#include "klibc.h"
+#include "percpu.h"
+#include "spinlock.h"
+#include "context_switcher.h"
+#include "workqueue.h"
+#include "kthread.h"
+#include "futex.h"
+#include "syscall_handler.h"
+#include "address_space.h"
+#include "vdso.h"
+#include "console.h"
+#include "heap.h"
+#include "shm.h"
+#include "ipc.h"
+#include "config.h"
+
+#define BENCH_SWITCH_ITERATIONS 10000
+#define BENCH_SCALING_MAX_WORKERS 16
+#define BENCH_SCALING_WORK 20000000ULL
+// Số vòng mỗi đường vào, được mã hóa sẵn trong bench_syscall_code
+#define BENCH_SYSCALL_ITERATIONS 1000
+
+static process_t bench_main;
+static process_t bench_peer;
+static uint8_t bench_peer_stack[4096] __attribute__((aligned(16)));
+
+// Tiến trình đối tác: luôn trả CPU ngay về tiến trình đo
+static void bench_peer_loop() {
+    for (;;) {
+        sched_context_switch(&bench_peer, &bench_main);
+    }
+}
+
+/**
+ * Measures a round trip between two kernel contexts.
+ *
+ * @param peer_page_table Address space of the peer process (physical PML4).
+ * @return Average TSC cycles per single switch.
+ */
+static uint64_t bench_switch_cycles(uint64_t peer_page_table) {
+    uint64_t cr3;
+    __asm__ volatile("mov %%cr3, %0" : "=r"(cr3));
+
+    memset(&bench_main, 0, sizeof(process_t));
+    bench_main.pid = 200;
+    bench_main.page_table = cr3;
+    bench_main.kernel_stack_top = kernel_stack_top;
+    bench_main.pkru = PKRU_DEFAULT;
+
+    memset(&bench_peer, 0, sizeof(process_t));
+    bench_peer.pid = 201;
+    bench_peer.page_table = peer_page_table;
+    bench_peer.kernel_stack_top = (uint64_t)bench_peer_stack + sizeof(bench_peer_stack);
+    bench_peer.pkru = PKRU_DEFAULT;
+    bench_peer.context.rsp = bench_peer.kernel_stack_top - 8;
+    bench_peer.context.rip = (uint64_t)bench_peer_loop;
+
+    // Lượt đầu khởi động bench_peer_loop, không tính vào kết quả
+    sched_context_switch(&bench_main, &bench_peer);
+
+    uint64_t start = rdtsc();
+    for (int i = 0; i < BENCH_SWITCH_ITERATIONS; i++) {
+        sched_context_switch(&bench_main, &bench_peer);
+    }
+    uint64_t cycles = rdtsc() - start;
+
+    return cycles / (2 * BENCH_SWITCH_ITERATIONS);
+}
+
+// Benchmark context switch: cùng và khác không gian địa chỉ
+static void bench_context_switch() {
+    uint64_t cr3;
+    __asm__ volatile("cli");
+    __asm__ volatile("mov %%cr3, %0" : "=r"(cr3));
+    process_t *saved_current = process_current();
+
+    uint64_t same = bench_switch_cycles(cr3);
+    kprintf("BENCH: context switch (same address space): %llu cycles, %llu ns\n",
+            same, timer_tsc_to_ns(same));
+
+    uint64_t other = (uint64_t)create_user_page_table();
+    if (other) {
+        uint64_t cross = bench_switch_cycles(other);
+        kprintf("BENCH: context switch (cross address space): %llu cycles, %llu ns\n",
+                cross, timer_tsc_to_ns(cross));
+        free_physical_block(other);
+    }
+
+    tss.rsp0 = kernel_stack_top;
+    process_set_current(saved_current);
+    __asm__ volatile("sti");
+}
+
+static process_t scaling_procs[BENCH_SCALING_MAX_WORKERS];
+static uint8_t scaling_stacks[BENCH_SCALING_MAX_WORKERS][4096] __attribute__((aligned(16)));
+static volatile int scaling_done;
+static volatile uint64_t scaling_sink;
+
+// Tiến trình CPU-bound: một lượng việc cố định rồi kết thúc
+static void scaling_worker() {
+    uint64_t x = process_current()->pid;
+    for (uint64_t i = 0; i < BENCH_SCALING_WORK; i++) {
+        x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+    }
+    scaling_sink = x;
+    __atomic_fetch_add(&scaling_done, 1, __ATOMIC_RELEASE);
+    process_current()->state = PROCESS_STATE_TERMINATED;
+    schedule();
+}
+
+/**
+ * Runs @p workers CPU-bound kernel processes to completion.
+ *
+ * The caller (bench_main, pinned to the BSP) yields while waiting, so the BSP
+ * takes part like any other CPU.
+ *
+ * @return Elapsed TSC cycles.
+ */
+static uint64_t bench_scaling_run(int workers) {
+    scaling_done = 0;
+    uint64_t start = rdtsc();
+    for (int i = 0; i < workers; i++) {
+        process_t *proc = &scaling_procs[i];
+        memset(proc, 0, sizeof(process_t));
+        proc->pid = 300 + i;
+        proc->page_table = bench_main.page_table;
+        proc->kernel_stack_top = (uint64_t)scaling_stacks[i] + sizeof(scaling_stacks[i]);
+        proc->pkru = PKRU_DEFAULT;
+        context_init(&proc->context, proc->kernel_stack_top - 8, scaling_worker);
+        sched_new_task(proc);
+    }
+    while (__atomic_load_n(&scaling_done, __ATOMIC_ACQUIRE) < workers) {
+        sched_yield();
+    }
+    return rdtsc() - start;
+}
+
+// Benchmark khả năng mở rộng: cùng lượng việc mỗi tiến trình, một tiến trình và một tiến trình mỗi CPU
+static void bench_scaling() {
+    uint64_t cr3;
+    __asm__ volatile("cli");
+    __asm__ volatile("mov %%cr3, %0" : "=r"(cr3));
+    process_t *saved_current = process_current();
+
+    memset(&bench_main, 0, sizeof(process_t));
+    bench_main.pid = 200;
+    bench_main.page_table = cr3;
+    bench_main.kernel_stack_top = kernel_stack_top;
+    bench_main.pkru = PKRU_DEFAULT;
+    bench_main.weight = NICE_0_WEIGHT;
+    bench_main.cpus_allowed = 1;
+    bench_main.state = PROCESS_STATE_RUNNING;
+    process_set_current(&bench_main);
+
+    int workers = cpu_count < BENCH_SCALING_MAX_WORKERS ? cpu_count : BENCH_SCALING_MAX_WORKERS;
+    uint64_t one = bench_scaling_run(1);
+    uint64_t all = bench_scaling_run(workers);
+    // Tốc độ tăng thông lượng, nhân 100 (lý tưởng = 100 * số CPU)
+    uint64_t speedup = all ? one * workers * 100 / all : 0;
+    kprintf("BENCH: %d CPU-bound processes on %u CPUs: throughput x%llu.%02llu vs one process\n",
+            workers, cpu_count, speedup / 100, speedup % 100);
+
+    this_cpu()->tss->rsp0 = kernel_stack_top;
+    process_set_current(saved_current);
+    __asm__ volatile("sti");
+}
+
+// Mã user: đo BENCH_SYSCALL_ITERATIONS lần gettid qua int 0x80, qua lệnh syscall, rồi getpid
+// và clock_ns của vDSO, ghi số chu kỳ vào arg[0..3] rồi exit(0)
+static const uint8_t bench_syscall_code[] = {
+    0x48, 0x89, 0xFB,                   // mov %rdi, %rbx
+    0x41, 0xBC, 0xE8, 0x03, 0x00, 0x00, // mov $1000, %r12d
+    0x0F, 0x31,                         // rdtsc
+    0x48, 0xC1, 0xE2, 0x20,             // shl $32, %rdx
+    0x48, 0x09, 0xC2,                   // or %rax, %rdx
+    0x49, 0x89, 0xD5,                   // mov %rdx, %r13
+    0xB8, 0x15, 0x00, 0x00, 0x00,       // 1: mov $SYSCALL_GETTID, %eax
+    0xCD, 0x80,                         // int $0x80
+    0x41, 0xFF, 0xCC,                   // dec %r12d
+    0x75, 0xF4,                         // jnz 1b
+    0x0F, 0x31,                         // rdtsc
+    0x48, 0xC1, 0xE2, 0x20,             // shl $32, %rdx
+    0x48, 0x09, 0xD0,                   // or %rdx, %rax
+    0x4C, 0x29, 0xE8,                   // sub %r13, %rax
+    0x48, 0x89, 0x03,                   // mov %rax, (%rbx)
+    0x41, 0xBC, 0xE8, 0x03, 0x00, 0x00, // mov $1000, %r12d
+    0x0F, 0x31,                         // rdtsc
+    0x48, 0xC1, 0xE2, 0x20,             // shl $32, %rdx
+    0x48, 0x09, 0xC2,                   // or %rax, %rdx
+    0x49, 0x89, 0xD5,                   // mov %rdx, %r13
+    0xB8, 0x15, 0x00, 0x00, 0x00,       // 2: mov $SYSCALL_GETTID, %eax
+    0x0F, 0x05,                         // syscall
+    0x41, 0xFF, 0xCC,                   // dec %r12d
+    0x75, 0xF4,                         // jnz 2b
+    0x0F, 0x31,                         // rdtsc
+    0x48, 0xC1, 0xE2, 0x20,             // shl $32, %rdx
+    0x48, 0x09, 0xD0,                   // or %rdx, %rax
+    0x4C, 0x29, 0xE8,                   // sub %r13, %rax
+    0x48, 0x89, 0x43, 0x08,             // mov %rax, 8(%rbx)
+    0x41, 0xBC, 0xE8, 0x03, 0x00, 0x00, // mov $1000, %r12d
+    0x49, 0xBE, 0x00, 0x20, 0xFF, 0xFF, // movabs $VDSO_CODE_ADDR, %r14
+    0xFF, 0x7F, 0x00, 0x00,
+    0x0F, 0x31,                         // rdtsc
+    0x48, 0xC1, 0xE2, 0x20,             // shl $32, %rdx
+    0x48, 0x09, 0xC2,                   // or %rax, %rdx
+    0x49, 0x89, 0xD5,                   // mov %rdx, %r13
+    0x41, 0xFF, 0xD6,                   // 3: call *%r14 (getpid)
+    0x41, 0xFF, 0xCC,                   // dec %r12d
+    0x75, 0xF8,                         // jnz 3b
+    0x0F, 0x31,                         // rdtsc
+    0x48, 0xC1, 0xE2, 0x20,             // shl $32, %rdx
+    0x48, 0x09, 0xD0,                   // or %rdx, %rax
+    0x4C, 0x29, 0xE8,                   // sub %r13, %rax
+    0x48, 0x89, 0x43, 0x10,             // mov %rax, 16(%rbx)
+    0x41, 0xBC, 0xE8, 0x03, 0x00, 0x00, // mov $1000, %r12d
+    0x0F, 0x31,                         // rdtsc
+    0x48, 0xC1, 0xE2, 0x20,             // shl $32, %rdx
+    0x48, 0x09, 0xC2,                   // or %rax, %rdx
+    0x49, 0x89, 0xD5,                   // mov %rdx, %r13
+    0x49, 0x8D, 0x46, 0x08,             // 4: lea 8(%r14), %rax
+    0xFF, 0xD0,                         // call *%rax (clock_ns)
+    0x41, 0xFF, 0xCC,                   // dec %r12d
+    0x75, 0xF5,                         // jnz 4b
+    0x0F, 0x31,                         // rdtsc
+    0x48, 0xC1, 0xE2, 0x20,             // shl $32, %rdx
+    0x48, 0x09, 0xD0,                   // or %rdx, %rax
+    0x4C, 0x29, 0xE8,                   // sub %r13, %rax
+    0x48, 0x89, 0x43, 0x18,             // mov %rax, 24(%rbx)
+    0xB8, 0x08, 0x00, 0x00, 0x00,       // mov $SYSCALL_EXIT, %eax
+    0x31, 0xFF,                         // xor %edi, %edi
+    0xCD, 0x80,                         // int $0x80
+    0xEB, 0xFE,                         // jmp .
+};
+
+/**
+ * Measures a syscall round trip from user mode through both entry paths,
+ * and the vDSO calls that replace a syscall.
+ *
+ * A user thread runs bench_syscall_code in a throwaway address space while
+ * bench_main yields on the BSP; the cycle counts come back through a shared
+ * data page.
+ */
+static void bench_syscall() {
+    uint64_t code_virt = 0x400000;
+    uint64_t data_virt = 0x600000;
+    address_space_t *as = address_space_create();
+    uint64_t code = allocate_physical_block();
+    uint64_t data = allocate_physical_block();
+    if (!as || !code || !data ||
+        !map_memory(as->page_table, code_virt, code, PAGE_SIZE, PAGING_PAGE_PRESENT | PAGING_PAGE_USER) ||
+        !map_memory(as->page_table, data_virt, data, PAGE_SIZE, PAGING_PAGE_PRESENT | PAGING_PAGE_RW | PAGING_PAGE_USER) ||
+        !vdso_map(as, 0)) {
+        kprintf("BENCH: syscall round trip: setup failed\n");
+        return;
+    }
+    memcpy(PHYS_TO_VIRT(code), bench_syscall_code, sizeof(bench_syscall_code));
+    volatile uint64_t *results = (volatile uint64_t *)PHYS_TO_VIRT(data);
+    memset((void *)results, 0, PAGE_SIZE);
+
+    uint64_t cr3;
+    __asm__ volatile("cli");
+    __asm__ volatile("mov %%cr3, %0" : "=r"(cr3));
+    process_t *saved_current = process_current();
+    memset(&bench_main, 0, sizeof(process_t));
+    bench_main.pid = 200;
+    bench_main.page_table = cr3;
+    bench_main.kernel_stack_top = kernel_stack_top;
+    bench_main.pkru = PKRU_DEFAULT;
+    bench_main.weight = NICE_0_WEIGHT;
+    bench_main.cpus_allowed = 1;
+    bench_main.state = PROCESS_STATE_RUNNING;
+    process_set_current(&bench_main);
+    __asm__ volatile("sti");
+
+    // Tiến trình cha giả: luồng đo chỉ cần không gian địa chỉ của nó
+    static process_t parent;
+    memset(&parent, 0, sizeof(parent));
+    parent.pid = parent.tgid = process_alloc_pid();
+    parent.mm = as;
+    parent.pkru = PKRU_DEFAULT;
+    parent.cpus_allowed = UINT64_MAX;
+    if (thread_create(&parent, code_virt, data_virt + PAGE_SIZE, data_virt)) {
+        uint64_t deadline = timer_now_ns() + 1000000000ULL;
+        while (!results[3] && timer_now_ns() < deadline) {
+            sched_yield();
+        }
+    }
+
+    __asm__ volatile("cli");
+    this_cpu()->tss->rsp0 = kernel_stack_top;
+    process_set_current(saved_current);
+    __asm__ volatile("sti");
+    address_space_put(as);
+
+    if (!results[3]) {
+        kprintf("BENCH: syscall round trip: measuring thread did not finish\n");
+        return;
+    }
+    uint64_t int80 = results[0] / BENCH_SYSCALL_ITERATIONS;
+    uint64_t fast = results[1] / BENCH_SYSCALL_ITERATIONS;
+    kprintf("BENCH: syscall round trip (int 0x80 entry): %llu cycles, %llu ns\n",
+            int80, timer_tsc_to_ns(int80));
+    kprintf("BENCH: syscall round trip (syscall entry): %llu cycles, %llu ns\n",
+            fast, timer_tsc_to_ns(fast));
+    uint64_t getpid = results[2] / BENCH_SYSCALL_ITERATIONS;
+    uint64_t clock = results[3] / BENCH_SYSCALL_ITERATIONS;
+    kprintf("BENCH: vDSO getpid: %llu cycles, clock_ns: %llu cycles\n", getpid, clock);
+}
+
+// Số dòng log mỗi đường ghi console
+#define BENCH_CONSOLE_LINES 32
+
+/**
+ * Compares the cost per byte of drawing log-style lines straight away with
+ * console_write against the buffered path (copy in, then the batches drawn
+ * by console_flush). The buffered figure includes the flush, so it is the
+ * full cost, not just the copy.
+ */
+static void bench_console() {
+    static const char line[] = "bench: console log line 0123456789 abcdefghijklmnopqrstuvwxyz\n";
+    size_t bytes = BENCH_CONSOLE_LINES * (sizeof(line) - 1);
+
+    uint64_t start = rdtsc();
+    for (int i = 0; i < BENCH_CONSOLE_LINES; i++) {
+        console_write(line, sizeof(line) - 1);
+    }
+    uint64_t direct = (rdtsc() - start) / bytes;
+
+    start = rdtsc();
+    for (int i = 0; i < BENCH_CONSOLE_LINES; i++) {
+        console_buffer_write(line, sizeof(line) - 1);
+    }
+    console_flush();
+    uint64_t buffered = (rdtsc() - start) / bytes;
+
+    kprintf("BENCH: console write per byte: %llu cycles direct, %llu cycles buffered\n", direct, buffered);
+}
+
+// Số lần sbrk nhỏ (như malloc xin thêm bộ nhớ) và kích thước mỗi lần
+#define BENCH_HEAP_CALLS 1024
+#define BENCH_HEAP_STEP  256
+
+/**
+ * Grows a fresh heap in small steps and reports the average cost of one
+ * sbrk. Only one call in HEAP_CHUNK_SIZE / BENCH_HEAP_STEP maps memory,
+ * so the average shows how much of the mapping cost chunking amortizes.
+ */
+static void bench_heap() {
+    address_space_t *as = address_space_create();
+    if (!as) {
+        return;
+    }
+    heap_init(as, 0x1000000);
+    uint64_t start = rdtsc();
+    for (int i = 0; i < BENCH_HEAP_CALLS; i++) {
+        if (heap_sbrk(as, BENCH_HEAP_STEP) < 0) {
+            break;
+        }
+    }
+    uint64_t grow = (rdtsc() - start) / BENCH_HEAP_CALLS;
+    start = rdtsc();
+    heap_sbrk(as, -(int64_t)(as->brk - as->brk_start));
+    uint64_t shrink = rdtsc() - start;
+    address_space_put(as);
+    kprintf("BENCH: sbrk(%d): %llu cycles per call, shrinking %d KiB: %llu cycles\n", BENCH_HEAP_STEP, grow,
+            BENCH_HEAP_CALLS * BENCH_HEAP_STEP / 1024, shrink);
+}
+
+// Số trang mỗi lần chuyển và số lần chuyển qua lại giữa hai không gian địa chỉ
+#define BENCH_SHM_PAGES  64
+#define BENCH_SHM_ROUNDS 16
+
+/**
+ * Moves BENCH_SHM_PAGES pages back and forth between two address spaces
+ * with page_send/page_recv and compares one transfer against copying the
+ * same amount of data, which is what a copying IPC path would pay.
+ */
+static void bench_page_transfer() {
+    address_space_t *as[2] = {address_space_create(), address_space_create()};
+    uint64_t len = BENCH_SHM_PAGES * PAGE_SIZE;
+    uint64_t src = allocate_physical_blocks(BENCH_SHM_PAGES);
+    uint64_t dst = allocate_physical_blocks(BENCH_SHM_PAGES);
+    if (!as[0] || !as[1] || !src || !dst) {
+        goto out;
+    }
+    as[0]->users = as[1]->users = 1;
+    uint64_t addr = 0x400000;
+    for (uint64_t i = 0; i < BENCH_SHM_PAGES; i++) {
+        uint64_t phys = allocate_physical_block();
+        if (!phys || !map_memory(as[0]->page_table, addr + i * PAGE_SIZE, phys, PAGE_SIZE,
+                                 PAGING_PAGE_PRESENT | PAGING_PAGE_RW | PAGING_PAGE_USER)) {
+            if (phys) {
+                free_physical_block(phys);
+            }
+            goto out;
+        }
+    }
+
+    int rounds = 0;
+    uint64_t start = rdtsc();
+    for (; rounds < BENCH_SHM_ROUNDS; rounds++) {
+        shm_msg_t msg;
+        address_space_t *to = as[(rounds + 1) & 1];
+        if (shm_transfer(as[rounds & 1], to, addr, len, 0) || shm_page_recv(to, &msg, PAGE_RECV_NONBLOCK)) {
+            break;
+        }
+        addr = msg.addr;
+    }
+    uint64_t transfer = rounds ? (rdtsc() - start) / rounds : 0;
+    start = rdtsc();
+    memcpy(PHYS_TO_VIRT(dst), PHYS_TO_VIRT(src), len);
+    uint64_t copy = rdtsc() - start;
+    kprintf("BENCH: moving %llu KiB: %llu cycles with page_send, %llu cycles to copy\n", len / 1024, transfer, copy);
+out:
+    for (int i = 0; i < 2; i++) {
+        if (as[i]) {
+            address_space_put(as[i]);
+        }
+    }
+    if (src) {
+        free_physical_blocks(src, BENCH_SHM_PAGES);
+    }
+    if (dst) {
+        free_physical_blocks(dst, BENCH_SHM_PAGES);
+    }
+}
+
+// Số vòng ping-pong mỗi lần đo IPC
+#define BENCH_IPC_ROUNDS 10000
+#define BENCH_IPC_STOP   0xDEADULL
+
+// Server ping-pong: trả lại thông điệp nguyên vẹn tới khi nhận BENCH_IPC_STOP
+static void bench_ipc_server(void *arg) {
+    (void)arg;
+    uint64_t msg[IPC_MSG_WORDS];
+    int64_t from = ipc_reply_wait(0, msg);
+    while (from > 0 && msg[0] != BENCH_IPC_STOP) {
+        from = ipc_reply_wait((uint64_t)from, msg);
+    }
+}
+
+/**
+ * Ping-pongs BENCH_IPC_ROUNDS calls with a server thread pinned to @p cpu.
+ *
+ * The first call is not timed: it may queue while the server is still on
+ * its way to reply_wait. The server is stopped with a call it does not
+ * answer, which returns -1.
+ *
+ * @return Average TSC cycles per round trip, or 0 if a call failed.
+ */
+static uint64_t bench_ipc_run(int cpu) {
+    process_t *server = kthread_create(bench_ipc_server, NULL, cpu);
+    if (!server) {
+        return 0;
+    }
+    uint64_t pid = server->pid;
+    uint64_t msg[IPC_MSG_WORDS] = {0};
+    bool ok = ipc_call(pid, msg) == 0;
+    uint64_t start = rdtsc();
+    for (int i = 0; ok && i < BENCH_IPC_ROUNDS; i++) {
+        ok = ipc_call(pid, msg) == 0;
+    }
+    uint64_t cycles = rdtsc() - start;
+    msg[0] = BENCH_IPC_STOP;
+    ipc_call(pid, msg);
+    return ok ? cycles / BENCH_IPC_ROUNDS : 0;
+}
+
+// Benchmark IPC đồng bộ: độ trễ một vòng call/reply với server trên cùng CPU (chuyển thẳng)
+// và, nếu có, trên CPU khác (đánh thức qua hàng đợi của CPU đó)
+static void bench_ipc() {
+    uint64_t cr3;
+    __asm__ volatile("cli");
+    __asm__ volatile("mov %%cr3, %0" : "=r"(cr3));
+    process_t *saved_current = process_current();
+    memset(&bench_main, 0, sizeof(process_t));
+    bench_main.pid = 200;
+    bench_main.page_table = cr3;
+    bench_main.kernel_stack_top = kernel_stack_top;
+    bench_main.pkru = PKRU_DEFAULT;
+    bench_main.weight = NICE_0_WEIGHT;
+    bench_main.cpus_allowed = 1;
+    bench_main.state = PROCESS_STATE_RUNNING;
+    process_set_current(&bench_main);
+    __asm__ volatile("sti");
+
+    uint64_t local = bench_ipc_run(0);
+    kprintf("BENCH: IPC call/reply round trip, same CPU: %llu cycles, %llu ns\n",
+            local, timer_tsc_to_ns(local));
+    if (cpu_count > 1) {
+        uint64_t remote = bench_ipc_run(1);
+        kprintf("BENCH: IPC call/reply round trip, other CPU: %llu cycles, %llu ns\n",
+                remote, timer_tsc_to_ns(remote));
+    }
+
+    __asm__ volatile("cli");
+    this_cpu()->tss->rsp0 = kernel_stack_top;
+    process_set_current(saved_current);
+    __asm__ volatile("sti");
+}
+
+// Hàm chạy tất cả benchmark
+void run_all_benchmarks() {
+    kprintf("=== Starting Benchmarks ===\n");
+
+    bench_context_switch();
+    bench_scaling();
+    bench_syscall();
+    bench_console();
+    bench_heap();
+    bench_page_transfer();
+    bench_ipc();
+    sched_dl_dump();
+    task_group_dump();
+    if (system_wq) {
+        workqueue_dump(system_wq);
+    }
+    futex_dump();
+    console_dump();
+    heap_dump();
+    shm_dump();
+    ipc_dump();
+    syscall_stats_dump();
+    // Không làm gì khi LOCK_STATS = 0 / LATENCY_TRACE = 0
+    lock_stats_dump();
+    latency_trace_dump();
+
+    kprintf("=== Benchmarks Completed ===\n");
+}
@@ -0,0 +1,8 @@
+// tests/bench.h
+#ifndef BENCH_H
+#define BENCH_H
+
+// Hàm chạy tất cả benchmark (chỉ có trong bản build TEST)
+void run_all_benchmarks();
+
+#endif // BENCH_H
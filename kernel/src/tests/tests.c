@@ -6,6 +6,39 @@
 #include "stacks.h"
 #include "tests.h"
 #include "idt.h"
+#include "memory_manager.h"
+#include "config.h"
+#include "paging.h"
+#include "process.h"
+#include "scheduler.h"
+#include "sched_fair.h"
+#include "sched_dl.h"
+#include "sched_group.h"
+#include "timer.h"
+#include "percpu.h"
+#include "cpu.h"
+#include "io.h"
+#include "context_switcher.h"
+#include "pkey.h"
+#include "klibc.h"
+#include "spinlock.h"
+#include "rcu.h"
+#include "preempt.h"
+#include "kthread.h"
+#include "softirq.h"
+#include "workqueue.h"
+#include "address_space.h"
+#include "futex.h"
+#include "syscall.h"
+#include "syscall_handler.h"
+#include "vdso.h"
+#include "uring.h"
+#include "console.h"
+#include "usercopy.h"
+#include "heap.h"
+#include "shm.h"
+#include "ipc.h"
+#include "mutex.h"
 
 // Hàm để in kết quả kiểm thử
 void test_print_result(const char *test_name, bool result) {
@@ -43,10 +76,10 @@ void test_gdt_entries() {
     if ((entries32[2].access & 0xFE) != 0x92) { // Kernel data segment
         result = false;
     }
-    if ((entries32[3].access & 0xFE) != 0xFA) { // User code segment
+    if ((entries32[3].access & 0xFE) != 0xF2) { // User data segment
         result = false;
     }
-    if ((entries32[4].access & 0xFE) != 0xF2) { // User data segment
+    if ((entries32[4].access & 0xFE) != 0xFA) { // User code segment
         result = false;
     }
 
@@ -57,10 +90,10 @@ void test_gdt_entries() {
     if ((entries32[2].granularity & 0xF0) != 0x00) { // Kernel data segment
         result = false;
     }
-    if ((entries32[3].granularity & 0xF0) != 0x20) { // User code segment
+    if ((entries32[3].granularity & 0xF0) != 0x00) { // User data segment
         result = false;
     }
-    if ((entries32[4].granularity & 0xF0) != 0x00) { // User data segment
+    if ((entries32[4].granularity & 0xF0) != 0x20) { // User code segment
         result = false;
     }
 
@@ -222,6 +255,2027 @@ void test_stacks() {
     test_print_result("Stacks Initialization Test", result);
 }
 
+// Kiểm thử báo cáo trang trống: chỉ các vùng 2 MiB trống và "bẩn" mới được cô lập
+void test_free_page_reporting() {
+    bool result = true;
+    uint64_t runs[4];
+    uint64_t run_bytes = FREE_PAGE_REPORT_RUN_BLOCKS * BLOCK_SIZE;
+
+    // Báo cáo hết các vùng hiện có để mọi vùng đều sạch
+    uint64_t n;
+    while ((n = memory_manager_isolate_free_runs(runs, 4)) != 0) {
+        memory_manager_release_reported_runs(runs, n);
+    }
+
+    // Giải phóng một dải 4 MiB làm bẩn ít nhất một vùng 2 MiB trọn vẹn
+    uint64_t region = allocate_physical_blocks(FREE_PAGE_REPORT_RUN_BLOCKS * 2);
+    if (!region) {
+        test_print_result("Free Page Reporting Test", false);
+        return;
+    }
+    free_physical_blocks(region, FREE_PAGE_REPORT_RUN_BLOCKS * 2);
+
+    n = memory_manager_isolate_free_runs(runs, 4);
+    if (n == 0) {
+        result = false;
+    }
+    for (uint64_t i = 0; i < n; i++) {
+        if (runs[i] % run_bytes != 0 || runs[i] < region || runs[i] + run_bytes > region + 2 * run_bytes) {
+            result = false;
+        }
+        if (!are_blocks_allocated(runs[i], FREE_PAGE_REPORT_RUN_BLOCKS)) {
+            result = false;
+        }
+    }
+    memory_manager_release_reported_runs(runs, n);
+
+    // Vùng đã báo cáo phải trống và không bị báo cáo lại
+    if (n > 0 && is_block_allocated(runs[0])) {
+        result = false;
+    }
+    if (memory_manager_isolate_free_runs(runs, 4) != 0) {
+        result = false;
+    }
+
+    test_print_result("Free Page Reporting Test", result);
+}
+
+// Kiểm thử protection key: key phải được ghi vào bit 59-62 của PTE lá
+void test_pkey_pte() {
+    bool result = true;
+    uint64_t virt = 0x500000;
+
+    uint64_t pml4 = (uint64_t)create_user_page_table();
+    uint64_t page = allocate_physical_block();
+    if (!pml4 || !page ||
+        !map_memory(pml4, virt, page, PAGE_SIZE, PAGING_PAGE_PRESENT | PAGING_PAGE_RW | PAGING_PAGE_USER | PAGING_PAGE_PKEY(3))) {
+        test_print_result("PKey PTE Test", false);
+        return;
+    }
+
+    uint64_t *pte = paging_get_pte(pml4, virt);
+    if (!pte || ((*pte & PAGING_PAGE_PKEY_MASK) >> PAGING_PAGE_PKEY_SHIFT) != 3) {
+        result = false;
+    }
+
+    // Bảng trung gian không được mang key
+    uint64_t pml4_entry = ((uint64_t *)PHYS_TO_VIRT(pml4))[0];
+    if (pml4_entry & PAGING_PAGE_PKEY_MASK) {
+        result = false;
+    }
+
+    if (!paging_set_pkey(pml4, virt, PAGE_SIZE, 5) || ((*pte & PAGING_PAGE_PKEY_MASK) >> PAGING_PAGE_PKEY_SHIFT) != 5) {
+        result = false;
+    }
+    if ((*pte & ~0xFFFULL & ~PAGING_PAGE_PKEY_MASK) != page) {
+        result = false;
+    }
+
+    // Dải chưa được ánh xạ phải bị từ chối
+    if (paging_set_pkey(pml4, virt + PAGE_SIZE, PAGE_SIZE, 5)) {
+        result = false;
+    }
+
+    test_print_result("PKey PTE Test", result);
+}
+
+// Ngữ cảnh của bài kiểm thử scheduler cũng là một tiến trình được lập lịch trên BSP
+static process_t sched_test_main;
+
+// Biến ngữ cảnh hiện tại thành sched_test_main (tắt ngắt), trả về tiến trình trước đó
+static process_t *sched_test_begin() {
+    uint64_t cr3;
+
+    __asm__ volatile("cli");
+    __asm__ volatile("mov %%cr3, %0" : "=r"(cr3));
+    process_t *saved_current = process_current();
+
+    memset(&sched_test_main, 0, sizeof(process_t));
+    sched_test_main.pid = 99;
+    sched_test_main.page_table = cr3;
+    sched_test_main.kernel_stack_top = kernel_stack_top;
+    sched_test_main.pkru = PKRU_DEFAULT;
+    sched_test_main.weight = NICE_0_WEIGHT;
+    sched_test_main.cpus_allowed = 1;
+    sched_test_main.state = PROCESS_STATE_RUNNING;
+    sched_test_main.exec_start = timer_now_ns();
+    process_set_current(&sched_test_main);
+    return saved_current;
+}
+
+static void sched_test_end(process_t *saved_current) {
+    // Bỏ tiến trình kiểm thử còn sót lại, nhưng giữ luồng kernel của CPU này (ksoftirqd, worker)
+    process_t *keep[8];
+    int nr_keep = 0;
+    process_t *proc;
+    while ((proc = process_dequeue())) {
+        if (proc->kthread && nr_keep < 8) {
+            keep[nr_keep++] = proc;
+        }
+    }
+    for (int i = 0; i < nr_keep; i++) {
+        process_enqueue(keep[i]);
+    }
+    tss.rsp0 = kernel_stack_top;
+    process_set_current(saved_current);
+    __asm__ volatile("sti");
+}
+
+// Dựng một tiến trình kernel chạy entry trên stack cho trước rồi đưa vào hàng đợi
+static void sched_test_spawn(process_t *proc, uint8_t *stack, uint64_t stack_size,
+                             void (*entry)(void), uint64_t pid, uint64_t cpus_allowed) {
+    memset(proc, 0, sizeof(process_t));
+    proc->pid = pid;
+    proc->page_table = sched_test_main.page_table;
+    proc->kernel_stack = (uint64_t)stack;
+    proc->kernel_stack_top = (uint64_t)stack + stack_size;
+    proc->pkru = PKRU_DEFAULT;
+    proc->cpus_allowed = cpus_allowed;
+    // Chừa một ô "địa chỉ trả về" để căn chỉnh stack như khi vừa call
+    context_init(&proc->context, proc->kernel_stack_top - 8, entry);
+    sched_new_task(proc);
+}
+
+// Các tiến trình kernel của mọi bài kiểm thử scheduler. Mỗi ô chỉ được dùng một lần:
+// tiến trình vừa báo xong có thể vẫn đang lưu ngữ cảnh vào ô của nó trên CPU khác
+#define SCHED_TEST_MAX_PROCS 32
+static process_t sched_test_procs[SCHED_TEST_MAX_PROCS];
+static uint8_t sched_test_stacks[SCHED_TEST_MAX_PROCS][4096] __attribute__((aligned(16)));
+static int sched_test_nr_procs;
+
+/**
+ * Starts @p n kernel processes running @p entry with PIDs @p first_pid,
+ * @p first_pid + 1, ... and the CPU mask @p cpus_allowed. Must be called
+ * inside a sched_test_begin/sched_test_end window.
+ *
+ * @return The first of the @p n consecutive processes.
+ */
+static process_t *test_make_procs(int n, void (*entry)(void), uint64_t first_pid, uint64_t cpus_allowed) {
+    if (sched_test_nr_procs + n > SCHED_TEST_MAX_PROCS) {
+        panic("Test: SCHED_TEST_MAX_PROCS is too small for the scheduler tests");
+    }
+    process_t *procs = &sched_test_procs[sched_test_nr_procs];
+    for (int i = 0; i < n; i++) {
+        int slot = sched_test_nr_procs++;
+        sched_test_spawn(&sched_test_procs[slot], sched_test_stacks[slot], sizeof(sched_test_stacks[slot]), entry,
+                         first_pid + i, cpus_allowed);
+    }
+    return procs;
+}
+
+// Kết thúc tiến trình kernel của bài kiểm thử
+static void sched_test_exit() {
+    process_current()->state = PROCESS_STATE_TERMINATED;
+    schedule();
+}
+
+// Trạng thái dùng chung cho kiểm thử chuyển ngữ cảnh của scheduler
+static uint64_t rr_log[8];
+static int rr_log_len;
+static int rr_done;
+
+// Hàm thân của tiến trình kiểm thử: ghi PID hai lần rồi kết thúc
+static void rr_worker() {
+    process_t *self = process_current();
+    for (int round = 0; round < 2; round++) {
+        if (rr_log_len < 8) {
+            rr_log[rr_log_len++] = self->pid;
+        }
+        sched_yield();
+    }
+    rr_done++;
+    sched_test_exit();
+}
+
+// Kiểm thử scheduler trên ngữ cảnh kernel thật: mọi tiến trình đều được chạy,
+// độ trễ lập lịch được ghi lại, và frame kernel không bao giờ bị chiếm quyền
+void test_scheduler_context_switch() {
+    bool result = true;
+    process_t *saved_current = sched_test_begin();
+
+    rr_log_len = 0;
+    rr_done = 0;
+    // Ghim vào BSP để thứ tự chạy chỉ phụ thuộc vào hàng đợi của CPU này
+    process_t *rr_procs = test_make_procs(3, rr_worker, 100, 1);
+    while (rr_done < 3) {
+        sched_yield();
+    }
+
+    if (rr_log_len != 6 || process_current() != &sched_test_main) {
+        result = false;
+    }
+    for (int i = 0; i < 3; i++) {
+        int runs = 0;
+        for (int j = 0; j < rr_log_len; j++) {
+            if (rr_log[j] == rr_procs[i].pid) {
+                runs++;
+            }
+        }
+        // Mỗi lần chạy đều đi qua hàng đợi và độ trễ phải hữu hạn (dưới 1 giây)
+        if (runs != 2 || rr_procs[i].wait_count < 2 || rr_procs[i].wait_max_ns >= 1000000000ULL) {
+            result = false;
+        }
+    }
+    if (sched_latency_max_ns < rr_procs[0].wait_max_ns) {
+        result = false;
+    }
+
+    // Frame ở chế độ kernel không bao giờ bị chiếm quyền; frame user thì có
+    static trap_frame_t frame;
+    memset(&frame, 0, sizeof(frame));
+    frame.cs = GDT_KERNEL_CODE;
+    this_cpu()->need_resched = true;
+    sched_check_resched(&frame);
+    if (!this_cpu()->need_resched) {
+        result = false;
+    }
+    frame.cs = GDT_USER_CODE;
+    sched_check_resched(&frame);
+    if (this_cpu()->need_resched || process_current() != &sched_test_main) {
+        result = false;
+    }
+
+    sched_test_end(saved_current);
+    test_print_result("Scheduler Context Switch Test", result);
+}
+
+// Trạng thái dùng chung cho kiểm thử hàng đợi per-CPU
+#define RQ_TEST_WORKERS 8
+static uint32_t rq_ran_on[RQ_TEST_WORKERS + 1];
+static volatile int rq_done;
+
+// Ghi lại CPU đang chạy, bận khoảng 2 ms để các CPU khác kịp nhận việc, rồi kết thúc
+static void rq_worker() {
+    process_t *self = process_current();
+    rq_ran_on[self->pid - 200] = this_cpu()->id;
+    uint64_t until = rdtsc() + tsc_per_ms * 2;
+    while (rdtsc() < until) {
+        cpu_relax();
+    }
+    __atomic_fetch_add(&rq_done, 1, __ATOMIC_RELEASE);
+    sched_test_exit();
+}
+
+// Kiểm thử hàng đợi per-CPU: affinity được tôn trọng và việc được chia cho nhiều CPU
+void test_per_cpu_runqueues() {
+    bool result = true;
+    process_t *saved_current = sched_test_begin();
+    uint32_t last_cpu = cpu_count - 1;
+    int workers = cpu_count > 1 ? RQ_TEST_WORKERS : 2;
+
+    if (sched_set_affinity(&sched_test_main, 0) != -1) {
+        result = false;
+    }
+
+    // Tiến trình chỉ được chạy trên CPU cuối cùng
+    rq_done = 0;
+    test_make_procs(1, rq_worker, 200, 1ULL << last_cpu);
+    while (__atomic_load_n(&rq_done, __ATOMIC_ACQUIRE) < 1) {
+        sched_yield();
+    }
+    if (rq_ran_on[0] != last_cpu) {
+        result = false;
+    }
+
+    // Tiến trình không bị ghim được phân tán ra các CPU rảnh
+    rq_done = 0;
+    test_make_procs(workers, rq_worker, 201, UINT64_MAX);
+    while (__atomic_load_n(&rq_done, __ATOMIC_ACQUIRE) < workers) {
+        sched_yield();
+    }
+    uint64_t used = 0;
+    for (int i = 1; i <= workers; i++) {
+        used |= 1ULL << rq_ran_on[i];
+    }
+    if (cpu_count > 1 && !(used & ~1ULL)) {
+        result = false;
+    }
+
+    sched_test_end(saved_current);
+    test_print_result("Per-CPU Run Queue Test", result);
+}
+
+// Trạng thái dùng chung cho kiểm thử khóa: mọi worker cùng tăng các bộ đếm không atomic
+#define LOCK_TEST_WORKERS 4
+#define LOCK_TEST_ITERATIONS 20000
+static spinlock_t test_spin;
+static mcs_lock_t test_mcs;
+static rwlock_t test_rw;
+static seqlock_t test_seq;
+static mutex_t test_mutex;
+static volatile uint64_t spin_counter, mcs_counter, rw_counter, mutex_counter;
+static volatile uint64_t seq_a, seq_b;
+static volatile int lock_torn_reads;
+static volatile int lock_done;
+
+static void lock_worker() {
+    for (int i = 0; i < LOCK_TEST_ITERATIONS; i++) {
+        uint64_t flags = spin_lock_irqsave(&test_spin);
+        spin_counter = spin_counter + 1;
+        spin_unlock_irqrestore(&test_spin, flags);
+
+        mcs_node_t node;
+        mcs_lock(&test_mcs, &node);
+        mcs_counter = mcs_counter + 1;
+        mcs_unlock(&test_mcs, &node);
+
+        // Chủ mutex nhường CPU giữa chừng: người khác phải ngủ chờ chứ không được vào cùng
+        if (i % 64 == 0) {
+            mutex_lock(&test_mutex);
+            uint64_t before = mutex_counter;
+            sched_yield();
+            mutex_counter = before + 1;
+            mutex_unlock(&test_mutex);
+        }
+
+        if (i % 8 == 0) {
+            write_lock(&test_rw);
+            rw_counter = rw_counter + 1;
+            write_unlock(&test_rw);
+
+            // seq_b luôn bằng 2 * seq_a khi nhìn từ reader
+            write_seqlock(&test_seq);
+            seq_a = seq_a + 1;
+            seq_b = seq_a * 2;
+            write_sequnlock(&test_seq);
+        } else {
+            read_lock(&test_rw);
+            uint64_t before = rw_counter;
+            cpu_relax();
+            if (rw_counter != before) {
+                __atomic_fetch_add(&lock_torn_reads, 1, __ATOMIC_RELAXED);
+            }
+            read_unlock(&test_rw);
+
+            uint64_t a, b;
+            uint32_t seq;
+            do {
+                seq = read_seqbegin(&test_seq);
+                a = seq_a;
+                b = seq_b;
+            } while (read_seqretry(&test_seq, seq));
+            if (b != a * 2) {
+                __atomic_fetch_add(&lock_torn_reads, 1, __ATOMIC_RELAXED);
+            }
+        }
+    }
+    __atomic_fetch_add(&lock_done, 1, __ATOMIC_RELEASE);
+    sched_test_exit();
+}
+
+// Kiểm thử ticket/MCS/rwlock/seqlock/mutex: trạng thái trên một CPU, rồi tranh chấp thật giữa các CPU
+void test_locks() {
+    bool result = true;
+
+    spin_init_named(&test_spin, "test_spin");
+    mcs_init_named(&test_mcs, "test_mcs");
+    rwlock_init_named(&test_rw, "test_rw");
+    seqlock_init_named(&test_seq, "test_seq");
+    mutex_init(&test_mutex);
+
+    // Ticket lock: trylock thất bại khi đang bị giữ
+    spin_lock(&test_spin);
+    if (!spin_is_locked(&test_spin) || spin_trylock(&test_spin)) {
+        result = false;
+    }
+    spin_unlock(&test_spin);
+    if (spin_is_locked(&test_spin) || !spin_trylock(&test_spin)) {
+        result = false;
+    }
+    spin_unlock(&test_spin);
+
+    // MCS: trylock thất bại khi đang bị giữ
+    mcs_node_t n1, n2;
+    mcs_lock(&test_mcs, &n1);
+    if (mcs_trylock(&test_mcs, &n2)) {
+        result = false;
+    }
+    mcs_unlock(&test_mcs, &n1);
+    if (test_mcs.tail != 0) {
+        result = false;
+    }
+
+    // rwlock: nhiều reader cùng lúc
+    read_lock(&test_rw);
+    read_lock(&test_rw);
+    if ((test_rw.state & RWLOCK_READERS) != 2) {
+        result = false;
+    }
+    read_unlock(&test_rw);
+    read_unlock(&test_rw);
+    write_lock(&test_rw);
+    if (test_rw.state != RWLOCK_WRITER) {
+        result = false;
+    }
+    write_unlock(&test_rw);
+
+    // mutex: không tranh chấp thì không chờ
+    mutex_lock(&test_mutex);
+    if (!test_mutex.locked) {
+        result = false;
+    }
+    mutex_unlock(&test_mutex);
+    if (test_mutex.locked || test_mutex.head) {
+        result = false;
+    }
+
+    // seqlock: reader phải đọc lại nếu writer chen vào
+    uint32_t seq = read_seqbegin(&test_seq);
+    write_seqlock(&test_seq);
+    write_sequnlock(&test_seq);
+    if (!read_seqretry(&test_seq, seq)) {
+        result = false;
+    }
+
+    // Tranh chấp thật: không được mất lần tăng nào và reader không thấy dữ liệu dở dang
+    process_t *saved_current = sched_test_begin();
+    spin_counter = mcs_counter = rw_counter = mutex_counter = 0;
+    seq_a = seq_b = 0;
+    lock_torn_reads = 0;
+    lock_done = 0;
+    test_make_procs(LOCK_TEST_WORKERS, lock_worker, 220, UINT64_MAX);
+    while (__atomic_load_n(&lock_done, __ATOMIC_ACQUIRE) < LOCK_TEST_WORKERS) {
+        sched_yield();
+    }
+    sched_test_end(saved_current);
+
+    uint64_t expected = (uint64_t)LOCK_TEST_WORKERS * LOCK_TEST_ITERATIONS;
+    uint64_t expected_writes = (uint64_t)LOCK_TEST_WORKERS * ((LOCK_TEST_ITERATIONS + 7) / 8);
+    uint64_t expected_mutex = (uint64_t)LOCK_TEST_WORKERS * ((LOCK_TEST_ITERATIONS + 63) / 64);
+    if (spin_counter != expected || mcs_counter != expected || mutex_counter != expected_mutex ||
+        rw_counter != expected_writes || seq_a != expected_writes || lock_torn_reads != 0) {
+        result = false;
+    }
+
+    test_print_result("Lock Primitives Test", result);
+}
+
+// Trạng thái dùng chung cho kiểm thử RCU
+static process_t rcu_procs[4];
+static rcu_head_t rcu_test_head;
+static volatile bool rcu_callback_ran;
+static volatile bool rcu_reader_inside;
+static volatile bool rcu_reader_left;
+
+static void rcu_test_callback(rcu_head_t *head) {
+    (void)head;
+    rcu_callback_ran = true;
+}
+
+// Ở trong vùng đọc khoảng 5 ms rồi thoát
+static void rcu_reader() {
+    rcu_read_lock();
+    rcu_reader_inside = true;
+    uint64_t until = rdtsc() + tsc_per_ms * 5;
+    while (rdtsc() < until) {
+        cpu_relax();
+    }
+    rcu_reader_left = true;
+    rcu_read_unlock();
+    sched_test_exit();
+}
+
+// Kiểm thử RCU: bảng PID tra cứu không khóa, call_rcu chạy sau grace period,
+// synchronize_rcu chờ reader trên CPU khác
+void test_rcu() {
+    bool result = true;
+
+    // Bảng PID
+    for (int i = 0; i < 4; i++) {
+        memset(&rcu_procs[i], 0, sizeof(process_t));
+        rcu_procs[i].pid = 9000 + i * 256;     // Cùng rơi vào vài bucket để thử danh sách dài
+        process_hash(&rcu_procs[i]);
+    }
+    rcu_read_lock();
+    for (int i = 0; i < 4; i++) {
+        if (process_find(rcu_procs[i].pid) != &rcu_procs[i]) {
+            result = false;
+        }
+    }
+    if (process_find(8999) != NULL) {
+        result = false;
+    }
+    rcu_read_unlock();
+    process_unhash(&rcu_procs[1]);
+    rcu_read_lock();
+    if (process_find(rcu_procs[1].pid) != NULL || process_find(rcu_procs[2].pid) != &rcu_procs[2]) {
+        result = false;
+    }
+    rcu_read_unlock();
+    for (int i = 0; i < 4; i++) {
+        process_unhash(&rcu_procs[i]);
+    }
+
+    // call_rcu: CPU này đi qua trạng thái tĩnh bằng cách halt như vòng idle
+    rcu_callback_ran = false;
+    call_rcu(&rcu_test_head, rcu_test_callback);
+    uint64_t deadline = rdtsc() + tsc_per_ms * 200;
+    while (!rcu_callback_ran && rdtsc() < deadline) {
+        rcu_idle_enter();
+        __asm__ volatile("sti; hlt" ::: "memory");
+        rcu_idle_exit();
+    }
+    if (!rcu_callback_ran) {
+        result = false;
+    }
+
+    // synchronize_rcu phải chờ reader đang ở trên CPU khác
+    if (cpu_count > 1) {
+        process_t *saved_current = sched_test_begin();
+        rcu_reader_inside = false;
+        rcu_reader_left = false;
+        test_make_procs(1, rcu_reader, 240, UINT64_MAX & ~1ULL);
+        while (!rcu_reader_inside) {
+            sched_yield();
+        }
+        synchronize_rcu();
+        if (!rcu_reader_left) {
+            result = false;
+        }
+        sched_test_end(saved_current);
+    }
+
+    test_print_result("RCU Test", result);
+}
+
+// Trạng thái dùng chung cho kiểm thử chiếm quyền trong kernel
+static volatile bool preempt_other_ran;
+static volatile bool preempt_ran_while_looping;
+static volatile bool preempt_ran_while_disabled;
+static volatile int preempt_done;
+static bool preempt_test_disable;
+
+// Vòng lặp kernel không bao giờ tự nhường CPU, bật ngắt và chờ tiến trình kia chạy (tối đa 200 ms)
+static void preempt_spinner() {
+    __asm__ volatile("sti");
+    if (preempt_test_disable) {
+        // Trong đoạn tắt chiếm quyền tiến trình kia không được chạy trên CPU này
+        preempt_disable();
+        uint64_t until = rdtsc() + tsc_per_ms * 40;
+        while (rdtsc() < until) {
+            cpu_relax();
+        }
+        preempt_ran_while_disabled = preempt_other_ran;
+        preempt_enable();
+    }
+    uint64_t deadline = rdtsc() + tsc_per_ms * 200;
+    while (!preempt_other_ran && rdtsc() < deadline) {
+        cpu_relax();
+    }
+    preempt_ran_while_looping = preempt_other_ran;
+    __atomic_fetch_add(&preempt_done, 1, __ATOMIC_RELEASE);
+    sched_test_exit();
+}
+
+static void preempt_other() {
+    preempt_other_ran = true;
+    __atomic_fetch_add(&preempt_done, 1, __ATOMIC_RELEASE);
+    sched_test_exit();
+}
+
+// Chạy hai tiến trình kernel trên cùng CPU cuối: spinner chạy trước và không nhường CPU
+static void preempt_test_run(bool disable) {
+    uint64_t mask = 1ULL << (cpu_count - 1);
+    preempt_test_disable = disable;
+    preempt_other_ran = false;
+    preempt_ran_while_looping = false;
+    preempt_ran_while_disabled = false;
+    preempt_done = 0;
+    test_make_procs(1, preempt_spinner, 250, mask);
+    test_make_procs(1, preempt_other, 251, mask);
+    while (__atomic_load_n(&preempt_done, __ATOMIC_ACQUIRE) < 2) {
+        sched_yield();
+    }
+}
+
+// Kiểm thử chiếm quyền trong kernel: preempt_count lồng nhau, vòng lặp kernel bị chiếm quyền
+// bởi tick, và đoạn preempt_disable chỉ bị chiếm quyền khi preempt_enable
+void test_kernel_preemption() {
+    bool result = true;
+    spinlock_t lock = SPINLOCK_INIT;
+
+    uint32_t base = preempt_count();
+    preempt_disable();
+    preempt_disable();
+    if (preempt_count() != base + 2) {
+        result = false;
+    }
+    preempt_enable();
+    preempt_enable();
+    spin_lock(&lock);
+    if (preempt_count() != base + 1) {
+        result = false;
+    }
+    spin_unlock(&lock);
+    if (preempt_count() != base) {
+        result = false;
+    }
+
+    process_t *saved_current = sched_test_begin();
+    preempt_test_run(false);
+    if (!preempt_ran_while_looping) {
+        result = false;
+    }
+    preempt_test_run(true);
+    if (preempt_ran_while_disabled || !preempt_ran_while_looping) {
+        result = false;
+    }
+    sched_test_end(saved_current);
+
+    test_print_result("Kernel Preemption Test", result);
+}
+
+// Kiểm thử tickless idle: trong lúc BSP bận 200 ms, tick của BSP vẫn chạy
+// còn các AP rảnh (đã tắt tick) nhận ít ngắt timer hơn hẳn TIMER_HZ
+void test_tickless_idle() {
+    bool result = true;
+    uint64_t ap_ticks[MAX_CPUS];
+
+    for (uint32_t i = 1; i < cpu_count; i++) {
+        ap_ticks[i] = cpus[i].ticks;
+    }
+    uint64_t bsp_ticks = this_cpu()->ticks;
+    uint64_t deadline = timer_now_ns() + 200000000ULL;
+    while (timer_now_ns() < deadline) {
+        cpu_relax();
+    }
+
+    // 200 ms với tick định kỳ là TIMER_HZ / 5 ngắt
+    if (this_cpu()->ticks - bsp_ticks < TIMER_HZ / 10) {
+        result = false;
+    }
+    for (uint32_t i = 1; i < cpu_count; i++) {
+        if (TIMER_NOHZ_IDLE && cpus[i].online && cpus[i].ticks - ap_ticks[i] >= TIMER_HZ / 25) {
+            kprintf("CPU %u took %llu timer interrupts while idle\n", i, cpus[i].ticks - ap_ticks[i]);
+            result = false;
+        }
+    }
+
+    test_print_result("Tickless Idle Test", result);
+}
+
+// Kiểm thử lập lịch công bằng trên hàng đợi riêng với thời gian giả lập:
+// CPU được chia theo trọng số nice, và các quyết định chiếm quyền đúng ngưỡng
+void test_fair_scheduler() {
+    bool result = true;
+    static fair_rq_t rq;
+    static process_t procs[4];
+
+    memset(&rq, 0, sizeof(rq));
+    memset(procs, 0, sizeof(procs));
+
+    // Cây trả về tiến trình theo vruntime tăng dần, bằng nhau thì theo thứ tự chèn
+    static const uint64_t vruntimes[4] = {300, 100, 200, 100};
+    for (int i = 0; i < 4; i++) {
+        procs[i].weight = NICE_0_WEIGHT;
+        procs[i].vruntime = vruntimes[i];
+        fair_enqueue(&rq, &procs[i]);
+    }
+    static const int order[4] = {1, 3, 2, 0};
+    for (int i = 0; i < 4; i++) {
+        process_t *first = fair_first(&rq);
+        if (first != &procs[order[i]]) {
+            result = false;
+            break;
+        }
+        fair_dequeue(&rq, first);
+    }
+    if (rq.nr_queued != 0 || rq.load_weight != 0 || fair_first(&rq)) {
+        result = false;
+    }
+
+    // nice 0 (1024) và nice 5 (335) chia CPU theo tỉ lệ trọng số, mỗi lượt 1 ms
+    memset(&rq, 0, sizeof(rq));
+    memset(procs, 0, sizeof(procs));
+    procs[0].weight = fair_nice_to_weight(0);
+    procs[1].weight = fair_nice_to_weight(5);
+    for (int i = 0; i < 2; i++) {
+        fair_place(&rq, &procs[i], true);
+        fair_enqueue(&rq, &procs[i]);
+    }
+    uint64_t now = 0;
+    for (int i = 0; i < 600; i++) {
+        process_t *curr = fair_first(&rq);
+        fair_dequeue(&rq, curr);
+        curr->exec_start = now;
+        now += 1000000;
+        fair_update_curr(&rq, curr, now);
+        fair_enqueue(&rq, curr);
+    }
+    uint64_t share0 = procs[0].sum_exec_runtime / 1000000 * procs[1].weight;
+    uint64_t share1 = procs[1].sum_exec_runtime / 1000000 * procs[0].weight;
+    if (share0 * 10 < share1 * 9 || share0 * 10 > share1 * 11) {
+        result = false;
+    }
+
+    // Chiếm quyền theo tick: chưa hết phần thì không, quá phần lý tưởng thì có
+    process_t *curr = fair_first(&rq);
+    fair_dequeue(&rq, curr);
+    curr->slice_exec_start = curr->sum_exec_runtime;
+    if (fair_tick_preempt(&rq, curr)) {
+        result = false;
+    }
+    curr->sum_exec_runtime += fair_slice(&rq, curr) + 1;
+    if (!fair_tick_preempt(&rq, curr)) {
+        result = false;
+    }
+
+    // Chiếm quyền khi thức dậy: tiến trình ngủ lâu vượt ngưỡng, ngang vruntime thì không
+    curr->vruntime = rq.min_vruntime + sched_latency_ns;
+    procs[2].weight = NICE_0_WEIGHT;
+    procs[2].vruntime = 0;
+    fair_place(&rq, &procs[2], false);
+    if (!fair_wakeup_preempt(curr, &procs[2]) ||
+        procs[2].vruntime != rq.min_vruntime - sched_latency_ns / 2) {
+        result = false;
+    }
+    procs[3].weight = NICE_0_WEIGHT;
+    procs[3].vruntime = curr->vruntime;
+    if (fair_wakeup_preempt(curr, &procs[3])) {
+        result = false;
+    }
+
+    test_print_result("Fair Scheduler Test", result);
+}
+
+// Trạng thái dùng chung cho kiểm thử deadline trên scheduler thật
+static volatile bool dl_live_admitted;
+static volatile bool dl_live_rejected;
+static volatile bool dl_live_stop;
+static volatile int dl_live_jobs;
+static volatile uint64_t dl_live_misses;
+static volatile bool dl_live_mask_ok;
+static int dl_live_done;
+
+// Tiến trình công bằng chiếm CPU cho tới khi tiến trình deadline xong
+static void dl_live_hog() {
+    __asm__ volatile("sti");
+    while (!dl_live_stop) {
+        cpu_relax();
+    }
+    __atomic_fetch_add(&dl_live_done, 1, __ATOMIC_RELEASE);
+    sched_test_exit();
+}
+
+// Tiến trình deadline 2 ms / 10 ms: mười job, mỗi job chạy 1 ms rồi báo xong bằng sched_yield
+static void dl_live_worker() {
+    const uint64_t ms = 1000000;
+    __asm__ volatile("sti");
+    dl_live_admitted = sched_set_deadline(2 * ms, 10 * ms, 10 * ms) == 0;
+    // 99% vượt giới hạn băng thông của CPU
+    dl_live_rejected = sched_set_deadline(10 * ms - ms / 10, 10 * ms, 10 * ms) != 0;
+    for (int job = 0; job < 10 && dl_live_admitted; job++) {
+        uint64_t until = timer_now_ns() + ms;
+        while (timer_now_ns() < until) {
+            cpu_relax();
+        }
+        dl_live_jobs++;
+        sched_yield();
+    }
+    dl_live_misses = process_current()->dl_misses;
+    // Mặt nạ đặt khi đang ở lớp deadline chỉ có hiệu lực sau khi rời lớp đó
+    process_t *self = process_current();
+    uint64_t pinned = self->cpus_allowed;
+    uint64_t mask = pinned | 1;
+    dl_live_mask_ok = sched_set_affinity(self, mask) == 0 && self->cpus_allowed == pinned;
+    sched_set_deadline(0, 0, 0);
+    dl_live_mask_ok = dl_live_mask_ok && self->cpus_allowed == mask;
+    dl_live_stop = true;
+    __atomic_fetch_add(&dl_live_done, 1, __ATOMIC_RELEASE);
+    sched_test_exit();
+}
+
+// Kiểm thử lớp deadline với thời gian giả lập: admission control, thứ tự EDF,
+// tạm dừng khi hết ngân sách, nạp lại ở chu kỳ sau, đếm trễ hạn và luật CBS khi thức dậy
+void test_deadline_scheduler() {
+    bool result = true;
+    static dl_rq_t rq;
+    static process_t procs[3];
+    const uint64_t ms = 1000000;
+
+    memset(&rq, 0, sizeof(rq));
+    memset(procs, 0, sizeof(procs));
+
+    if (!dl_params_valid(2 * ms, 5 * ms, 10 * ms) || dl_params_valid(6 * ms, 5 * ms, 10 * ms) ||
+        dl_params_valid(2 * ms, 11 * ms, 10 * ms) || dl_params_valid(0, 5 * ms, 10 * ms)) {
+        result = false;
+    }
+
+    // 50% + 40% được nhận, thêm 10% vượt SCHED_DL_BW_PCT thì bị từ chối và không đổi tổng
+    uint64_t half = dl_bandwidth(5 * ms, 10 * ms);
+    uint64_t forty = dl_bandwidth(4 * ms, 10 * ms);
+    uint64_t ten = dl_bandwidth(1 * ms, 10 * ms);
+    if (!dl_admit(&rq, 0, half) || !dl_admit(&rq, 0, forty) || dl_admit(&rq, 0, ten) ||
+        rq.total_bw != half + forty) {
+        result = false;
+    }
+    // Đổi tham số của tiến trình đã được nhận chỉ tính phần chênh lệch
+    if (!dl_admit(&rq, forty, forty + ten / 2)) {
+        result = false;
+    }
+
+    // Hạn chót sớm nhất đứng đầu
+    static const uint64_t deadlines[3] = {30 * ms, 10 * ms, 20 * ms};
+    for (int i = 0; i < 3; i++) {
+        procs[i].dl_deadline = deadlines[i];
+        dl_start_period(&procs[i], 0);
+        dl_enqueue(&rq, &procs[i]);
+    }
+    static const int order[3] = {1, 2, 0};
+    for (int i = 0; i < 3; i++) {
+        process_t *first = dl_first(&rq);
+        if (first != &procs[order[i]]) {
+            result = false;
+            break;
+        }
+        dl_dequeue(&rq, first);
+    }
+    if (rq.nr_queued != 0 || dl_first(&rq)) {
+        result = false;
+    }
+
+    // 2 ms mỗi 10 ms, hạn chót 5 ms: chạy lố 0.5 ms thì bị tạm dừng tới 10 ms và trả nợ ở chu kỳ sau
+    process_t *proc = &procs[0];
+    memset(proc, 0, sizeof(process_t));
+    proc->dl_runtime = 2 * ms;
+    proc->dl_deadline = 5 * ms;
+    proc->dl_period = 10 * ms;
+    proc->dl_bw = dl_bandwidth(2 * ms, 5 * ms);
+    dl_start_period(proc, 0);
+    proc->exec_start = 0;
+    if (dl_update_curr(proc, 1 * ms) || !dl_update_curr(proc, 2 * ms + ms / 2)) {
+        result = false;
+    }
+    dl_throttle(&rq, proc, 2 * ms + ms / 2, true);
+    if (!proc->dl_throttled || proc->dl_throttles != 1 || proc->dl_misses != 0 || rq.nr_throttles != 1) {
+        result = false;
+    }
+    if (dl_replenish(&rq, 9 * ms) != NULL || dl_replenish(&rq, 10 * ms) != proc ||
+        proc->dl_throttled || rq.throttled || proc->dl_abs_deadline != 15 * ms ||
+        proc->dl_budget != (int64_t)(ms + ms / 2)) {
+        result = false;
+    }
+
+    // Job xong sau hạn chót là một lần trễ hạn, và không tính là hết ngân sách
+    proc->exec_start = 15 * ms;
+    dl_update_curr(proc, 16 * ms);
+    dl_throttle(&rq, proc, 16 * ms, false);
+    if (proc->dl_misses != 1 || rq.nr_misses != 1 || proc->dl_throttles != 1) {
+        result = false;
+    }
+    dl_unthrottle(&rq, proc);
+    if (proc->dl_throttled || rq.throttled) {
+        result = false;
+    }
+
+    // CBS: còn 1.5 ms trước hạn chót 1 ms nữa là vượt băng thông, nên bắt đầu job mới;
+    // còn 1 ms trước hạn chót 4 ms nữa thì giữ nguyên job
+    dl_start_period(proc, 10 * ms);
+    proc->dl_budget = ms + ms / 2;
+    dl_wakeup(proc, 14 * ms);
+    if (proc->dl_abs_deadline != 19 * ms || proc->dl_budget != (int64_t)(2 * ms)) {
+        result = false;
+    }
+    proc->dl_budget = ms;
+    dl_wakeup(proc, 15 * ms);
+    if (proc->dl_abs_deadline != 19 * ms || proc->dl_budget != (int64_t)ms) {
+        result = false;
+    }
+
+    // Trên scheduler thật: cùng CPU với một tiến trình công bằng luôn bận, tiến trình
+    // deadline vẫn xong mọi job đúng hạn, trả lại băng thông và lấy lại mặt nạ CPU khi rời lớp deadline
+    uint32_t cpu = cpu_count - 1;
+    process_t *saved_current = sched_test_begin();
+    dl_live_stop = false;
+    dl_live_jobs = 0;
+    dl_live_done = 0;
+    test_make_procs(1, dl_live_hog, 260, 1ULL << cpu);
+    test_make_procs(1, dl_live_worker, 261, 1ULL << cpu);
+    while (__atomic_load_n(&dl_live_done, __ATOMIC_ACQUIRE) < 2) {
+        sched_yield();
+    }
+    sched_test_end(saved_current);
+    if (!dl_live_admitted || !dl_live_rejected || dl_live_jobs != 10 || dl_live_misses != 0 ||
+        !dl_live_mask_ok || runqueues[cpu].dl.total_bw != 0) {
+        result = false;
+    }
+
+    test_print_result("Deadline Scheduler Test", result);
+}
+
+// Trạng thái dùng chung cho kiểm thử nhóm trên scheduler thật
+static task_group_t group_test_capped;
+static volatile bool group_stop;
+static int group_done;
+
+// Thành viên nhóm bị giới hạn: chạy liên tục cho tới khi được dừng
+static void group_hog() {
+    __asm__ volatile("sti");
+    sched_group_attach(process_current(), &group_test_capped);
+    while (!group_stop) {
+        cpu_relax();
+    }
+    sched_group_attach(process_current(), NULL);
+    __atomic_fetch_add(&group_done, 1, __ATOMIC_RELEASE);
+    sched_test_exit();
+}
+
+// Kiểm thử nhóm giới hạn CPU: quota/period với thời gian giả lập, trọng số chia theo shares,
+// và trên scheduler thật hai tiến trình bận của nhóm 25% chỉ dùng khoảng một phần tư CPU
+void test_task_groups() {
+    bool result = true;
+    static task_group_t group;
+    static bool initialized;
+    const uint64_t ms = 1000000;
+
+    if (!initialized) {
+        task_group_init(&group, "test", NICE_0_WEIGHT);
+        task_group_init(&group_test_capped, "test-capped", NICE_0_WEIGHT);
+        initialized = true;
+    }
+
+    // Nhóm có shares 1024: hai thành viên nice 0 mỗi bên 512, nice 0 và nice 5 chia theo tỉ lệ nice
+    uint32_t w0 = fair_nice_to_weight(0);
+    uint32_t w5 = fair_nice_to_weight(5);
+    if (task_group_member_weight(&group, w0, 2 * w0) != NICE_0_WEIGHT / 2 ||
+        task_group_member_weight(&group, w0, w0 + w5) != NICE_0_WEIGHT * w0 / (w0 + w5) ||
+        task_group_member_weight(&group, 15, 1000000) != 2) {
+        result = false;
+    }
+
+    // 10 ms mỗi 50 ms: bị tạm dừng khi dùng hết, hết tạm dừng ở chu kỳ sau
+    if (task_group_set_bandwidth(&group, 10 * ms, 100) == 0 ||
+        task_group_set_bandwidth(&group, 10 * ms, 50 * ms) != 0) {
+        result = false;
+    }
+    uint64_t start = group.period_start;
+    if (task_group_charge(&group, 6 * ms, start + 6 * ms) ||
+        !task_group_charge(&group, 5 * ms, start + 11 * ms) || !group.throttled || group.nr_throttled != 1) {
+        result = false;
+    }
+    task_group_refresh(&group, start + 49 * ms);
+    if (!group.throttled) {
+        result = false;
+    }
+    task_group_refresh(&group, start + 50 * ms);
+    if (group.throttled || group.period_used != 0 || group.period_start != start + 50 * ms ||
+        group.throttled_ns != 39 * ms || group.usage_ns != 11 * ms) {
+        result = false;
+    }
+    // Bỏ qua nhiều chu kỳ: mốc chu kỳ vẫn thẳng hàng
+    task_group_refresh(&group, start + 175 * ms);
+    if (group.period_start != start + 150 * ms) {
+        result = false;
+    }
+    task_group_set_bandwidth(&group, 0, 0);
+    if (task_group_charge(&group, 100 * ms, start + 200 * ms) || group.throttled) {
+        result = false;
+    }
+
+    // Trên scheduler thật: 25 ms mỗi 100 ms, đo trong 300 ms (chạy lố tối đa một tick mỗi chu kỳ)
+    uint32_t cpu = cpu_count - 1;
+    task_group_set_bandwidth(&group_test_capped, 25 * ms, 100 * ms);
+    uint64_t used_before = group_test_capped.usage_ns;
+    uint64_t throttled_before = group_test_capped.nr_throttled;
+    process_t *saved_current = sched_test_begin();
+    group_stop = false;
+    group_done = 0;
+    test_make_procs(2, group_hog, 270, 1ULL << cpu);
+    uint64_t until = timer_now_ns() + 300 * ms;
+    while (timer_now_ns() < until) {
+        sched_yield();
+    }
+    uint64_t used = group_test_capped.usage_ns - used_before;
+    group_stop = true;
+    while (__atomic_load_n(&group_done, __ATOMIC_ACQUIRE) < 2) {
+        sched_yield();
+    }
+    sched_test_end(saved_current);
+    task_group_set_bandwidth(&group_test_capped, 0, 0);
+    if (used < 50 * ms || used > 100 * ms || group_test_capped.nr_throttled - throttled_before < 2 ||
+        group_test_capped.members) {
+        result = false;
+    }
+
+    test_print_result("Task Group Test", result);
+}
+
+// Trạng thái dùng chung cho kiểm thử luồng kernel và work queue
+static volatile bool kt_ran;
+static volatile uint32_t kt_cpu;
+static volatile bool kt_in_kthread;
+static volatile int wq_count;
+static volatile uint64_t wq_delayed_at;
+static volatile bool tasklet_ran;
+static volatile bool tasklet_in_softirq;
+
+static void kt_body(void *arg) {
+    kt_cpu = this_cpu()->id;
+    kt_in_kthread = process_current()->kthread && arg == &kt_ran;
+    kt_ran = true;
+}
+
+static void wq_count_func(work_t *work) {
+    (void)work;
+    if (process_current()->kthread) {
+        __atomic_fetch_add(&wq_count, 1, __ATOMIC_RELAXED);
+    }
+}
+
+static void wq_delayed_func(work_t *work) {
+    (void)work;
+    wq_delayed_at = timer_now_ns();
+}
+
+static void tasklet_func(void *data) {
+    tasklet_in_softirq = in_interrupt() && data == &tasklet_ran;
+    tasklet_ran = true;
+}
+
+// Chờ cờ được bật, nhường CPU trong lúc chờ; trả về false nếu quá 500 ms
+static bool wait_flag(volatile bool *flag) {
+    uint64_t deadline = timer_now_ns() + 500000000ULL;
+    while (!*flag && timer_now_ns() < deadline) {
+        sched_yield();
+    }
+    return *flag;
+}
+
+// Kiểm thử luồng kernel, work queue, delayed work và tasklet: mỗi việc chạy đúng
+// ngữ cảnh (luồng kernel trên CPU được chọn, tasklet trong softirq), delayed work không chạy sớm
+void test_kthreads_workqueue() {
+    bool result = true;
+    uint32_t cpu = cpu_count > 1 && cpus[1].online ? 1 : 0;
+    process_t *saved_current = sched_test_begin();
+    __asm__ volatile("sti");
+
+    // Luồng kernel chạy trên CPU được gắn rồi kết thúc và rời bảng PID
+    kt_ran = false;
+    process_t *thread = kthread_create(kt_body, (void *)&kt_ran, (int)cpu);
+    uint64_t pid = thread ? thread->pid : 0;
+    if (!thread || !wait_flag(&kt_ran) || kt_cpu != cpu || !kt_in_kthread) {
+        result = false;
+    }
+    uint64_t deadline = timer_now_ns() + 100000000ULL;
+    bool gone = false;
+    while (!gone && timer_now_ns() < deadline) {
+        rcu_read_lock();
+        gone = process_find(pid) == NULL;
+        rcu_read_unlock();
+        sched_yield();
+    }
+    if (!gone) {
+        result = false;
+    }
+
+    // Work queue: việc chạy trong worker; flush chờ mọi việc đã đưa vào
+    if (!system_wq) {
+        result = false;
+    } else {
+        work_t works[4];
+        wq_count = 0;
+        for (int i = 0; i < 4; i++) {
+            work_init(&works[i], wq_count_func);
+        }
+        // Việc đang chờ chạy không được đưa vào lần nữa (tắt chiếm quyền để worker chưa kịp chạy)
+        preempt_disable();
+        if (!queue_work_on(system_wq, 0, &works[0]) || queue_work_on(system_wq, 0, &works[0])) {
+            result = false;
+        }
+        preempt_enable();
+        for (int i = 1; i < 4; i++) {
+            queue_work_on(system_wq, i % 2 ? cpu : 0, &works[i]);
+        }
+        flush_workqueue(system_wq);
+        if (wq_count != 4) {
+            result = false;
+        }
+
+        // Delayed work chạy sau ít nhất độ trễ đã hẹn
+        delayed_work_t dw;
+        delayed_work_init(&dw, wq_delayed_func);
+        wq_delayed_at = 0;
+        uint64_t queued_at = timer_now_ns();
+        queue_delayed_work(system_wq, &dw, 20000000ULL);
+        deadline = queued_at + 500000000ULL;
+        while (!wq_delayed_at && timer_now_ns() < deadline) {
+            sched_yield();
+        }
+        if (!wq_delayed_at || wq_delayed_at - queued_at < 20000000ULL) {
+            result = false;
+        }
+    }
+
+    // Tasklet lên lịch từ tiến trình chạy trong softirq (qua ksoftirqd)
+    tasklet_t tasklet;
+    tasklet_init(&tasklet, tasklet_func, (void *)&tasklet_ran);
+    tasklet_ran = false;
+    if (!tasklet_schedule(&tasklet) || !wait_flag(&tasklet_ran) || !tasklet_in_softirq) {
+        result = false;
+    }
+
+    __asm__ volatile("cli");
+    sched_test_end(saved_current);
+    test_print_result("Kernel Threads and Work Queue Test", result);
+}
+
+// Mã user của luồng thử: set_fs_base(arg) qua lệnh syscall; *(fs:8) = *(fs:0); exit(0) qua int 0x80
+static const uint8_t thread_test_code[] = {
+    0xB8, 0x16, 0x00, 0x00, 0x00,                         // mov $SYSCALL_SET_FS_BASE, %eax
+    0x0F, 0x05,                                           // syscall (rdi = arg)
+    0x64, 0x48, 0x8B, 0x04, 0x25, 0x00, 0x00, 0x00, 0x00, // mov %fs:0, %rax
+    0x64, 0x48, 0x89, 0x04, 0x25, 0x08, 0x00, 0x00, 0x00, // mov %rax, %fs:8
+    0xB8, 0x08, 0x00, 0x00, 0x00,                         // mov $SYSCALL_EXIT, %eax
+    0x31, 0xFF,                                           // xor %edi, %edi
+    0xCD, 0x80,                                           // int $0x80
+    0xEB, 0xFE,                                           // jmp .
+};
+
+// Kiểm thử luồng: hai luồng dùng chung một không gian địa chỉ nhưng có FS base riêng
+void test_threads() {
+    bool result = true;
+    uint64_t code_virt = 0x400000;
+    uint64_t data_virt = 0x600000;
+
+    address_space_t *as = address_space_create();
+    uint64_t code = allocate_physical_block();
+    uint64_t data = allocate_physical_block();
+    if (!as || !code || !data ||
+        !map_memory(as->page_table, code_virt, code, PAGE_SIZE, PAGING_PAGE_PRESENT | PAGING_PAGE_USER) ||
+        !map_memory(as->page_table, data_virt, data, PAGE_SIZE, PAGING_PAGE_PRESENT | PAGING_PAGE_RW | PAGING_PAGE_USER)) {
+        test_print_result("Thread Test", false);
+        return;
+    }
+    memcpy(PHYS_TO_VIRT(code), thread_test_code, sizeof(thread_test_code));
+    // Vùng TLS của luồng i ở data_virt + 0x100 * i: ô 0 là giá trị riêng, luồng chép nó sang ô 1
+    volatile uint64_t *tls = (volatile uint64_t *)PHYS_TO_VIRT(data);
+    memset((void *)tls, 0, PAGE_SIZE);
+    tls[0] = 0x1111;
+    tls[0x20] = 0x2222;
+
+    // Tiến trình cha giả chỉ cần không gian địa chỉ và các thuộc tính được kế thừa
+    static process_t parent;
+    memset(&parent, 0, sizeof(parent));
+    parent.pid = parent.tgid = process_alloc_pid();
+    parent.mm = as;
+    parent.pkru = PKRU_DEFAULT;
+    parent.cpus_allowed = UINT64_MAX;
+
+    // Tham số không hợp lệ bị từ chối
+    if (thread_create(&parent, 0, data_virt + 0x800, 0) ||
+        thread_create(&parent, USER_SPACE_END, data_virt + 0x800, 0)) {
+        result = false;
+    }
+
+    process_t *saved_current = sched_test_begin();
+    __asm__ volatile("sti");
+
+    uint64_t pids[2] = {0, 0};
+    for (int i = 0; i < 2; i++) {
+        // Giữ RCU để luồng không bị giải phóng trước khi kiểm tra xong
+        rcu_read_lock();
+        process_t *thread = thread_create(&parent, code_virt, data_virt + 0x800 + 0x400 * i, data_virt + 0x100 * i);
+        if (!thread || thread->tgid != parent.tgid || thread->mm != as || thread->page_table != as->page_table ||
+            thread->pid == parent.pid) {
+            result = false;
+        } else {
+            pids[i] = thread->pid;
+        }
+        rcu_read_unlock();
+    }
+
+    // Mỗi luồng đọc ô 0 qua FS của chính nó, ghi vào trang dùng chung và thoát
+    uint64_t deadline = timer_now_ns() + 200000000ULL;
+    bool gone = false;
+    while (!gone && timer_now_ns() < deadline) {
+        gone = true;
+        rcu_read_lock();
+        for (int i = 0; i < 2; i++) {
+            if (pids[i] && process_find(pids[i])) {
+                gone = false;
+            }
+        }
+        rcu_read_unlock();
+        sched_yield();
+    }
+    if (!gone || tls[1] != 0x1111 || tls[0x21] != 0x2222) {
+        result = false;
+    }
+
+    // Địa chỉ kernel không được làm FS base
+    if (process_set_fs_base(USER_SPACE_END) == 0) {
+        result = false;
+    }
+
+    // CPU idle có thể vẫn giữ page table của các luồng đã thoát: shootdown phải trả về
+    address_space_flush_tlb(as, data_virt, PAGE_SIZE);
+
+    __asm__ volatile("cli");
+    sched_test_end(saved_current);
+    // Tham chiếu cuối (của tiến trình cha) giải phóng trang đã ánh xạ sau grace period
+    address_space_put(as);
+    test_print_result("Thread Test", result);
+}
+
+// Luồng kernel chờ trên futex của không gian địa chỉ thử
+typedef struct {
+    address_space_t *mm;
+    uint64_t uaddr;
+    uint64_t timeout_ns;
+    int result;
+    uint64_t elapsed_ns;
+    volatile bool done;
+} futex_test_waiter_t;
+
+static void futex_test_body(void *arg) {
+    futex_test_waiter_t *waiter = arg;
+    uint64_t start = timer_now_ns();
+    waiter->result = futex_wait(waiter->mm, waiter->uaddr, 0, waiter->timeout_ns);
+    waiter->elapsed_ns = timer_now_ns() - start;
+    __atomic_store_n(&waiter->done, true, __ATOMIC_RELEASE);
+}
+
+// Chờ tới khi luồng đã nằm trong hàng đợi futex (BLOCKED chỉ được đặt sau khi vào hàng đợi)
+static bool futex_test_wait_blocked(process_t *thread) {
+    uint64_t deadline = timer_now_ns() + 500000000ULL;
+    while (thread->state != PROCESS_STATE_BLOCKED && timer_now_ns() < deadline) {
+        sched_yield();
+    }
+    return thread->state == PROCESS_STATE_BLOCKED;
+}
+
+// Kiểm thử futex: so sánh giá trị, đánh thức qua ánh xạ khác của cùng trang, hết giờ và requeue
+void test_futex() {
+    bool result = true;
+    uint64_t virt = 0x600000;
+    uint64_t alias = 0x700000;
+
+    address_space_t *as = address_space_create();
+    uint64_t page = allocate_physical_block();
+    if (!as || !page ||
+        !map_memory(as->page_table, virt, page, PAGE_SIZE, PAGING_PAGE_PRESENT | PAGING_PAGE_RW | PAGING_PAGE_USER) ||
+        !map_memory(as->page_table, alias, page, PAGE_SIZE, PAGING_PAGE_PRESENT | PAGING_PAGE_RW | PAGING_PAGE_USER)) {
+        test_print_result("Futex Test", false);
+        return;
+    }
+    volatile uint32_t *words = (volatile uint32_t *)PHYS_TO_VIRT(page);
+    memset((void *)words, 0, PAGE_SIZE);
+
+    uint32_t cpu = cpu_count > 1 && cpus[1].online ? 1 : 0;
+    process_t *saved_current = sched_test_begin();
+
+    // Giá trị khác, địa chỉ lệch hoặc chưa ánh xạ: trả về ngay với mã lỗi riêng
+    words[0] = 1;
+    if (futex_wait(as, virt, 0, 0) != -EAGAIN || futex_wait(as, virt, 0, 1000000ULL) != -EAGAIN ||
+        futex_wait(as, virt + 2, 1, 0) != -EINVAL || futex_wait(NULL, virt, 1, 0) != -EINVAL ||
+        futex_wait(as, 0x800000, 0, 0) != -EFAULT || futex_wake(as, 0x800000, 1) != -EFAULT ||
+        futex_wake(as, virt + 2, 1) != -EINVAL || futex_requeue(as, virt, 0x800000, 1, 1) != -EFAULT ||
+        futex_requeue(as, virt + 2, virt, 1, 1) != -EINVAL) {
+        result = false;
+    }
+    words[0] = 0;
+
+    __asm__ volatile("sti");
+
+    // Đánh thức qua địa chỉ ảo khác của cùng trang vật lý
+    futex_test_waiter_t waiters[2];
+    memset(waiters, 0, sizeof(waiters));
+    waiters[0].mm = as;
+    waiters[0].uaddr = virt;
+    process_t *thread = kthread_create(futex_test_body, &waiters[0], (int)cpu);
+    if (!thread || !futex_test_wait_blocked(thread) || futex_wake(as, alias, 1) != 1 ||
+        !wait_flag(&waiters[0].done) || waiters[0].result != 0) {
+        result = false;
+    }
+
+    // Không ai đánh thức: hết giờ sau ít nhất timeout
+    memset(waiters, 0, sizeof(waiters));
+    waiters[0].mm = as;
+    waiters[0].uaddr = virt;
+    waiters[0].timeout_ns = 20000000ULL;
+    if (!kthread_create(futex_test_body, &waiters[0], (int)cpu) || !wait_flag(&waiters[0].done) ||
+        waiters[0].result != -ETIMEDOUT || waiters[0].elapsed_ns < 20000000ULL) {
+        result = false;
+    }
+
+    // Requeue: một luồng được đánh thức, luồng kia chuyển sang futex thứ hai mà vẫn ngủ
+    memset(waiters, 0, sizeof(waiters));
+    for (int i = 0; i < 2; i++) {
+        waiters[i].mm = as;
+        waiters[i].uaddr = virt;
+        thread = kthread_create(futex_test_body, &waiters[i], (int)cpu);
+        if (!thread || !futex_test_wait_blocked(thread)) {
+            result = false;
+        }
+    }
+    if (futex_requeue(as, virt, virt + 4, 1, 1) != 2 || futex_wake(as, virt, 1) != 0) {
+        result = false;
+    }
+    uint64_t deadline = timer_now_ns() + 20000000ULL;
+    while (timer_now_ns() < deadline) {
+        sched_yield();
+    }
+    if (waiters[0].done + waiters[1].done != 1) {
+        result = false;
+    }
+    if (futex_wake(as, virt + 4, 2) != 1 || !wait_flag(&waiters[0].done) || !wait_flag(&waiters[1].done) ||
+        waiters[0].result != 0 || waiters[1].result != 0) {
+        result = false;
+    }
+
+    __asm__ volatile("cli");
+    sched_test_end(saved_current);
+    address_space_put(as);
+    test_print_result("Futex Test", result);
+}
+
+/**
+ * Runs @p code as a user thread in a fresh address space and waits for it
+ * to exit.
+ *
+ * The code is mapped read-only at 0x400000 and a zeroed data page at
+ * 0x600000; the thread starts with rdi pointing at the data page and its
+ * stack at the end of that page. The first @p words words of the data page
+ * are copied to @p out before the address space is released. Must be called
+ * inside a sched_test_begin/sched_test_end window with interrupts enabled.
+ *
+ * @return false if setup failed or the thread did not exit within 500 ms.
+ */
+static bool test_run_user(const uint8_t *code, size_t len, uint64_t *out, size_t words) {
+    uint64_t code_virt = 0x400000;
+    uint64_t data_virt = 0x600000;
+    address_space_t *as = address_space_create();
+    uint64_t code_page = allocate_physical_block();
+    uint64_t data_page = allocate_physical_block();
+    if (!as || !code_page || !data_page || len > PAGE_SIZE ||
+        !map_memory(as->page_table, code_virt, code_page, PAGE_SIZE, PAGING_PAGE_PRESENT | PAGING_PAGE_USER) ||
+        !map_memory(as->page_table, data_virt, data_page, PAGE_SIZE, PAGING_PAGE_PRESENT | PAGING_PAGE_RW | PAGING_PAGE_USER)) {
+        return false;
+    }
+    memcpy(PHYS_TO_VIRT(code_page), code, len);
+    memset(PHYS_TO_VIRT(data_page), 0, PAGE_SIZE);
+    // Như tiến trình nạp từ ELF: heap bắt đầu sau trang dữ liệu
+    heap_init(as, data_virt + PAGE_SIZE);
+
+    static process_t parent;
+    memset(&parent, 0, sizeof(parent));
+    parent.pid = parent.tgid = process_alloc_pid();
+    if (!vdso_map(as, parent.tgid)) {
+        return false;
+    }
+    parent.mm = as;
+    parent.pkru = PKRU_DEFAULT;
+    parent.cpus_allowed = UINT64_MAX;
+    process_t *thread = thread_create(&parent, code_virt, data_virt + PAGE_SIZE, data_virt);
+    uint64_t pid = thread ? thread->pid : 0;
+
+    bool gone = false;
+    uint64_t deadline = timer_now_ns() + 500000000ULL;
+    while (pid && !gone && timer_now_ns() < deadline) {
+        rcu_read_lock();
+        gone = process_find(pid) == NULL;
+        rcu_read_unlock();
+        sched_yield();
+    }
+    memcpy(out, PHYS_TO_VIRT(data_page), words * sizeof(uint64_t));
+    address_space_put(as);
+    return gone;
+}
+
+// Mã user: gettid(); data[0x40] = getstats(SYSCALL_GETTID, data); exit(0), mọi syscall qua lệnh syscall
+static const uint8_t syscall_stats_code[] = {
+    0x48, 0x89, 0xFB,                         // mov %rdi, %rbx
+    0xB8, 0x15, 0x00, 0x00, 0x00,             // mov $SYSCALL_GETTID, %eax
+    0x0F, 0x05,                               // syscall
+    0xB8, 0x1A, 0x00, 0x00, 0x00,             // mov $SYSCALL_GETSTATS, %eax
+    0xBF, 0x15, 0x00, 0x00, 0x00,             // mov $SYSCALL_GETTID, %edi
+    0x48, 0x89, 0xDE,                         // mov %rbx, %rsi
+    0x0F, 0x05,                               // syscall
+    0x48, 0x89, 0x83, 0x00, 0x02, 0x00, 0x00, // mov %rax, 0x200(%rbx)
+    0xB8, 0x08, 0x00, 0x00, 0x00,             // mov $SYSCALL_EXIT, %eax
+    0x31, 0xFF,                               // xor %edi, %edi
+    0x0F, 0x05,                               // syscall
+    0xEB, 0xFE,                               // jmp .
+};
+
+// Kiểm thử bảng syscall: số ngoài bảng bị từ chối, thống kê đọc được từ user space và khớp histogram
+void test_syscall_table() {
+    bool result = true;
+    if (syscall_handler_c(SYSCALL_MAX, 0, 0, 0, 0, 0, 0) != -1) {
+        result = false;
+    }
+    // Bộ đệm thống kê phải nằm trong không gian user
+    syscall_stats_t kernel_buf;
+    if (syscall_handler_c(SYSCALL_GETSTATS, SYSCALL_GETTID, (uint64_t)&kernel_buf, 0, 0, 0, 0) != -1) {
+        result = false;
+    }
+    // Hàm trả về int: -1 phải tới caller đủ 64 bit, và tham số int chỉ lấy phần thấp của thanh ghi
+    if (syscall_handler_c(SYSCALL_PKEY_FREE, 0xFFFFFFFF00000000ULL, 0, 0, 0, 0, 0) != -1) {
+        result = false;
+    }
+
+    process_t *saved_current = sched_test_begin();
+    __asm__ volatile("sti");
+    uint64_t data[0x41];
+    if (!test_run_user(syscall_stats_code, sizeof(syscall_stats_code), data, 0x41)) {
+        result = false;
+    } else {
+        syscall_stats_t *stats = (syscall_stats_t *)data;
+        uint64_t sum = 0;
+        for (int i = 0; i < SYSCALL_HIST_BUCKETS; i++) {
+            sum += stats->hist[i];
+        }
+        if (data[0x40] != 0 || stats->count < 1 || sum != stats->count) {
+            result = false;
+        }
+    }
+    __asm__ volatile("cli");
+    sched_test_end(saved_current);
+    test_print_result("Syscall Table Test", result);
+}
+
+// Mã user: data[0] = write(1, 0x500000, 8), data[1] = getstats(SYSCALL_GETTID, 0x500000),
+// data[2] = sched_getdlstats(0x500000), data[3] = sched_getdlstats(data + 0x20); exit(0).
+// 0x500000 không được ánh xạ
+static const uint8_t usercopy_code[] = {
+    0x48, 0x89, 0xFB,                         // mov %rdi, %rbx
+    0xB8, 0x01, 0x00, 0x00, 0x00,             // mov $SYSCALL_WRITE, %eax
+    0xBF, 0x01, 0x00, 0x00, 0x00,             // mov $1, %edi
+    0xBE, 0x00, 0x00, 0x50, 0x00,             // mov $0x500000, %esi
+    0xBA, 0x08, 0x00, 0x00, 0x00,             // mov $8, %edx
+    0x0F, 0x05,                               // syscall
+    0x48, 0x89, 0x03,                         // mov %rax, (%rbx)
+    0xB8, 0x1A, 0x00, 0x00, 0x00,             // mov $SYSCALL_GETSTATS, %eax
+    0xBF, 0x15, 0x00, 0x00, 0x00,             // mov $SYSCALL_GETTID, %edi
+    0xBE, 0x00, 0x00, 0x50, 0x00,             // mov $0x500000, %esi
+    0x0F, 0x05,                               // syscall
+    0x48, 0x89, 0x43, 0x08,                   // mov %rax, 8(%rbx)
+    0xB8, 0x13, 0x00, 0x00, 0x00,             // mov $SYSCALL_SCHED_GETDLSTATS, %eax
+    0xBF, 0x00, 0x00, 0x50, 0x00,             // mov $0x500000, %edi
+    0x0F, 0x05,                               // syscall
+    0x48, 0x89, 0x43, 0x10,                   // mov %rax, 16(%rbx)
+    0xB8, 0x13, 0x00, 0x00, 0x00,             // mov $SYSCALL_SCHED_GETDLSTATS, %eax
+    0x48, 0x8D, 0x7B, 0x20,                   // lea 0x20(%rbx), %rdi
+    0x0F, 0x05,                               // syscall
+    0x48, 0x89, 0x43, 0x18,                   // mov %rax, 24(%rbx)
+    0xB8, 0x08, 0x00, 0x00, 0x00,             // mov $SYSCALL_EXIT, %eax
+    0x31, 0xFF,                               // xor %edi, %edi
+    0x0F, 0x05,                               // syscall
+    0xEB, 0xFE,                               // jmp .
+};
+
+// Kiểm thử chép bộ nhớ user: địa chỉ ngoài nửa user bị từ chối, lỗi trang trong lúc chép
+// thành -1 của syscall thay vì dừng máy, địa chỉ hợp lệ vẫn chép được
+void test_usercopy() {
+    bool result = true;
+    char buf[16];
+    if (access_ok(USER_SPACE_END - 8, 16) || !access_ok(USER_SPACE_END - 8, 8) || access_ok(UINT64_MAX, 1)) {
+        result = false;
+    }
+    if (copy_from_user(buf, buf, sizeof(buf)) != -EFAULT || copy_to_user(buf, buf, sizeof(buf)) != -EFAULT ||
+        strncpy_from_user(buf, (const char *)USER_SPACE_END, sizeof(buf)) != -EFAULT) {
+        result = false;
+    }
+
+    process_t *saved_current = sched_test_begin();
+    __asm__ volatile("sti");
+    uint64_t data[4];
+    if (!test_run_user(usercopy_code, sizeof(usercopy_code), data, 4)) {
+        result = false;
+    } else if (data[0] != (uint64_t)-1 || data[1] != (uint64_t)-1 || data[2] != (uint64_t)-1 || data[3] != 0) {
+        result = false;
+    }
+    __asm__ volatile("cli");
+    sched_test_end(saved_current);
+    test_print_result("User Copy Test", result);
+}
+
+// Mã user: đọc địa chỉ 0 (chưa ánh xạ). Lỗi trang phải kết thúc luồng chứ không dừng máy
+static const uint8_t user_fault_code[] = {
+    0x48, 0x8B, 0x04, 0x25, 0x00, 0x00, 0x00, 0x00, // mov 0x0, %rax
+    0xEB, 0xFE,                                     // jmp .
+};
+
+// Luồng kernel mượn không gian địa chỉ thử để dùng protection key như một luồng của tiến trình
+typedef struct {
+    address_space_t *mm;
+    uint32_t cpu;
+    bool ok;
+    volatile bool done;
+} pkey_test_t;
+
+static volatile bool pkey_other_ran;
+
+static void pkey_other_body(void *arg) {
+    (void)arg;
+    wrpkru(PKRU_DEFAULT);
+    pkey_other_ran = true;
+}
+
+// Nhường CPU cho một luồng khác trên cùng CPU, luồng này nạp PKRU mặc định;
+// true nếu PKRU của luồng gọi vẫn còn nguyên khi nó được chạy lại
+static bool pkey_test_switch(uint32_t cpu) {
+    uint32_t pkru = rdpkru();
+    pkey_other_ran = false;
+    if (!kthread_create(pkey_other_body, NULL, (int)cpu) || !wait_flag(&pkey_other_ran)) {
+        return false;
+    }
+    return rdpkru() == pkru;
+}
+
+static void pkey_test_body(void *arg) {
+    pkey_test_t *t = arg;
+    process_t *self = process_current();
+    const void *page = (const void *)0x600000;
+    uint64_t value = 0;
+    kthread_use_mm(t->mm);
+
+    // Trang gắn key mới, quyền đầy đủ: đọc được, kể cả sau khi luồng khác chạy với key bị cấm
+    int pkey = pkey_alloc(self, 0, 0);
+    bool ok = pkey > 0 && pkey_mprotect(self, 0x600000, PAGE_SIZE, pkey) == 0 &&
+              copy_from_user(&value, page, sizeof(value)) == 0 && value == 0x1234;
+    ok = ok && pkey_test_switch(t->cpu) && copy_from_user(&value, page, sizeof(value)) == 0;
+
+    // Cấm key bằng WRPKRU: bản sao của kernel cũng bị chặn, và quyền bị cấm cũng sống qua chuyển ngữ cảnh
+    wrpkru(rdpkru() | PKEY_DISABLE_ACCESS << (pkey * 2));
+    ok = ok && copy_from_user(&value, page, sizeof(value)) == -EFAULT &&
+         copy_to_user((void *)page, &value, sizeof(value)) == -EFAULT;
+    ok = ok && pkey_test_switch(t->cpu) && copy_from_user(&value, page, sizeof(value)) == -EFAULT;
+
+    // Chỉ ghi bị cấm: đọc được, ghi thì không
+    wrpkru((rdpkru() & ~(0x3u << (pkey * 2))) | PKEY_DISABLE_WRITE << (pkey * 2));
+    ok = ok && copy_from_user(&value, page, sizeof(value)) == 0 &&
+         copy_to_user((void *)page, &value, sizeof(value)) == -EFAULT;
+
+    ok = ok && pkey_mprotect(self, 0x600000, PAGE_SIZE, 0) == 0 && pkey_free(self, pkey) == 0;
+    t->ok = ok;
+    __atomic_store_n(&t->done, true, __ATOMIC_RELEASE);
+}
+
+// Kiểm thử thực thi protection key (cần -cpu ...,+pku): pkey_alloc/pkey_mprotect, PKRU chặn
+// copy_from_user/copy_to_user, PKRU được lưu và nạp lại qua chuyển ngữ cảnh, và lỗi trang
+// từ user mode chỉ kết thúc luồng gây lỗi
+void test_pkey_enforcement() {
+    bool result = true;
+    process_t *saved_current = sched_test_begin();
+    __asm__ volatile("sti");
+
+    uint64_t data[1];
+    if (!test_run_user(user_fault_code, sizeof(user_fault_code), data, 1)) {
+        result = false;
+    }
+
+    if (!pku_supported) {
+        kprintf("PKU not supported: key enforcement not tested\n");
+    } else {
+        uint32_t cpu = cpu_count > 1 && cpus[1].online ? 1 : 0;
+        address_space_t *as = address_space_create();
+        uint64_t page = allocate_physical_block();
+        if (!as || !page ||
+            !map_memory(as->page_table, 0x600000, page, PAGE_SIZE, PAGING_PAGE_PRESENT | PAGING_PAGE_RW | PAGING_PAGE_USER)) {
+            result = false;
+        } else {
+            memset(PHYS_TO_VIRT(page), 0, PAGE_SIZE);
+            *(uint64_t *)PHYS_TO_VIRT(page) = 0x1234;
+            pkey_test_t t = {.mm = as, .cpu = cpu};
+            if (!kthread_create(pkey_test_body, &t, (int)cpu) || !wait_flag(&t.done) || !t.ok) {
+                result = false;
+            }
+        }
+        if (as) {
+            address_space_put(as);
+        }
+    }
+
+    __asm__ volatile("cli");
+    sched_test_end(saved_current);
+    test_print_result("PKey Enforcement Test", result);
+}
+
+// Mã user: data[0] = sbrk(0x10000), ghi vào 8 byte cuối vùng mới, data[1] = sbrk(0),
+// data[2] = brk(data[0]); exit(0)
+static const uint8_t heap_code[] = {
+    0x48, 0x89, 0xFB,                         // mov %rdi, %rbx
+    0xB8, 0x07, 0x00, 0x00, 0x00,             // mov $SYSCALL_SBRK, %eax
+    0xBF, 0x00, 0x00, 0x01, 0x00,             // mov $0x10000, %edi
+    0x0F, 0x05,                               // syscall
+    0x48, 0x89, 0x03,                         // mov %rax, (%rbx)
+    0x48, 0xC7, 0x80, 0xF8, 0xFF, 0x00, 0x00, // movq $1, 0xFFF8(%rax)
+    0x01, 0x00, 0x00, 0x00,
+    0xB8, 0x07, 0x00, 0x00, 0x00,             // mov $SYSCALL_SBRK, %eax
+    0x31, 0xFF,                               // xor %edi, %edi
+    0x0F, 0x05,                               // syscall
+    0x48, 0x89, 0x43, 0x08,                   // mov %rax, 8(%rbx)
+    0xB8, 0x1D, 0x00, 0x00, 0x00,             // mov $SYSCALL_BRK, %eax
+    0x48, 0x8B, 0x3B,                         // mov (%rbx), %rdi
+    0x0F, 0x05,                               // syscall
+    0x48, 0x89, 0x43, 0x10,                   // mov %rax, 16(%rbx)
+    0xB8, 0x08, 0x00, 0x00, 0x00,             // mov $SYSCALL_EXIT, %eax
+    0x31, 0xFF,                               // xor %edi, %edi
+    0x0F, 0x05,                               // syscall
+    0xEB, 0xFE,                               // jmp .
+};
+
+// Kiểm thử heap: sbrk ánh xạ sẵn theo khối, vượt mốc 2 MiB thì dùng trang lớn (nếu còn vùng
+// trống căn chỉnh), thu nhỏ thì gỡ ánh xạ, break ngoài giới hạn bị từ chối; rồi qua syscall
+void test_heap() {
+    bool result = true;
+    address_space_t *as = address_space_create();
+    if (!as) {
+        test_print_result("Heap Test", false);
+        return;
+    }
+    heap_init(as, 0x600123);
+    uint64_t start = 0x601000;
+    if (heap_sbrk(as, 100) != (int64_t)start || as->brk_mapped != start + HEAP_CHUNK_SIZE ||
+        paging_page_size(as->page_table, start + HEAP_CHUNK_SIZE - 1) != PAGE_SIZE ||
+        paging_page_size(as->page_table, start + HEAP_CHUNK_SIZE) != 0) {
+        result = false;
+    }
+    // 3 MiB: vượt mốc 0x800000, phần từ mốc trở đi là một trang 2 MiB
+    if (heap_sbrk(as, 3 * 1024 * 1024) != (int64_t)(start + 100) || as->brk_mapped != 0xA00000) {
+        result = false;
+    }
+    uint64_t large = paging_page_size(as->page_table, 0x800000);
+    uint64_t phys = paging_user_phys(as->page_table, 0x9FFFF8);
+    if ((HEAP_LARGE_PAGES && large != LARGE_PAGE_SIZE && large != PAGE_SIZE) || !phys ||
+        *(uint64_t *)PHYS_TO_VIRT(phys) != 0) {
+        result = false;
+    }
+    if (heap_sbrk(as, -(3 * 1024 * 1024 + 100)) != (int64_t)(start + 3 * 1024 * 1024 + 100) ||
+        as->brk != start || as->brk_mapped != start || paging_page_size(as->page_table, start) != 0 ||
+        paging_page_size(as->page_table, 0x800000) != 0) {
+        result = false;
+    }
+    if (heap_sbrk(as, -1) != -1 || heap_sbrk(as, (int64_t)HEAP_MAX_SIZE + 1) != -1 || heap_brk(as, 0) != start) {
+        result = false;
+    }
+    address_space_put(as);
+
+    process_t *saved_current = sched_test_begin();
+    __asm__ volatile("sti");
+    uint64_t data[3];
+    if (!test_run_user(heap_code, sizeof(heap_code), data, 3)) {
+        result = false;
+    } else if (data[0] != 0x601000 || data[1] != 0x611000 || data[2] != 0x601000) {
+        result = false;
+    }
+    __asm__ volatile("cli");
+    sched_test_end(saved_current);
+    test_print_result("Heap Test", result);
+}
+
+// Mã user: data[0] = sbrk(0x1000) rồi ghi 0x1234 vào trang đó; data[1] = page_send(gettid(),
+// trang đó) cho chính mình; data[2] = page_recv(data + 4, NONBLOCK), data[3] = giá trị đọc qua
+// địa chỉ nhận được; data[7] = shm_map("t", 0x1000); exit(0)
+static const uint8_t shm_code[] = {
+    0x48, 0x89, 0xFB,                         // mov %rdi, %rbx
+    0xB8, 0x07, 0x00, 0x00, 0x00,             // mov $SYSCALL_SBRK, %eax
+    0xBF, 0x00, 0x10, 0x00, 0x00,             // mov $0x1000, %edi
+    0x0F, 0x05,                               // syscall
+    0x48, 0x89, 0x03,                         // mov %rax, (%rbx)
+    0x48, 0xC7, 0x00, 0x34, 0x12, 0x00, 0x00, // movq $0x1234, (%rax)
+    0xB8, 0x15, 0x00, 0x00, 0x00,             // mov $SYSCALL_GETTID, %eax
+    0x0F, 0x05,                               // syscall
+    0x48, 0x89, 0xC7,                         // mov %rax, %rdi
+    0xB8, 0x21, 0x00, 0x00, 0x00,             // mov $SYSCALL_PAGE_SEND, %eax
+    0x48, 0x8B, 0x33,                         // mov (%rbx), %rsi
+    0xBA, 0x00, 0x10, 0x00, 0x00,             // mov $0x1000, %edx
+    0x0F, 0x05,                               // syscall
+    0x48, 0x89, 0x43, 0x08,                   // mov %rax, 8(%rbx)
+    0xB8, 0x22, 0x00, 0x00, 0x00,             // mov $SYSCALL_PAGE_RECV, %eax
+    0x48, 0x8D, 0x7B, 0x20,                   // lea 0x20(%rbx), %rdi
+    0xBE, 0x01, 0x00, 0x00, 0x00,             // mov $PAGE_RECV_NONBLOCK, %esi
+    0x0F, 0x05,                               // syscall
+    0x48, 0x89, 0x43, 0x10,                   // mov %rax, 16(%rbx)
+    0x48, 0x85, 0xC0,                         // test %rax, %rax
+    0x75, 0x0B,                               // jnz 1f
+    0x48, 0x8B, 0x43, 0x20,                   // mov 0x20(%rbx), %rax
+    0x48, 0x8B, 0x00,                         // mov (%rax), %rax
+    0x48, 0x89, 0x43, 0x18,                   // mov %rax, 24(%rbx)
+    0x48, 0xC7, 0x43, 0x40, 0x74, 0x00, 0x00, // 1: movq $'t', 0x40(%rbx)
+    0x00,
+    0xB8, 0x1E, 0x00, 0x00, 0x00,             // mov $SYSCALL_SHM_MAP, %eax
+    0x48, 0x8D, 0x7B, 0x40,                   // lea 0x40(%rbx), %rdi
+    0xBE, 0x00, 0x10, 0x00, 0x00,             // mov $0x1000, %esi
+    0x0F, 0x05,                               // syscall
+    0x48, 0x89, 0x43, 0x38,                   // mov %rax, 0x38(%rbx)
+    0xB8, 0x08, 0x00, 0x00, 0x00,             // mov $SYSCALL_EXIT, %eax
+    0x31, 0xFF,                               // xor %edi, %edi
+    0x0F, 0x05,                               // syscall
+    0xEB, 0xFE,                               // jmp .
+};
+
+// Kiểm thử bộ nhớ chia sẻ: hai không gian địa chỉ mở cùng tên thấy cùng frame, đối tượng
+// sống tới khi hết tên và ánh xạ; page_send chuyển chính frame sang người nhận và gỡ khỏi
+// người gửi, từ chối trang chung và trang chưa ánh xạ; rồi qua syscall
+void test_shm() {
+    bool result = true;
+    address_space_t *a = address_space_create();
+    address_space_t *b = address_space_create();
+    uint64_t page = allocate_physical_block();
+    if (!a || !b || !page) {
+        test_print_result("Shared Memory Test", false);
+        return;
+    }
+    a->users = b->users = 1;
+
+    int64_t addr_a = shm_map(a, "test", 3 * PAGE_SIZE);
+    int64_t addr_b = shm_map(b, "test", 0);
+    if (addr_a != (int64_t)SHM_MAP_BASE || addr_b != (int64_t)SHM_MAP_BASE || shm_map(b, "test", 4 * PAGE_SIZE) != -1 ||
+        shm_map(b, "", PAGE_SIZE) != -1) {
+        result = false;
+    }
+    uint64_t phys = paging_user_phys(a->page_table, addr_a + 2 * PAGE_SIZE);
+    if (!phys || phys != paging_user_phys(b->page_table, addr_b + 2 * PAGE_SIZE) || *(uint64_t *)PHYS_TO_VIRT(phys) != 0) {
+        result = false;
+    }
+    if (shm_unlink("test") != 0 || shm_unlink("test") != -1 || shm_map(a, "test", 0) != -1 ||
+        shm_unmap(a, addr_a) != 0 || shm_unmap(a, addr_a) != -1 ||
+        paging_user_phys(a->page_table, addr_a) != 0 || paging_user_phys(b->page_table, addr_b) == 0) {
+        result = false;
+    }
+
+    *(uint64_t *)PHYS_TO_VIRT(page) = 0x5A5A;
+    map_memory(a->page_table, 0x400000, page, PAGE_SIZE, PAGING_PAGE_PRESENT | PAGING_PAGE_RW | PAGING_PAGE_USER);
+    shm_msg_t msg;
+    if (shm_transfer(a, b, 0x400000, 2 * PAGE_SIZE, 7) != -1 || shm_transfer(b, a, addr_b, PAGE_SIZE, 7) != -1 ||
+        shm_page_recv(b, &msg, PAGE_RECV_NONBLOCK) != -1 || paging_user_phys(a->page_table, 0x400000) != page) {
+        result = false;
+    }
+    if (shm_transfer(a, b, 0x400000, PAGE_SIZE, 7) != 0 || paging_user_phys(a->page_table, 0x400000) != 0 ||
+        shm_page_recv(b, &msg, PAGE_RECV_NONBLOCK) != 0 || shm_page_recv(b, &msg, PAGE_RECV_NONBLOCK) == 0) {
+        result = false;
+    } else if (msg.len != PAGE_SIZE || msg.sender != 7 || paging_user_phys(b->page_table, msg.addr) != page) {
+        result = false;
+    }
+    if (shm_unmap(b, msg.addr) != 0 || paging_user_phys(b->page_table, msg.addr) != 0) {
+        result = false;
+    }
+    address_space_put(a);
+    address_space_put(b);
+
+    process_t *saved_current = sched_test_begin();
+    __asm__ volatile("sti");
+    uint64_t data[8];
+    if (!test_run_user(shm_code, sizeof(shm_code), data, 8)) {
+        result = false;
+    } else if (data[0] != 0x601000 || data[1] != 0 || data[2] != 0 || data[3] != 0x1234 ||
+               data[5] != PAGE_SIZE || data[7] != data[4] + PAGE_SIZE || shm_unlink("t") != 0) {
+        result = false;
+    }
+    __asm__ volatile("cli");
+    sched_test_end(saved_current);
+    test_print_result("Shared Memory Test", result);
+}
+// Thông điệp làm luồng server của test_ipc kết thúc mà không trả lời
+#define IPC_TEST_STOP 0xDEADULL
+
+// Server: cộng 1 vào mỗi từ của thông điệp rồi trả lời, tới khi nhận IPC_TEST_STOP
+static void ipc_test_server(void *arg) {
+    (void)arg;
+    uint64_t msg[IPC_MSG_WORDS];
+    int64_t from = ipc_reply_wait(0, msg);
+    while (from > 0 && msg[0] != IPC_TEST_STOP) {
+        for (int i = 0; i < IPC_MSG_WORDS; i++) {
+            msg[i]++;
+        }
+        from = ipc_reply_wait((uint64_t)from, msg);
+    }
+}
+
+// Kiểm thử IPC đồng bộ: thông điệp đi và về nguyên vẹn qua nhiều vòng, call tới luồng không
+// tồn tại và reply cho luồng không phải caller bị từ chối, server kết thúc thì caller nhận -1
+void test_ipc() {
+    bool result = true;
+    process_t *saved_current = sched_test_begin();
+    __asm__ volatile("sti");
+
+    process_t *server = kthread_create(ipc_test_server, NULL, 0);
+    uint64_t pid = server ? server->pid : 0;
+    uint64_t msg[IPC_MSG_WORDS] = {1, 2, 3, 4, 5};
+    // Server có thể chưa tới reply_wait: call đầu tiên xếp hàng chờ nó
+    if (!server || ipc_call(pid, msg) != 0 || msg[0] != 2 || msg[4] != 6) {
+        result = false;
+    }
+    for (uint64_t i = 0; result && i < 100; i++) {
+        msg[0] = i;
+        if (ipc_call(pid, msg) != 0 || msg[0] != i + 1) {
+            result = false;
+        }
+    }
+
+    // Luồng này không có caller nào để trả lời; PID không tồn tại
+    uint64_t bad[IPC_MSG_WORDS] = {0};
+    if (ipc_reply_wait(pid, bad) != -1 || ipc_call(0x7FFFFFFF, bad) != -1) {
+        result = false;
+    }
+
+    // Server trả về mà không trả lời: caller được đánh thức với -1
+    if (server) {
+        msg[0] = IPC_TEST_STOP;
+        if (ipc_call(pid, msg) != -1) {
+            result = false;
+        }
+    }
+
+    __asm__ volatile("cli");
+    sched_test_end(saved_current);
+    test_print_result("IPC Test", result);
+}
+
+
+// Mã user: gọi getpid, clock_ns, coarse_ns, getcpu, clock_ns của vDSO, lưu vào data[0..4],
+// rồi data[5] = getpid qua syscall; exit(0)
+static const uint8_t vdso_code[] = {
+    0x48, 0x89, 0xFB,                                           // mov %rdi, %rbx
+    0x49, 0xBC, 0x00, 0x20, 0xFF, 0xFF, 0xFF, 0x7F, 0x00, 0x00, // movabs $VDSO_CODE_ADDR, %r12
+    0x41, 0xFF, 0xD4,                                           // call *%r12 (getpid)
+    0x48, 0x89, 0x03,                                           // mov %rax, (%rbx)
+    0x49, 0x8D, 0x44, 0x24, 0x08,                               // lea 8(%r12), %rax
+    0xFF, 0xD0,                                                 // call *%rax (clock_ns)
+    0x48, 0x89, 0x43, 0x08,                                     // mov %rax, 8(%rbx)
+    0x49, 0x8D, 0x44, 0x24, 0x10,                               // lea 16(%r12), %rax
+    0xFF, 0xD0,                                                 // call *%rax (coarse_ns)
+    0x48, 0x89, 0x43, 0x10,                                     // mov %rax, 16(%rbx)
+    0x49, 0x8D, 0x44, 0x24, 0x18,                               // lea 24(%r12), %rax
+    0xFF, 0xD0,                                                 // call *%rax (getcpu)
+    0x48, 0x63, 0xC0,                                           // movslq %eax, %rax
+    0x48, 0x89, 0x43, 0x18,                                     // mov %rax, 24(%rbx)
+    0x49, 0x8D, 0x44, 0x24, 0x08,                               // lea 8(%r12), %rax
+    0xFF, 0xD0,                                                 // call *%rax (clock_ns)
+    0x48, 0x89, 0x43, 0x20,                                     // mov %rax, 32(%rbx)
+    0xB8, 0x0A, 0x00, 0x00, 0x00,                               // mov $SYSCALL_GETPID, %eax
+    0x0F, 0x05,                                                 // syscall
+    0x48, 0x89, 0x43, 0x28,                                     // mov %rax, 40(%rbx)
+    0xB8, 0x08, 0x00, 0x00, 0x00,                               // mov $SYSCALL_EXIT, %eax
+    0x31, 0xFF,                                                 // xor %edi, %edi
+    0x0F, 0x05,                                                 // syscall
+    0xEB, 0xFE,                                                 // jmp .
+};
+
+// Kiểm thử vDSO: PID khớp với syscall, đồng hồ nằm giữa hai lần đọc của kernel và không lùi,
+// đồng hồ thô không vượt đồng hồ chính xác, CPU hợp lệ
+void test_vdso() {
+    bool result = true;
+    process_t *saved_current = sched_test_begin();
+    __asm__ volatile("sti");
+    uint64_t data[6];
+    uint64_t before = timer_now_ns();
+    if (!test_run_user(vdso_code, sizeof(vdso_code), data, 6)) {
+        result = false;
+    } else {
+        uint64_t after = timer_now_ns();
+        int64_t cpu = (int64_t)data[3];
+        if (data[0] == 0 || data[0] != data[5] ||
+            data[1] < before || data[1] > data[4] || data[4] > after ||
+            data[2] == 0 || data[2] > data[1] ||
+            cpu < -1 || cpu >= (int64_t)cpu_count) {
+            result = false;
+        }
+    }
+    __asm__ volatile("cli");
+    sched_test_end(saved_current);
+    test_print_result("vDSO Test", result);
+}
+
+// Luồng kernel dùng vòng gửi/nhận như một tiến trình: nó mượn hẳn không gian địa chỉ thử
+typedef struct {
+    address_space_t *mm;
+    uint32_t flags;
+    bool ok;
+    volatile bool done;
+} uring_test_t;
+
+// Công bố SQE tới tail; với SQPOLL thì đánh thức luồng kernel nếu nó đang ngủ
+static void uring_test_submit(uring_shared_t *shared, uint32_t tail, bool sqpoll) {
+    __atomic_store_n(&shared->sq_tail, tail, __ATOMIC_SEQ_CST);
+    if (sqpoll && (__atomic_load_n(&shared->flags, __ATOMIC_SEQ_CST) & URING_SQ_NEED_WAKEUP)) {
+        uring_enter(0, 0, URING_ENTER_SQ_WAKEUP);
+    }
+}
+
+static void uring_test_body(void *arg) {
+    uring_test_t *t = arg;
+    bool sqpoll = t->flags & URING_SETUP_SQPOLL;
+    kthread_use_mm(t->mm);
+    bool ok = uring_setup(4, t->flags) == (int64_t)URING_ADDR && uring_setup(4, 0) == -1;
+    uring_shared_t *shared = (uring_shared_t *)URING_ADDR;
+    uring_sqe_t *sqes = (uring_sqe_t *)(URING_ADDR + shared->sqes_offset);
+    uring_cqe_t *cqes = (uring_cqe_t *)(URING_ADDR + shared->cqes_offset);
+
+    // Hết giờ gửi trước nhưng hoàn thành sau cùng; thao tác lạ báo -1
+    sqes[0] = (uring_sqe_t){.opcode = URING_OP_TIMEOUT, .len = 10000000ULL, .user_data = 1};
+    sqes[1] = (uring_sqe_t){.opcode = URING_OP_NOP, .user_data = 2};
+    sqes[2] = (uring_sqe_t){.opcode = URING_OP_FUTEX_WAKE, .addr = 0x600000, .len = 1, .user_data = 3};
+    sqes[3] = (uring_sqe_t){.opcode = 0xFF, .user_data = 4};
+    uint64_t start = timer_now_ns();
+    uring_test_submit(shared, 4, sqpoll);
+    ok = ok && uring_enter(4, 4, 0) == (sqpoll ? 0 : 4);
+    uint64_t elapsed = timer_now_ns() - start;
+    static const int64_t expected[4][2] = {{2, 0}, {3, 0}, {4, -1}, {1, 0}};
+    for (int i = 0; ok && i < 4; i++) {
+        ok = cqes[i].user_data == (uint64_t)expected[i][0] && cqes[i].res == expected[i][1];
+    }
+    ok = ok && shared->sq_head == 4 && shared->cq_tail == 4 && shared->cq_overflow == 0 && elapsed >= 10000000ULL;
+    // Hẹn giờ đã hoàn thành trả lại chỗ của nó trong giới hạn URING_MAX_TIMEOUTS
+    ok = ok && t->mm->uring->timeouts == 0;
+    shared->cq_head = 4;
+
+    // Luồng SQPOLL ngủ khi rảnh và thức dậy nhờ URING_ENTER_SQ_WAKEUP
+    if (sqpoll) {
+        uint64_t deadline = timer_now_ns() + 100000000ULL;
+        while (!(shared->flags & URING_SQ_NEED_WAKEUP) && timer_now_ns() < deadline) {
+            sched_yield();
+        }
+        ok = ok && (shared->flags & URING_SQ_NEED_WAKEUP);
+        sqes[0] = (uring_sqe_t){.opcode = URING_OP_NOP, .user_data = 5};
+        uring_test_submit(shared, 5, sqpoll);
+        ok = ok && uring_enter(0, 1, 0) == 0 && shared->cq_tail == 5 && cqes[4].user_data == 5;
+    }
+
+    t->ok = ok;
+    // Luồng kernel không được tính là luồng user: tự gỡ vòng như luồng user cuối cùng khi thoát
+    uring_release(t->mm);
+    __atomic_store_n(&t->done, true, __ATOMIC_RELEASE);
+}
+
+// Kiểm thử vòng gửi/nhận: gửi cả loạt bằng một lần enter, thứ tự và kết quả CQE, hết giờ,
+// và chế độ SQPOLL (gửi không cần syscall, ngủ và được đánh thức)
+void test_uring() {
+    bool result = true;
+    process_t *saved_current = sched_test_begin();
+    __asm__ volatile("sti");
+    for (int i = 0; i < 2; i++) {
+        address_space_t *as = address_space_create();
+        uint64_t page = allocate_physical_block();
+        if (!as || !page ||
+            !map_memory(as->page_table, 0x600000, page, PAGE_SIZE, PAGING_PAGE_PRESENT | PAGING_PAGE_RW | PAGING_PAGE_USER)) {
+            result = false;
+            break;
+        }
+        uring_test_t t = {.mm = as, .flags = i ? URING_SETUP_SQPOLL : 0};
+        if (!kthread_create(uring_test_body, &t, -1) || !wait_flag(&t.done) || !t.ok) {
+            result = false;
+        }
+        address_space_put(as);
+    }
+    __asm__ volatile("cli");
+    sched_test_end(saved_current);
+    test_print_result("Uring Test", result);
+}
+
+// Kiểm thử bộ đệm console: write chỉ chép vào bộ đệm, worker vẽ hết phần đang chờ
+void test_console_buffer() {
+    bool result = true;
+    process_t *saved_current = sched_test_begin();
+    // Ngắt còn tắt nên worker của CPU này chưa chạy được: dữ liệu phải còn trong bộ đệm
+    size_t before = console_pending();
+    console_buffer_write("    \n", 5);
+    if (console_pending() != before + 5) {
+        result = false;
+    }
+    __asm__ volatile("sti");
+    flush_workqueue(system_wq);
+    if (console_pending() != 0) {
+        result = false;
+    }
+    __asm__ volatile("cli");
+    sched_test_end(saved_current);
+    test_print_result("Console Buffer Test", result);
+}
+
+// Kiểm thử per-CPU: GS trỏ đúng vào cpu_t, mỗi AP có TSS/stack riêng và đang nhận tick
+void test_percpu() {
+    bool result = true;
+    cpu_t *cpu = this_cpu();
+
+    if (cpu != &cpus[0] || cpu->self != cpu || cpu->id != 0 || cpu->tss != &tss ||
+        rdmsr(IA32_GS_BASE_MSR) != (uint64_t)cpu || cpu_count < 1 || cpu_count > MAX_CPUS) {
+        result = false;
+    }
+
+    // Chờ vài tick để mọi AP kịp chạy timer của nó
+    uint64_t start = timer_ticks;
+    while (timer_ticks < start + 5) {
+        __asm__ volatile("hlt");
+    }
+
+    for (uint32_t i = 1; i < cpu_count; i++) {
+        cpu_t *ap = &cpus[i];
+        GDTEntry64 *tss_entry = (GDTEntry64 *)(ap->gdt + sizeof(GDTEntry32) * 5);
+        uint64_t tss_base = tss_entry->base_low | ((uint64_t)tss_entry->base_middle1 << 16) |
+                            ((uint64_t)tss_entry->base_middle2 << 24) | ((uint64_t)tss_entry->base_high << 32);
+        if (!ap->online || ap->id != i || ap->self != ap || ap->tss != &ap->tss_data ||
+            tss_base != (uint64_t)ap->tss || ap->tss->rsp0 != ap->kernel_stack_top ||
+            ap->kernel_stack_top == kernel_stack_top || ap->ticks == 0) {
+            result = false;
+        }
+    }
+
+    test_print_result("Per-CPU Data Test", result);
+}
+
 // Hàm chạy tất cả kiểm thử
 void run_all_tests() {
     kprintf("=== Starting All Tests ===\n");
@@ -233,6 +2287,30 @@ void run_all_tests() {
     test_idt_initialization();
     test_idt_entries();
     test_stacks();
+    test_free_page_reporting();
+    test_pkey_pte();
+    test_scheduler_context_switch();
+    test_fair_scheduler();
+    test_deadline_scheduler();
+    test_task_groups();
+    test_kthreads_workqueue();
+    test_threads();
+    test_futex();
+    test_syscall_table();
+    test_usercopy();
+    test_pkey_enforcement();
+    test_heap();
+    test_shm();
+    test_ipc();
+    test_vdso();
+    test_uring();
+    test_console_buffer();
+    test_percpu();
+    test_per_cpu_runqueues();
+    test_locks();
+    test_rcu();
+    test_kernel_preemption();
+    test_tickless_idle();
 
     kprintf("=== All Tests Completed ===\n");
 }
@@ -0,0 +1,230 @@
+// timer.c
+#include "timer.h"
+#include "apic.h"
+#include "cpu.h"
+#include "io.h"
+#include "scheduler.h"
+#include "graphics.h"
+#include "config.h"
+#include "percpu.h"
+#include "rcu.h"
+#include "workqueue.h"
+#include "futex.h"
+#include "vdso.h"
+
+#define PIT_FREQUENCY     1193182
+#define PIT_CHANNEL2_DATA 0x42
+#define PIT_COMMAND       0x43
+#define PIT_GATE_PORT     0x61
+#define CALIBRATION_MS    10
+
+volatile uint64_t timer_ticks = 0;
+uint64_t tsc_per_ms = 0;
+
+static uint64_t lapic_ticks_per_ms = 0;
+static uint64_t tsc_boot = 0;
+// Số chu kỳ TSC giữa hai tick định kỳ
+static uint64_t tick_cycles = 0;
+// LAPIC hỗ trợ chế độ TSC-deadline; nếu không, dùng chế độ one-shot với bộ đếm
+static bool tsc_deadline_mode = false;
+// ns = (cycles * tsc_ns_mult) >> 32
+static uint64_t tsc_ns_mult = 0;
+
+/**
+ * Busy-waits @p ms milliseconds using PIT channel 2 in one-shot mode.
+ *
+ * Channel 2 is used because its output can be polled through port 0x61
+ * without an interrupt, which is all calibration needs.
+ */
+static void pit_wait_ms(uint32_t ms) {
+    uint32_t count = PIT_FREQUENCY * ms / 1000;
+
+    // Bật gate của kênh 2, tắt loa
+    uint8_t gate = (inb(PIT_GATE_PORT) & ~0x02) | 0x01;
+    outb(PIT_GATE_PORT, gate & ~0x01);
+
+    outb(PIT_COMMAND, 0xB0); // Kênh 2, lobyte/hibyte, mode 0
+    outb(PIT_CHANNEL2_DATA, count & 0xFF);
+    outb(PIT_CHANNEL2_DATA, (count >> 8) & 0xFF);
+
+    outb(PIT_GATE_PORT, gate);
+    while (!(inb(PIT_GATE_PORT) & 0x20)) {
+        cpu_relax();
+    }
+}
+
+/**
+ * Arms the LAPIC timer of this CPU to fire at TSC value @p deadline.
+ *
+ * In TSC-deadline mode this is a single MSR write. Otherwise the distance is
+ * converted to LAPIC timer counts for one-shot mode, clamped to the 32-bit
+ * counter. Either way the new deadline replaces the old one.
+ */
+static void timer_arm(uint64_t deadline) {
+    if (tsc_deadline_mode) {
+        wrmsr(IA32_TSC_DEADLINE_MSR, deadline);
+        return;
+    }
+    uint64_t now = rdtsc();
+    uint64_t cycles = deadline > now ? deadline - now : 1;
+    uint64_t count = cycles * lapic_ticks_per_ms / tsc_per_ms;
+    if (count == 0) {
+        count = 1;
+    } else if (count > 0xFFFFFFFF) {
+        count = 0xFFFFFFFF;
+    }
+    lapic_write(LAPIC_REG_TIMER_INITIAL, (uint32_t)count);
+}
+
+/**
+ * Timer interrupt: the periodic tick, or the wakeup of an idle CPU whose tick
+ * is stopped.
+ *
+ * The tick is re-armed from the previous deadline rather than from now, so
+ * ticks do not drift by the interrupt latency. timer_ticks is derived from
+ * the TSC, so it stays right while the BSP's tick is stopped.
+ */
+static trap_frame_t *timer_interrupt(trap_frame_t *frame) {
+    cpu_t *cpu = this_cpu();
+    cpu->ticks++;
+    // timer_ticks là đồng hồ toàn cục nên chỉ BSP cập nhật
+    if (cpu->id == 0) {
+        timer_ticks = timer_now_ns() / (1000000000ULL / TIMER_HZ);
+    }
+    if (!cpu->tick_stopped) {
+        uint64_t now = rdtsc();
+        cpu->next_tick_tsc += tick_cycles;
+        if (cpu->next_tick_tsc <= now) {
+            cpu->next_tick_tsc = now + tick_cycles;
+        }
+        timer_arm(cpu->next_tick_tsc);
+    }
+    lapic_eoi();
+    rcu_tick();
+    uint64_t now_ns = timer_now_ns();
+    delayed_work_tick(now_ns);
+    futex_timeout_tick(now_ns);
+    vdso_tick(now_ns);
+    return sched_tick(frame);
+}
+
+// Bật tick TIMER_HZ trên LAPIC của CPU hiện tại (mỗi tick được hẹn lại trong ngắt)
+static void timer_start_tick() {
+    cpu_t *cpu = this_cpu();
+    lapic_write(LAPIC_REG_TIMER_DIVIDE, LAPIC_TIMER_DIVIDE_16);
+    lapic_write(LAPIC_REG_LVT_TIMER,
+                (tsc_deadline_mode ? LAPIC_TIMER_TSC_DEADLINE : LAPIC_TIMER_ONESHOT) | TIMER_VECTOR);
+    cpu->tick_stopped = false;
+    cpu->next_tick_tsc = rdtsc() + tick_cycles;
+    timer_arm(cpu->next_tick_tsc);
+}
+
+/**
+ * Stops the periodic tick before this CPU sleeps in idle.
+ *
+ * The tick stays on while this CPU has pending RCU callbacks, which need
+ * ticks to notice the end of a grace period, or throttled processes
+ * waiting for their next period. Otherwise the timer is armed
+ * once, for the earliest delayed work or futex timeout expiry, but never
+ * later than TIMER_IDLE_MAX_MS from now so that periodic load balancing
+ * still runs. Work queued for this CPU by others arrives with a reschedule
+ * IPI or a write to its polled need_resched, so it needs no timer.
+ *
+ * Must be called with interrupts disabled.
+ */
+void timer_idle_enter() {
+    cpu_t *cpu = this_cpu();
+    if (!TIMER_NOHZ_IDLE || cpu->rcu_next || cpu->rcu_wait || !sched_can_stop_tick()) {
+        return;
+    }
+    cpu->tick_stopped = true;
+    uint64_t deadline = rdtsc() + tsc_per_ms * TIMER_IDLE_MAX_MS;
+    uint64_t expiry = delayed_work_next_expiry();
+    uint64_t futex_expiry = futex_next_expiry();
+    if (futex_expiry < expiry) {
+        expiry = futex_expiry;
+    }
+    if (expiry != UINT64_MAX) {
+        uint64_t now = timer_now_ns();
+        uint64_t delay = expiry > now ? expiry - now : 0;
+        uint64_t expiry_tsc = rdtsc() + delay * tsc_per_ms / 1000000;
+        if (expiry_tsc < deadline) {
+            deadline = expiry_tsc;
+        }
+    }
+    timer_arm(deadline);
+}
+
+// Bật lại tick khi CPU rời trạng thái rảnh (gọi khi đã tắt ngắt)
+void timer_idle_exit() {
+    cpu_t *cpu = this_cpu();
+    if (!cpu->tick_stopped) {
+        return;
+    }
+    cpu->tick_stopped = false;
+    cpu->next_tick_tsc = rdtsc() + tick_cycles;
+    timer_arm(cpu->next_tick_tsc);
+}
+
+/**
+ * Calibrates the Local APIC timer and the TSC against the PIT and starts the
+ * scheduler tick.
+ *
+ * The LAPIC timer counts down from its maximum with a divider of 16 while the
+ * PIT waits CALIBRATION_MS; the elapsed count and TSC delta give both rates.
+ */
+void timer_init() {
+    pic_disable();
+    lapic_init();
+
+    lapic_write(LAPIC_REG_TIMER_DIVIDE, LAPIC_TIMER_DIVIDE_16);
+    lapic_write(LAPIC_REG_LVT_TIMER, LAPIC_LVT_MASKED);
+    lapic_write(LAPIC_REG_TIMER_INITIAL, 0xFFFFFFFF);
+    uint64_t tsc_start = rdtsc();
+
+    pit_wait_ms(CALIBRATION_MS);
+
+    uint32_t remaining = lapic_read(LAPIC_REG_TIMER_CURRENT);
+    uint64_t tsc_end = rdtsc();
+    lapic_write(LAPIC_REG_TIMER_INITIAL, 0);
+
+    lapic_ticks_per_ms = (0xFFFFFFFFu - remaining) / CALIBRATION_MS;
+    tsc_per_ms = (tsc_end - tsc_start) / CALIBRATION_MS;
+    tsc_ns_mult = (1000000ULL << 32) / tsc_per_ms;
+    tsc_boot = tsc_end;
+    tick_cycles = tsc_per_ms * 1000 / TIMER_HZ;
+
+    uint32_t eax, ebx, ecx, edx;
+    cpuid(1, 0, &eax, &ebx, &ecx, &edx);
+    tsc_deadline_mode = ecx & CPUID_1_ECX_TSC_DEADLINE;
+
+    kprintf("Timer: TSC %llu kHz, LAPIC %llu ticks/ms, %d Hz, %s mode\n", tsc_per_ms, lapic_ticks_per_ms,
+            TIMER_HZ, tsc_deadline_mode ? "TSC-deadline" : "one-shot");
+
+    irq_register_handler(TIMER_VECTOR, timer_interrupt);
+    timer_start_tick();
+}
+
+/**
+ * Starts the scheduler tick on an application processor.
+ *
+ * LAPIC timers run at the same rate on every CPU, so the BSP's calibration is
+ * reused.
+ */
+void timer_init_ap() {
+    lapic_init();
+    timer_start_tick();
+}
+
+uint64_t timer_tsc_to_ns(uint64_t cycles) {
+    return (uint64_t)(((unsigned __int128)cycles * tsc_ns_mult) >> 32);
+}
+
+uint64_t timer_now_ns() {
+    return timer_tsc_to_ns(rdtsc() - tsc_boot);
+}
+
+void timer_tsc_params(uint64_t *base, uint64_t *mult) {
+    *base = tsc_boot;
+    *mult = tsc_ns_mult;
+}
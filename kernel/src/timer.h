@@ -0,0 +1,33 @@
+// timer.h
+#ifndef TIMER_H
+#define TIMER_H
+
+#include <stdint.h>
+#include "idt.h"
+
+// Số chu kỳ tick TIMER_HZ đã trôi qua kể từ khi hiệu chỉnh (tính từ TSC)
+extern volatile uint64_t timer_ticks;
+
+// Số chu kỳ TSC trong một mili giây (đo khi khởi tạo)
+extern uint64_t tsc_per_ms;
+
+// Hiệu chỉnh LAPIC timer và TSC bằng PIT, sau đó bật tick TIMER_HZ (TSC-deadline nếu có, không thì one-shot)
+void timer_init();
+
+// Bật Local APIC và tick định kỳ trên AP, dùng kết quả hiệu chỉnh của BSP
+void timer_init_ap();
+
+// Tắt tick khi CPU sắp ngủ trong vòng idle / bật lại khi thức dậy (gọi khi đã tắt ngắt)
+void timer_idle_enter();
+void timer_idle_exit();
+
+// Thời gian tính bằng nano giây kể từ khi hiệu chỉnh, dựa trên TSC
+uint64_t timer_now_ns();
+
+// Đổi số chu kỳ TSC sang nano giây
+uint64_t timer_tsc_to_ns(uint64_t cycles);
+
+// Tham số của timer_now_ns: ns = ((tsc - *base) * *mult) >> 32 (dùng cho vDSO)
+void timer_tsc_params(uint64_t *base, uint64_t *mult);
+
+#endif // TIMER_H
@@ -6,21 +6,24 @@
 
 TSS tss;
 
-void init_tss() {
+void tss_setup(TSS *t, uint64_t rsp0, uint64_t ist1) {
     // Zero out the TSS structure
     for(int i = 0; i < sizeof(TSS)/8; i++) {
-        ((uint64_t*)&tss)[i] = 0;
+        ((uint64_t*)t)[i] = 0;
     }
 
     // Set the stack pointer for Ring 0 (kernel)
-    tss.rsp0 = kernel_stack_top;
+    t->rsp0 = rsp0;
 
-    // Optionally set IST pointers
-    // For example, IST1 can be used for double faults
-    tss.ist1 = ist1_stack_top;
+    // IST1 is used for double faults
+    t->ist1 = ist1;
 
     // Set the I/O Map Base Address to the end of the TSS
-    tss.iomap_base = sizeof(TSS);
+    t->iomap_base = sizeof(TSS);
+}
+
+void init_tss() {
+    tss_setup(&tss, kernel_stack_top, ist1_stack_top);
 }
 
 extern void loadTss();
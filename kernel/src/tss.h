@@ -27,4 +27,9 @@ extern TSS tss;
 
 void init_tss();
 
+// Khởi tạo một TSS với stack ring 0 và stack IST1 cho trước
+void tss_setup(TSS *t, uint64_t rsp0, uint64_t ist1);
+
+void load_tss(uint16_t tss_selector);
+
 #endif // TSS_H
@@ -0,0 +1,393 @@
+// uring.c
+#include "uring.h"
+#include "memory_manager.h"
+#include "paging.h"
+#include "scheduler.h"
+#include "kthread.h"
+#include "workqueue.h"
+#include "futex.h"
+#include "syscall_handler.h"
+#include "context_switcher.h"
+#include "timer.h"
+#include "klibc.h"
+#include "io.h"
+#include "config.h"
+#include "graphics.h"
+
+_Static_assert(sizeof(uring_shared_t) == 128, "uring_shared_t là hai cache line, khớp với thư viện user");
+_Static_assert(sizeof(uring_sqe_t) == 32 && sizeof(uring_cqe_t) == 16, "bố cục SQE/CQE khớp với thư viện user");
+
+// Giá trị của mm->uring trong lúc uring_setup đang dựng vòng: giữ chỗ nhưng chưa dùng được
+#define URING_RESERVED ((uring_t *)1)
+
+// Thao tác URING_OP_TIMEOUT đang chờ; giữ một tham chiếu tới vòng
+typedef struct {
+    delayed_work_t dw;
+    uring_t *ring;
+    uint64_t user_data;
+} uring_timeout_t;
+
+static void uring_get(uring_t *ring) {
+    __atomic_fetch_add(&ring->refcount, 1, __ATOMIC_RELAXED);
+}
+
+// Tham chiếu cuối giải phóng vùng nhớ chung; tiến trình đã hết luồng nên không còn ai đọc nó
+static void uring_put(uring_t *ring) {
+    if (__atomic_sub_fetch(&ring->refcount, 1, __ATOMIC_ACQ_REL) == 0) {
+        free_physical_blocks(ring->phys, ring->pages);
+        free_memory_bytes((uint64_t)VIRT_TO_PHYS(ring), sizeof(uring_t));
+    }
+}
+
+static bool uring_cq_ready(uring_t *ring, uint32_t min_complete) {
+    return ring->cq_tail - __atomic_load_n(&ring->shared->cq_head, __ATOMIC_ACQUIRE) >= min_complete;
+}
+
+/**
+ * Appends a completion to the CQ and wakes every thread waiting in
+ * uring_enter; each one checks its own count again.
+ *
+ * A full CQ drops the completion and counts it in cq_overflow, so
+ * applications should reap before submitting more than cq_entries
+ * operations.
+ */
+static void uring_post(uring_t *ring, uint64_t user_data, int64_t res) {
+    uring_shared_t *shared = ring->shared;
+    uint64_t flags = spin_lock_irqsave(&ring->lock);
+    if (ring->cq_tail - __atomic_load_n(&shared->cq_head, __ATOMIC_ACQUIRE) >= ring->cq_entries) {
+        __atomic_fetch_add(&shared->cq_overflow, 1, __ATOMIC_RELAXED);
+    } else {
+        uring_cqe_t *cqe = &ring->cqes[ring->cq_tail & (ring->cq_entries - 1)];
+        cqe->user_data = user_data;
+        cqe->res = res;
+        ring->cq_tail++;
+        // CQE phải hiện ra trước chỉ số mới
+        __atomic_store_n(&shared->cq_tail, ring->cq_tail, __ATOMIC_RELEASE);
+    }
+    for (uring_waiter_t *w = ring->waiters; w; w = w->next) {
+        w->queued = false;
+        sched_wakeup(w->task);
+    }
+    ring->waiters = NULL;
+    spin_unlock_irqrestore(&ring->lock, flags);
+}
+
+static void uring_timeout_fn(work_t *work) {
+    uring_timeout_t *t = container_of(work, uring_timeout_t, dw.work);
+    // Trả chỗ trước khi báo: ứng dụng thấy CQE là có thể gửi hẹn giờ mới
+    __atomic_fetch_sub(&t->ring->timeouts, 1, __ATOMIC_RELAXED);
+    uring_post(t->ring, t->user_data, 0);
+    uring_put(t->ring);
+    free_memory_bytes((uint64_t)VIRT_TO_PHYS(t), sizeof(uring_timeout_t));
+}
+
+// Hẹn giờ cho một SQE TIMEOUT; false nếu vòng đã có URING_MAX_TIMEOUTS hẹn giờ hoặc hết bộ nhớ
+static bool uring_timeout(uring_t *ring, const uring_sqe_t *sqe) {
+    if (__atomic_fetch_add(&ring->timeouts, 1, __ATOMIC_RELAXED) >= URING_MAX_TIMEOUTS) {
+        __atomic_fetch_sub(&ring->timeouts, 1, __ATOMIC_RELAXED);
+        return false;
+    }
+    uint64_t phys = allocate_memory_bytes(sizeof(uring_timeout_t));
+    if (!phys) {
+        __atomic_fetch_sub(&ring->timeouts, 1, __ATOMIC_RELAXED);
+        return false;
+    }
+    uring_timeout_t *t = PHYS_TO_VIRT(phys);
+    delayed_work_init(&t->dw, uring_timeout_fn);
+    t->ring = ring;
+    t->user_data = sqe->user_data;
+    uring_get(ring);
+    queue_delayed_work(system_wq, &t->dw, sqe->len);
+    return true;
+}
+
+// Thực hiện một SQE; thao tác đồng bộ báo kết quả ngay, TIMEOUT báo khi hết giờ
+static void uring_issue(uring_t *ring, const uring_sqe_t *sqe) {
+    int64_t res;
+    switch (sqe->opcode) {
+    case URING_OP_NOP:
+        res = 0;
+        break;
+    case URING_OP_WRITE:
+        res = syscall_write((uint64_t)sqe->fd, sqe->addr, sqe->len, 0, 0, 0);
+        break;
+    case URING_OP_READ:
+        res = syscall_read((uint64_t)sqe->fd, sqe->addr, sqe->len, 0, 0, 0);
+        break;
+    case URING_OP_FUTEX_WAKE:
+        res = futex_wake(ring->mm, sqe->addr, (uint32_t)sqe->len);
+        break;
+    case URING_OP_TIMEOUT:
+        if (uring_timeout(ring, sqe)) {
+            return;
+        }
+        res = -1;
+        break;
+    default:
+        res = -1;
+        break;
+    }
+    uring_post(ring, sqe->user_data, res);
+}
+
+/**
+ * Consumes up to @p to_submit SQEs.
+ *
+ * Each SQE is copied out under the ring lock, so that two threads
+ * submitting at once never take the same entry, and then executed with the
+ * lock dropped. The copy also keeps the user from changing an entry while
+ * it is being executed. A tail more than sq_entries ahead is clamped rather
+ * than trusted.
+ *
+ * @return The number of SQEs consumed.
+ */
+static uint32_t uring_submit(uring_t *ring, uint32_t to_submit) {
+    uring_shared_t *shared = ring->shared;
+    uint32_t submitted = 0;
+    while (submitted < to_submit) {
+        uint64_t flags = spin_lock_irqsave(&ring->lock);
+        uint32_t tail = __atomic_load_n(&shared->sq_tail, __ATOMIC_ACQUIRE);
+        if (tail == ring->sq_head) {
+            spin_unlock_irqrestore(&ring->lock, flags);
+            break;
+        }
+        if (tail - ring->sq_head > ring->sq_entries) {
+            ring->sq_head = tail - ring->sq_entries;
+        }
+        uring_sqe_t sqe = ring->sqes[ring->sq_head & (ring->sq_entries - 1)];
+        ring->sq_head++;
+        __atomic_store_n(&shared->sq_head, ring->sq_head, __ATOMIC_RELEASE);
+        spin_unlock_irqrestore(&ring->lock, flags);
+
+        uring_issue(ring, &sqe);
+        submitted++;
+    }
+    return submitted;
+}
+
+// Ngủ tới khi vòng CQ có ít nhất min_complete CQE chưa đọc
+static void uring_wait(uring_t *ring, uint32_t min_complete) {
+    process_t *self = process_current();
+    uring_waiter_t w = {.task = self};
+    for (;;) {
+        uint64_t flags = spin_lock_irqsave(&ring->lock);
+        if (uring_cq_ready(ring, min_complete)) {
+            if (w.queued) {
+                uring_waiter_t **link = &ring->waiters;
+                while (*link != &w) {
+                    link = &(*link)->next;
+                }
+                *link = w.next;
+            }
+            spin_unlock_irqrestore(&ring->lock, flags);
+            return;
+        }
+        if (!w.queued) {
+            w.next = ring->waiters;
+            ring->waiters = &w;
+            w.queued = true;
+        }
+        self->state = PROCESS_STATE_BLOCKED;
+        spin_unlock_irqrestore(&ring->lock, flags);
+        schedule();
+    }
+}
+
+/**
+ * Body of the SQPOLL thread.
+ *
+ * The thread runs in the address space of the process, so SQEs that carry
+ * user pointers work as if the process had made the syscall. It polls the
+ * SQ and, after URING_SQPOLL_IDLE_US without work, sets
+ * URING_SQ_NEED_WAKEUP and sleeps. The thread marks itself BLOCKED before
+ * publishing the flag and checks the tail after a full fence; the
+ * application stores the tail before reading the flag, so either the
+ * thread sees the new entries or the application sees the flag and wakes
+ * it.
+ */
+static void uring_sq_thread(void *arg) {
+    uring_t *ring = arg;
+    uring_shared_t *shared = ring->shared;
+    process_t *self = process_current();
+    kthread_use_mm(ring->mm);
+    // Bỏ tham chiếu do uring_setup lấy hộ: luồng đã giữ tham chiếu riêng
+    address_space_put(ring->mm);
+    self->pkru = ring->pkru;
+    context_restore_pkru(self);
+
+    uint64_t idle_since = timer_now_ns();
+    while (!ring->stopping) {
+        if (uring_submit(ring, UINT32_MAX)) {
+            idle_since = timer_now_ns();
+            continue;
+        }
+        if (timer_now_ns() - idle_since < URING_SQPOLL_IDLE_US * 1000ULL) {
+            cpu_relax();
+            continue;
+        }
+        uint64_t flags = spin_lock_irqsave(&ring->lock);
+        self->state = PROCESS_STATE_BLOCKED;
+        __atomic_fetch_or(&shared->flags, URING_SQ_NEED_WAKEUP, __ATOMIC_SEQ_CST);
+        if (ring->stopping || __atomic_load_n(&shared->sq_tail, __ATOMIC_SEQ_CST) != ring->sq_head) {
+            self->state = PROCESS_STATE_RUNNING;
+            spin_unlock_irqrestore(&ring->lock, flags);
+        } else {
+            spin_unlock_irqrestore(&ring->lock, flags);
+            schedule();
+        }
+        __atomic_fetch_and(&shared->flags, ~URING_SQ_NEED_WAKEUP, __ATOMIC_RELAXED);
+        idle_since = timer_now_ns();
+    }
+
+    uint64_t flags = spin_lock_irqsave(&ring->lock);
+    ring->sq_thread = NULL;
+    spin_unlock_irqrestore(&ring->lock, flags);
+    uring_put(ring);
+}
+
+/**
+ * Creates the ring of the calling process and maps it at URING_ADDR.
+ *
+ * The shared area is one physically contiguous run: the header, then the
+ * SQE array, then the CQE array. It is mapped with PAGING_PAGE_SHARED
+ * because the ring, not the page table, owns those frames: pending
+ * timeouts and the SQPOLL thread may still post completions after the
+ * address space is gone.
+ *
+ * mm->uring is reserved first so that a concurrent setup fails, but the
+ * ring is only published once it is mapped and its SQPOLL thread runs;
+ * uring_enter never sees a ring that setup may still free. Every failure
+ * after the reservation unmaps whatever was mapped, clears the slot and
+ * drops the ring.
+ */
+int64_t uring_setup(uint32_t entries, uint32_t flags) {
+    process_t *self = process_current();
+    if (!self || !self->mm || !entries || entries > URING_MAX_ENTRIES || (flags & ~URING_SETUP_SQPOLL)) {
+        return -1;
+    }
+    address_space_t *mm = self->mm;
+    uint32_t sq_entries = 1;
+    while (sq_entries < entries) {
+        sq_entries <<= 1;
+    }
+    uint32_t cq_entries = 2 * sq_entries;
+    uint32_t sqes_offset = sizeof(uring_shared_t);
+    uint32_t cqes_offset = sqes_offset + sq_entries * sizeof(uring_sqe_t);
+    uint32_t pages = (cqes_offset + cq_entries * sizeof(uring_cqe_t) + BLOCK_SIZE - 1) / BLOCK_SIZE;
+
+    uint64_t ring_phys = allocate_memory_bytes(sizeof(uring_t));
+    uint64_t phys = allocate_physical_blocks(pages);
+    if (!ring_phys || !phys) {
+        kprintf("uring: Out of memory\n");
+        if (ring_phys) free_memory_bytes(ring_phys, sizeof(uring_t));
+        if (phys) free_physical_blocks(phys, pages);
+        return -1;
+    }
+    uring_t *ring = PHYS_TO_VIRT(ring_phys);
+    memset(ring, 0, sizeof(uring_t));
+    spin_init_named(&ring->lock, "uring");
+    ring->refcount = 1;
+    ring->phys = phys;
+    ring->pages = pages;
+    ring->sq_entries = sq_entries;
+    ring->cq_entries = cq_entries;
+    ring->mm = mm;
+    ring->pkru = self->pkru;
+    ring->sqpoll = flags & URING_SETUP_SQPOLL;
+
+    uint8_t *base = PHYS_TO_VIRT(phys);
+    memset(base, 0, pages * BLOCK_SIZE);
+    ring->shared = (uring_shared_t *)base;
+    ring->sqes = (uring_sqe_t *)(base + sqes_offset);
+    ring->cqes = (uring_cqe_t *)(base + cqes_offset);
+    ring->shared->sq_entries = sq_entries;
+    ring->shared->sqes_offset = sqes_offset;
+    ring->shared->cq_entries = cq_entries;
+    ring->shared->cqes_offset = cqes_offset;
+
+    uint64_t mm_flags = spin_lock_irqsave(&mm->lock);
+    if (mm->uring) {
+        spin_unlock_irqrestore(&mm->lock, mm_flags);
+        uring_put(ring);
+        return -1;
+    }
+    mm->uring = URING_RESERVED;
+    spin_unlock_irqrestore(&mm->lock, mm_flags);
+
+    if (!map_memory(mm->page_table, URING_ADDR, phys, pages * BLOCK_SIZE,
+                    PAGING_PAGE_PRESENT | PAGING_PAGE_RW | PAGING_PAGE_USER | PAGING_PAGE_SHARED)) {
+        kprintf("uring: Failed to map ring\n");
+        goto fail;
+    }
+    if (ring->sqpoll) {
+        // Tham chiếu của luồng tới vòng, và tham chiếu tạm tới mm cho tới khi luồng nạp nó
+        uring_get(ring);
+        address_space_get(mm);
+        ring->sq_thread = kthread_create(uring_sq_thread, ring, -1);
+        if (!ring->sq_thread) {
+            address_space_put(mm);
+            uring_put(ring);
+            goto fail;
+        }
+    }
+
+    mm_flags = spin_lock_irqsave(&mm->lock);
+    mm->uring = ring;
+    spin_unlock_irqrestore(&mm->lock, mm_flags);
+    return URING_ADDR;
+
+fail:
+    // Các trang thuộc về vòng (PAGING_PAGE_SHARED): chỉ gỡ ánh xạ, uring_put trả chúng về
+    address_space_unmap(mm, URING_ADDR, URING_ADDR + pages * BLOCK_SIZE, false);
+    mm_flags = spin_lock_irqsave(&mm->lock);
+    mm->uring = NULL;
+    spin_unlock_irqrestore(&mm->lock, mm_flags);
+    uring_put(ring);
+    return -1;
+}
+
+int64_t uring_enter(uint32_t to_submit, uint32_t min_complete, uint32_t flags) {
+    process_t *self = process_current();
+    // mm->uring chỉ bị gỡ khi không còn luồng user nào, nên đọc không cần khóa
+    uring_t *ring = self && self->mm ? self->mm->uring : NULL;
+    if (!ring || ring == URING_RESERVED) {
+        return -1;
+    }
+    int64_t submitted = 0;
+    if (ring->sqpoll) {
+        if (flags & URING_ENTER_SQ_WAKEUP) {
+            uint64_t lock_flags = spin_lock_irqsave(&ring->lock);
+            if (ring->sq_thread) {
+                sched_wakeup(ring->sq_thread);
+            }
+            spin_unlock_irqrestore(&ring->lock, lock_flags);
+        }
+    } else {
+        submitted = uring_submit(ring, to_submit);
+    }
+    if (min_complete) {
+        uring_wait(ring, min_complete > ring->cq_entries ? ring->cq_entries : min_complete);
+    }
+    return submitted;
+}
+
+void uring_release(address_space_t *mm) {
+    uint64_t flags = spin_lock_irqsave(&mm->lock);
+    uring_t *ring = mm->uring;
+    if (ring == URING_RESERVED) {
+        ring = NULL;
+    } else {
+        mm->uring = NULL;
+    }
+    spin_unlock_irqrestore(&mm->lock, flags);
+    if (!ring) {
+        return;
+    }
+    flags = spin_lock_irqsave(&ring->lock);
+    ring->stopping = true;
+    if (ring->sq_thread) {
+        sched_wakeup(ring->sq_thread);
+    }
+    spin_unlock_irqrestore(&ring->lock, flags);
+    uring_put(ring);
+}
@@ -0,0 +1,106 @@
+// uring.h
+#ifndef URING_H
+#define URING_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "address_space.h"
+#include "process.h"
+#include "spinlock.h"
+
+// Vòng gửi/nhận (giống io_uring): tiến trình ghi yêu cầu vào vòng SQ trong bộ nhớ chung
+// với kernel, gửi cả loạt bằng một syscall (hoặc không cần syscall khi có luồng SQPOLL),
+// và đọc kết quả từ vòng CQ mà không vào kernel. Mỗi không gian địa chỉ có tối đa một vòng,
+// ánh xạ tại URING_ADDR; bố cục dưới đây khớp với thư viện user
+
+#define URING_ADDR 0x7FFF00000000ULL
+
+// Thao tác
+#define URING_OP_NOP        0
+#define URING_OP_WRITE      1   // write(fd, addr, len)
+#define URING_OP_READ       2   // read(fd, addr, len)
+#define URING_OP_FUTEX_WAKE 3   // futex_wake(addr, len)
+#define URING_OP_TIMEOUT    4   // Hoàn thành với res = 0 sau len ns (-1 nếu vòng đã có đủ hẹn giờ)
+
+// Cờ của uring_setup
+#define URING_SETUP_SQPOLL  0x1 // Luồng kernel đọc vòng SQ, không cần uring_enter để gửi
+
+// Cờ của uring_enter
+#define URING_ENTER_SQ_WAKEUP 0x1   // Đánh thức luồng SQPOLL đang ngủ
+
+// Cờ trong uring_shared_t.flags
+#define URING_SQ_NEED_WAKEUP 0x1    // Luồng SQPOLL đã ngủ: phải gọi uring_enter với URING_ENTER_SQ_WAKEUP
+
+typedef struct {
+    uint8_t opcode;
+    uint8_t flags;
+    uint16_t reserved;
+    int32_t fd;
+    uint64_t addr;
+    uint64_t len;
+    uint64_t user_data;             // Trả lại nguyên vẹn trong CQE
+} uring_sqe_t;
+
+typedef struct {
+    uint64_t user_data;
+    int64_t res;                    // Kết quả của thao tác (như giá trị trả về của syscall)
+} uring_cqe_t;
+
+// Đầu vùng nhớ chung. User ghi sq_tail và cq_head, kernel ghi sq_head và cq_tail;
+// hai nửa nằm trên hai cache line khác nhau. Chỉ số tăng mãi, vị trí = chỉ số & (entries - 1)
+typedef struct {
+    volatile uint32_t sq_head;
+    volatile uint32_t sq_tail;
+    uint32_t sq_entries;
+    uint32_t sqes_offset;           // Offset của mảng SQE tính từ URING_ADDR
+    volatile uint32_t flags;
+    uint32_t reserved0[11];
+    volatile uint32_t cq_head;
+    volatile uint32_t cq_tail;
+    uint32_t cq_entries;
+    uint32_t cqes_offset;
+    volatile uint64_t cq_overflow;  // Số CQE bị bỏ vì vòng CQ đầy
+    uint32_t reserved1[10];
+} uring_shared_t;
+
+// Một chờ trong uring_enter, nằm trên kernel stack của luồng chờ
+typedef struct uring_waiter {
+    struct uring_waiter *next;
+    process_t *task;
+    bool queued;                    // Còn trong danh sách; người đánh thức xóa cả danh sách
+} uring_waiter_t;
+
+typedef struct uring {
+    spinlock_t lock;                // Bảo vệ phía ghi của CQ, danh sách chờ và sq_head
+    volatile uint32_t refcount;     // Không gian địa chỉ, luồng SQPOLL, mỗi thao tác đang chờ
+    uring_shared_t *shared;         // Vùng nhớ chung qua HHDM
+    uring_sqe_t *sqes;
+    uring_cqe_t *cqes;
+    uint64_t phys;
+    uint32_t pages;
+    uint32_t sq_entries;
+    uint32_t cq_entries;
+    uint32_t sq_head;               // Bản của kernel, user ghi đè phần chung cũng không ảnh hưởng
+    uint32_t cq_tail;
+    address_space_t *mm;            // Không giữ tham chiếu: chỉ dùng khi tiến trình còn luồng
+    uring_waiter_t *waiters;
+    bool sqpoll;
+    process_t *sq_thread;           // Luồng SQPOLL đang chạy, NULL khi đã thoát
+    uint32_t pkru;                  // PKRU của tiến trình, luồng SQPOLL dùng khi truy cập bộ nhớ user
+    volatile uint32_t timeouts;     // Số thao tác TIMEOUT đang chờ, tối đa URING_MAX_TIMEOUTS
+    volatile bool stopping;
+} uring_t;
+
+// Tạo vòng cho không gian địa chỉ của luồng gọi với entries SQE (làm tròn lên lũy thừa 2,
+// tối đa URING_MAX_ENTRIES) và 2 * entries CQE. Trả về URING_ADDR, hoặc -1 nếu đã có vòng
+// hoặc hết bộ nhớ
+int64_t uring_setup(uint32_t entries, uint32_t flags);
+
+// Gửi tối đa to_submit SQE rồi chờ tới khi vòng CQ có ít nhất min_complete CQE.
+// Trả về số SQE đã gửi (0 khi có luồng SQPOLL), -1 nếu không có vòng
+int64_t uring_enter(uint32_t to_submit, uint32_t min_complete, uint32_t flags);
+
+// Tiến trình không còn luồng user: dừng luồng SQPOLL và bỏ tham chiếu của không gian địa chỉ
+void uring_release(address_space_t *mm);
+
+#endif // URING_H
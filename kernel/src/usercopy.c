@@ -0,0 +1,72 @@
+// usercopy.c
+#include "usercopy.h"
+#include "config.h"
+
+extern const exception_entry_t __ex_table_start[];
+extern const exception_entry_t __ex_table_end[];
+
+size_t __copy_user(void *dst, const void *src, size_t len);
+int64_t __strncpy_user(char *dst, const char *src, size_t max);
+
+bool access_ok(uint64_t addr, size_t len) {
+    return addr <= USER_SPACE_END && len <= USER_SPACE_END - addr;
+}
+
+/**
+ * Copies @p len bytes from user address @p usrc into kernel memory.
+ *
+ * The range is checked once against USER_SPACE_END; page-level problems
+ * are not checked up front but caught when the copy faults, so the common
+ * case costs one comparison and a rep movsb.
+ *
+ * @return 0, or -EFAULT if the range is not user memory or part of it
+ * cannot be read.
+ */
+int copy_from_user(void *dst, const void *usrc, size_t len) {
+    if (!access_ok((uint64_t)usrc, len)) {
+        return -EFAULT;
+    }
+    return __copy_user(dst, usrc, len) ? -EFAULT : 0;
+}
+
+int copy_to_user(void *udst, const void *src, size_t len) {
+    if (!access_ok((uint64_t)udst, len)) {
+        return -EFAULT;
+    }
+    return __copy_user(udst, src, len) ? -EFAULT : 0;
+}
+
+/**
+ * Copies a NUL-terminated string of at most @p max bytes from user space.
+ *
+ * A string that ends close to USER_SPACE_END is valid even if @p max bytes
+ * from @p usrc would cross it, so the limit is clamped to the user half
+ * instead of rejecting the call. A string that runs into the end of the
+ * user half without a NUL is reported as a fault.
+ *
+ * @return The length of the string, @p max if no NUL was found within
+ * @p max bytes, or -EFAULT.
+ */
+int64_t strncpy_from_user(char *dst, const char *usrc, size_t max) {
+    uint64_t addr = (uint64_t)usrc;
+    if (addr >= USER_SPACE_END) {
+        return -EFAULT;
+    }
+    size_t limit = max < USER_SPACE_END - addr ? max : USER_SPACE_END - addr;
+    int64_t len = __strncpy_user(dst, usrc, limit);
+    if (len == (int64_t)limit && limit < max) {
+        return -EFAULT;
+    }
+    return len;
+}
+
+// Bảng không được sắp xếp: chỉ có vài mục và chỉ được tra khi kernel gây lỗi
+bool exception_table_fixup(trap_frame_t *frame) {
+    for (const exception_entry_t *e = __ex_table_start; e < __ex_table_end; e++) {
+        if (e->insn == frame->rip) {
+            frame->rip = e->fixup;
+            return true;
+        }
+    }
+    return false;
+}
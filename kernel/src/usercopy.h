@@ -0,0 +1,47 @@
+// usercopy.h
+#ifndef USERCOPY_H
+#define USERCOPY_H
+
+// Chép giữa kernel và bộ nhớ user của tiến trình hiện tại. Khoảng địa chỉ được kiểm tra
+// một lần, rồi cả khối được chép bằng rep movsb. Lỗi trang trong lúc chép (trang chưa ánh
+// xạ, protection key cấm) không dừng máy: bảng ngoại lệ đưa lệnh chép tới đoạn sửa lỗi
+// và hàm trả về -EFAULT
+
+// Mã lỗi trả về (âm) cho user space, cùng giá trị với Linux
+#define EAGAIN 11
+#define EFAULT 14
+#define EINVAL 22
+#define ETIMEDOUT 110
+
+#ifndef __ASSEMBLER__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "idt.h"
+
+// Một mục của bảng ngoại lệ (section .ex_table): lệnh có thể gây lỗi và nơi tiếp tục
+typedef struct {
+    uint64_t insn;
+    uint64_t fixup;
+} exception_entry_t;
+
+// true nếu [addr, addr + len) nằm trọn trong nửa user của không gian địa chỉ
+bool access_ok(uint64_t addr, size_t len);
+
+// Trả về 0, hoặc -EFAULT nếu khoảng sai hoặc có trang không đọc/ghi được.
+// Khi lỗi, phần đích có thể đã được chép một phần
+int copy_from_user(void *dst, const void *usrc, size_t len);
+int copy_to_user(void *udst, const void *src, size_t len);
+
+// Chép chuỗi kết thúc bằng NUL, tối đa max byte kể cả NUL. Trả về độ dài chuỗi (không kể
+// NUL), max nếu không gặp NUL trong max byte (dst khi đó không có NUL), hoặc -EFAULT
+int64_t strncpy_from_user(char *dst, const char *usrc, size_t max);
+
+// Gọi từ isr_handler_c khi kernel gây lỗi: nếu frame->rip có trong bảng ngoại lệ thì
+// chuyển rip tới đoạn sửa lỗi và trả về true
+bool exception_table_fixup(trap_frame_t *frame);
+
+#endif // __ASSEMBLER__
+
+#endif // USERCOPY_H
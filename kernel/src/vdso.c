@@ -0,0 +1,154 @@
+// vdso.c
+#include "vdso.h"
+#include "paging.h"
+#include "memory_manager.h"
+#include "spinlock.h"
+#include "timer.h"
+#include "cpu.h"
+#include "klibc.h"
+#include "config.h"
+#include "graphics.h"
+
+// CPUID.80000001H:EDX bit 27: có RDTSCP và IA32_TSC_AUX
+#define CPUID_80000001_EDX_RDTSCP (1u << 27)
+#define IA32_TSC_AUX_MSR          0xC0000103
+
+extern const uint8_t vdso_start[];
+extern const uint8_t vdso_end[];
+
+_Static_assert(__builtin_offsetof(vdso_data_t, seq) == VDSO_DATA_SEQ, "vdso.S dùng offset của seq");
+_Static_assert(__builtin_offsetof(vdso_data_t, has_rdtscp) == VDSO_DATA_HAS_RDTSCP, "vdso.S dùng offset của has_rdtscp");
+_Static_assert(__builtin_offsetof(vdso_data_t, tsc_base) == VDSO_DATA_TSC_BASE, "vdso.S dùng offset của tsc_base");
+_Static_assert(__builtin_offsetof(vdso_data_t, tsc_ns_mult) == VDSO_DATA_TSC_MULT, "vdso.S dùng offset của tsc_ns_mult");
+_Static_assert(__builtin_offsetof(vdso_data_t, coarse_ns) == VDSO_DATA_COARSE_NS, "vdso.S dùng offset của coarse_ns");
+_Static_assert(sizeof(vdso_data_t) <= BLOCK_SIZE, "vdso_data_t phải nằm trong một trang");
+
+static uint64_t vdso_data_phys;
+static uint64_t vdso_code_phys;
+// NULL cho tới khi vdso_init xong; ngắt timer đọc nó trên mọi CPU
+static vdso_data_t *volatile vdso_data;
+// Tuần tự hóa các lần ghi vào trang dữ liệu (seq chỉ là phần cho reader)
+static spinlock_t vdso_lock = SPINLOCK_INIT;
+
+static bool vdso_cpu_has_rdtscp() {
+    uint32_t eax, ebx, ecx, edx;
+    cpuid(0x80000000, 0, &eax, &ebx, &ecx, &edx);
+    if (eax < 0x80000001) {
+        return false;
+    }
+    cpuid(0x80000001, 0, &eax, &ebx, &ecx, &edx);
+    return edx & CPUID_80000001_EDX_RDTSCP;
+}
+
+void vdso_init_cpu() {
+    if (vdso_cpu_has_rdtscp()) {
+        wrmsr(IA32_TSC_AUX_MSR, this_cpu()->id);
+    }
+}
+
+static void vdso_write_begin(vdso_data_t *data) {
+    __atomic_store_n(&data->seq, data->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static void vdso_write_end(vdso_data_t *data) {
+    __atomic_store_n(&data->seq, data->seq + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * Builds the shared vDSO pages: the code page, a copy of vdso_start..vdso_end,
+ * and the data page with the TSC parameters of timer_now_ns and the CPU list.
+ *
+ * Runs after smp_init so that every AP has already programmed IA32_TSC_AUX.
+ * RDTSCP support is taken from the BSP; the CPUs of one machine are the
+ * same model.
+ */
+void vdso_init() {
+    size_t code_size = (size_t)(vdso_end - vdso_start);
+    if (code_size > BLOCK_SIZE) {
+        kprintf("vDSO: code is %llu bytes, more than a page\n", (uint64_t)code_size);
+        return;
+    }
+    vdso_data_phys = allocate_physical_block();
+    vdso_code_phys = allocate_physical_block();
+    if (!vdso_data_phys || !vdso_code_phys) {
+        kprintf("vDSO: Out of memory\n");
+        if (vdso_data_phys) free_physical_block(vdso_data_phys);
+        if (vdso_code_phys) free_physical_block(vdso_code_phys);
+        vdso_data_phys = vdso_code_phys = 0;
+        return;
+    }
+    uint8_t *code = PHYS_TO_VIRT(vdso_code_phys);
+    memset(code, 0xCC, BLOCK_SIZE); // int3 ngoài phần mã
+    memcpy(code, vdso_start, code_size);
+
+    vdso_init_cpu();
+    vdso_data_t *data = PHYS_TO_VIRT(vdso_data_phys);
+    memset(data, 0, BLOCK_SIZE);
+    timer_tsc_params(&data->tsc_base, &data->tsc_ns_mult);
+    data->coarse_ns = timer_now_ns();
+    bool rdtscp = vdso_cpu_has_rdtscp();
+    data->cpu_count = cpu_count;
+    for (uint32_t i = 0; i < cpu_count; i++) {
+        data->cpus[i].lapic_id = cpus[i].lapic_id;
+        data->cpus[i].online = cpus[i].online;
+    }
+    data->has_rdtscp = rdtscp;
+    __atomic_store_n(&vdso_data, data, __ATOMIC_RELEASE);
+
+    kprintf("vDSO: %llu bytes of code, %u CPUs, getcpu %s\n", (uint64_t)code_size, cpu_count,
+            rdtscp ? "via RDTSCP" : "unavailable");
+}
+
+/**
+ * Refreshes the coarse clock once per tick period.
+ *
+ * Every CPU calls this from its timer interrupt, because the BSP's tick
+ * stops while it idles. A CPU that finds the lock taken skips the update:
+ * another CPU is writing the same value.
+ */
+void vdso_tick(uint64_t now) {
+    vdso_data_t *data = __atomic_load_n(&vdso_data, __ATOMIC_ACQUIRE);
+    if (!data || now - data->coarse_ns < 1000000000ULL / TIMER_HZ) {
+        return;
+    }
+    if (!spin_trylock(&vdso_lock)) {
+        return;
+    }
+    if (now > data->coarse_ns) {
+        vdso_write_begin(data);
+        data->coarse_ns = now;
+        vdso_write_end(data);
+    }
+    spin_unlock(&vdso_lock);
+}
+
+/**
+ * Maps the vDSO into @p as: the shared data page, a private page holding
+ * @p pid and the shared code page, all read-only. The shared pages carry
+ * PAGING_PAGE_SHARED so that freeing the page table leaves them alone; the
+ * private page belongs to the page table and is freed with it.
+ *
+ * @return false if the vDSO is unavailable or memory ran out.
+ */
+bool vdso_map(address_space_t *as, uint64_t pid) {
+    if (!as || !vdso_data_phys) {
+        return false;
+    }
+    uint64_t proc_phys = allocate_physical_block();
+    if (!proc_phys) {
+        return false;
+    }
+    vdso_proc_t *proc = PHYS_TO_VIRT(proc_phys);
+    memset(proc, 0, BLOCK_SIZE);
+    proc->pid = pid;
+
+    uint64_t shared = PAGING_PAGE_PRESENT | PAGING_PAGE_USER | PAGING_PAGE_SHARED;
+    if (!map_memory(as->page_table, VDSO_PROC_ADDR, proc_phys, BLOCK_SIZE, PAGING_PAGE_PRESENT | PAGING_PAGE_USER)) {
+        free_physical_block(proc_phys);
+        return false;
+    }
+    // Trang đã ánh xạ thuộc về page table, kể cả khi hai trang sau thất bại
+    return map_memory(as->page_table, VDSO_DATA_ADDR, vdso_data_phys, BLOCK_SIZE, shared) &&
+           map_memory(as->page_table, VDSO_CODE_ADDR, vdso_code_phys, BLOCK_SIZE, shared);
+}
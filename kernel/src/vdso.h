@@ -0,0 +1,70 @@
+// vdso.h
+#ifndef VDSO_H
+#define VDSO_H
+
+// vDSO: các trang chỉ đọc được ánh xạ vào mọi tiến trình để đọc PID, thời gian và CPU
+// hiện tại mà không cần syscall. Phần hằng số dưới đây cũng được vdso.S dùng
+
+// Địa chỉ user cố định, ngay trên user stack của tiến trình
+#define VDSO_DATA_ADDR 0x7FFFFFFF0000   // Dữ liệu chung của mọi tiến trình
+#define VDSO_PROC_ADDR 0x7FFFFFFF1000   // Dữ liệu riêng của tiến trình (PID)
+#define VDSO_CODE_ADDR 0x7FFFFFFF2000   // Mã
+
+// Bảng nhảy ở đầu trang mã: mỗi hàm một ô 8 byte
+#define VDSO_GETPID_OFFSET    0     // int getpid(void)
+#define VDSO_CLOCK_NS_OFFSET  8     // uint64_t clock_ns(void): ns kể từ khi hiệu chỉnh TSC
+#define VDSO_COARSE_NS_OFFSET 16    // uint64_t coarse_ns(void): như trên, chính xác tới một tick
+#define VDSO_GETCPU_OFFSET    24    // int getcpu(void): CPU đang chạy, -1 nếu CPU không có RDTSCP
+
+// Offset trong trang dữ liệu chung (khớp với vdso_data_t)
+#define VDSO_DATA_SEQ        0
+#define VDSO_DATA_HAS_RDTSCP 4
+#define VDSO_DATA_TSC_BASE   8
+#define VDSO_DATA_TSC_MULT   16
+#define VDSO_DATA_COARSE_NS  24
+
+#ifndef __ASSEMBLER__
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "percpu.h"
+#include "address_space.h"
+
+typedef struct {
+    uint32_t lapic_id;
+    uint32_t online;
+} vdso_cpu_t;
+
+// Trang dữ liệu chung. Các trường được ghi sau khi khởi tạo nằm trong seqlock: seq lẻ khi
+// kernel đang ghi, user space đọc lại nếu seq lẻ hoặc đã đổi
+typedef struct {
+    volatile uint32_t seq;
+    uint32_t has_rdtscp;            // IA32_TSC_AUX của mỗi CPU chứa chỉ số CPU
+    uint64_t tsc_base;              // ns = ((tsc - tsc_base) * tsc_ns_mult) >> 32
+    uint64_t tsc_ns_mult;
+    volatile uint64_t coarse_ns;    // Thời điểm của tick gần nhất
+    uint32_t cpu_count;
+    uint32_t reserved;
+    vdso_cpu_t cpus[MAX_CPUS];
+} vdso_data_t;
+
+// Trang dữ liệu riêng của tiến trình, dùng chung bởi mọi luồng của nó
+typedef struct {
+    uint64_t pid;                   // tgid
+} vdso_proc_t;
+
+// Tạo trang dữ liệu và trang mã (gọi một lần trên BSP, sau timer_init và smp_init)
+void vdso_init();
+
+// Ghi chỉ số CPU vào IA32_TSC_AUX cho RDTSCP (gọi trên mỗi CPU)
+void vdso_init_cpu();
+
+// Ánh xạ vDSO vào không gian địa chỉ của tiến trình pid. false nếu hết bộ nhớ
+bool vdso_map(address_space_t *as, uint64_t pid);
+
+// Gọi từ ngắt timer: cập nhật đồng hồ thô
+void vdso_tick(uint64_t now);
+
+#endif // __ASSEMBLER__
+
+#endif // VDSO_H
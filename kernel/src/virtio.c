@@ -0,0 +1,174 @@
+// virtio.c
+#include "virtio.h"
+#include "io.h"
+#include "memory_manager.h"
+#include "klibc.h"
+#include "graphics.h"
+#include "timer.h"
+#include "config.h"
+
+#define ALIGN_UP(x, align) (((x) + ((align) - 1)) & ~((uint64_t)(align) - 1))
+
+static uint8_t virtio_get_status(virtio_device_t *dev) {
+    return inb(dev->io_base + VIRTIO_PCI_STATUS);
+}
+
+static void virtio_set_status(virtio_device_t *dev, uint8_t status) {
+    outb(dev->io_base + VIRTIO_PCI_STATUS, status);
+}
+
+/**
+ * Resets a legacy virtio-pci device and negotiates features.
+ *
+ * Only the legacy (transitional) register layout in BAR0 is supported, which
+ * is what QEMU exposes for devices on the root bus of both the pc and q35
+ * machines. The accepted feature set is the intersection of what the host
+ * offers and @p wanted_features and is stored in @p dev->features.
+ *
+ * @param dev The device state to initialise.
+ * @param pci The PCI location of the device.
+ * @param wanted_features The feature bits the driver understands.
+ * @return true on success, false if BAR0 is not an I/O BAR.
+ */
+bool virtio_device_init(virtio_device_t *dev, const pci_device_t *pci, uint32_t wanted_features) {
+    bool is_io;
+    uint64_t bar = pci_read_bar(pci, 0, &is_io);
+    if (!is_io || bar == 0) {
+        kprintf("Virtio: Device %x has no legacy I/O BAR\n", pci->device_id);
+        return false;
+    }
+
+    dev->pci = *pci;
+    dev->io_base = (uint16_t)bar;
+    pci_enable_device(pci);
+
+    virtio_set_status(dev, 0);
+    virtio_set_status(dev, VIRTIO_STATUS_ACKNOWLEDGE);
+    virtio_set_status(dev, VIRTIO_STATUS_ACKNOWLEDGE | VIRTIO_STATUS_DRIVER);
+
+    uint32_t host_features = inl(dev->io_base + VIRTIO_PCI_HOST_FEATURES);
+    dev->features = host_features & wanted_features;
+    outl(dev->io_base + VIRTIO_PCI_GUEST_FEATURES, dev->features);
+    return true;
+}
+
+void virtio_device_ready(virtio_device_t *dev) {
+    virtio_set_status(dev, virtio_get_status(dev) | VIRTIO_STATUS_DRIVER_OK);
+}
+
+void virtio_device_fail(virtio_device_t *dev) {
+    virtio_set_status(dev, virtio_get_status(dev) | VIRTIO_STATUS_FAILED);
+}
+
+uint32_t virtio_config_read32(virtio_device_t *dev, uint16_t offset) {
+    return inl(dev->io_base + VIRTIO_PCI_CONFIG + offset);
+}
+
+void virtio_config_write32(virtio_device_t *dev, uint16_t offset, uint32_t value) {
+    outl(dev->io_base + VIRTIO_PCI_CONFIG + offset, value);
+}
+
+uint8_t virtio_read_isr(virtio_device_t *dev) {
+    return inb(dev->io_base + VIRTIO_PCI_ISR);
+}
+
+/**
+ * Allocates the rings of virtqueue @p index and hands them to the device.
+ *
+ * The legacy interface requires the descriptor table, available ring and
+ * used ring to live in one physically contiguous area, with the used ring
+ * starting on the next 4 KiB boundary.
+ *
+ * @param dev The device owning the queue.
+ * @param vq The queue state to initialise.
+ * @param index The queue index on the device.
+ * @return true on success, false if the queue does not exist or memory is
+ *         exhausted.
+ */
+bool virtq_init(virtio_device_t *dev, virtq_t *vq, uint16_t index) {
+    outw(dev->io_base + VIRTIO_PCI_QUEUE_SELECT, index);
+    uint16_t size = inw(dev->io_base + VIRTIO_PCI_QUEUE_SIZE);
+    if (size == 0) {
+        return false;
+    }
+
+    uint64_t avail_offset = sizeof(virtq_desc_t) * size;
+    uint64_t used_offset = ALIGN_UP(avail_offset + sizeof(uint16_t) * (3 + size), VIRTQ_ALIGN);
+    uint64_t total = used_offset + ALIGN_UP(sizeof(uint16_t) * 3 + sizeof(virtq_used_elem_t) * size, VIRTQ_ALIGN);
+
+    uint64_t pages = total / BLOCK_SIZE;
+    uint64_t phys = allocate_physical_blocks(pages);
+    if (!phys) {
+        kprintf("Virtio: Failed to allocate queue %d\n", index);
+        return false;
+    }
+    memset(PHYS_TO_VIRT(phys), 0, total);
+
+    vq->index = index;
+    vq->size = size;
+    vq->last_used_idx = 0;
+    vq->broken = false;
+    vq->phys = phys;
+    vq->pages = pages;
+    vq->desc = (volatile virtq_desc_t *)PHYS_TO_VIRT(phys);
+    vq->avail = (volatile virtq_avail_t *)PHYS_TO_VIRT(phys + avail_offset);
+    vq->used = (volatile virtq_used_t *)PHYS_TO_VIRT(phys + used_offset);
+
+    outl(dev->io_base + VIRTIO_PCI_QUEUE_PFN, (uint32_t)(phys / BLOCK_SIZE));
+    return true;
+}
+
+/**
+ * Posts one descriptor chain, notifies the device and polls for completion.
+ *
+ * The driver keeps at most one chain in flight per queue, so the chain always
+ * starts at descriptor 0. This keeps the queue bookkeeping trivial; batching
+ * happens inside the chain instead (many buffers per notification).
+ *
+ * A device that does not return the chain within VIRTQ_TIMEOUT_MS still owns
+ * descriptor 0, so the queue is marked broken and every later submission on
+ * it fails immediately.
+ *
+ * @param dev The device owning the queue.
+ * @param vq The queue to submit on.
+ * @param buffers The buffers making up the chain.
+ * @param count The number of buffers, at most the queue size.
+ * @return The number of bytes written by the device, or -1 on failure.
+ */
+int64_t virtq_submit_sync(virtio_device_t *dev, virtq_t *vq, const virtq_buffer_t *buffers, uint16_t count) {
+    if (vq->broken || count == 0 || count > vq->size) {
+        return -1;
+    }
+
+    for (uint16_t i = 0; i < count; i++) {
+        vq->desc[i].addr = buffers[i].phys;
+        vq->desc[i].len = buffers[i].len;
+        vq->desc[i].flags = (buffers[i].device_writable ? VIRTQ_DESC_F_WRITE : 0) |
+                            (i + 1 < count ? VIRTQ_DESC_F_NEXT : 0);
+        vq->desc[i].next = i + 1 < count ? i + 1 : 0;
+    }
+
+    uint16_t avail_idx = vq->avail->idx;
+    vq->avail->ring[avail_idx % vq->size] = 0;
+    // Descriptor phải hiển thị với thiết bị trước khi tăng idx
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    vq->avail->idx = avail_idx + 1;
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    outw(dev->io_base + VIRTIO_PCI_QUEUE_NOTIFY, vq->index);
+
+    uint64_t deadline = timer_now_ns() + VIRTQ_TIMEOUT_MS * 1000000ULL;
+    while (vq->used->idx == vq->last_used_idx) {
+        if (timer_now_ns() > deadline) {
+            kprintf("Virtio: Device %x did not complete a request on queue %d\n", dev->pci.device_id, vq->index);
+            vq->broken = true;
+            return -1;
+        }
+        cpu_relax();
+    }
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+    uint32_t written = vq->used->ring[vq->last_used_idx % vq->size].len;
+    vq->last_used_idx++;
+    return written;
+}
@@ -0,0 +1,107 @@
+// virtio.h
+#ifndef VIRTIO_H
+#define VIRTIO_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "pci.h"
+
+#define VIRTIO_PCI_VENDOR_ID 0x1AF4
+
+// Thanh ghi của giao diện virtio-pci legacy (BAR0 là cổng I/O)
+#define VIRTIO_PCI_HOST_FEATURES  0x00
+#define VIRTIO_PCI_GUEST_FEATURES 0x04
+#define VIRTIO_PCI_QUEUE_PFN      0x08
+#define VIRTIO_PCI_QUEUE_SIZE     0x0C
+#define VIRTIO_PCI_QUEUE_SELECT   0x0E
+#define VIRTIO_PCI_QUEUE_NOTIFY   0x10
+#define VIRTIO_PCI_STATUS         0x12
+#define VIRTIO_PCI_ISR            0x13
+#define VIRTIO_PCI_CONFIG         0x14 // Không dùng MSI-X
+
+// Các bit trạng thái thiết bị
+#define VIRTIO_STATUS_ACKNOWLEDGE 0x1
+#define VIRTIO_STATUS_DRIVER      0x2
+#define VIRTIO_STATUS_DRIVER_OK   0x4
+#define VIRTIO_STATUS_FAILED      0x80
+
+// Cờ của descriptor
+#define VIRTQ_DESC_F_NEXT  0x1
+#define VIRTQ_DESC_F_WRITE 0x2
+
+#define VIRTQ_ALIGN 4096
+
+typedef struct {
+    uint64_t addr;
+    uint32_t len;
+    uint16_t flags;
+    uint16_t next;
+} __attribute__((packed)) virtq_desc_t;
+
+typedef struct {
+    uint16_t flags;
+    uint16_t idx;
+    uint16_t ring[];
+} __attribute__((packed)) virtq_avail_t;
+
+typedef struct {
+    uint32_t id;
+    uint32_t len;
+} __attribute__((packed)) virtq_used_elem_t;
+
+typedef struct {
+    uint16_t flags;
+    uint16_t idx;
+    virtq_used_elem_t ring[];
+} __attribute__((packed)) virtq_used_t;
+
+// Một split virtqueue. Bộ đệm được gửi theo lô và driver chờ bằng polling
+typedef struct {
+    uint16_t index;
+    uint16_t size;
+    uint16_t last_used_idx;
+    bool broken;                    // Thiết bị không trả lại chuỗi trong VIRTQ_TIMEOUT_MS
+    uint64_t phys;                  // Địa chỉ vật lý của vùng nhớ queue
+    uint64_t pages;                 // Số trang đã cấp phát cho queue
+    volatile virtq_desc_t *desc;
+    volatile virtq_avail_t *avail;
+    volatile virtq_used_t *used;
+} virtq_t;
+
+// Một buffer trong chuỗi descriptor
+typedef struct {
+    uint64_t phys;
+    uint32_t len;
+    bool device_writable;
+} virtq_buffer_t;
+
+typedef struct {
+    pci_device_t pci;
+    uint16_t io_base;
+    uint32_t features;             // Các feature đã thỏa thuận
+} virtio_device_t;
+
+// Khởi tạo thiết bị legacy: reset, ACKNOWLEDGE|DRIVER và thỏa thuận feature
+bool virtio_device_init(virtio_device_t *dev, const pci_device_t *pci, uint32_t wanted_features);
+
+// Báo cho thiết bị rằng driver đã sẵn sàng
+void virtio_device_ready(virtio_device_t *dev);
+
+// Đánh dấu thiết bị lỗi
+void virtio_device_fail(virtio_device_t *dev);
+
+// Đọc/ghi vùng cấu hình riêng của thiết bị
+uint32_t virtio_config_read32(virtio_device_t *dev, uint16_t offset);
+void virtio_config_write32(virtio_device_t *dev, uint16_t offset, uint32_t value);
+
+// Đọc (và xóa) thanh ghi ISR
+uint8_t virtio_read_isr(virtio_device_t *dev);
+
+// Cấp phát và đăng ký virtqueue thứ index với thiết bị
+bool virtq_init(virtio_device_t *dev, virtq_t *vq, uint16_t index);
+
+// Gửi một chuỗi buffer, báo thiết bị và chờ đến khi thiết bị trả lại, tối đa VIRTQ_TIMEOUT_MS.
+// Trả về số byte thiết bị đã ghi hoặc -1 nếu thất bại; sau khi hết giờ queue không dùng được nữa
+int64_t virtq_submit_sync(virtio_device_t *dev, virtq_t *vq, const virtq_buffer_t *buffers, uint16_t count);
+
+#endif // VIRTIO_H
@@ -0,0 +1,278 @@
+// virtio_balloon.c
+#include "virtio_balloon.h"
+#include "virtio.h"
+#include "memory_manager.h"
+#include "klibc.h"
+#include "graphics.h"
+#include "workqueue.h"
+#include "config.h"
+
+// Offset trong vùng cấu hình của thiết bị
+#define BALLOON_CONFIG_NUM_PAGES 0
+#define BALLOON_CONFIG_ACTUAL    4
+
+#define BALLOON_VQ_INFLATE 0
+#define BALLOON_VQ_DEFLATE 1
+
+static virtio_device_t balloon_dev;
+static virtq_t inflate_vq;
+static virtq_t deflate_vq;
+static virtq_t reporting_vq;
+static bool balloon_present = false;
+static bool reporting_enabled = false;
+
+// Trang chứa mảng PFN gửi cho thiết bị
+static uint64_t pfn_page_phys;
+static uint32_t *pfn_page;
+
+// Mỗi bit ứng với một khối vật lý đang nằm trong balloon
+static uint8_t *balloon_bitmap;
+static uint64_t balloon_bitmap_blocks;
+static uint64_t deflate_cursor = 0;
+
+static uint64_t report_runs[VIRTIO_BALLOON_REPORT_CAPACITY];
+static virtq_buffer_t report_buffers[VIRTIO_BALLOON_REPORT_CAPACITY];
+
+static virtio_balloon_stats_t balloon_stats;
+
+// Lần kiểm tra kế tiếp của driver
+static delayed_work_t balloon_work;
+
+// Các queue tùy chọn đứng sau inflate/deflate theo thứ tự stats, free page hint, reporting,
+// và chỉ queue có feature đã thỏa thuận mới chiếm một chỉ số
+static uint16_t balloon_reporting_vq_index(uint32_t features) {
+    uint16_t index = BALLOON_VQ_DEFLATE + 1;
+    if (features & (1u << VIRTIO_BALLOON_F_STATS_VQ)) {
+        index++;
+    }
+    if (features & (1u << VIRTIO_BALLOON_F_FREE_PAGE_HINT)) {
+        index++;
+    }
+    return index;
+}
+
+static bool balloon_update();
+static void balloon_work_func(work_t *work);
+
+/**
+ * Probes for a virtio-balloon-pci device, brings it to DRIVER_OK and does
+ * the first resize and free page report before scheduling the periodic one.
+ *
+ * Free page reporting is enabled when the host offers
+ * VIRTIO_BALLOON_F_REPORTING (QEMU: free-page-reporting=on). The index of
+ * the reporting queue depends on which other optional queues were
+ * negotiated.
+ *
+ * @return true if a balloon device was found, initialised and answered the
+ *         first requests.
+ */
+bool virtio_balloon_init() {
+    pci_device_t pci;
+    if (!pci_find_device(VIRTIO_PCI_VENDOR_ID, VIRTIO_BALLOON_DEVICE_ID, &pci)) {
+        return false;
+    }
+
+    uint32_t wanted = (1u << VIRTIO_BALLOON_F_MUST_TELL_HOST) | (1u << VIRTIO_BALLOON_F_REPORTING);
+    if (!virtio_device_init(&balloon_dev, &pci, wanted)) {
+        return false;
+    }
+
+    if (!virtq_init(&balloon_dev, &inflate_vq, BALLOON_VQ_INFLATE) ||
+        !virtq_init(&balloon_dev, &deflate_vq, BALLOON_VQ_DEFLATE)) {
+        kprintf("Virtio Balloon: Failed to set up inflate/deflate queues\n");
+        virtio_device_fail(&balloon_dev);
+        return false;
+    }
+
+    if (balloon_dev.features & (1u << VIRTIO_BALLOON_F_REPORTING)) {
+        reporting_enabled = virtq_init(&balloon_dev, &reporting_vq, balloon_reporting_vq_index(balloon_dev.features));
+    }
+
+    pfn_page_phys = allocate_physical_block();
+    balloon_bitmap_blocks = phys_allocator.total_blocks;
+    uint64_t bitmap_phys = allocate_memory_bytes(balloon_bitmap_blocks / 8);
+    if (!pfn_page_phys || !bitmap_phys) {
+        kprintf("Virtio Balloon: Failed to allocate driver memory\n");
+        virtio_device_fail(&balloon_dev);
+        return false;
+    }
+    pfn_page = (uint32_t *)PHYS_TO_VIRT(pfn_page_phys);
+    balloon_bitmap = (uint8_t *)PHYS_TO_VIRT(bitmap_phys);
+    memset(balloon_bitmap, 0, balloon_bitmap_blocks / 8);
+
+    virtio_device_ready(&balloon_dev);
+    balloon_present = true;
+    if (!balloon_update()) {
+        return false;
+    }
+
+    delayed_work_init(&balloon_work, balloon_work_func);
+    queue_delayed_work(system_wq, &balloon_work, VIRTIO_BALLOON_POLL_MS * 1000000ULL);
+    kprintf("Virtio Balloon: Ready (free page reporting %s)\n", reporting_enabled ? "on" : "off");
+    return true;
+}
+
+/**
+ * Moves up to VIRTIO_BALLOON_PFNS_PER_REQUEST free frames into the balloon.
+ *
+ * @param pages The number of pages the host still wants.
+ * @return The number of pages actually inflated, or -1 if the device did not
+ *         take them (they stay marked as ballooned).
+ */
+static int64_t balloon_inflate(uint64_t pages) {
+    uint64_t n = 0;
+    if (pages > VIRTIO_BALLOON_PFNS_PER_REQUEST) {
+        pages = VIRTIO_BALLOON_PFNS_PER_REQUEST;
+    }
+
+    while (n < pages) {
+        uint64_t phys = allocate_physical_block();
+        if (!phys) {
+            break;
+        }
+        uint64_t block = phys / BLOCK_SIZE;
+        balloon_bitmap[block / 8] |= (1 << (block % 8));
+        pfn_page[n++] = (uint32_t)block;
+    }
+    if (n == 0) {
+        return 0;
+    }
+
+    virtq_buffer_t buffer = { .phys = pfn_page_phys, .len = n * sizeof(uint32_t), .device_writable = false };
+    if (virtq_submit_sync(&balloon_dev, &inflate_vq, &buffer, 1) < 0) {
+        return -1;
+    }
+    return n;
+}
+
+/**
+ * Tells the host about up to VIRTIO_BALLOON_PFNS_PER_REQUEST ballooned frames
+ * and gives them back to the physical allocator afterwards.
+ *
+ * @param pages The number of pages the host wants back.
+ * @return The number of pages actually deflated, or -1 if the host could not
+ *         be told (the frames then stay in the balloon).
+ */
+static int64_t balloon_deflate(uint64_t pages) {
+    uint64_t n = 0;
+    if (pages > VIRTIO_BALLOON_PFNS_PER_REQUEST) {
+        pages = VIRTIO_BALLOON_PFNS_PER_REQUEST;
+    }
+
+    for (uint64_t scanned = 0; scanned < balloon_bitmap_blocks && n < pages; scanned++) {
+        uint64_t block = deflate_cursor;
+        deflate_cursor = (deflate_cursor + 1) % balloon_bitmap_blocks;
+        if (balloon_bitmap[block / 8] & (1 << (block % 8))) {
+            pfn_page[n++] = (uint32_t)block;
+        }
+    }
+    if (n == 0) {
+        return 0;
+    }
+
+    // Với MUST_TELL_HOST, host phải được báo trước khi khung được dùng lại
+    virtq_buffer_t buffer = { .phys = pfn_page_phys, .len = n * sizeof(uint32_t), .device_writable = false };
+    if (virtq_submit_sync(&balloon_dev, &deflate_vq, &buffer, 1) < 0) {
+        return -1;
+    }
+
+    for (uint64_t i = 0; i < n; i++) {
+        uint64_t block = pfn_page[i];
+        balloon_bitmap[block / 8] &= ~(1 << (block % 8));
+        free_physical_block(block * BLOCK_SIZE);
+    }
+    return n;
+}
+
+/**
+ * Reports every free 2 MiB run that changed since the last pass.
+ *
+ * Runs are isolated from the allocator in batches of
+ * VIRTIO_BALLOON_REPORT_CAPACITY, sent as one device-writable descriptor chain
+ * and released once the host has discarded their backing memory. If the
+ * device does not answer, the batch is released anyway: discarding free
+ * memory later is harmless.
+ *
+ * @return false if the device stopped responding.
+ */
+static bool balloon_report_free_pages() {
+    for (;;) {
+        uint64_t count = memory_manager_isolate_free_runs(report_runs, VIRTIO_BALLOON_REPORT_CAPACITY);
+        if (count == 0) {
+            return true;
+        }
+
+        for (uint64_t i = 0; i < count; i++) {
+            report_buffers[i].phys = report_runs[i];
+            report_buffers[i].len = FREE_PAGE_REPORT_RUN_BLOCKS * BLOCK_SIZE;
+            report_buffers[i].device_writable = true;
+        }
+        int64_t ret = virtq_submit_sync(&balloon_dev, &reporting_vq, report_buffers, count);
+        memory_manager_release_reported_runs(report_runs, count);
+        if (ret < 0) {
+            return false;
+        }
+
+        balloon_stats.reported_runs += count;
+        balloon_stats.report_requests++;
+    }
+}
+
+/**
+ * Moves the balloon towards the size the host asks for and reports the free
+ * runs that changed since the last pass.
+ *
+ * A device that stops answering is marked FAILED and the driver stops; the
+ * frames it may have seen stay in the balloon.
+ *
+ * @return false if the device stopped responding.
+ */
+static bool balloon_update() {
+    // Đọc ISR để xóa cờ thay đổi cấu hình
+    virtio_read_isr(&balloon_dev);
+
+    bool ok = true;
+    uint64_t target = virtio_config_read32(&balloon_dev, BALLOON_CONFIG_NUM_PAGES);
+    while (ok && balloon_stats.balloon_pages != target) {
+        int64_t done;
+        if (balloon_stats.balloon_pages < target) {
+            done = balloon_inflate(target - balloon_stats.balloon_pages);
+            if (done > 0) {
+                balloon_stats.balloon_pages += done;
+                balloon_stats.inflated_pages += done;
+            }
+        } else {
+            done = balloon_deflate(balloon_stats.balloon_pages - target);
+            if (done > 0) {
+                balloon_stats.balloon_pages -= done;
+                balloon_stats.deflated_pages += done;
+            }
+        }
+        ok = done >= 0;
+        virtio_config_write32(&balloon_dev, BALLOON_CONFIG_ACTUAL, (uint32_t)balloon_stats.balloon_pages);
+        if (done == 0) {
+            break; // Hết bộ nhớ trống, thử lại ở lần kiểm tra sau
+        }
+    }
+
+    if (ok && reporting_enabled) {
+        ok = balloon_report_free_pages();
+    }
+    if (!ok) {
+        kprintf("Virtio Balloon: Device stopped responding, driver disabled\n");
+        virtio_device_fail(&balloon_dev);
+        balloon_present = false;
+    }
+    return ok;
+}
+
+static void balloon_work_func(work_t *work) {
+    (void)work;
+    if (balloon_present && balloon_update()) {
+        queue_delayed_work(system_wq, &balloon_work, VIRTIO_BALLOON_POLL_MS * 1000000ULL);
+    }
+}
+
+void virtio_balloon_get_stats(virtio_balloon_stats_t *stats) {
+    *stats = balloon_stats;
+}
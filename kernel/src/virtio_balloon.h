@@ -0,0 +1,40 @@
+// virtio_balloon.h
+#ifndef VIRTIO_BALLOON_H
+#define VIRTIO_BALLOON_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Device ID của virtio-balloon (giao diện transitional/legacy)
+#define VIRTIO_BALLOON_DEVICE_ID 0x1002
+
+// Các feature bit của virtio-balloon
+#define VIRTIO_BALLOON_F_MUST_TELL_HOST 0
+#define VIRTIO_BALLOON_F_STATS_VQ       1
+#define VIRTIO_BALLOON_F_FREE_PAGE_HINT 3
+#define VIRTIO_BALLOON_F_REPORTING      5
+
+// Số PFN tối đa trong một yêu cầu inflate/deflate
+#define VIRTIO_BALLOON_PFNS_PER_REQUEST 256
+
+// Số vùng 2 MiB tối đa trong một yêu cầu báo cáo trang trống
+#define VIRTIO_BALLOON_REPORT_CAPACITY 32
+
+// Bộ đếm của driver
+typedef struct {
+    uint64_t balloon_pages;      // Số trang đang nằm trong balloon
+    uint64_t inflated_pages;     // Tổng số trang đã inflate
+    uint64_t deflated_pages;     // Tổng số trang đã deflate
+    uint64_t reported_runs;      // Tổng số vùng 2 MiB đã báo cáo cho host
+    uint64_t report_requests;    // Số yêu cầu báo cáo đã gửi
+} virtio_balloon_stats_t;
+
+// Tìm và khởi tạo thiết bị virtio-balloon-pci, đưa balloon về kích thước host yêu cầu và báo
+// cáo các vùng trống. Sau đó driver tự làm lại việc này mỗi VIRTIO_BALLOON_POLL_MS trên system_wq
+// (gọi sau workqueue_init). Trả về false nếu không có thiết bị hoặc thiết bị không phản hồi
+bool virtio_balloon_init();
+
+// Lấy bộ đếm hiện tại
+void virtio_balloon_get_stats(virtio_balloon_stats_t *stats);
+
+#endif // VIRTIO_BALLOON_H
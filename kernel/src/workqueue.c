@@ -0,0 +1,230 @@
+// workqueue.c
+#include "workqueue.h"
+#include "kthread.h"
+#include "softirq.h"
+#include "scheduler.h"
+#include "memory_manager.h"
+#include "paging.h"
+#include "timer.h"
+#include "klibc.h"
+#include "graphics.h"
+
+workqueue_t *system_wq;
+static workqueue_t system_wq_storage;
+
+// Delayed work đang chờ của mỗi CPU, sắp theo expires; chỉ CPU sở hữu chạm vào, khi đã tắt ngắt
+static delayed_work_t *delayed_lists[MAX_CPUS];
+
+/**
+ * Body of a worker thread: runs the pool's work in FIFO order and sleeps
+ * while the pool is empty.
+ *
+ * The state is set to BLOCKED under the pool lock, so a queue_work() that
+ * slips in before schedule() finds it blocked and wakes it; schedule() then
+ * returns at once.
+ */
+static void worker_main(void *arg) {
+    worker_pool_t *pool = arg;
+    process_t *self = process_current();
+    for (;;) {
+        uint64_t flags = spin_lock_irqsave(&pool->lock);
+        work_t *work = pool->head;
+        if (!work) {
+            self->state = PROCESS_STATE_BLOCKED;
+            spin_unlock_irqrestore(&pool->lock, flags);
+            schedule();
+            continue;
+        }
+        pool->head = work->next;
+        if (!pool->head) {
+            pool->tail = NULL;
+        }
+        // Xóa trước khi chạy: func có thể đưa chính nó vào hàng đợi lần nữa
+        __atomic_store_n(&work->pending, false, __ATOMIC_RELEASE);
+        spin_unlock_irqrestore(&pool->lock, flags);
+
+        work->func(work);
+        pool->nr_done++;
+        cond_resched();
+    }
+}
+
+// Dựng hàng đợi trong bộ nhớ cho trước và tạo worker trên mỗi CPU online
+static bool workqueue_setup(workqueue_t *wq, const char *name) {
+    memset(wq, 0, sizeof(workqueue_t));
+    wq->name = name;
+    bool any = false;
+    for (uint32_t i = 0; i < cpu_count; i++) {
+        worker_pool_t *pool = &wq->pools[i];
+        spin_init_named(&pool->lock, name);
+        if (!cpus[i].online) {
+            continue;
+        }
+        pool->worker = kthread_create(worker_main, pool, (int)i);
+        if (!pool->worker) {
+            kprintf("Workqueue %s: Failed to start worker on CPU %u\n", name, i);
+            continue;
+        }
+        any = true;
+    }
+    return any;
+}
+
+workqueue_t *workqueue_create(const char *name) {
+    uint64_t phys = allocate_memory_bytes(sizeof(workqueue_t));
+    if (!phys) {
+        kprintf("Workqueue %s: Failed to allocate memory\n", name);
+        return NULL;
+    }
+    workqueue_t *wq = (workqueue_t *)PHYS_TO_VIRT(phys);
+    if (!workqueue_setup(wq, name)) {
+        // Worker nào đã tạo được vẫn giữ con trỏ tới pool: không giải phóng
+        return NULL;
+    }
+    return wq;
+}
+
+void workqueue_init() {
+    if (workqueue_setup(&system_wq_storage, "system_wq")) {
+        system_wq = &system_wq_storage;
+    }
+}
+
+bool queue_work_on(workqueue_t *wq, uint32_t cpu, work_t *work) {
+    worker_pool_t *pool = cpu < MAX_CPUS ? &wq->pools[cpu] : NULL;
+    // CPU không có worker (không online): dùng worker đầu tiên có được
+    for (uint32_t i = 0; (!pool || !pool->worker) && i < cpu_count; i++) {
+        pool = &wq->pools[i];
+    }
+    if (!pool || !pool->worker) {
+        return false;
+    }
+    if (__atomic_exchange_n(&work->pending, true, __ATOMIC_ACQ_REL)) {
+        return false;
+    }
+
+    uint64_t flags = spin_lock_irqsave(&pool->lock);
+    work->next = NULL;
+    if (pool->tail) {
+        pool->tail->next = work;
+    } else {
+        pool->head = work;
+    }
+    pool->tail = work;
+    spin_unlock_irqrestore(&pool->lock, flags);
+
+    sched_wakeup(pool->worker);
+    return true;
+}
+
+bool queue_work(workqueue_t *wq, work_t *work) {
+    return queue_work_on(wq, this_cpu()->id, work);
+}
+
+/**
+ * Queues @p dw on this CPU's worker once @p delay_ns has passed.
+ *
+ * The item waits on this CPU's timer list; expiry is checked on every tick,
+ * and an idle CPU with its tick stopped arms its timer for the earliest
+ * expiry (see timer_idle_enter), so the delay is accurate to about one tick.
+ *
+ * @return false if @p dw is already waiting or queued.
+ */
+bool queue_delayed_work(workqueue_t *wq, delayed_work_t *dw, uint64_t delay_ns) {
+    if (!delay_ns) {
+        return queue_work(wq, &dw->work);
+    }
+    if (__atomic_exchange_n(&dw->work.pending, true, __ATOMIC_ACQ_REL)) {
+        return false;
+    }
+
+    uint64_t flags = irq_save();
+    cpu_t *cpu = this_cpu();
+    dw->wq = wq;
+    dw->cpu = cpu->id;
+    dw->expires = timer_now_ns() + delay_ns;
+    delayed_work_t **link = &delayed_lists[cpu->id];
+    while (*link && (*link)->expires <= dw->expires) {
+        link = &(*link)->next;
+    }
+    dw->next = *link;
+    *link = dw;
+    irq_restore(flags);
+    return true;
+}
+
+void delayed_work_tick(uint64_t now) {
+    delayed_work_t *first = delayed_lists[this_cpu()->id];
+    if (first && first->expires <= now) {
+        raise_softirq(SOFTIRQ_TIMER);
+    }
+}
+
+void delayed_work_run(void) {
+    uint64_t now = timer_now_ns();
+    for (;;) {
+        uint64_t flags = irq_save();
+        delayed_work_t **head = &delayed_lists[this_cpu()->id];
+        delayed_work_t *dw = *head;
+        if (!dw || dw->expires > now) {
+            irq_restore(flags);
+            return;
+        }
+        *head = dw->next;
+        dw->next = NULL;
+        irq_restore(flags);
+
+        // pending vẫn đang bật từ lúc hẹn giờ: xóa để queue_work_on nhận việc
+        __atomic_store_n(&dw->work.pending, false, __ATOMIC_RELEASE);
+        queue_work_on(dw->wq, dw->cpu, &dw->work);
+    }
+}
+
+uint64_t delayed_work_next_expiry(void) {
+    delayed_work_t *first = delayed_lists[this_cpu()->id];
+    return first ? first->expires : UINT64_MAX;
+}
+
+// Việc rào chắn của flush_workqueue: chạy sau mọi việc đứng trước nó trong cùng hàng đợi
+typedef struct {
+    work_t work;
+    volatile bool done;
+} wq_barrier_t;
+
+static void wq_barrier_func(work_t *work) {
+    wq_barrier_t *barrier = container_of(work, wq_barrier_t, work);
+    __atomic_store_n(&barrier->done, true, __ATOMIC_RELEASE);
+}
+
+/**
+ * Waits until all work queued on @p wq before the call has run.
+ *
+ * Each pool runs its work in order, so a barrier item appended to every
+ * pool has run only after everything ahead of it. Work queued later, or
+ * delayed work still waiting for its timer, is not waited for.
+ */
+void flush_workqueue(workqueue_t *wq) {
+    wq_barrier_t barriers[MAX_CPUS];
+    for (uint32_t i = 0; i < cpu_count; i++) {
+        barriers[i].done = true;
+        if (!wq->pools[i].worker) {
+            continue;
+        }
+        work_init(&barriers[i].work, wq_barrier_func);
+        barriers[i].done = false;
+        queue_work_on(wq, i, &barriers[i].work);
+    }
+    for (uint32_t i = 0; i < cpu_count; i++) {
+        while (!__atomic_load_n(&barriers[i].done, __ATOMIC_ACQUIRE)) {
+            sched_yield();
+        }
+    }
+}
+
+void workqueue_dump(workqueue_t *wq) {
+    for (uint32_t i = 0; i < cpu_count; i++) {
+        if (wq->pools[i].worker) {
+            kprintf("Workqueue %s: CPU %u ran %llu work items\n", wq->name, i, wq->pools[i].nr_done);
+        }
+    }
+}
@@ -0,0 +1,90 @@
+// workqueue.h
+#ifndef WORKQUEUE_H
+#define WORKQUEUE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "process.h"
+#include "percpu.h"
+#include "spinlock.h"
+
+// Work queue: việc được chạy sau trong một luồng kernel (worker), nên có thể lấy khóa,
+// chờ và chạy lâu mà không giữ ngắt hay chiếm quyền tắt. Mỗi CPU có một worker riêng.
+
+struct work;
+typedef void (*work_func_t)(struct work *work);
+
+// Một việc, thường nhúng trong đối tượng mà nó xử lý (lấy lại bằng container_of)
+typedef struct work {
+    struct work *next;
+    work_func_t func;
+    volatile bool pending;      // Đang nằm trong hàng đợi; xóa ngay trước khi func chạy
+} work_t;
+
+// Việc được đưa vào hàng đợi sau một khoảng thời gian
+typedef struct delayed_work {
+    work_t work;
+    struct workqueue *wq;
+    uint32_t cpu;               // CPU có worker sẽ chạy việc
+    uint64_t expires;           // Thời điểm tới hạn (ns, timer_now_ns)
+    struct delayed_work *next;  // Danh sách chờ của CPU đã hẹn giờ, sắp theo expires
+} delayed_work_t;
+
+// Hàng đợi và worker của một CPU
+typedef struct worker_pool {
+    spinlock_t lock;            // Bảo vệ head/tail; worker đánh thức được từ ngắt nên luôn lấy kèm tắt ngắt
+    work_t *head;
+    work_t *tail;
+    process_t *worker;          // Luồng kernel gắn với CPU, NULL nếu CPU không online
+    uint64_t nr_done;           // Số việc đã chạy
+} worker_pool_t;
+
+typedef struct workqueue {
+    const char *name;
+    worker_pool_t pools[MAX_CPUS];
+} workqueue_t;
+
+// Hàng đợi dùng chung cho việc nền của kernel
+extern workqueue_t *system_wq;
+
+// Tạo system_wq (gọi sau smp_init)
+void workqueue_init();
+
+// Tạo hàng đợi với một worker cho mỗi CPU online; NULL nếu hết bộ nhớ
+workqueue_t *workqueue_create(const char *name);
+
+static inline void work_init(work_t *work, work_func_t func) {
+    work->next = NULL;
+    work->func = func;
+    work->pending = false;
+}
+
+static inline void delayed_work_init(delayed_work_t *dw, work_func_t func) {
+    work_init(&dw->work, func);
+    dw->next = NULL;
+}
+
+// Đưa việc vào hàng đợi của CPU hiện tại / của CPU cpu (an toàn trong ngắt).
+// Trả về false nếu việc đang chờ chạy rồi
+bool queue_work(workqueue_t *wq, work_t *work);
+bool queue_work_on(workqueue_t *wq, uint32_t cpu, work_t *work);
+
+// Đưa việc vào hàng đợi của CPU hiện tại sau ít nhất delay_ns (độ chính xác một tick)
+bool queue_delayed_work(workqueue_t *wq, delayed_work_t *dw, uint64_t delay_ns);
+
+// Chờ mọi việc đã vào hàng đợi trước lúc gọi chạy xong (gọi từ tiến trình, không trong ngắt)
+void flush_workqueue(workqueue_t *wq);
+
+// Gọi từ ngắt timer: báo softirq khi có delayed work của CPU tới hạn
+void delayed_work_tick(uint64_t now);
+
+// Softirq SOFTIRQ_TIMER: chuyển delayed work đã tới hạn vào hàng đợi
+void delayed_work_run(void);
+
+// Thời điểm tới hạn sớm nhất của delayed work trên CPU hiện tại (UINT64_MAX nếu không có)
+uint64_t delayed_work_next_expiry(void);
+
+// In số việc đã chạy của mỗi worker
+void workqueue_dump(workqueue_t *wq);
+
+#endif // WORKQUEUE_H
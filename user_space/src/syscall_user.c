@@ -1,8 +1,34 @@
 #include "syscall_user.h"
+#include <stddef.h>
 
 long syscall(long number, long arg1, long arg2, long arg3) {
     long ret;
-    // Assuming you use interrupt 0x80 for syscalls
+    // Lệnh syscall ghi đè RCX (RIP trở về) và R11 (RFLAGS)
+    asm volatile (
+        "syscall"
+        : "=a" (ret)
+        : "0" (number), "D" (arg1), "S" (arg2), "d" (arg3)
+        : "rcx", "r11", "memory"
+    );
+    return ret;
+}
+
+long syscall6(long number, long arg1, long arg2, long arg3, long arg4, long arg5, long arg6) {
+    long ret;
+    register long r10 asm("r10") = arg4;
+    register long r8 asm("r8") = arg5;
+    register long r9 asm("r9") = arg6;
+    asm volatile (
+        "syscall"
+        : "=a" (ret)
+        : "0" (number), "D" (arg1), "S" (arg2), "d" (arg3), "r" (r10), "r" (r8), "r" (r9)
+        : "rcx", "r11", "memory"
+    );
+    return ret;
+}
+
+long syscall_int80(long number, long arg1, long arg2, long arg3) {
+    long ret;
     asm volatile (
         "int $0x80"
         : "=a" (ret)
@@ -47,10 +73,233 @@ pid_t kill(pid_t pid, int sig) {
 }
 
 pid_t getpid(void) {
-    return syscall(SYSCALL_GETPID, 0, 0, 0);
+    return ((pid_t (*)(void))(VDSO_CODE_ADDR + VDSO_GETPID_OFFSET))();
 }
 
 void *sbrk(intptr_t increment) {
-    // Giả sử không cần quản lý heap động, chỉ trả về lỗi
-    return (void *)-1;
-}
\ No newline at end of file
+    return (void *)syscall(SYSCALL_SBRK, increment, 0, 0);
+}
+
+// Kernel trả về break hiện tại; break không đổi tới addr nghĩa là thất bại
+int brk(void *addr) {
+    return syscall(SYSCALL_BRK, (long)addr, 0, 0) == (long)addr ? 0 : -1;
+}
+
+int pkey_alloc(unsigned int flags, unsigned int access_rights) {
+    return syscall(SYSCALL_PKEY_ALLOC, flags, access_rights, 0);
+}
+
+int pkey_free(int pkey) {
+    return syscall(SYSCALL_PKEY_FREE, pkey, 0, 0);
+}
+
+int pkey_mprotect(void *addr, size_t len, int pkey) {
+    return syscall(SYSCALL_PKEY_MPROTECT, (long)addr, len, pkey);
+}
+
+int nice(int inc) {
+    return syscall(SYSCALL_NICE, inc, 0, 0);
+}
+
+int sched_setaffinity(uint64_t mask) {
+    return syscall(SYSCALL_SCHED_SETAFFINITY, (long)mask, 0, 0);
+}
+
+uint64_t sched_getaffinity(void) {
+    return (uint64_t)syscall(SYSCALL_SCHED_GETAFFINITY, 0, 0, 0);
+}
+
+int sched_setdeadline(uint64_t runtime, uint64_t deadline, uint64_t period) {
+    return syscall(SYSCALL_SCHED_SETDEADLINE, (long)runtime, (long)deadline, (long)period);
+}
+
+int sched_yield(void) {
+    return syscall(SYSCALL_SCHED_YIELD, 0, 0, 0);
+}
+
+int sched_getdlstats(uint64_t stats[2]) {
+    return syscall(SYSCALL_SCHED_GETDLSTATS, (long)stats, 0, 0);
+}
+
+int thread_create(void (*entry)(void *arg), void *stack, void *arg) {
+    return syscall(SYSCALL_THREAD_CREATE, (long)entry, (long)stack, (long)arg);
+}
+
+pid_t gettid(void) {
+    return syscall(SYSCALL_GETTID, 0, 0, 0);
+}
+
+int set_fs_base(void *base) {
+    return syscall(SYSCALL_SET_FS_BASE, (long)base, 0, 0);
+}
+
+int futex_wait(volatile uint32_t *uaddr, uint32_t val, uint64_t timeout_ns) {
+    return syscall(SYSCALL_FUTEX_WAIT, (long)uaddr, val, (long)timeout_ns);
+}
+
+int futex_wake(volatile uint32_t *uaddr, uint32_t nr) {
+    return syscall(SYSCALL_FUTEX_WAKE, (long)uaddr, nr, 0);
+}
+
+int futex_requeue(volatile uint32_t *uaddr, volatile uint32_t *uaddr2, uint32_t nr_wake, uint32_t nr_requeue) {
+    return syscall6(SYSCALL_FUTEX_REQUEUE, (long)uaddr, (long)uaddr2, nr_wake, nr_requeue, 0, 0);
+}
+
+int syscall_getstats(int nr, syscall_stats_t *stats) {
+    return syscall(SYSCALL_GETSTATS, nr, (long)stats, 0);
+}
+
+void mutex_lock(mutex_t *mutex) {
+    uint32_t c = 0;
+    if (__atomic_compare_exchange_n(&mutex->state, &c, 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        return;
+    }
+    // Đánh dấu có người chờ trước khi ngủ để mutex_unlock biết phải gọi futex_wake
+    if (c != 2) {
+        c = __atomic_exchange_n(&mutex->state, 2, __ATOMIC_ACQUIRE);
+    }
+    while (c != 0) {
+        futex_wait(&mutex->state, 2, 0);
+        c = __atomic_exchange_n(&mutex->state, 2, __ATOMIC_ACQUIRE);
+    }
+}
+
+void mutex_unlock(mutex_t *mutex) {
+    if (__atomic_fetch_sub(&mutex->state, 1, __ATOMIC_RELEASE) != 1) {
+        __atomic_store_n(&mutex->state, 0, __ATOMIC_RELEASE);
+        futex_wake(&mutex->state, 1);
+    }
+}
+
+uint64_t clock_gettime_ns(int clock) {
+    switch (clock) {
+    case CLOCK_MONOTONIC:
+        return ((uint64_t (*)(void))(VDSO_CODE_ADDR + VDSO_CLOCK_NS_OFFSET))();
+    case CLOCK_MONOTONIC_COARSE:
+        return ((uint64_t (*)(void))(VDSO_CODE_ADDR + VDSO_COARSE_NS_OFFSET))();
+    default:
+        return 0;
+    }
+}
+
+int getcpu(void) {
+    return ((int (*)(void))(VDSO_CODE_ADDR + VDSO_GETCPU_OFFSET))();
+}
+
+long uring_setup(unsigned entries, unsigned flags) {
+    return syscall(SYSCALL_URING_SETUP, entries, flags, 0);
+}
+
+long uring_enter(unsigned to_submit, unsigned min_complete, unsigned flags) {
+    return syscall(SYSCALL_URING_ENTER, to_submit, min_complete, flags);
+}
+
+int uring_init(uring_t *ring, unsigned entries, unsigned flags) {
+    long addr = uring_setup(entries, flags);
+    if (addr == -1) {
+        return -1;
+    }
+    ring->shared = (uring_shared_t *)addr;
+    ring->sqes = (uring_sqe_t *)(addr + ring->shared->sqes_offset);
+    ring->cqes = (uring_cqe_t *)(addr + ring->shared->cqes_offset);
+    ring->sqe_tail = ring->shared->sq_tail;
+    ring->sqpoll = (flags & URING_SETUP_SQPOLL) != 0;
+    return 0;
+}
+
+uring_sqe_t *uring_get_sqe(uring_t *ring) {
+    uint32_t head = __atomic_load_n(&ring->shared->sq_head, __ATOMIC_ACQUIRE);
+    if (ring->sqe_tail - head >= ring->shared->sq_entries) {
+        return NULL;
+    }
+    uring_sqe_t *sqe = &ring->sqes[ring->sqe_tail & (ring->shared->sq_entries - 1)];
+    ring->sqe_tail++;
+    return sqe;
+}
+
+int uring_submit(uring_t *ring) {
+    uint32_t pending = ring->sqe_tail - ring->shared->sq_tail;
+    // Nội dung SQE phải hiện ra trước chỉ số mới
+    __atomic_store_n(&ring->shared->sq_tail, ring->sqe_tail, __ATOMIC_RELEASE);
+    if (!ring->sqpoll) {
+        return (int)uring_enter(pending, 0, 0);
+    }
+    // Cặp với rào chắn của luồng SQPOLL: hoặc nó thấy chỉ số mới, hoặc ta thấy cờ ngủ
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&ring->shared->flags, __ATOMIC_RELAXED) & URING_SQ_NEED_WAKEUP) {
+        uring_enter(0, 0, URING_ENTER_SQ_WAKEUP);
+    }
+    return (int)pending;
+}
+
+int uring_wait(uring_t *ring, unsigned min_complete) {
+    uint32_t ready = __atomic_load_n(&ring->shared->cq_tail, __ATOMIC_ACQUIRE) - ring->shared->cq_head;
+    if (ready >= min_complete) {
+        return 0;
+    }
+    return uring_enter(0, min_complete, 0) == -1 ? -1 : 0;
+}
+
+uring_cqe_t *uring_peek_cqe(uring_t *ring) {
+    uint32_t head = ring->shared->cq_head;
+    if (head == __atomic_load_n(&ring->shared->cq_tail, __ATOMIC_ACQUIRE)) {
+        return NULL;
+    }
+    return &ring->cqes[head & (ring->shared->cq_entries - 1)];
+}
+
+void uring_cqe_seen(uring_t *ring) {
+    __atomic_store_n(&ring->shared->cq_head, ring->shared->cq_head + 1, __ATOMIC_RELEASE);
+}
+
+void *shm_map(const char *name, size_t size) {
+    return (void *)syscall(SYSCALL_SHM_MAP, (long)name, size, 0);
+}
+
+int shm_unmap(void *addr) {
+    return syscall(SYSCALL_SHM_UNMAP, (long)addr, 0, 0);
+}
+
+int shm_unlink(const char *name) {
+    return syscall(SYSCALL_SHM_UNLINK, (long)name, 0, 0);
+}
+
+int page_send(pid_t pid, void *addr, size_t len) {
+    return syscall(SYSCALL_PAGE_SEND, pid, (long)addr, len);
+}
+
+int page_recv(shm_msg_t *msg, unsigned int flags) {
+    return syscall(SYSCALL_PAGE_RECV, (long)msg, flags, 0);
+}
+
+// Thông điệp đi và về trong rsi, rdx, r10, r8, r9
+static long ipc_syscall(long number, long arg, uint64_t msg[IPC_MSG_WORDS]) {
+    long ret;
+    register uint64_t rsi asm("rsi") = msg[0];
+    register uint64_t rdx asm("rdx") = msg[1];
+    register uint64_t r10 asm("r10") = msg[2];
+    register uint64_t r8 asm("r8") = msg[3];
+    register uint64_t r9 asm("r9") = msg[4];
+    asm volatile (
+        "syscall"
+        : "=a" (ret), "+r" (rsi), "+r" (rdx), "+r" (r10), "+r" (r8), "+r" (r9)
+        : "0" (number), "D" (arg)
+        : "rcx", "r11", "memory"
+    );
+    if (ret >= 0) {
+        msg[0] = rsi;
+        msg[1] = rdx;
+        msg[2] = r10;
+        msg[3] = r8;
+        msg[4] = r9;
+    }
+    return ret;
+}
+
+int ipc_call(pid_t tid, uint64_t msg[IPC_MSG_WORDS]) {
+    return (int)ipc_syscall(SYSCALL_IPC_CALL, tid, msg);
+}
+
+long ipc_reply_wait(pid_t reply_to, uint64_t msg[IPC_MSG_WORDS]) {
+    return ipc_syscall(SYSCALL_IPC_REPLY_WAIT, reply_to, msg);
+}
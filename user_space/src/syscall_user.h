@@ -16,9 +16,43 @@
 #define SYSCALL_EXIT    8
 #define SYSCALL_KILL    9
 #define SYSCALL_GETPID  10
+#define SYSCALL_PKEY_ALLOC    11
+#define SYSCALL_PKEY_FREE     12
+#define SYSCALL_PKEY_MPROTECT 13
+#define SYSCALL_NICE          14
+#define SYSCALL_SCHED_SETAFFINITY 15
+#define SYSCALL_SCHED_GETAFFINITY 16
+#define SYSCALL_SCHED_SETDEADLINE 17
+#define SYSCALL_SCHED_YIELD       18
+#define SYSCALL_SCHED_GETDLSTATS  19
+#define SYSCALL_THREAD_CREATE     20
+#define SYSCALL_GETTID            21
+#define SYSCALL_SET_FS_BASE       22
+#define SYSCALL_FUTEX_WAIT        23
+#define SYSCALL_FUTEX_WAKE        24
+#define SYSCALL_FUTEX_REQUEUE     25
+#define SYSCALL_GETSTATS          26
+#define SYSCALL_URING_SETUP       27
+#define SYSCALL_URING_ENTER       28
+#define SYSCALL_BRK               29
+#define SYSCALL_SHM_MAP           30
+#define SYSCALL_SHM_UNMAP         31
+#define SYSCALL_SHM_UNLINK        32
+#define SYSCALL_PAGE_SEND         33
+#define SYSCALL_PAGE_RECV         34
+#define SYSCALL_IPC_CALL          35
+#define SYSCALL_IPC_REPLY_WAIT    36
 
-// Generic syscall function
+// Quyền truy cập của protection key
+#define PKEY_DISABLE_ACCESS 0x1
+#define PKEY_DISABLE_WRITE  0x2
+
+// Generic syscall function (lệnh syscall)
 long syscall(long number, long arg1, long arg2, long arg3);
+// Đủ sáu tham số theo quy ước Linux (rdi, rsi, rdx, r10, r8, r9)
+long syscall6(long number, long arg1, long arg2, long arg3, long arg4, long arg5, long arg6);
+// Cùng ABI qua int 0x80, đường vào cũ chậm hơn
+long syscall_int80(long number, long arg1, long arg2, long arg3);
 
 // Syscall wrappers
 ssize_t write(int fd, const void *buf, size_t count);
@@ -30,6 +64,193 @@ off_t lseek(int fd, off_t offset, int whence);
 void _exit(int status);
 pid_t kill(pid_t pid, int sig);
 pid_t getpid(void);
+// Heap: sbrk trả về break cũ ((void *)-1 nếu lỗi); brk đặt break, 0 hoặc -1.
+// Vùng mới luôn đã được ánh xạ và xóa, nên truy cập không gây lỗi trang
 void *sbrk(intptr_t increment);
+int brk(void *addr);
+
+// Protection keys: cấp phát key, gán key cho dải trang đã ánh xạ
+int pkey_alloc(unsigned int flags, unsigned int access_rights);
+int pkey_free(int pkey);
+int pkey_mprotect(void *addr, size_t len, int pkey);
+
+// Cộng inc vào mức nice (-20..19) của tiến trình, trả về mức mới
+int nice(int inc);
+
+// Mặt nạ CPU của tiến trình gọi (bit i = CPU i)
+int sched_setaffinity(uint64_t mask);
+uint64_t sched_getaffinity(void);
+
+// Lập lịch deadline (EDF): cần runtime ns CPU trong mỗi period ns, xong trước deadline ns
+// tính từ đầu chu kỳ. runtime = 0 trở về lập lịch công bằng
+int sched_setdeadline(uint64_t runtime, uint64_t deadline, uint64_t period);
+// Nhường CPU; tiến trình deadline ngủ tới chu kỳ kế tiếp
+int sched_yield(void);
+// stats[0] = số job trễ hạn, stats[1] = số lần hết ngân sách
+int sched_getdlstats(uint64_t stats[2]);
+
+// Luồng: chạy entry(arg) trong cùng không gian địa chỉ, trên stack (đỉnh stack) do người gọi cấp.
+// Trả về TID của luồng mới; luồng kết thúc bằng _exit() (chỉ luồng đó kết thúc)
+int thread_create(void (*entry)(void *arg), void *stack, void *arg);
+pid_t gettid(void);
+// Thread-local storage: đặt FS base của luồng gọi (đọc bằng %fs:offset)
+int set_fs_base(void *base);
+
+// Futex: ngủ nếu *uaddr vẫn bằng val (timeout_ns = 0: chờ mãi), trả về 0 khi được đánh thức,
+// -11 (EAGAIN) nếu giá trị đã khác, -110 (ETIMEDOUT) nếu hết giờ, -14/-22 nếu địa chỉ sai.
+// futex_wake/futex_requeue trả về số luồng đã đánh thức (và đã chuyển sang uaddr2), hoặc
+// -14/-22 nếu địa chỉ sai như futex_wait
+int futex_wait(volatile uint32_t *uaddr, uint32_t val, uint64_t timeout_ns);
+int futex_wake(volatile uint32_t *uaddr, uint32_t nr);
+int futex_requeue(volatile uint32_t *uaddr, volatile uint32_t *uaddr2, uint32_t nr_wake, uint32_t nr_requeue);
+
+// Mutex user: không cần syscall khi không tranh chấp, ngủ trên futex khi tranh chấp.
+// state: 0 = tự do, 1 = bị khóa, 2 = bị khóa và có luồng đang chờ
+typedef struct {
+    volatile uint32_t state;
+} mutex_t;
+
+#define MUTEX_INIT { .state = 0 }
+
+void mutex_lock(mutex_t *mutex);
+void mutex_unlock(mutex_t *mutex);
+
+// Thống kê syscall (khớp với syscall.h): hist[i] đếm số lần gọi mất [2^i, 2^(i+1)) chu kỳ TSC
+#define SYSCALL_HIST_BUCKETS 32
+
+typedef struct {
+    uint64_t count;
+    uint64_t hist[SYSCALL_HIST_BUCKETS];
+} syscall_stats_t;
+
+int syscall_getstats(int nr, syscall_stats_t *stats);
+
+// vDSO (khớp với vdso.h): kernel ánh xạ mã và dữ liệu chỉ đọc vào mọi tiến trình, các hàm
+// dưới đây gọi thẳng vào đó mà không vào kernel. getpid() cũng đi qua vDSO
+#define VDSO_CODE_ADDR        0x7FFFFFFF2000
+#define VDSO_GETPID_OFFSET    0
+#define VDSO_CLOCK_NS_OFFSET  8
+#define VDSO_COARSE_NS_OFFSET 16
+#define VDSO_GETCPU_OFFSET    24
+
+#define CLOCK_MONOTONIC        1    // Theo TSC, chính xác tới ns
+#define CLOCK_MONOTONIC_COARSE 6    // Thời điểm tick gần nhất, rẻ hơn
+
+// Nano giây kể từ khi kernel hiệu chỉnh TSC; 0 nếu clock không hợp lệ
+uint64_t clock_gettime_ns(int clock);
+// CPU đang chạy luồng gọi (có thể đã đổi khi hàm trả về), -1 nếu không xác định được
+int getcpu(void);
+
+// Vòng gửi/nhận (khớp với uring.h): ghi nhiều yêu cầu vào vòng SQ rồi gửi bằng một syscall,
+// đọc kết quả từ vòng CQ không cần syscall. Mỗi tiến trình một vòng
+#define URING_OP_NOP        0
+#define URING_OP_WRITE      1   // write(fd, addr, len)
+#define URING_OP_READ       2   // read(fd, addr, len)
+#define URING_OP_FUTEX_WAKE 3   // futex_wake(addr, len)
+#define URING_OP_TIMEOUT    4   // Hoàn thành với res = 0 sau len ns
+
+#define URING_SETUP_SQPOLL    0x1   // Luồng kernel tự đọc vòng SQ: gửi không cần syscall
+#define URING_ENTER_SQ_WAKEUP 0x1
+#define URING_SQ_NEED_WAKEUP  0x1
+
+typedef struct {
+    uint8_t opcode;
+    uint8_t flags;
+    uint16_t reserved;
+    int32_t fd;
+    uint64_t addr;
+    uint64_t len;
+    uint64_t user_data;
+} uring_sqe_t;
+
+typedef struct {
+    uint64_t user_data;
+    int64_t res;
+} uring_cqe_t;
+
+typedef struct {
+    volatile uint32_t sq_head;
+    volatile uint32_t sq_tail;
+    uint32_t sq_entries;
+    uint32_t sqes_offset;
+    volatile uint32_t flags;
+    uint32_t reserved0[11];
+    volatile uint32_t cq_head;
+    volatile uint32_t cq_tail;
+    uint32_t cq_entries;
+    uint32_t cqes_offset;
+    volatile uint64_t cq_overflow;
+    uint32_t reserved1[10];
+} uring_shared_t;
+
+typedef struct {
+    uring_shared_t *shared;
+    uring_sqe_t *sqes;
+    uring_cqe_t *cqes;
+    uint32_t sqe_tail;      // SQE đã lấy nhưng chưa gửi nằm trong [shared->sq_tail, sqe_tail)
+    int sqpoll;
+} uring_t;
+
+// Syscall thô: trả về địa chỉ vòng / số SQE đã gửi, -1 nếu lỗi
+long uring_setup(unsigned entries, unsigned flags);
+long uring_enter(unsigned to_submit, unsigned min_complete, unsigned flags);
+
+// Tạo vòng với entries SQE (lũy thừa 2, tối đa 256), 0 nếu thành công
+int uring_init(uring_t *ring, unsigned entries, unsigned flags);
+// SQE trống kế tiếp, NULL nếu vòng SQ đầy
+uring_sqe_t *uring_get_sqe(uring_t *ring);
+// Công bố các SQE đã lấy và gửi (hoặc đánh thức luồng SQPOLL nếu nó đang ngủ)
+int uring_submit(uring_t *ring);
+// Chờ tới khi có ít nhất min_complete CQE chưa đọc
+int uring_wait(uring_t *ring, unsigned min_complete);
+// CQE chưa đọc cũ nhất, NULL nếu không có; uring_cqe_seen trả ô đó cho kernel
+uring_cqe_t *uring_peek_cqe(uring_t *ring);
+void uring_cqe_seen(uring_t *ring);
+
+// Bộ nhớ chia sẻ (khớp với shm.h). shm_map mở đối tượng tên name (tạo với size byte nếu
+// chưa có, size = 0 chỉ mở) và ánh xạ cả đối tượng; trả về địa chỉ hoặc (void *)-1.
+// Đối tượng còn sống tới khi tên bị shm_unlink và mọi ánh xạ bị gỡ
+#define SHM_NAME_MAX 32
+
+void *shm_map(const char *name, size_t size);
+int shm_unmap(void *addr);
+int shm_unlink(const char *name);
+
+// Chuyển trang không chép: page_send gỡ [addr, addr + len) (trang 4 KiB riêng, addr căn
+// trang) khỏi tiến trình gọi và ánh xạ chính các trang đó vào tiến trình pid. page_recv
+// chờ lần chuyển kế tiếp (không chờ với PAGE_RECV_NONBLOCK); gỡ bằng shm_unmap(msg.addr)
+#define PAGE_RECV_NONBLOCK 0x1
+
+typedef struct {
+    uint64_t addr;
+    uint64_t len;
+    uint64_t sender;
+} shm_msg_t;
+
+int page_send(pid_t pid, void *addr, size_t len);
+int page_recv(shm_msg_t *msg, unsigned int flags);
+
+// IPC đồng bộ (khớp với ipc.h): ipc_call gửi msg tới luồng tid và chờ trả lời, được ghi đè
+// vào msg (0, hoặc -1 nếu không có luồng đó hay nó kết thúc trước khi trả lời).
+// ipc_reply_wait trả lời msg cho caller reply_to (0: không trả lời ai), rồi chờ call kế tiếp
+// và trả về TID của caller đó. Thông điệp đi trong thanh ghi, không qua bộ nhớ
+#define IPC_MSG_WORDS 5
+
+int ipc_call(pid_t tid, uint64_t msg[IPC_MSG_WORDS]);
+long ipc_reply_wait(pid_t reply_to, uint64_t msg[IPC_MSG_WORDS]);
+
+// Đổi quyền của một key ngay trong user space bằng WRPKRU, không cần syscall
+static inline unsigned int pkey_read_pkru(void) {
+    unsigned int eax, edx;
+    asm volatile("rdpkru" : "=a"(eax), "=d"(edx) : "c"(0));
+    return eax;
+}
+
+static inline void pkey_set(int pkey, unsigned int access_rights) {
+    unsigned int pkru = pkey_read_pkru();
+    pkru &= ~(0x3u << (pkey * 2));
+    pkru |= (access_rights & 0x3u) << (pkey * 2);
+    asm volatile("wrpkru" : : "a"(pkru), "c"(0), "d"(0) : "memory");
+}
 
 #endif // SYSCALL_USER_H